@@ -1,22 +1,23 @@
 #version 330
 
-// Light inputs
-uniform vec2 light_position;
-uniform vec3 light_color;
-uniform float light_radius;
+// Lights binned into screen tiles on the CPU (see LightTileGrid)
+uniform samplerBuffer light_data;          // 3 texels per light, see RenderSystem::uploadLightTiles
+uniform usamplerBuffer tile_ranges;        // (first, count) per tile
+uniform usamplerBuffer tile_light_indices;
+uniform int tile_size;
+uniform int tiles_per_row;
+
 uniform vec2 screen_size;
-uniform float flicker_intensity;
 uniform float time;
 uniform sampler2D scene_texture;
 uniform sampler2D sdf_texture;
-uniform vec2 light_direction;
-uniform float cone_angle;
-uniform float light_height;
+// Pixels the camera moved since sdf_texture was generated, when it is reused from an earlier frame
+uniform vec2 sdf_offset;
 
 in vec2 texcoord;
 out vec4 fragColor;
 
-float calculateShadow(vec2 pixelPos, vec2 lightPos)
+float calculateShadow(vec2 pixelPos, vec2 lightPos, float light_height)
 {
     vec2 toLightDir = lightPos - pixelPos;
     float distToLight = length(toLightDir);
@@ -50,7 +51,7 @@ float calculateShadow(vec2 pixelPos, vec2 lightPos)
                 if (traveled >= dist) break;
 
                 vec2 testPos = samplePos + dir * traveled;
-                vec2 uv = testPos / screen_size;
+                vec2 uv = (testPos + sdf_offset) / screen_size;
                 uv.y = 1.0 - uv.y;
 
                 if (uv.x < 0.0 || uv.x > 1.0 || uv.y < 0.0 || uv.y > 1.0) {
@@ -87,16 +88,27 @@ float calculateShadow(vec2 pixelPos, vec2 lightPos)
     return mix(0.5, 1.0, visibility);
 }
 
-void main()
+// Contribution of one light; the old one-pass-per-light version added these up with GL_ONE blending
+vec3 shadeLight(int light, vec2 pixelPos, vec3 sceneColor, bool isEmpty)
 {
-    vec2 pixelPos = texcoord * screen_size;
-    pixelPos.y = screen_size.y - pixelPos.y;
+    vec4 position_radius_cone = texelFetch(light_data, 3 * light);
+    vec4 color_flicker = texelFetch(light_data, 3 * light + 1);
+    vec4 direction_height_shadows = texelFetch(light_data, 3 * light + 2);
+
+    vec2 light_position = position_radius_cone.xy;
+    float light_radius = position_radius_cone.z;
+    float cone_angle = position_radius_cone.w;
+    vec3 light_color = color_flicker.rgb;
+    float flicker_intensity = color_flicker.a;
+    vec2 light_direction = direction_height_shadows.xy;
+    float light_height = direction_height_shadows.z;
+    bool soft_shadows = direction_height_shadows.w > 0.5;
 
     vec2 toPixel = pixelPos - light_position;
     float dist = length(toPixel);
 
     if (dist > light_radius) {
-        discard;
+        return vec3(0.0);
     }
 
     float normalized = clamp(dist / light_radius, 0.0, 1.0);
@@ -117,18 +129,16 @@ void main()
         float innerCone = cone_angle * 0.8;
 
         if (angle > outerCone) {
-            // discard if outside cone
-            discard;
+            // nothing outside the cone
+            return vec3(0.0);
         }
 
         // Smooth edge
         coneFactor = 1.0 - smoothstep(innerCone, outerCone, angle);
     }
 
-    float shadow = calculateShadow(pixelPos, light_position);
-
-    vec4 sceneColor = texture(scene_texture, texcoord);
-    bool isEmpty = length(sceneColor.rgb) < 0.01;
+    // small lights (bullets) are not worth 16 shadow marches per pixel
+    float shadow = soft_shadows ? calculateShadow(pixelPos, light_position, light_height) : 1.0;
 
     // If there's flickering, randomly calculate and change flickering over time
     float flickerAmount = 1.0;
@@ -140,11 +150,30 @@ void main()
 
     float Factor = distFactor * coneFactor * flickerAmount * shadow * 0.6;
 
-    vec3 result;
     if (isEmpty) {
-        result = light_color * Factor;
-    } else {
-        result = sceneColor.rgb * light_color * Factor;
+        return light_color * Factor;
+    }
+    return sceneColor * light_color * Factor;
+}
+
+void main()
+{
+    vec2 pixelPos = texcoord * screen_size;
+    pixelPos.y = screen_size.y - pixelPos.y;
+
+    ivec2 tile = ivec2(pixelPos) / tile_size;
+    uvec2 range = texelFetch(tile_ranges, tile.y * tiles_per_row + tile.x).rg;
+    if (range.y == 0u) {
+        discard;
+    }
+
+    vec4 sceneColor = texture(scene_texture, texcoord);
+    bool isEmpty = length(sceneColor.rgb) < 0.01;
+
+    vec3 result = vec3(0.0);
+    for (uint i = 0u; i < range.y; i++) {
+        int light = int(texelFetch(tile_light_indices, int(range.x + i)).r);
+        result += shadeLight(light, pixelPos, sceneColor.rgb, isEmpty);
     }
 
     fragColor = vec4(result, 1.0);
@@ -6,11 +6,24 @@ in vec2 texcoord;
 out vec4 fragColor;
 
 uniform sampler2D scene_texture;
+// Scene pixels per SDF texel along each axis (the SDF resolution divisor)
+uniform int footprint;
 
 void main()
 {
-    vec4 scene = texture(scene_texture, texcoord);
-    bool hasScene = scene.a > 0.5;
+    // An SDF texel is an occluder if any scene pixel it covers is. The SDF target is rounded up
+    // to whole texels, so go through texcoord rather than assume footprint pixels per texel exactly
+    ivec2 scene_size = textureSize(scene_texture, 0);
+    ivec2 first = max(ivec2(texcoord * vec2(scene_size)) - footprint / 2, ivec2(0));
+    bool hasScene = false;
+    for (int y = 0; y < footprint; ++y)
+    {
+        for (int x = 0; x < footprint; ++x)
+        {
+            ivec2 pixel = min(first + ivec2(x, y), scene_size - 1);
+            hasScene = hasScene || texelFetch(scene_texture, pixel, 0).a > 0.5;
+        }
+    }
 
     if (hasScene)
     {
@@ -0,0 +1,22 @@
+#version 330
+
+// From vertex shader
+in vec2 texcoord;
+flat in int is_hurt;
+
+// Application data
+uniform sampler2D sampler0;
+
+// Output color
+layout(location = 0) out  vec4 color;
+
+void main()
+{
+	vec4 tex = texture(sampler0, texcoord);
+
+	if (is_hurt != 0) {
+		color = vec4(1.0, 0.2, 0.2, tex.a);
+	} else {
+		color = vec4(tex.rgb, tex.a);
+	}
+}
\ No newline at end of file
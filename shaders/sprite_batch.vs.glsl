@@ -0,0 +1,43 @@
+#version 330
+
+// Input attributes
+in vec3 in_position;
+in vec2 in_texcoord;
+
+// Per-instance attributes, see SpriteInstance
+in vec3 instance_transform_0;
+in vec3 instance_transform_1;
+in vec3 instance_transform_2;
+in vec4 instance_frame; // curr_frame, total_frame, curr_row, total_row
+in vec2 instance_flags; // should_flip, is_hurt
+in vec4 instance_uv_rect; // atlas page offset in xy, scale in zw
+
+// Passed to fragment shader
+out vec2 texcoord;
+flat out int is_hurt;
+
+// Application data
+uniform mat3 projection;
+
+void main()
+{
+	// same sprite sheet lookup as the textured shader
+	float frameWidth = 1.0f / instance_frame.y;
+	float frameHeight = 1.0f / instance_frame.w;
+
+	float u = in_texcoord.x;
+	float v = in_texcoord.y;
+
+	if (instance_flags.x > 0.5f){
+		u = 1.0f - u;
+	}
+
+	texcoord.x = (instance_frame.x + u) * frameWidth;
+	texcoord.y = (instance_frame.z + v) * frameHeight;
+	texcoord = instance_uv_rect.xy + texcoord * instance_uv_rect.zw;
+	is_hurt = instance_flags.y > 0.5f ? 1 : 0;
+
+	mat3 transform = mat3(instance_transform_0, instance_transform_1, instance_transform_2);
+	vec3 pos = projection * transform * vec3(in_position.xy, 1.0);
+	gl_Position = vec4(pos.xy, in_position.z, 1.0);
+}
\ No newline at end of file
@@ -15,6 +15,7 @@ uniform int curr_frame;
 uniform int total_row;
 uniform int curr_row;
 uniform bool should_flip;
+uniform vec4 uv_rect = vec4(0.0, 0.0, 1.0, 1.0); // atlas page offset in xy, scale in zw
 uniform vec2 camera_offset; // For background scrolling effect
 
 void main()
@@ -31,6 +32,7 @@ void main()
 
 	texcoord.x = (float(curr_frame) + u) * frameWidth;
 	texcoord.y = (float(curr_row) + v) * frameHeight;
+	texcoord = uv_rect.xy + texcoord * uv_rect.zw;
 
 	// Apply camera offset for background scrolling (only affects background quad with large UV values)
 	// camera_offset will be (0,0) for non-background entities
@@ -2,6 +2,8 @@
 #include "ai_system.hpp"
 #include "world_init.hpp"
 #include "audio_system.hpp"
+#include "boss_system.hpp"
+#include <array>
 #include <iostream>
 
 #ifndef M_PI_2
@@ -23,15 +25,108 @@ void AISystem::step(float elapsed_ms)
 	trailStep(step_seconds);
 }
 
+static std::array<EnemyAnimationDef, (size_t)EnemyAnimation::ANIMATION_COUNT> make_enemy_animations()
+{
+	std::array<EnemyAnimationDef, (size_t)EnemyAnimation::ANIMATION_COUNT> table;
+
+	EnemyAnimationDef& minion = table[(size_t)EnemyAnimation::MINION];
+	minion.shocks_swarm = true;
+
+	EnemyAnimationDef& slime = table[(size_t)EnemyAnimation::SLIME];
+	slime.death = DeathCurve::SPRITE_ROW;
+	slime.death_row = 1;
+	slime.death_length = 6.f;
+
+	EnemyAnimationDef& plant = table[(size_t)EnemyAnimation::EVIL_PLANT];
+	plant.hurt = HurtCurve::SPRITE_SHEET;
+	plant.death = DeathCurve::SPRITE_SHEET;
+	plant.idle_texture = TEXTURE_ASSET_ID::PLANT_IDLE_1;
+	plant.hurt_texture = TEXTURE_ASSET_ID::PLANT_HURT_1;
+	plant.death_texture = TEXTURE_ASSET_ID::PLANT_DEATH_1;
+	plant.variant_stride = (int)TEXTURE_ASSET_ID::PLANT_IDLE_2 - (int)TEXTURE_ASSET_ID::PLANT_IDLE_1;
+	plant.sheet_rows = 4;
+	plant.idle_frames = 4;
+	plant.idle_speed = 10.f;
+	plant.hurt_frames = 5;
+	plant.hurt_speed = 25.f;
+	plant.death_frames = 10;
+	plant.death_length = 9.f;
+
+	return table;
+}
+
+static const std::array<EnemyAnimationDef, (size_t)EnemyAnimation::ANIMATION_COUNT> enemy_animations = make_enemy_animations();
+
+static TEXTURE_ASSET_ID variant_texture(TEXTURE_ASSET_ID texture, const EnemyAnimationDef& anim, const Enemy& enemy)
+{
+	return static_cast<TEXTURE_ASSET_ID>(static_cast<int>(texture) + anim.variant_stride * enemy.variant);
+}
+
+static void set_sheet(Entity entity, TEXTURE_ASSET_ID texture, int rows, int frames)
+{
+	registry.renderRequests.get(entity).used_texture = texture;
+	Sprite& sprite = registry.sprites.get(entity);
+	sprite.total_row = rows;
+	sprite.total_frame = frames;
+	sprite.curr_frame = 0;
+	sprite.step_seconds_acc = 0.0f;
+}
+
+static void hurt_step(Entity entity, Enemy& enemy, const EnemyAnimationDef& anim)
+{
+	const TEXTURE_ASSET_ID hurt_texture = variant_texture(anim.hurt_texture, anim, enemy);
+	if (registry.renderRequests.get(entity).used_texture != hurt_texture) {
+		set_sheet(entity, hurt_texture, anim.sheet_rows, anim.hurt_frames);
+		registry.sprites.get(entity).animation_speed = anim.hurt_speed;
+	}
+
+	if (registry.sprites.get(entity).step_seconds_acc > anim.hurt_frames - 1)
+		enemy.is_hurt = false;
+
+	if (!enemy.is_hurt) {
+		set_sheet(entity, variant_texture(anim.idle_texture, anim, enemy), anim.sheet_rows, anim.idle_frames);
+		registry.sprites.get(entity).animation_speed = anim.idle_speed;
+	}
+}
+
+static void start_death(Entity entity, const Enemy& enemy, const EnemyAnimationDef& anim)
+{
+	if (anim.death == DeathCurve::SPRITE_ROW) {
+		Sprite& sprite = registry.sprites.get(entity);
+		sprite.curr_row = anim.death_row;
+		sprite.curr_frame = 0;
+		sprite.step_seconds_acc = 0.0f;
+	} else if (anim.death == DeathCurve::SPRITE_SHEET) {
+		set_sheet(entity, variant_texture(anim.death_texture, anim, enemy), anim.sheet_rows, anim.death_frames);
+	}
+}
+
+// Returns true once the death animation has finished
+static bool death_step(Entity entity, const EnemyAnimationDef& anim, float step_seconds)
+{
+	if (anim.death != DeathCurve::SHRINK)
+		return registry.sprites.get(entity).step_seconds_acc > anim.death_length;
+
+	Motion& motion = registry.motions.get(entity);
+	if (anim.shocks_swarm)
+		boss::onMinionDeath(motion.position);
+
+	motion.angle += anim.spin_speed * step_seconds;
+	motion.velocity = {0.0f, 0.0f};
+	motion.scale -= glm::vec2(anim.shrink_speed) * step_seconds;
+	return motion.scale.x < 0.f || motion.scale.y < 0.f;
+}
+
 void AISystem::enemyStep(float step_seconds)
 {
 	auto& enemy_registry = registry.enemies;
-	
+	finished_enemies.clear();
+
 	for(uint i = 0; i< enemy_registry.size(); i++) {
 		Entity entity = enemy_registry.entities[i];
-		Enemy& enemy = registry.enemies.get(entity);
-		Motion& motion = registry.motions.get(entity);
-		
+		Enemy& enemy = enemy_registry.components[i];
+		const EnemyAnimationDef& anim = enemy_animations[(size_t)enemy.animation];
+
 		// Update healthbar visibility timer (decrease over time)
 		if (enemy.healthbar_visibility_timer > 0.0f) {
 			enemy.healthbar_visibility_timer -= step_seconds;
@@ -48,10 +143,8 @@ void AISystem::enemyStep(float step_seconds)
 					enemy.hurt_timer = 0.f;
 			}
 			
-			if(enemy.hurt_animation == NULL) {
-			} else {
-				enemy.hurt_animation(entity, step_seconds);
-			}
+			if (anim.hurt == HurtCurve::SPRITE_SHEET)
+				hurt_step(entity, enemy, anim);
 		}
 
 		if (enemy.is_dead) {
@@ -69,27 +162,18 @@ void AISystem::enemyStep(float step_seconds)
 				if (registry.colliders.has(entity)) {
 					registry.colliders.remove(entity);
 				}
-			}
 
-			if(enemy.death_animation == NULL) {
-				motion.angle += 3 * M_PI * step_seconds;
-				motion.velocity = {0.0f, 0.0f};
-				motion.scale -= glm::vec2(30.0f) * step_seconds;
-
-				if (motion.scale.x < 0.f || motion.scale.y < 0.f) {
-					registry.remove_all_components_of(entity);
-				}
-			} else {
-				enemy.death_animation(entity, step_seconds);
+				start_death(entity, enemy, anim);
 			}
 
-		} else {
-			//glm::vec2 diff = player_motion.position - motion.position;
-			//motion.angle = atan2(diff.y, diff.x);
-			//motion.velocity = glm::normalize(diff) * 50.f;
-
+			if (death_step(entity, anim, step_seconds))
+				finished_enemies.push_back(entity);
 		}
 	}
+
+	// removing inside the loop would swap the last enemy into this slot and skip it for a step
+	for (Entity entity : finished_enemies)
+		registry.remove_all_components_of(entity);
 }
 
 // Functiton for stationaryEnemies (evil plants)
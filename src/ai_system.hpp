@@ -9,6 +9,45 @@
 
 class AudioSystem;
 
+// How an enemy's hurt animation plays
+enum class HurtCurve {
+	NONE,          // no hurt animation; is_hurt just times out
+	SPRITE_SHEET   // swap to the hurt sheet, then back to the idle sheet once it has played
+};
+
+// How an enemy's death animation plays before it is removed
+enum class DeathCurve {
+	SHRINK,        // spin and shrink until the scale reaches zero
+	SPRITE_ROW,    // play a row of the current sheet
+	SPRITE_SHEET   // swap to the death sheet and play it
+};
+
+// One row of the enemy animation table, indexed by EnemyAnimation.
+// Sheet textures are offset by variant_stride for every Enemy::variant.
+struct EnemyAnimationDef {
+	HurtCurve hurt = HurtCurve::NONE;
+	DeathCurve death = DeathCurve::SHRINK;
+
+	// SHRINK
+	float spin_speed = 3.f * M_PI;   // rad/s
+	float shrink_speed = 30.f;       // px/s on each axis
+	bool shocks_swarm = false;       // pushes the boss minion swarm away every dying step
+
+	// sprite sheets
+	TEXTURE_ASSET_ID idle_texture = TEXTURE_ASSET_ID::TEXTURE_COUNT;
+	TEXTURE_ASSET_ID hurt_texture = TEXTURE_ASSET_ID::TEXTURE_COUNT;
+	TEXTURE_ASSET_ID death_texture = TEXTURE_ASSET_ID::TEXTURE_COUNT;
+	int variant_stride = 0;
+	int sheet_rows = 1;
+	int idle_frames = 1;
+	float idle_speed = 10.f;         // frames/s
+	int hurt_frames = 1;
+	float hurt_speed = 10.f;
+	int death_row = 0;               // SPRITE_ROW
+	int death_frames = 1;            // SPRITE_SHEET
+	float death_length = 1.f;        // frames played before the enemy is removed
+};
+
 class AISystem
 {
 public:
@@ -21,14 +60,18 @@ public:
 	AISystem()
 	{
 	}
-private:
+	// Hurt and death animations of every enemy, evaluated from the animation table.
+	// Public so the enemy benchmark can time it on its own.
 	void enemyStep(float step_seconds);
+
+private:
 	void stationaryEnemyStep(float step_seconds);
 	void spriteStep(float step_seconds);
 	void dropStep(float step_seconds);
 	void trailStep(float step_seconds);
 
 	std::function<void()> on_enemy_killed;
+	std::vector<Entity> finished_enemies;  // death animations done this step, removed after the loop
 
 	RenderSystem* renderer;
 	AudioSystem* audio_system;
@@ -0,0 +1,1811 @@
+// internal
+#include "benchmark_system.hpp"
+#include "ai_system.hpp"
+#include "noise_gen.hpp"
+#include "boid_swarm.hpp"
+#include "chunk_mesh.hpp"
+#include "chunk_region_store.hpp"
+#include "light_tiles.hpp"
+#include "particle_pool.hpp"
+#include "physics_system.hpp"
+#include "save_stream.hpp"
+#include "save_system.hpp"
+#include "shadow_sdf.hpp"
+#include "sprite_batch.hpp"
+#include "texture_atlas.hpp"
+#include "steering_system.hpp"
+#include "texture_loader.hpp"
+#include "pathfinding_system.hpp"
+#include "tiny_ecs_registry.hpp"
+#include "world_cells.hpp"
+#include "world_init.hpp"
+
+// stlib
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <stb_image.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#define MKDIR(path) _mkdir(path)
+#define RMDIR(path) _rmdir(path)
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#define MKDIR(path) mkdir(path, 0755)
+#define RMDIR(path) rmdir(path)
+#endif
+
+using Clock = std::chrono::high_resolution_clock;
+
+namespace benchmark {
+
+static float elapsed_ms_since(Clock::time_point start)
+{
+	return (float)(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start)).count() / 1000;
+}
+
+bool run(const std::string& name)
+{
+	bool all = name == "all";
+	bool found = false;
+	if (all || name == "physics") { physics_broadphase(); found = true; }
+	if (all || name == "ecs") { ecs_storage(); found = true; }
+	if (all || name == "pathfinding") { pathfinding_field(); found = true; }
+	if (all || name == "cells") { world_cell_probes(); found = true; }
+	if (all || name == "noise") { noise_throughput(); found = true; }
+	if (all || name == "sprites") { sprite_batching(); found = true; }
+	if (all || name == "lights") { light_tiling(); found = true; }
+	if (all || name == "particles") { particle_churn(); found = true; }
+	if (all || name == "swarm") { minion_swarm(); found = true; }
+	if (all || name == "horde") { horde_soak(); found = true; }
+	if (all || name == "enemies") { enemy_animation_step(); found = true; }
+	if (all || name == "save") { save_round_trip(); found = true; }
+	if (all || name == "regions") { region_paging(); found = true; }
+	if (all || name == "textures") { texture_decode(); found = true; }
+	if (all || name == "atlas") { atlas_packing(); found = true; }
+	if (all || name == "isolines") { isoline_baking(); found = true; }
+	if (all || name == "sdf") { shadow_sdf_options(); found = true; }
+
+	if (!found)
+		printf("Unknown benchmark '%s'. Available: all, physics, ecs, pathfinding, cells, noise, sprites, lights, particles, swarm, horde, enemies, save, regions, textures, atlas, isolines, sdf\n", name.c_str());
+	return found;
+}
+
+void physics_broadphase()
+{
+	const int COLLIDER_COUNT = 5000;
+	const int STEP_COUNT = 10;
+	const float ARENA_SIZE = 4000.f;
+	const float STEP_MS = 1000.f / 60.f;
+
+	registry.clear_all_components();
+	std::mt19937 rng(427);
+	std::uniform_real_distribution<float> pos_dist(-ARENA_SIZE / 2.f, ARENA_SIZE / 2.f);
+	std::uniform_real_distribution<float> vel_dist(-150.f, 150.f);
+
+	// a player, a crowd of enemies and a cloud of player and enemy bullets
+	for (int i = 0; i < COLLIDER_COUNT; i++) {
+		Entity e;
+		Motion& motion = registry.motions.emplace(e);
+		motion.position = { pos_dist(rng), pos_dist(rng) };
+		motion.velocity = { vel_dist(rng), vel_dist(rng) };
+		if (i == 0) {
+			motion.scale = { 40.f, 40.f };
+			registry.players.emplace(e);
+			registry.collisionCircles.emplace(e).radius = 14.f;
+		} else if (i % 3 == 0) {
+			motion.scale = { 8.f, 8.f };
+			registry.bullets.emplace(e);
+			registry.collisionCircles.emplace(e).radius = 4.f;
+			if (i % 2 == 0)
+				registry.deadlies.emplace(e);
+		} else {
+			motion.scale = { 40.f, 40.f };
+			registry.enemies.emplace(e);
+			registry.collisionCircles.emplace(e).radius = 16.f;
+		}
+	}
+
+	std::vector<Motion> initial_motions = registry.motions.components;
+
+	PhysicsSystem physics;
+	std::vector<std::pair<unsigned int, unsigned int>> collisions[2];
+	std::vector<Motion> final_motions[2];
+	float total_ms[2] = { 0.f, 0.f };
+	for (int path = 0; path < 2; path++) {
+		physics.use_broadphase = path == 1;
+		registry.motions.components = initial_motions;
+		for (int s = 0; s < STEP_COUNT; s++) {
+			registry.collisions.clear();
+			auto start = Clock::now();
+			physics.step(STEP_MS);
+			total_ms[path] += elapsed_ms_since(start);
+		}
+		for (uint i = 0; i < registry.collisions.size(); i++)
+			collisions[path].push_back({ registry.collisions.entities[i], registry.collisions.components[i].other });
+		final_motions[path] = registry.motions.components;
+	}
+
+	int position_mismatches = 0;
+	for (size_t i = 0; i < initial_motions.size(); i++)
+		if (final_motions[0][i].position != final_motions[1][i].position)
+			position_mismatches++;
+
+	printf("[physics] %d colliders, %d steps\n", COLLIDER_COUNT, STEP_COUNT);
+	printf("  all-pairs:   %8.3f ms/step\n", total_ms[0] / STEP_COUNT);
+	printf("  broadphase:  %8.3f ms/step\n", total_ms[1] / STEP_COUNT);
+	printf("  collisions (last step): %zu vs %zu, identical: %s; position mismatches: %d\n",
+		collisions[0].size(), collisions[1].size(), collisions[0] == collisions[1] ? "yes" : "no", position_mismatches);
+
+	registry.collisions.clear();
+	while (registry.motions.entities.size() > 0)
+		registry.remove_all_components_of(registry.motions.entities.back());
+}
+
+struct StorageTimings
+{
+	float insert_ms = 0.f;
+	float lookup_ms = 0.f;
+	float iterate_ms = 0.f;
+	float remove_ms = 0.f;
+	float checksum = 0.f; // keeps the optimizer from dropping the loops
+};
+
+template <typename Index>
+static StorageTimings time_component_container(const std::vector<Entity>& entities, const std::vector<Entity>& shuffled)
+{
+	const int LOOKUP_ROUNDS = 10;
+	StorageTimings timings;
+	ComponentContainer<Motion, Index> container;
+
+	auto start = Clock::now();
+	for (Entity e : entities)
+		container.emplace(e).position = { 1.f, 2.f };
+	timings.insert_ms = elapsed_ms_since(start);
+
+	// random-order has() + get(), as systems do when probing other containers
+	start = Clock::now();
+	for (int r = 0; r < LOOKUP_ROUNDS; r++)
+		for (Entity e : shuffled)
+			if (container.has(e))
+				timings.checksum += container.get(e).position.x;
+	timings.lookup_ms = elapsed_ms_since(start) / LOOKUP_ROUNDS;
+
+	// walk the entity list and fetch each component through the index
+	start = Clock::now();
+	for (int r = 0; r < LOOKUP_ROUNDS; r++)
+		for (Entity e : container.entities)
+			timings.checksum += container.get(e).position.y;
+	timings.iterate_ms = elapsed_ms_since(start) / LOOKUP_ROUNDS;
+
+	start = Clock::now();
+	for (Entity e : shuffled)
+		container.remove(e);
+	timings.remove_ms = elapsed_ms_since(start);
+	return timings;
+}
+
+void ecs_storage()
+{
+	const int SIZES[] = { 1000, 10000, 100000 };
+	std::mt19937 rng(427);
+
+	printf("[ecs] ComponentContainer<Motion>, times in ms (lookup/iterate are per pass)\n");
+	printf("  %8s %-8s %10s %10s %10s %10s\n", "entities", "index", "insert", "lookup", "iterate", "remove");
+	for (int size : SIZES) {
+		std::vector<Entity> entities(size);
+		std::vector<Entity> shuffled = entities;
+		std::shuffle(shuffled.begin(), shuffled.end(), rng);
+
+		StorageTimings hash_map = time_component_container<HashMapEntityIndex>(entities, shuffled);
+		StorageTimings sparse = time_component_container<PagedSparseEntityIndex>(entities, shuffled);
+		printf("  %8d %-8s %10.3f %10.3f %10.3f %10.3f\n", size, "hash", hash_map.insert_ms, hash_map.lookup_ms, hash_map.iterate_ms, hash_map.remove_ms);
+		printf("  %8d %-8s %10.3f %10.3f %10.3f %10.3f\n", size, "sparse", sparse.insert_ms, sparse.lookup_ms, sparse.iterate_ms, sparse.remove_ms);
+		if (hash_map.checksum != sparse.checksum)
+			printf("  warning: backends disagree (%f vs %f)\n", hash_map.checksum, sparse.checksum);
+
+		for (Entity e : entities)
+			Entity::release(e);
+	}
+}
+
+// Fills the chunks in [min_chunk, max_chunk]^2 with scattered obstacle cells
+static void create_random_chunks(int min_chunk, int max_chunk, float obstacle_ratio, std::mt19937& rng)
+{
+	std::uniform_real_distribution<float> dist(0.f, 1.f);
+	for (int cy = min_chunk; cy <= max_chunk; cy++) {
+		for (int cx = min_chunk; cx <= max_chunk; cx++) {
+			Chunk& chunk = registry.chunks.emplace(cx, cy);
+			for (auto& column : chunk.cell_states)
+				for (auto& cell : column)
+					if (dist(rng) < obstacle_ratio)
+						cell = CHUNK_CELL_STATE::OBSTACLE;
+		}
+	}
+}
+
+void pathfinding_field()
+{
+	const int RADII[] = { 16, 32, 64, 128 };
+	const int REPS = 20;
+
+	registry.clear_all_components();
+	std::mt19937 rng(427);
+	create_random_chunks(4, 12, 0.15f, rng);
+
+	Entity player;
+	registry.players.emplace(player);
+	Motion& player_motion = registry.motions.emplace(player);
+	const vec2 start = vec2(8 * CHUNK_CELLS_PER_ROW + 32) * (float)CHUNK_CELL_SIZE;
+
+	printf("[pathfinding] flow field update, ms per step\n");
+	printf("  %6s %8s %10s %12s %10s\n", "radius", "cells", "rebuild", "incremental", "cached");
+	for (int radius : RADII) {
+		PathfindingSystem pathfinding(radius);
+		player_motion.position = start;
+		pathfinding.step(0.f);
+
+		float rebuild_ms = 0.f;
+		for (int r = 0; r < REPS; r++) {
+			pathfinding.invalidate();
+			auto t = Clock::now();
+			pathfinding.step(0.f);
+			rebuild_ms += elapsed_ms_since(t);
+		}
+
+		// walk back and forth one cell at a time
+		float incremental_ms = 0.f;
+		for (int r = 0; r < REPS; r++) {
+			player_motion.position.x += (r % 2 == 0 ? 1.f : -1.f) * CHUNK_CELL_SIZE;
+			auto t = Clock::now();
+			pathfinding.step(0.f);
+			incremental_ms += elapsed_ms_since(t);
+		}
+
+		float cached_ms = 0.f;
+		for (int r = 0; r < REPS; r++) {
+			auto t = Clock::now();
+			pathfinding.step(0.f);
+			cached_ms += elapsed_ms_since(t);
+		}
+
+		int side = radius * 2 + 1;
+		printf("  %6d %8d %10.3f %12.3f %10.3f\n", radius, side * side, rebuild_ms / REPS, incremental_ms / REPS, cached_ms / REPS);
+	}
+
+	registry.remove_all_components_of(player);
+	registry.chunks.clear();
+}
+
+// The lookup systems did per probe before WorldCellQuery: a positional hash lookup every time
+static CHUNK_CELL_STATE probe_uncached(glm::ivec2 cell)
+{
+	glm::ivec2 chunk = chunk_of_cell(cell);
+	if (!registry.chunks.has((short)chunk.x, (short)chunk.y))
+		return CHUNK_CELL_STATE::EMPTY;
+	glm::ivec2 local = local_cell(cell);
+	return registry.chunks.get((short)chunk.x, (short)chunk.y).cell_states[local.x][local.y];
+}
+
+void world_cell_probes()
+{
+	const int MIN_CHUNK = -4, MAX_CHUNK = 3;
+	const int RAY_COUNT = 200000;
+	const int RAY_LENGTH = 5; // as in the steering obstacle probes
+	const int WINDOW_RADIUS = 64;
+	const int WINDOW_COUNT = 50;
+	const int WINDOW_SIDE = WINDOW_RADIUS * 2 + 1;
+	const glm::ivec2 DIRS[] = { { 1, 0 }, { 1, 1 }, { 0, 1 }, { -1, 1 }, { -1, 0 }, { -1, -1 }, { 0, -1 }, { 1, -1 } };
+
+	registry.clear_all_components();
+	std::mt19937 rng(427);
+	create_random_chunks(MIN_CHUNK, MAX_CHUNK, 0.15f, rng);
+
+	// origins spread over the loaded area, with some rays and windows running past its edge
+	std::uniform_int_distribution<int> cell_dist(MIN_CHUNK * (int)CHUNK_CELLS_PER_ROW, (MAX_CHUNK + 1) * (int)CHUNK_CELLS_PER_ROW - 1);
+	std::uniform_int_distribution<int> dir_dist(0, 7);
+	std::vector<std::pair<glm::ivec2, glm::ivec2>> rays(RAY_COUNT);
+	for (auto& ray : rays)
+		ray = { { cell_dist(rng), cell_dist(rng) }, DIRS[dir_dist(rng)] };
+	std::vector<glm::ivec2> windows(WINDOW_COUNT);
+	for (auto& center : windows)
+		center = { cell_dist(rng), cell_dist(rng) };
+
+	WorldCellQuery query;
+	std::vector<CHUNK_CELL_STATE> window_cells(WINDOW_SIDE * WINDOW_SIDE);
+	int hits[5] = { 0, 0, 0, 0, 0 };
+	float ms[5];
+
+	auto start = Clock::now();
+	for (const auto& ray : rays)
+		for (int i = 1; i <= RAY_LENGTH; i++)
+			hits[0] += probe_uncached(ray.first + ray.second * i) == CHUNK_CELL_STATE::OBSTACLE;
+	ms[0] = elapsed_ms_since(start);
+
+	start = Clock::now();
+	for (const auto& ray : rays)
+		for (int i = 1; i <= RAY_LENGTH; i++)
+			hits[1] += query.get(ray.first + ray.second * i) == CHUNK_CELL_STATE::OBSTACLE;
+	ms[1] = elapsed_ms_since(start);
+
+	start = Clock::now();
+	for (glm::ivec2 center : windows)
+		for (int y = -WINDOW_RADIUS; y <= WINDOW_RADIUS; y++)
+			for (int x = -WINDOW_RADIUS; x <= WINDOW_RADIUS; x++)
+				hits[2] += probe_uncached(center + glm::ivec2(x, y)) == CHUNK_CELL_STATE::OBSTACLE;
+	ms[2] = elapsed_ms_since(start);
+
+	start = Clock::now();
+	for (glm::ivec2 center : windows)
+		for (int y = -WINDOW_RADIUS; y <= WINDOW_RADIUS; y++)
+			for (int x = -WINDOW_RADIUS; x <= WINDOW_RADIUS; x++)
+				hits[3] += query.get(center + glm::ivec2(x, y)) == CHUNK_CELL_STATE::OBSTACLE;
+	ms[3] = elapsed_ms_since(start);
+
+	start = Clock::now();
+	for (glm::ivec2 center : windows) {
+		query.fetch_rect(center - WINDOW_RADIUS, WINDOW_SIDE, WINDOW_SIDE, window_cells.data());
+		for (CHUNK_CELL_STATE state : window_cells)
+			hits[4] += state == CHUNK_CELL_STATE::OBSTACLE;
+	}
+	ms[4] = elapsed_ms_since(start);
+
+	// million probes per second
+	auto rate = [](int probes, float elapsed_ms) { return elapsed_ms > 0.f ? probes / (elapsed_ms * 1000.f) : 0.f; };
+	const int ray_probes = RAY_COUNT * RAY_LENGTH;
+	const int window_probes = WINDOW_COUNT * WINDOW_SIDE * WINDOW_SIDE;
+
+	printf("[cells] chunk cell probes over %d chunks, million probes/s\n", (MAX_CHUNK - MIN_CHUNK + 1) * (MAX_CHUNK - MIN_CHUNK + 1));
+	printf("  %-20s %10s %10s %10s\n", "pattern", "uncached", "cached", "rect");
+	printf("  %-20s %10.1f %10.1f %10s\n", "5-cell rays", rate(ray_probes, ms[0]), rate(ray_probes, ms[1]), "-");
+	printf("  %-20s %10.1f %10.1f %10.1f\n", "129x129 windows", rate(window_probes, ms[2]), rate(window_probes, ms[3]), rate(window_probes, ms[4]));
+	printf("  results match: %s\n", (hits[0] == hits[1] && hits[2] == hits[3] && hits[3] == hits[4]) ? "yes" : "no");
+
+	registry.chunks.clear();
+}
+
+void noise_throughput()
+{
+	const int SAMPLE_COUNT = 1 << 20;
+	const int GRID_SIDE = 1024;
+	const int CHUNK_COUNT = 64;
+	const float SPREAD = 300.f; // in noise units, like a few hundred chunks of map noise
+
+	PerlinNoiseGenerator noise;
+	noise.init(427);
+	std::mt19937 rng(427);
+	std::uniform_real_distribution<float> coord_dist(-SPREAD, SPREAD);
+	std::vector<float> xs(SAMPLE_COUNT), ys(SAMPLE_COUNT);
+	for (int i = 0; i < SAMPLE_COUNT; i++) {
+		xs[i] = coord_dist(rng);
+		ys[i] = coord_dist(rng);
+	}
+	std::vector<float> grid_xs(GRID_SIDE), grid_ys(GRID_SIDE);
+	for (int i = 0; i < GRID_SIDE; i++) {
+		grid_xs[i] = -SPREAD + i * 0.37f;
+		grid_ys[i] = -SPREAD + i * 0.29f;
+	}
+
+	std::vector<float> scalar_out(SAMPLE_COUNT), batch_out(SAMPLE_COUNT), grid_out(GRID_SIDE * GRID_SIDE);
+	float ms[4];
+
+	auto start = Clock::now();
+	for (int i = 0; i < SAMPLE_COUNT; i++)
+		scalar_out[i] = noise.noise(xs[i], ys[i]);
+	ms[0] = elapsed_ms_since(start);
+
+	start = Clock::now();
+	noise.noise_batch(xs.data(), ys.data(), batch_out.data(), SAMPLE_COUNT);
+	ms[1] = elapsed_ms_since(start);
+
+	start = Clock::now();
+	noise.noise_grid(grid_xs.data(), GRID_SIDE, grid_ys.data(), GRID_SIDE, grid_out.data());
+	ms[2] = elapsed_ms_since(start);
+
+	// every result must match noise() bit for bit
+	int mismatches = 0;
+	for (int i = 0; i < SAMPLE_COUNT; i++)
+		mismatches += std::memcmp(&scalar_out[i], &batch_out[i], sizeof(float)) != 0;
+	for (int j = 0; j < GRID_SIDE; j++) {
+		for (int i = 0; i < GRID_SIDE; i++) {
+			float expected = noise.noise(grid_xs[i], grid_ys[j]);
+			mismatches += std::memcmp(&expected, &grid_out[j * GRID_SIDE + i], sizeof(float)) != 0;
+		}
+	}
+
+	int no_obstacle_cells = 0;
+	start = Clock::now();
+	for (int c = 0; c < CHUNK_COUNT; c++) {
+		ChunkCellGrid cells = generateChunkCells(vec2(c % 8 - 4, c / 8 - 4), noise);
+		for (const auto& column : cells)
+			for (CHUNK_CELL_STATE state : column)
+				no_obstacle_cells += state == CHUNK_CELL_STATE::NO_OBSTACLE_AREA;
+	}
+	ms[3] = elapsed_ms_since(start);
+
+	// million samples per second
+	auto rate = [](int samples, float elapsed_ms) { return elapsed_ms > 0.f ? samples / (elapsed_ms * 1000.f) : 0.f; };
+#if defined(__AVX2__)
+	const char* lanes = "AVX2";
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	const char* lanes = "SSE2";
+#else
+	const char* lanes = "scalar";
+#endif
+
+	printf("[noise] 4-octave Perlin noise, million samples/s (%s lanes)\n", lanes);
+	printf("  %-20s %10.1f\n", "noise()", rate(SAMPLE_COUNT, ms[0]));
+	printf("  %-20s %10.1f\n", "noise_batch", rate(SAMPLE_COUNT, ms[1]));
+	printf("  %-20s %10.1f\n", "noise_grid", rate(GRID_SIDE * GRID_SIDE, ms[2]));
+	printf("  bitwise mismatches vs. noise(): %d\n", mismatches);
+	printf("  generateChunkCells: %.3f ms/chunk (%d no-obstacle cells)\n", ms[3] / CHUNK_COUNT, no_obstacle_cells);
+}
+
+// Checks that every pair of overlapping boxes with different keys is drawn in submission order.
+// frame.x of each instance holds its submission index.
+static bool batches_keep_overlap_order(const SpriteBatchBuilder& builder, const std::vector<SpriteBatchKey>& keys,
+	const std::vector<glm::vec2>& centers, const std::vector<glm::vec2>& half_extents)
+{
+	std::vector<int> drawn_at(keys.size(), -1);
+	int position = 0;
+	for (const SpriteBatch& batch : builder.batches())
+		for (unsigned int i = batch.first; i < batch.first + batch.count; i++)
+			drawn_at[(size_t)builder.instances()[i].frame.x] = position++;
+
+	for (size_t a = 0; a < keys.size(); a++) {
+		for (size_t b = a + 1; b < keys.size(); b++) {
+			glm::vec2 gap = abs(centers[a] - centers[b]) - half_extents[a] - half_extents[b];
+			bool overlap = gap.x < 0.f && gap.y < 0.f;
+			if (overlap && drawn_at[a] > drawn_at[b])
+				return false;
+		}
+	}
+	return true;
+}
+
+void sprite_batching()
+{
+	const int SPRITE_COUNTS[] = { 500, 2000, 10000 };
+	const int REPEATS = 20;
+	const glm::vec2 VIEW_SIZE = { 1920.f, 1080.f };
+	// the textures a typical screen mixes: enemies, trees, rocks, pickups and the boss
+	const TEXTURE_ASSET_ID TEXTURES[] = {
+		TEXTURE_ASSET_ID::SLIME_1, TEXTURE_ASSET_ID::SLIME_2, TEXTURE_ASSET_ID::SLIME_3,
+		TEXTURE_ASSET_ID::PLANT_IDLE_1, TEXTURE_ASSET_ID::TREE, TEXTURE_ASSET_ID::WALL,
+		TEXTURE_ASSET_ID::FIRST_AID, TEXTURE_ASSET_ID::XYLARITE,
+	};
+	const int TEXTURE_KINDS = sizeof(TEXTURES) / sizeof(TEXTURES[0]);
+
+	printf("[sprites] scene sprites on a %.0fx%.0f view, draw calls and batch build time\n", VIEW_SIZE.x, VIEW_SIZE.y);
+	printf("  %-8s %14s %14s %12s %14s\n", "sprites", "per-entity", "batched", "build ms", "order kept");
+
+	for (int sprite_count : SPRITE_COUNTS) {
+		registry.clear_all_components();
+		std::mt19937 rng(427);
+		std::uniform_real_distribution<float> x_dist(0.f, VIEW_SIZE.x);
+		std::uniform_real_distribution<float> y_dist(0.f, VIEW_SIZE.y);
+		std::uniform_real_distribution<float> size_dist(24.f, 64.f);
+		std::uniform_int_distribution<int> texture_dist(0, TEXTURE_KINDS - 1);
+		std::uniform_int_distribution<int> percent_dist(0, 99);
+
+		std::vector<SpriteBatchKey> keys;
+		std::vector<glm::vec2> centers, half_extents;
+		for (int i = 0; i < sprite_count; i++) {
+			Entity e;
+			Motion& motion = registry.motions.emplace(e);
+			motion.position = { x_dist(rng), y_dist(rng) };
+			float size = size_dist(rng);
+			motion.scale = { size, size };
+
+			RenderRequest& request = registry.renderRequests.emplace(e);
+			request.used_geometry = GEOMETRY_BUFFER_ID::SPRITE;
+			// one in ten is a coloured mesh such as a bullet, which is drawn on its own
+			if (percent_dist(rng) < 10) {
+				request.used_effect = EFFECT_ASSET_ID::COLOURED;
+				request.used_geometry = GEOMETRY_BUFFER_ID::BULLET_CIRCLE;
+			} else {
+				request.used_effect = EFFECT_ASSET_ID::TEXTURED;
+				request.used_texture = TEXTURES[texture_dist(rng)];
+				Sprite& sprite = registry.sprites.emplace(e);
+				sprite.total_row = 1;
+				sprite.total_frame = 4;
+				registry.enemies.emplace(e);
+			}
+
+			SpriteBatchKey key;
+			key.effect = request.used_effect;
+			key.texture = request.used_texture;
+			key.geometry = request.used_geometry;
+			keys.push_back(key);
+			centers.push_back(motion.position);
+			half_extents.push_back(glm::vec2(request.used_effect == EFFECT_ASSET_ID::TEXTURED ? size * 0.5f : size));
+		}
+
+		SpriteBatchBuilder builder;
+		auto start = Clock::now();
+		for (int r = 0; r < REPEATS; r++) {
+			builder.clear();
+			for (size_t i = 0; i < registry.renderRequests.size(); i++) {
+				Entity e = registry.renderRequests.entities[i];
+				builder.add_entity(e, registry.renderRequests.components[i], registry.motions.get(e));
+			}
+			builder.finish();
+		}
+		float build_ms = elapsed_ms_since(start) / REPEATS;
+		size_t batched_calls = builder.draw_calls();
+
+		// same scene through add(), tagging every instance with its submission index;
+		// the coloured meshes are tagged instances here too, under keys of their own
+		SpriteBatchBuilder tagged;
+		for (size_t i = 0; i < keys.size(); i++) {
+			SpriteInstance instance{};
+			instance.frame.x = (float)i;
+			SpriteBatchKey key = keys[i];
+			if (key.effect != EFFECT_ASSET_ID::TEXTURED)
+				key.texture = (TEXTURE_ASSET_ID)((int)TEXTURE_ASSET_ID::TEXTURE_COUNT + (int)i);
+			keys[i] = key;
+			tagged.add(key, instance, centers[i], half_extents[i]);
+		}
+		tagged.finish();
+		const char* order_kept = batches_keep_overlap_order(tagged, keys, centers, half_extents) ? "yes" : "NO";
+
+		printf("  %-8d %14d %14zu %12.3f %14s\n", sprite_count, sprite_count, batched_calls, build_ms, order_kept);
+	}
+
+	registry.clear_all_components();
+}
+
+// Pixels of a w x h screen within a light's radius
+static long long lit_pixels(const ScreenLight& light, int w, int h)
+{
+	long long count = 0;
+	int min_y = std::max(0, (int)(light.position.y - light.radius));
+	int max_y = std::min(h - 1, (int)(light.position.y + light.radius));
+	for (int y = min_y; y <= max_y; y++) {
+		float dy = y + 0.5f - light.position.y;
+		float half = light.radius * light.radius - dy * dy;
+		if (half < 0.f)
+			continue;
+		half = sqrtf(half);
+		int x0 = std::max(0, (int)ceilf(light.position.x - half - 0.5f));
+		int x1 = std::min(w - 1, (int)floorf(light.position.x + half - 0.5f));
+		count += std::max(0, x1 - x0 + 1);
+	}
+	return count;
+}
+
+void light_tiling()
+{
+	const int LIGHT_COUNTS[] = { 1, 50, 500 };
+	const int REPEATS = 50;
+	const ivec2 SCREEN = { 1920, 1080 };
+	const vec2 CAMERA = { 0.f, 0.f };
+
+	printf("[lights] %dx%d lighting pass, %dpx tiles; light work in million pixel-light evaluations\n", SCREEN.x, SCREEN.y, LIGHT_TILE_SIZE);
+	printf("  %-7s %10s %12s %12s %14s %14s\n", "lights", "bin ms", "pass pixels", "tiled evals", "shadowed old", "shadowed new");
+
+	for (int light_count : LIGHT_COUNTS) {
+		registry.clear_all_components();
+		std::mt19937 rng(427);
+		std::uniform_real_distribution<float> x_dist(-SCREEN.x * 0.5f, SCREEN.x * 0.5f);
+		std::uniform_real_distribution<float> y_dist(-SCREEN.y * 0.5f, SCREEN.y * 0.5f);
+		std::uniform_real_distribution<float> angle_dist(-3.14159f, 3.14159f);
+		std::uniform_int_distribution<int> percent_dist(0, 99);
+
+		// the bonfire, then a fight: mostly bullets, a few larger lights
+		for (int i = 0; i < light_count; i++) {
+			Entity e;
+			Motion& motion = registry.motions.emplace(e);
+			motion.position = i == 0 ? CAMERA : vec2(x_dist(rng), y_dist(rng));
+			motion.angle = angle_dist(rng);
+			Light& light = registry.lights.emplace(e);
+			light.cone_angle = 3.14159f;
+			if (i == 0) {
+				light.range = 400.f;
+			} else if (percent_dist(rng) < 80) {
+				registry.bullets.emplace(e);
+			} else {
+				light.range = 200.f;
+				light.cone_angle = 1.f;
+			}
+		}
+
+		std::vector<ScreenLight> lights;
+		LightTileGrid grid;
+		auto start = Clock::now();
+		for (int r = 0; r < REPEATS; r++) {
+			gather_screen_lights(CAMERA, SCREEN, lights);
+			grid.build(lights, SCREEN);
+		}
+		float bin_ms = elapsed_ms_since(start) / REPEATS;
+
+		// one full-screen pass per light runs the shader on every pixel; the tiled pass only
+		// evaluates the lights binned to each pixel's tile
+		const long long screen_pixels = (long long)SCREEN.x * SCREEN.y;
+		long long pass_pixels = screen_pixels * (long long)lights.size();
+		long long tiled_evals = 0;
+		for (int y = 0; y < grid.tile_count().y; y++) {
+			for (int x = 0; x < grid.tile_count().x; x++) {
+				int tile_w = std::min(LIGHT_TILE_SIZE, SCREEN.x - x * LIGHT_TILE_SIZE);
+				int tile_h = std::min(LIGHT_TILE_SIZE, SCREEN.y - y * LIGHT_TILE_SIZE);
+				tiled_evals += (long long)grid.count(x, y) * tile_w * tile_h;
+			}
+		}
+		// pixels inside a light's radius run the 16-sample shadow march, now only for large lights
+		long long lit = 0, shadowed_new = 0;
+		for (const ScreenLight& light : lights) {
+			long long pixels = lit_pixels(light, SCREEN.x, SCREEN.y);
+			lit += pixels;
+			if (light.soft_shadows)
+				shadowed_new += pixels;
+		}
+
+		printf("  %-7d %10.3f %12.1f %12.1f %14.1f %14.1f\n", light_count, bin_ms,
+			pass_pixels / 1e6, tiled_evals / 1e6, lit / 1e6, shadowed_new / 1e6);
+	}
+
+	registry.clear_all_components();
+}
+
+// What a particle used to be: a component on its own entity in the registry
+struct EntityParticle {
+	vec3 position;
+	vec3 velocity;
+	vec4 color;
+	float size;
+	float lifetime;
+	float age;
+	bool alive;
+};
+
+void particle_churn()
+{
+	const int EMIT_PER_SECOND = 100000;
+	const int FRAMES_PER_SECOND = 60;
+	const int SECONDS = 5;
+	const float DT = 1.f / FRAMES_PER_SECOND;
+	const int EMIT_PER_FRAME = EMIT_PER_SECOND / FRAMES_PER_SECOND;
+
+	printf("[particles] %d emitted per second at %d fps for %d s, 0.3-0.6 s lifetimes; ms per simulated second\n",
+		EMIT_PER_SECOND, FRAMES_PER_SECOND, SECONDS);
+	printf("  %-8s %10s %10s %10s %10s %10s\n", "storage", "emit", "step", "total", "peak", "alive");
+
+	// entity per particle, stepped and removed the way WorldSystem::step used to
+	{
+		registry.clear_all_components();
+		ComponentContainer<EntityParticle> particles;
+		std::mt19937 rng(427);
+		std::uniform_real_distribution<float> unit(0.f, 1.f);
+		float emit_ms = 0.f, step_ms = 0.f;
+		size_t peak = 0;
+		std::vector<Entity> to_delete;
+		for (int frame = 0; frame < SECONDS * FRAMES_PER_SECOND; frame++) {
+			auto start = Clock::now();
+			for (int i = 0; i < EMIT_PER_FRAME; i++) {
+				Entity e;
+				EntityParticle& p = particles.emplace(e);
+				p.position = vec3(unit(rng) * 100.f, unit(rng) * 100.f, 0.f);
+				p.velocity = vec3(unit(rng) * 300.f, unit(rng) * 300.f, 0.f);
+				p.color = vec4(0.7f, 0.05f, 0.05f, 1.f);
+				p.size = 8.f;
+				p.lifetime = 0.3f + unit(rng) * 0.3f;
+				p.age = 0.f;
+				p.alive = true;
+			}
+			emit_ms += elapsed_ms_since(start);
+			peak = std::max(peak, particles.size());
+
+			start = Clock::now();
+			for (EntityParticle& p : particles.components) {
+				if (!p.alive) continue;
+				p.age += DT;
+				if (p.age >= p.lifetime) {
+					p.alive = false;
+					continue;
+				}
+				p.velocity += vec3(0, -300.f, 0) * DT * 0.2f;
+				p.position += p.velocity * DT;
+				p.color.a = 1.f - p.age / p.lifetime;
+			}
+			to_delete.clear();
+			for (unsigned int i = 0; i < particles.components.size(); i++)
+				if (!particles.components[i].alive)
+					to_delete.push_back(particles.entities[i]);
+			for (Entity e : to_delete) {
+				particles.remove(e);
+				registry.remove_all_components_of(e);
+			}
+			step_ms += elapsed_ms_since(start);
+		}
+		printf("  %-8s %10.3f %10.3f %10.3f %10zu %10zu\n", "entity", emit_ms / SECONDS, step_ms / SECONDS,
+			(emit_ms + step_ms) / SECONDS, peak, particles.size());
+		for (Entity e : particles.entities)
+			Entity::release(e);
+	}
+
+	// the pool, with the same emission sequence
+	{
+		ParticlePool pool;
+		std::mt19937 rng(427);
+		std::uniform_real_distribution<float> unit(0.f, 1.f);
+		float emit_ms = 0.f, step_ms = 0.f;
+		size_t peak = 0, dropped = 0;
+		for (int frame = 0; frame < SECONDS * FRAMES_PER_SECOND; frame++) {
+			auto start = Clock::now();
+			for (int i = 0; i < EMIT_PER_FRAME; i++) {
+				vec2 position = vec2(unit(rng) * 100.f, unit(rng) * 100.f);
+				vec2 velocity = vec2(unit(rng) * 300.f, unit(rng) * 300.f);
+				if (!pool.emit(position, velocity, vec4(0.7f, 0.05f, 0.05f, 1.f), 8.f, 0.3f + unit(rng) * 0.3f))
+					dropped++;
+			}
+			emit_ms += elapsed_ms_since(start);
+			peak = std::max(peak, pool.size());
+
+			start = Clock::now();
+			pool.step(DT);
+			step_ms += elapsed_ms_since(start);
+		}
+		printf("  %-8s %10.3f %10.3f %10.3f %10zu %10zu\n", "pool", emit_ms / SECONDS, step_ms / SECONDS,
+			(emit_ms + step_ms) / SECONDS, peak, pool.size());
+		if (dropped > 0)
+			printf("  warning: pool dropped %zu particles at capacity %zu\n", dropped, pool.capacity());
+	}
+
+	registry.clear_all_components();
+}
+
+// The minion flocking as it ran before BoidSwarm: all pairs, through the registry, writing each
+// minion's velocity back before the next one reads it
+static void all_pairs_minion_velocities(const std::vector<Entity>& swarm, const BoidParams& params,
+	vec2 target, float t, std::vector<vec2>& out)
+{
+	vec2 swarm_center = { 0.f, 0.f };
+	int n = 0;
+	for (Entity e : swarm) {
+		if (!registry.minions.has(e)) continue;
+		swarm_center += registry.motions.get(e).position;
+		n++;
+	}
+	swarm_center /= (float)n;
+
+	vec2 to_target = target - swarm_center;
+	float tl = sqrt(to_target.x * to_target.x + to_target.y * to_target.y);
+	if (tl > 0.0001f) to_target = to_target / tl;
+
+	out.clear();
+	for (Entity e : swarm) {
+		if (!registry.minions.has(e)) continue;
+		vec2 p = registry.motions.get(e).position;
+		vec2 sep = { 0, 0 }, coh = { 0, 0 }, ali = { 0, 0 };
+		int coh_count = 0, ali_count = 0;
+		for (Entity o : swarm) {
+			if (o == e) continue;
+			if (!registry.minions.has(o)) continue;
+			Motion& om = registry.motions.get(o);
+			vec2 d = om.position - p;
+			float dsq = d.x * d.x + d.y * d.y;
+			if (dsq < 0.0001f) continue;
+			float l = sqrt(dsq);
+			vec2 nd = d / l;
+			if (l < params.desired_distance) sep -= nd * (params.desired_distance - l);
+			if (l < params.cohesion_radius) { coh += om.position; coh_count++; }
+			if (l < params.align_radius) { ali += om.velocity; ali_count++; }
+		}
+		if (coh_count > 0) coh = coh / (float)coh_count - p;
+		if (ali_count > 0) ali /= (float)ali_count;
+
+		vec2 wave = vec2(cos(t * params.wave_speed + (float)e), sin(t * params.wave_speed + (float)e)) * params.wave_amplitude;
+		vec2 to_center = swarm_center - p;
+		float cl = sqrt(to_center.x * to_center.x + to_center.y * to_center.y);
+		if (cl > 0.0001f) to_center = to_center / cl;
+
+		vec2 v = (to_target + to_center * params.center_weight) * params.max_speed;
+		v += sep * params.separation_weight;
+		v += coh * params.cohesion_weight;
+		v += ali * params.align_weight;
+		v += wave;
+		float vl = sqrt(v.x * v.x + v.y * v.y);
+		if (vl > params.max_speed) v = v * (params.max_speed / vl);
+		registry.motions.get(e).velocity = v;
+		out.push_back(v);
+	}
+}
+
+void minion_swarm()
+{
+	const int MINION_COUNTS[] = { 100, 1000, 5000 };
+	const int STEP_COUNT = 10;
+	const vec2 TARGET = { 600.f, 0.f };
+
+	printf("[swarm] boss minion flocking, ms per update\n");
+	printf("  %-8s %12s %12s %14s\n", "minions", "all pairs", "BoidSwarm", "max |dv| px/s");
+
+	for (int minion_count : MINION_COUNTS) {
+		registry.clear_all_components();
+		std::mt19937 rng(427);
+		// spawned around the boss and spread out the way a long fight leaves them
+		const float spread = 12.f * sqrt((float)minion_count);
+		std::uniform_real_distribution<float> pos_dist(-spread, spread);
+		std::uniform_real_distribution<float> vel_dist(-250.f, 250.f);
+		std::vector<Entity> swarm;
+		for (int i = 0; i < minion_count; i++) {
+			Entity e;
+			Motion& motion = registry.motions.emplace(e);
+			motion.position = { pos_dist(rng), pos_dist(rng) };
+			motion.velocity = { vel_dist(rng), vel_dist(rng) };
+			registry.minions.emplace(e).scatter_timer = 0.f;
+			swarm.push_back(e);
+		}
+
+		// both update velocities in place, so every step starts over from the spawn velocities
+		std::vector<vec2> start_velocities;
+		for (Entity e : swarm)
+			start_velocities.push_back(registry.motions.get(e).velocity);
+		auto restore_velocities = [&]() {
+			for (size_t i = 0; i < swarm.size(); i++)
+				registry.motions.get(swarm[i]).velocity = start_velocities[i];
+		};
+
+		BoidParams params;
+		std::vector<vec2> expected;
+		const int all_pairs_steps = minion_count > 1000 ? 1 : STEP_COUNT;
+		float all_pairs_ms = 0.f;
+		for (int s = 0; s < all_pairs_steps; s++) {
+			restore_velocities();
+			auto start = Clock::now();
+			all_pairs_minion_velocities(swarm, params, TARGET, 1.f, expected);
+			all_pairs_ms += elapsed_ms_since(start);
+		}
+		all_pairs_ms /= all_pairs_steps;
+		restore_velocities();
+
+		BoidSwarm boids;
+		auto start = Clock::now();
+		for (int s = 0; s < STEP_COUNT; s++) {
+			boids.clear();
+			for (Entity e : swarm) {
+				const Motion& m = registry.motions.get(e);
+				boids.add(m.position, m.velocity, (float)e);
+			}
+			boids.update(params, TARGET, 1.f);
+		}
+		float grid_ms = elapsed_ms_since(start) / STEP_COUNT;
+
+		float max_diff = 0.f;
+		for (unsigned int i = 0; i < swarm.size(); i++)
+			max_diff = std::max(max_diff, length(boids.velocity(i) - expected[i]));
+
+		printf("  %-8d %12.3f %12.3f %14.5f\n", minion_count, all_pairs_ms, grid_ms, max_diff);
+	}
+
+	registry.clear_all_components();
+}
+
+static float percentile(std::vector<float> values, float p)
+{
+	std::sort(values.begin(), values.end());
+	return values[(size_t)(p * (values.size() - 1))];
+}
+
+void horde_soak()
+{
+	const int ENEMY_COUNTS[] = { 250, 500, 1000, 2000, 3000 };
+	const int WARMUP_FRAMES = 10;
+	const int FRAME_COUNT = 120;
+	const float STEP_MS = 1000.f / 60.f;
+
+	printf("[horde] pathfinding + steering + physics + sprite batching per %d frames, ms per frame\n", FRAME_COUNT);
+	printf("  %-8s %-4s %8s %8s %8s %8s %8s\n", "enemies", "lod", "p50", "p95", "p99", "max", "far %");
+
+	for (int lod = 1; lod >= 0; lod--) {
+		registry.clear_all_components();
+		std::mt19937 rng(427);
+		create_random_chunks(-4, 3, 0.05f, rng);
+
+		Entity player;
+		registry.players.emplace(player);
+		registry.motions.emplace(player).position = { 0.f, 0.f };
+
+		PathfindingSystem pathfinding;
+		SteeringSystem steering;
+		steering.use_lod = lod == 1;
+		PhysicsSystem physics;
+		SpriteBatchBuilder batches;
+		const vec4 cam_view = { -window_width_px / 2.f, window_width_px / 2.f, -window_height_px / 2.f, window_height_px / 2.f };
+
+		std::uniform_real_distribution<float> angle_dist(-3.14159f, 3.14159f);
+		std::uniform_real_distribution<float> radius_dist(300.f, 2500.f);
+		int enemy_count = 0;
+		for (int target : ENEMY_COUNTS) {
+			// the ramp: the next batch of enemies spawns in a ring around the player
+			for (; enemy_count < target; enemy_count++) {
+				Entity e;
+				float a = angle_dist(rng), r = radius_dist(rng);
+				Motion& motion = registry.motions.emplace(e);
+				motion.position = vec2(cos(a), sin(a)) * r;
+				motion.scale = { 40.f, 40.f };
+				registry.enemies.emplace(e);
+				registry.collisionCircles.emplace(e).radius = 16.f;
+				registry.renderRequests.insert(e, { TEXTURE_ASSET_ID::ENEMY1, EFFECT_ASSET_ID::TEXTURED, GEOMETRY_BUFFER_ID::SPRITE });
+			}
+
+			std::vector<float> frame_ms;
+			for (int frame = 0; frame < WARMUP_FRAMES + FRAME_COUNT; frame++) {
+				registry.collisions.clear();
+				auto start = Clock::now();
+				pathfinding.step(STEP_MS);
+				steering.step(STEP_MS);
+				physics.step(STEP_MS);
+				batches.clear();
+				for (uint i = 0; i < registry.renderRequests.size(); i++) {
+					Entity e = registry.renderRequests.entities[i];
+					const Motion& m = registry.motions.get(e);
+					if (m.position.x < cam_view.x || m.position.x > cam_view.y || m.position.y < cam_view.z || m.position.y > cam_view.w)
+						continue;
+					batches.add_entity(e, registry.renderRequests.components[i], m);
+				}
+				batches.finish();
+				if (frame >= WARMUP_FRAMES)
+					frame_ms.push_back(elapsed_ms_since(start));
+			}
+
+			int far = 0;
+			for (const Steering& s : registry.enemy_steerings.components)
+				far += s.is_far;
+			printf("  %-8d %-4s %8.3f %8.3f %8.3f %8.3f %8.1f\n", enemy_count, lod ? "on" : "off",
+				percentile(frame_ms, 0.5f), percentile(frame_ms, 0.95f), percentile(frame_ms, 0.99f),
+				percentile(frame_ms, 1.f), 100.f * far / enemy_count);
+		}
+	}
+
+	registry.clear_all_components();
+	registry.chunks.clear();
+}
+
+
+// What Enemy used to be: one type-erased callback per animation
+struct CallbackEnemy {
+	bool is_dead = false;
+	bool is_hurt = false;
+	bool death_handled = false;
+	std::function<void(Entity, float)> death_animation = NULL;
+	std::function<void(Entity, float)> hurt_animation = NULL;
+	float hurt_timer = 0.0f;
+	float healthbar_visibility_timer = 0.0f;
+	int damage = 10;
+	int health = 100;
+	int max_health = 100;
+	int xylarite_drop = 1;
+};
+
+// The slime and evil plant callbacks as world_init used to set them
+static void set_enemy_callbacks(CallbackEnemy& enemy, EnemyAnimation animation, ComponentContainer<CallbackEnemy>& enemies)
+{
+	if (animation == EnemyAnimation::SLIME) {
+		enemy.death_animation = [](Entity entity, float step_seconds) {
+			Sprite& sprite = registry.sprites.get(entity);
+			if (sprite.curr_row == 0) {
+				sprite.curr_row = 1;
+				sprite.curr_frame = 0;
+				sprite.step_seconds_acc = 0.0f;
+			}
+			if (sprite.step_seconds_acc > sprite.total_frame)
+				registry.remove_all_components_of(entity);
+		};
+	} else if (animation == EnemyAnimation::EVIL_PLANT) {
+		const TEXTURE_ASSET_ID idle_texture = TEXTURE_ASSET_ID::PLANT_IDLE_1;
+		const TEXTURE_ASSET_ID hurt_texture = TEXTURE_ASSET_ID::PLANT_HURT_1;
+		const TEXTURE_ASSET_ID death_texture = TEXTURE_ASSET_ID::PLANT_DEATH_1;
+		enemy.death_animation = [death_texture](Entity entity, float step_seconds) {
+			RenderRequest& render = registry.renderRequests.get(entity);
+			Sprite& sprite = registry.sprites.get(entity);
+			if (render.used_texture != death_texture) {
+				render.used_texture = death_texture;
+				sprite.total_row = 4;
+				sprite.total_frame = 10;
+				sprite.curr_frame = 0;
+				sprite.step_seconds_acc = 0.0f;
+			}
+			if (sprite.step_seconds_acc > sprite.total_frame - 1)
+				registry.remove_all_components_of(entity);
+		};
+		enemy.hurt_animation = [hurt_texture, idle_texture, &enemies](Entity entity, float step_seconds) {
+			RenderRequest& render = registry.renderRequests.get(entity);
+			Sprite& sprite = registry.sprites.get(entity);
+			CallbackEnemy& enemy = enemies.get(entity);
+			if (render.used_texture != hurt_texture) {
+				render.used_texture = hurt_texture;
+				sprite.total_row = 4;
+				sprite.total_frame = 5;
+				sprite.curr_frame = 0;
+				sprite.step_seconds_acc = 0.0f;
+				sprite.animation_speed = 25.f;
+			}
+			if (sprite.step_seconds_acc > sprite.total_frame - 1)
+				enemy.is_hurt = false;
+			if (!enemy.is_hurt) {
+				render.used_texture = idle_texture;
+				sprite.total_row = 4;
+				sprite.total_frame = 4;
+				sprite.curr_frame = 0;
+				sprite.step_seconds_acc = 0.0f;
+				sprite.animation_speed = 10.f;
+			}
+		};
+	}
+}
+
+// AISystem::enemyStep as it was with callbacks
+static void callback_enemy_step(ComponentContainer<CallbackEnemy>& enemies, float step_seconds)
+{
+	for (uint i = 0; i < enemies.size(); i++) {
+		Entity entity = enemies.entities[i];
+		CallbackEnemy& enemy = enemies.get(entity);
+		Motion& motion = registry.motions.get(entity);
+
+		if (enemy.healthbar_visibility_timer > 0.0f) {
+			enemy.healthbar_visibility_timer -= step_seconds;
+			if (enemy.healthbar_visibility_timer < 0.0f)
+				enemy.healthbar_visibility_timer = 0.0f;
+		}
+
+		if (enemy.is_hurt && !enemy.is_dead) {
+			enemy.hurt_timer += step_seconds;
+			if (enemy.hurt_timer > 0.2f) {
+				enemy.is_hurt = false;
+				enemy.hurt_timer = 0.f;
+			}
+			if (enemy.hurt_animation != NULL)
+				enemy.hurt_animation(entity, step_seconds);
+		}
+
+		if (enemy.is_dead) {
+			if (!enemy.death_handled) {
+				enemy.death_handled = true;
+				if (registry.collisionCircles.has(entity))
+					registry.collisionCircles.remove(entity);
+				if (registry.colliders.has(entity))
+					registry.colliders.remove(entity);
+			}
+			if (enemy.death_animation == NULL) {
+				motion.angle += 3 * M_PI * step_seconds;
+				motion.velocity = { 0.0f, 0.0f };
+				motion.scale -= glm::vec2(30.0f) * step_seconds;
+				if (motion.scale.x < 0.f || motion.scale.y < 0.f)
+					registry.remove_all_components_of(entity);
+			} else {
+				enemy.death_animation(entity, step_seconds);
+			}
+		}
+	}
+}
+
+void enemy_animation_step()
+{
+	const int STEP_COUNT = 60;
+	const float STEP_MS = 1000.f / 60.f;
+	const EnemyAnimation TYPES[] = { EnemyAnimation::DEFAULT, EnemyAnimation::SLIME, EnemyAnimation::EVIL_PLANT };
+
+	printf("[enemies] Enemy is %zu bytes, was %zu with animation callbacks\n", sizeof(Enemy), sizeof(CallbackEnemy));
+	printf("[enemies] enemyStep over %d steps, 10%% hurt and 10%% dying; swap-remove of half the enemies\n", STEP_COUNT);
+	printf("  %-8s %-10s %12s %12s %12s\n", "enemies", "enemy", "ms/step", "Menemies/s", "remove ms");
+
+	for (int enemy_count : { 1000, 10000, 100000 }) {
+		for (int path = 0; path < 2; path++) {
+			registry.clear_all_components();
+			ComponentContainer<CallbackEnemy> callback_enemies;
+			std::vector<Entity> entities;
+			for (int i = 0; i < enemy_count; i++) {
+				Entity e;
+				entities.push_back(e);
+				const EnemyAnimation type = TYPES[i % 3];
+				Motion& motion = registry.motions.emplace(e);
+				motion.scale = { 100.f, 100.f };
+				Sprite& sprite = registry.sprites.emplace(e);
+				sprite.total_row = 4;
+				sprite.total_frame = 4;
+				registry.renderRequests.insert(e, { type == EnemyAnimation::EVIL_PLANT ? TEXTURE_ASSET_ID::PLANT_IDLE_1 : TEXTURE_ASSET_ID::SLIME_1,
+					EFFECT_ASSET_ID::TEXTURED, GEOMETRY_BUFFER_ID::SPRITE });
+
+				// dying enemies never finish: nothing advances their sprites and 60 steps don't shrink them away
+				const bool dying = i % 10 == 5;
+				if (path == 0) {
+					CallbackEnemy& enemy = callback_enemies.emplace(e);
+					set_enemy_callbacks(enemy, type, callback_enemies);
+					enemy.is_dead = dying;
+				} else {
+					Enemy& enemy = registry.enemies.emplace(e);
+					enemy.animation = type;
+					enemy.is_dead = dying;
+				}
+			}
+
+			AISystem ai;
+			float step_ms = 0.f;
+			for (int s = 0; s < STEP_COUNT; s++) {
+				// a fresh tenth of the crowd gets hit every step
+				for (int i = (s % 10); i < enemy_count; i += 10) {
+					if (path == 0)
+						callback_enemies.components[i].is_hurt = true;
+					else
+						registry.enemies.components[i].is_hurt = true;
+				}
+				auto start = Clock::now();
+				if (path == 0)
+					callback_enemy_step(callback_enemies, STEP_MS / 1000.f);
+				else
+					ai.enemyStep(STEP_MS / 1000.f);
+				step_ms += elapsed_ms_since(start);
+			}
+
+			auto start = Clock::now();
+			for (int i = 0; i < enemy_count; i += 2) {
+				if (path == 0)
+					callback_enemies.remove(entities[i]);
+				else
+					registry.enemies.remove(entities[i]);
+			}
+			const float remove_ms = elapsed_ms_since(start);
+
+			printf("  %-8d %-10s %12.3f %12.2f %12.3f\n", enemy_count, path == 0 ? "callbacks" : "table",
+				step_ms / STEP_COUNT, enemy_count * STEP_COUNT / step_ms / 1000.f, remove_ms);
+		}
+	}
+
+	registry.clear_all_components();
+}
+
+
+static bool same_serialized_chunk(const SerializedChunk& a, const SerializedChunk& b)
+{
+	if (a.decorated != b.decorated || a.serial_trees.size() != b.serial_trees.size() ||
+		a.serial_walls.size() != b.serial_walls.size() || a.iso_filters.size() != b.iso_filters.size())
+		return false;
+	for (size_t t = 0; t < b.serial_trees.size(); t++)
+		if (a.serial_trees[t].position != b.serial_trees[t].position || a.serial_trees[t].scale != b.serial_trees[t].scale)
+			return false;
+	for (size_t w = 0; w < b.serial_walls.size(); w++)
+		if (a.serial_walls[w].position != b.serial_walls[w].position || a.serial_walls[w].scale != b.serial_walls[w].scale)
+			return false;
+	for (size_t f = 0; f < b.iso_filters.size(); f++) {
+		const IsolineFilter& fa = a.iso_filters[f];
+		const IsolineFilter& fb = b.iso_filters[f];
+		if (fa.reconstruct_upper != fb.reconstruct_upper || fa.reconstruct_lower != fb.reconstruct_lower ||
+			fa.reconstruct_left != fb.reconstruct_left || fa.reconstruct_right != fb.reconstruct_right ||
+			fa.upper_left_cell != fb.upper_left_cell || fa.lower_right_cell != fb.lower_right_cell)
+			return false;
+	}
+	return true;
+}
+
+static bool same_serialized_chunks(const std::vector<SerializedChunk>& a, const std::vector<short>& a_xs, const std::vector<short>& a_ys)
+{
+	if (a.size() != registry.serial_chunks.size())
+		return false;
+	for (size_t i = 0; i < a.size(); i++) {
+		if (!registry.serial_chunks.has(a_xs[i], a_ys[i]) || !same_serialized_chunk(a[i], registry.serial_chunks.get(a_xs[i], a_ys[i])))
+			return false;
+	}
+	return true;
+}
+
+// Trees, walls and isoline filters in the numbers a decorated chunk typically has
+static SerializedChunk random_serialized_chunk(int x, int y, std::mt19937& rng)
+{
+	std::uniform_real_distribution<float> unit(0.f, 1.f);
+	const float chunk_size = (float)(CHUNK_CELLS_PER_ROW * CHUNK_CELL_SIZE);
+	SerializedChunk chunk;
+	chunk.decorated = unit(rng) < 0.9f;
+	const vec2 base = vec2(x, y) * chunk_size;
+	for (int t = 10 + (int)(unit(rng) * 20); t > 0; t--)
+		chunk.serial_trees.push_back({ base + vec2(unit(rng), unit(rng)) * chunk_size, 60.f + unit(rng) * 40.f });
+	for (int w = (int)(unit(rng) * 8); w > 0; w--)
+		chunk.serial_walls.push_back({ base + vec2(unit(rng), unit(rng)) * chunk_size, vec2(40.f, 40.f + unit(rng) * 160.f) });
+	for (int f = (int)(unit(rng) * 16); f > 0; f--) {
+		IsolineFilter filter;
+		filter.reconstruct_upper = unit(rng) < 0.5f;
+		filter.reconstruct_left = unit(rng) < 0.5f;
+		filter.upper_left_cell = vec2((int)(unit(rng) * 60), (int)(unit(rng) * 60));
+		filter.lower_right_cell = filter.upper_left_cell + vec2(4.f, 4.f);
+		chunk.iso_filters.push_back(filter);
+	}
+	return chunk;
+}
+
+static size_t file_size(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	return file.is_open() ? (size_t)file.tellg() : 0;
+}
+
+void save_round_trip()
+{
+	const int CHUNK_COUNT = 1000;
+	const int ROUNDS = 5;
+	const std::string json_path = "benchmark_save.json";
+	const std::string binary_path = "benchmark_save.sav";
+
+	registry.clear_all_components();
+	registry.chunks.clear();
+	registry.serial_chunks.clear();
+	std::mt19937 rng(427);
+	for (int i = 0; i < CHUNK_COUNT; i++) {
+		const short x = (short)(i % 40 - 20);
+		const short y = (short)(i / 40 - 12);
+		registry.serial_chunks.insert(x, y, random_serialized_chunk(x, y, rng));
+	}
+	const std::vector<SerializedChunk> saved = registry.serial_chunks.components;
+	const std::vector<short> saved_xs = registry.serial_chunks.position_xs;
+	const std::vector<short> saved_ys = registry.serial_chunks.position_ys;
+
+	printf("[save] %d serialized chunks, best of %d rounds, including file I/O\n", CHUNK_COUNT, ROUNDS);
+	printf("  %-8s %10s %10s %12s %10s\n", "format", "save ms", "load ms", "bytes", "identical");
+
+	for (int format = 0; format < 2; format++) {
+		const std::string& path = format == 0 ? json_path : binary_path;
+		float save_ms = 1e9f, load_ms = 1e9f;
+		bool identical = true;
+		for (int round = 0; round < ROUNDS; round++) {
+			registry.serial_chunks.clear();
+			for (size_t i = 0; i < saved.size(); i++)
+				registry.serial_chunks.insert(saved_xs[i], saved_ys[i], saved[i]);
+
+			auto start = Clock::now();
+			if (format == 0) {
+				json data;
+				data["chunks"] = serialize_chunks();
+				std::ofstream file(path);
+				file << data.dump(4);
+			} else {
+				std::ofstream file(path, std::ios::binary);
+				SaveWriter writer(&file);
+				writer.write_header();
+				write_chunk_sections(writer);
+				writer.finish();
+			}
+			save_ms = std::min(save_ms, elapsed_ms_since(start));
+
+			registry.serial_chunks.clear();
+			start = Clock::now();
+			if (format == 0) {
+				std::ifstream file(path);
+				json data = json::parse(file);
+				deserialize_chunks(data["chunks"]);
+			} else {
+				std::ifstream file(path, std::ios::binary | std::ios::ate);
+				std::vector<char> bytes((size_t)file.tellg());
+				file.seekg(0);
+				file.read(bytes.data(), (std::streamsize)bytes.size());
+				SaveReader reader(bytes.data(), bytes.size());
+				reader.read_header();
+				for (SaveSection section = reader.next_section(); section != SaveSection::END; section = reader.next_section())
+					read_chunk_section(reader);
+			}
+			load_ms = std::min(load_ms, elapsed_ms_since(start));
+			identical = identical && same_serialized_chunks(saved, saved_xs, saved_ys);
+		}
+		printf("  %-8s %10.3f %10.3f %12zu %10s\n", format == 0 ? "json" : "binary", save_ms, load_ms,
+			file_size(path), identical ? "yes" : "no");
+		std::remove(path.c_str());
+	}
+
+	registry.serial_chunks.clear();
+}
+
+
+// Heap bytes held by the resident serialized chunks
+static size_t resident_chunk_bytes()
+{
+	size_t bytes = registry.serial_chunks.components.size() * sizeof(SerializedChunk);
+	for (const SerializedChunk& chunk : registry.serial_chunks.components)
+		bytes += chunk.serial_trees.capacity() * sizeof(SerializedTree) + chunk.serial_walls.capacity() * sizeof(SerializedWall) +
+			chunk.iso_filters.capacity() * sizeof(IsolineFilter);
+	return bytes;
+}
+
+void region_paging()
+{
+	const int WALK_LENGTH = 20000;
+	const int LOOKUPS = 2000;
+	const std::string directory = "benchmark_regions";
+
+	MKDIR(directory.c_str());
+	printf("[regions] walk over %d chunks, one new serialized chunk per step, then %d random revisits\n", WALK_LENGTH, LOOKUPS);
+	printf("  %-10s %12s %14s %12s %12s %14s %10s\n", "budget", "resident", "resident KB", "evict ms", "disk KB", "page-in us", "identical");
+
+	for (int pass = 0; pass < 2; pass++) {
+		const bool bounded = pass == 1;
+		registry.chunks.clear();
+		registry.serial_chunks.clear();
+		chunk_store.set_directory(bounded ? directory : "");
+		chunk_store.reset(427, 1042);
+
+		// a meandering walk, so both nearby and long-abandoned chunks get revisited
+		std::mt19937 rng(427);
+		std::uniform_int_distribution<int> turn(0, 3);
+		std::vector<ivec2> walk;
+		std::vector<SerializedChunk> originals;
+		ivec2 position(0, 0);
+		float evict_ms = 0.f;
+		size_t peak_bytes = 0;
+		size_t peak_resident = 0;
+		while ((int)walk.size() < WALK_LENGTH) {
+			const int direction = turn(rng);
+			position += ivec2(direction == 0 ? 1 : direction == 1 ? -1 : 0, direction == 2 ? 1 : direction == 3 ? -1 : 0);
+			if (registry.serial_chunks.has(position.x, position.y) || chunk_store.is_stored(position.x, position.y))
+				continue;
+			walk.push_back(position);
+			originals.push_back(random_serialized_chunk(position.x, position.y, rng));
+			registry.serial_chunks.insert(position.x, position.y, originals.back());
+
+			const auto start = Clock::now();
+			chunk_store.evict(position);
+			evict_ms += elapsed_ms_since(start);
+			peak_resident = std::max(peak_resident, registry.serial_chunks.size());
+			if (walk.size() % 500 == 0)
+				peak_bytes = std::max(peak_bytes, resident_chunk_bytes());
+		}
+		peak_bytes = std::max(peak_bytes, resident_chunk_bytes());
+
+		std::uniform_int_distribution<int> pick(0, WALK_LENGTH - 1);
+		float page_in_ms = 0.f;
+		bool identical = true;
+		for (int i = 0; i < LOOKUPS; i++) {
+			const int w = pick(rng);
+			const auto start = Clock::now();
+			const bool found = chunk_store.page_in(walk[w].x, walk[w].y);
+			page_in_ms += elapsed_ms_since(start);
+			identical = identical && found && same_serialized_chunk(originals[w], registry.serial_chunks.get(walk[w].x, walk[w].y));
+		}
+
+		if (bounded)
+			printf("  %-10zu %12zu %14.1f %12.2f %12.1f %14.2f %10s\n", chunk_store.get_budget(), peak_resident, peak_bytes / 1024.f,
+				evict_ms, chunk_store.written_bytes() / 1024.f, page_in_ms * 1000.f / LOOKUPS, identical ? "yes" : "no");
+		else
+			printf("  %-10s %12zu %14.1f %12s %12s %14.2f %10s\n", "none", peak_resident, peak_bytes / 1024.f, "-", "-",
+				page_in_ms * 1000.f / LOOKUPS, identical ? "yes" : "no");
+	}
+
+	// files of the benchmark world are the only ones in the directory
+	chunk_store.reset(0, 0);
+	chunk_store.prune();
+	chunk_store.set_directory("");
+	registry.serial_chunks.clear();
+	RMDIR(directory.c_str());
+}
+
+
+void texture_decode()
+{
+	const int ROUNDS = 3;
+	const std::string cache_directory = "benchmark_texture_cache";
+	// the sheets that dominate startup: player animations, the crab and the blood overlay
+	std::vector<std::string> paths;
+	for (const char* weapon : { "Handgun", "Shotgun", "Rifle" })
+		for (const char* animation : { "idle", "move", "shoot", "reload", "hurt" })
+			paths.push_back(textures_path(std::string("Player/") + weapon + "/" + animation + ".png"));
+	paths.push_back(textures_path("Enemies/xylarite_crab.png"));
+	paths.push_back(textures_path("low_health_blood.png"));
+
+	size_t pixel_bytes = 0;
+	for (const std::string& path : paths) {
+		int width = 0, height = 0, channels = 0;
+		if (stbi_info(path.c_str(), &width, &height, &channels))
+			pixel_bytes += (size_t)width * height * 4;
+	}
+	printf("[textures] %zu textures, %.1f MB of RGBA, best of %d rounds\n", paths.size(), pixel_bytes / 1048576.f, ROUNDS);
+	printf("  %-22s %8s %10s %12s\n", "path", "threads", "ms", "from cache");
+
+	float serial_ms = 1e9f;
+	for (int round = 0; round < ROUNDS; round++) {
+		auto start = Clock::now();
+		for (const std::string& path : paths) {
+			int width, height;
+			stbi_uc* data = stbi_load(path.c_str(), &width, &height, NULL, 4);
+			stbi_image_free(data);
+		}
+		serial_ms = std::min(serial_ms, elapsed_ms_since(start));
+	}
+	printf("  %-22s %8d %10.2f %12s\n", "serial stbi_load", 1, serial_ms, "-");
+
+	unsigned int texture_checksum = 0;
+	for (int mode = 0; mode < 3; mode++) {
+		float best_ms = 1e9f;
+		size_t hits = 0;
+		unsigned int threads = 0;
+		for (int round = 0; round < ROUNDS; round++) {
+			// a cold cache starts from nothing every round
+			if (mode == 1)
+				for (const std::string& path : paths)
+					std::remove(TextureLoader::cache_path(cache_directory, path).c_str());
+			auto start = Clock::now();
+			TextureLoader loader(paths, mode == 0 ? std::string() : cache_directory);
+			// read every page like the GL upload would, so a mapped cache pays for its page faults
+			unsigned int checksum = 0;
+			for (size_t i = 0; i < paths.size(); i++) {
+				const DecodedTexture& texture = loader.wait(i);
+				const size_t bytes = (size_t)texture.size.x * texture.size.y * 4;
+				for (size_t b = 0; texture.pixels && b < bytes; b += 4096)
+					checksum += texture.pixels[b];
+			}
+			texture_checksum += checksum;
+			best_ms = std::min(best_ms, elapsed_ms_since(start));
+			hits = loader.cache_hits();
+			threads = loader.threads();
+		}
+		const char* names[] = { "parallel decode", "parallel, cold cache", "parallel, warm cache" };
+		printf("  %-22s %8u %10.2f %12zu\n", names[mode], threads, best_ms, hits);
+	}
+
+	printf("  (checksum %u)\n", texture_checksum);
+	for (const std::string& path : paths)
+		std::remove(TextureLoader::cache_path(cache_directory, path).c_str());
+	RMDIR(cache_directory.c_str());
+}
+
+
+// True if no two placements overlap, padding included, and all of them lie within their page
+static bool atlas_layout_valid(const AtlasLayout& layout, int max_page_size, int padding)
+{
+	for (size_t a = 0; a < layout.placements.size(); a++) {
+		const AtlasPlacement& pa = layout.placements[a];
+		if (pa.page < 0)
+			continue;
+		const glm::ivec2 end = pa.position + pa.size + glm::ivec2(padding);
+		if (pa.position.x < 0 || pa.position.y < 0 || end.x > layout.page_sizes[pa.page].x ||
+			end.y > layout.page_sizes[pa.page].y || end.x > max_page_size || end.y > max_page_size)
+			return false;
+		for (size_t b = a + 1; b < layout.placements.size(); b++) {
+			const AtlasPlacement& pb = layout.placements[b];
+			if (pb.page != pa.page)
+				continue;
+			const glm::ivec2 b_end = pb.position + pb.size + glm::ivec2(padding);
+			if (pa.position.x < b_end.x && pb.position.x < end.x && pa.position.y < b_end.y && pb.position.y < end.y)
+				return false;
+		}
+	}
+	return true;
+}
+
+void atlas_packing()
+{
+	const int REPEATS = 100;
+	const int SPRITE_COUNT = 2000;
+	const glm::vec2 VIEW_SIZE = { 1920.f, 1080.f };
+	// the sheets RenderSystem packs, see is_atlas_texture
+	std::vector<std::pair<TEXTURE_ASSET_ID, std::string>> sheets = {
+		{ TEXTURE_ASSET_ID::XY_CRAB, "Enemies/xylarite_crab.png" },
+		{ TEXTURE_ASSET_ID::ENEMY1, "Enemies/enemy1/1.png" },
+		{ TEXTURE_ASSET_ID::ENEMY1_DMG1, "Enemies/enemy1/2.png" },
+		{ TEXTURE_ASSET_ID::ENEMY1_DMG2, "Enemies/enemy1/3.png" },
+		{ TEXTURE_ASSET_ID::ENEMY1_DMG3, "Enemies/enemy1/4.png" },
+	};
+	const char* PLANT_ANIMATIONS[] = { "Idle", "Attack", "Hurt", "Death" };
+	for (int i = 0; i < 3; i++) {
+		const std::string n = std::to_string(i + 1);
+		sheets.push_back({ (TEXTURE_ASSET_ID)((int)TEXTURE_ASSET_ID::SLIME_1 + i), "Enemies/slime_" + n + ".png" });
+		for (int a = 0; a < 4; a++)
+			sheets.push_back({ (TEXTURE_ASSET_ID)((int)TEXTURE_ASSET_ID::PLANT_IDLE_1 + i * 4 + a),
+				std::string("Enemies/Plant_") + PLANT_ANIMATIONS[a] + "_" + n + ".png" });
+	}
+
+	std::vector<TEXTURE_ASSET_ID> textures;
+	std::vector<glm::ivec2> sizes;
+	long long texels = 0;
+	for (const auto& sheet : sheets) {
+		glm::ivec2 size;
+		int channels;
+		if (!stbi_info(textures_path(sheet.second).c_str(), &size.x, &size.y, &channels))
+			continue;
+		textures.push_back(sheet.first);
+		sizes.push_back(size);
+		texels += (long long)size.x * size.y;
+	}
+
+	printf("[atlas] %zu enemy sheets, %.1f Mtexels, pack time best of %d\n", sizes.size(), texels / 1e6f, REPEATS);
+	printf("  %-10s %8s %14s %12s %10s %8s\n", "max page", "pages", "largest page", "occupancy", "pack ms", "valid");
+	AtlasLayout layout;
+	for (int max_page_size : { 2048, 4096, 8192 }) {
+		float best_ms = 1e9f;
+		for (int r = 0; r < REPEATS; r++) {
+			auto start = Clock::now();
+			layout = pack_atlas(sizes, max_page_size);
+			best_ms = std::min(best_ms, elapsed_ms_since(start));
+		}
+		long long page_texels = 0;
+		glm::ivec2 largest = { 0, 0 };
+		for (const glm::ivec2& page : layout.page_sizes) {
+			page_texels += (long long)page.x * page.y;
+			if (page.x * page.y > largest.x * largest.y)
+				largest = page;
+		}
+		size_t packed = 0;
+		long long packed_texels = 0;
+		for (const AtlasPlacement& placement : layout.placements) {
+			if (placement.page < 0)
+				continue;
+			packed++;
+			packed_texels += (long long)placement.size.x * placement.size.y;
+		}
+		char largest_text[32];
+		snprintf(largest_text, sizeof(largest_text), "%dx%d", largest.x, largest.y);
+		printf("  %-10d %8zu %14s %11.1f%% %10.3f %8s   (%zu of %zu packed)\n", max_page_size, layout.page_sizes.size(), largest_text,
+			page_texels ? 100.f * packed_texels / page_texels : 0.f, best_ms, atlas_layout_valid(layout, max_page_size, ATLAS_PADDING) ? "yes" : "NO",
+			packed, sizes.size());
+	}
+
+	// random rectangles, to check the packer beyond the shipped sheets
+	std::mt19937 rng(22);
+	std::uniform_int_distribution<int> side_dist(1, 600);
+	std::vector<glm::ivec2> random_sizes(500);
+	for (glm::ivec2& size : random_sizes)
+		size = { side_dist(rng), side_dist(rng) };
+	const AtlasLayout random_layout = pack_atlas(random_sizes, 2048);
+	printf("  500 random rectangles: %zu pages of 2048, valid %s\n", random_layout.page_sizes.size(),
+		atlas_layout_valid(random_layout, 2048, ATLAS_PADDING) ? "yes" : "NO");
+	if (textures.empty())
+		return;
+
+	// the enemy-heavy scene the atlas is for, batched with and without it; a bind is counted
+	// whenever a batch samples a different GL texture than the one before
+	layout = pack_atlas(sizes, ATLAS_MAX_PAGE_SIZE);
+	TextureAtlasTable atlas;
+	atlas.assign(textures, layout);
+	registry.clear_all_components();
+	std::uniform_real_distribution<float> x_dist(0.f, VIEW_SIZE.x);
+	std::uniform_real_distribution<float> y_dist(0.f, VIEW_SIZE.y);
+	std::uniform_real_distribution<float> size_dist(24.f, 64.f);
+	std::uniform_int_distribution<size_t> texture_dist(0, textures.size() - 1);
+	for (int i = 0; i < SPRITE_COUNT; i++) {
+		Entity e;
+		Motion& motion = registry.motions.emplace(e);
+		motion.position = { x_dist(rng), y_dist(rng) };
+		const float size = size_dist(rng);
+		motion.scale = { size, size };
+		registry.renderRequests.insert(e, { textures[texture_dist(rng)], EFFECT_ASSET_ID::TEXTURED, GEOMETRY_BUFFER_ID::SPRITE });
+		Sprite& sprite = registry.sprites.emplace(e);
+		sprite.total_row = 1;
+		sprite.total_frame = 4;
+		registry.enemies.emplace(e);
+	}
+
+	printf("  %d enemy sprites on a %.0fx%.0f view:\n", SPRITE_COUNT, VIEW_SIZE.x, VIEW_SIZE.y);
+	printf("  %-14s %12s %12s\n", "textures", "draw calls", "binds");
+	for (int with_atlas = 0; with_atlas < 2; with_atlas++) {
+		SpriteBatchBuilder builder;
+		builder.set_atlas(with_atlas ? &atlas : nullptr);
+		for (size_t i = 0; i < registry.renderRequests.size(); i++) {
+			Entity e = registry.renderRequests.entities[i];
+			builder.add_entity(e, registry.renderRequests.components[i], registry.motions.get(e));
+		}
+		builder.finish();
+		size_t binds = 0;
+		int bound = -1;
+		for (const SpriteBatch& batch : builder.batches()) {
+			if ((int)batch.key.texture != bound)
+				binds++;
+			bound = (int)batch.key.texture;
+		}
+		printf("  %-14s %12zu %12zu\n", with_atlas ? "atlas pages" : "one per sheet", builder.draw_calls(), binds);
+	}
+
+	registry.clear_all_components();
+}
+
+
+void isoline_baking()
+{
+	const int CHUNK_SIDE = 8;
+	const int VIEW_COUNT = 1000;
+	const glm::vec2 VIEW_SIZE = { 1920.f, 1080.f };
+	const float chunk_size = (float)(CHUNK_CELLS_PER_ROW * CHUNK_CELL_SIZE);
+	const size_t blocks_per_row = CHUNK_CELLS_PER_ROW / CHUNK_ISOLINE_SIZE;
+
+	PerlinNoiseGenerator noise;
+	noise.init(24);
+	std::vector<ChunkCellGrid> chunks;
+	std::vector<glm::vec2> bases;
+	for (int c = 0; c < CHUNK_SIDE * CHUNK_SIDE; c++) {
+		const glm::vec2 chunk_pos = { c % CHUNK_SIDE - CHUNK_SIDE / 2, c / CHUNK_SIDE - CHUNK_SIDE / 2 };
+		chunks.push_back(generateChunkCells(chunk_pos, noise));
+		bases.push_back(chunk_pos * chunk_size);
+	}
+
+	// baked once per chunk at generation, instead of walked every frame
+	std::vector<std::vector<TexturedVertex>> meshes(chunks.size());
+	std::vector<std::vector<bool>> rock(chunks.size(), std::vector<bool>(blocks_per_row * blocks_per_row));
+	size_t tiles = 0;
+	auto start = Clock::now();
+	for (size_t c = 0; c < chunks.size(); c++)
+		tiles += build_chunk_isoline_mesh(chunks[c], bases[c], meshes[c]);
+	const float bake_ms = elapsed_ms_since(start);
+
+	// the blocks the per-block loop drew: any of its four corner cells holds an isoline state
+	auto is_iso = [](CHUNK_CELL_STATE state) { return state >= CHUNK_CELL_STATE::ISO_01 && state <= CHUNK_CELL_STATE::ISO_15; };
+	const size_t last = CHUNK_ISOLINE_SIZE - 1;
+	bool consistent = true;
+	for (size_t c = 0; c < chunks.size(); c++) {
+		const ChunkCellGrid& cells = chunks[c];
+		size_t rock_blocks = 0;
+		for (size_t i = 0; i < CHUNK_CELLS_PER_ROW; i += CHUNK_ISOLINE_SIZE) {
+			for (size_t j = 0; j < CHUNK_CELLS_PER_ROW; j += CHUNK_ISOLINE_SIZE) {
+				const bool has_rock = is_iso(cells[i][j]) || is_iso(cells[i][j + last]) || is_iso(cells[i + last][j]) || is_iso(cells[i + last][j + last]);
+				rock[c][(i / CHUNK_ISOLINE_SIZE) * blocks_per_row + j / CHUNK_ISOLINE_SIZE] = has_rock;
+				rock_blocks += has_rock;
+			}
+		}
+		// every baked tile must sit on a block with rock, one tile per block
+		consistent = consistent && meshes[c].size() == rock_blocks * ISOLINE_TILE_VERTICES;
+		for (size_t t = 0; t < meshes[c].size(); t += ISOLINE_TILE_VERTICES) {
+			const glm::vec2 center = (glm::vec2(meshes[c][t + 1].position) + glm::vec2(meshes[c][t + 2].position)) / 2.f - bases[c];
+			const size_t i = (size_t)(center.x / (CHUNK_CELL_SIZE * CHUNK_ISOLINE_SIZE));
+			const size_t j = (size_t)(center.y / (CHUNK_CELL_SIZE * CHUNK_ISOLINE_SIZE));
+			consistent = consistent && rock[c][i * blocks_per_row + j];
+		}
+	}
+
+	std::mt19937 rng(24);
+	std::uniform_real_distribution<float> x_dist(bases.front().x, bases.front().x + CHUNK_SIDE * chunk_size - VIEW_SIZE.x);
+	std::uniform_real_distribution<float> y_dist(bases.front().y, bases.front().y + CHUNK_SIDE * chunk_size - VIEW_SIZE.y);
+	size_t block_calls = 0, chunk_calls = 0;
+	for (int v = 0; v < VIEW_COUNT; v++) {
+		const glm::vec4 view = { 0.f, VIEW_SIZE.x, 0.f, VIEW_SIZE.y };
+		const glm::vec2 offset = { x_dist(rng), y_dist(rng) };
+		const glm::vec4 cam_view = view + glm::vec4(offset.x, offset.x, offset.y, offset.y);
+		for (size_t c = 0; c < chunks.size(); c++) {
+			const glm::vec2 base = bases[c];
+			if (base.x + chunk_size < cam_view.x || base.x > cam_view.y || base.y + chunk_size < cam_view.z || base.y > cam_view.w)
+				continue;
+			chunk_calls += !meshes[c].empty();
+			// the per-block culling drawChunks did before baking
+			for (size_t i = 0; i < CHUNK_CELLS_PER_ROW; i += CHUNK_ISOLINE_SIZE) {
+				if (base.x + (i + 4) * CHUNK_CELL_SIZE < cam_view.x || base.x + i * CHUNK_CELL_SIZE > cam_view.y)
+					continue;
+				for (size_t j = 0; j < CHUNK_CELLS_PER_ROW; j += CHUNK_ISOLINE_SIZE) {
+					if (base.y + (j + 4) * CHUNK_CELL_SIZE < cam_view.z || base.y + j * CHUNK_CELL_SIZE > cam_view.w)
+						continue;
+					block_calls += rock[c][(i / CHUNK_ISOLINE_SIZE) * blocks_per_row + j / CHUNK_ISOLINE_SIZE];
+				}
+			}
+		}
+	}
+
+	printf("[isolines] %zu chunks, %zu rock tiles, bake %.3f ms/chunk, %.1f KB of vertices/chunk, tiles match: %s\n",
+		chunks.size(), tiles, bake_ms / chunks.size(), (float)(tiles * ISOLINE_TILE_VERTICES * sizeof(TexturedVertex)) / 1024.f / chunks.size(),
+		consistent ? "yes" : "NO");
+	printf("  draw calls per %.0fx%.0f view, average of %d:\n", VIEW_SIZE.x, VIEW_SIZE.y, VIEW_COUNT);
+	printf("  %-14s %10.1f\n", "per block", (float)block_calls / VIEW_COUNT);
+	printf("  %-14s %10.1f\n", "baked chunks", (float)chunk_calls / VIEW_COUNT);
+}
+
+
+void shadow_sdf_options()
+{
+	const glm::ivec2 FRAMEBUFFER = { 1920, 1080 };
+	const int SPRITE_COUNT = 2000;
+	const int PHASE_FRAMES = 300;
+	const TEXTURE_ASSET_ID TEXTURES[] = {
+		TEXTURE_ASSET_ID::SLIME_1, TEXTURE_ASSET_ID::PLANT_IDLE_1, TEXTURE_ASSET_ID::TREE, TEXTURE_ASSET_ID::WALL,
+	};
+	const int TEXTURE_KINDS = sizeof(TEXTURES) / sizeof(TEXTURES[0]);
+
+	// texture fetches of one generation: the seed pass reads the scene pixels under each texel,
+	// every jump flood pass nine neighbours, and the distance pass one
+	printf("[sdf] one SDF generation for a %dx%d framebuffer\n", FRAMEBUFFER.x, FRAMEBUFFER.y);
+	printf("  %-8s %12s %8s %16s %10s\n", "divisor", "SDF size", "passes", "fetches (M)", "vs. full");
+	double fetches[SDF_RESOLUTION_DIVISOR_COUNT];
+	for (int d = 0; d < SDF_RESOLUTION_DIVISOR_COUNT; d++) {
+		const int divisor = SDF_RESOLUTION_DIVISORS[d];
+		const glm::ivec2 size = sdf_target_size(FRAMEBUFFER, divisor);
+		const double texels = (double)size.x * size.y;
+		const int passes = (int)ceil(log2(fmax(size.x, size.y)));
+		fetches[d] = texels * divisor * divisor + texels * 9 * passes + texels;
+		char size_text[32];
+		snprintf(size_text, sizeof(size_text), "%dx%d", size.x, size.y);
+		printf("  %-8d %12s %8d %16.1f %9.0f%%\n", divisor, size_text, passes, fetches[d] / 1e6, 100.0 * fetches[d] / fetches[0]);
+	}
+
+	registry.clear_all_components();
+	std::mt19937 rng(25);
+	std::uniform_real_distribution<float> x_dist(0.f, (float)FRAMEBUFFER.x);
+	std::uniform_real_distribution<float> y_dist(0.f, (float)FRAMEBUFFER.y);
+	std::uniform_int_distribution<int> texture_dist(0, TEXTURE_KINDS - 1);
+	std::uniform_int_distribution<int> percent_dist(0, 99);
+	std::vector<Entity> sprites;
+	for (int i = 0; i < SPRITE_COUNT; i++) {
+		Entity e;
+		Motion& motion = registry.motions.emplace(e);
+		motion.position = { x_dist(rng), y_dist(rng) };
+		motion.scale = { 48.f, 48.f };
+		RenderRequest& request = registry.renderRequests.emplace(e);
+		request.used_geometry = GEOMETRY_BUFFER_ID::SPRITE;
+		// one in ten is a coloured mesh, hashed from its components rather than an instance
+		if (percent_dist(rng) < 10) {
+			request.used_effect = EFFECT_ASSET_ID::COLOURED;
+			request.used_geometry = GEOMETRY_BUFFER_ID::BULLET_CIRCLE;
+		} else {
+			request.used_effect = EFFECT_ASSET_ID::TEXTURED;
+			request.used_texture = TEXTURES[texture_dist(rng)];
+			Sprite& sprite = registry.sprites.emplace(e);
+			sprite.total_row = 1;
+			sprite.total_frame = 4;
+		}
+		sprites.push_back(e);
+	}
+	const std::vector<unsigned int> chunk_ids = { 1, 2, 3, 4, 5, 6 };
+
+	// a scripted camera path: standing still while the camera settles on the player, walking, and
+	// standing still again while a few enemies move
+	struct Phase {
+		const char* name;
+		float camera_step;
+		int moving_sprites;
+	};
+	const Phase PHASES[] = { { "settling", 0.2f, 0 }, { "walking", 4.f, 0 }, { "enemies", 0.f, 20 } };
+
+	SpriteBatchBuilder builder;
+	std::vector<SdfCache> caches(SDF_RESOLUTION_DIVISOR_COUNT);
+	std::vector<std::vector<size_t>> regenerated(SDF_RESOLUTION_DIVISOR_COUNT);
+	std::uniform_int_distribution<size_t> sprite_dist(0, sprites.size() - 1);
+	glm::vec2 camera = { 0.f, 0.f };
+	float hash_ms = 0.f;
+	for (const Phase& phase : PHASES) {
+		for (SdfCache& cache : caches)
+			cache.reset_counts();
+		for (int f = 0; f < PHASE_FRAMES; f++) {
+			camera.x += phase.camera_step;
+			for (int m = 0; m < phase.moving_sprites; m++)
+				registry.motions.get(sprites[sprite_dist(rng)]).position.x += 1.f;
+
+			builder.clear();
+			for (size_t i = 0; i < registry.renderRequests.size(); i++) {
+				Entity e = registry.renderRequests.entities[i];
+				builder.add_entity(e, registry.renderRequests.components[i], registry.motions.get(e));
+			}
+			builder.finish();
+			auto start = Clock::now();
+			const uint64_t signature = occluder_signature(builder, chunk_ids);
+			hash_ms += elapsed_ms_since(start);
+
+			for (int d = 0; d < SDF_RESOLUTION_DIVISOR_COUNT; d++) {
+				const glm::ivec2 size = sdf_target_size(FRAMEBUFFER, SDF_RESOLUTION_DIVISORS[d]);
+				const bool hit = caches[d].can_reuse(signature, camera, size, SDF_RESOLUTION_DIVISORS[d]);
+				caches[d].count(hit);
+				if (!hit)
+					caches[d].store(signature, camera, size);
+			}
+		}
+		for (int d = 0; d < SDF_RESOLUTION_DIVISOR_COUNT; d++)
+			regenerated[d].push_back(caches[d].miss_count());
+	}
+
+	const int frames = PHASE_FRAMES * (int)(sizeof(PHASES) / sizeof(PHASES[0]));
+	printf("  occluder signature of %d sprites: %.3f ms/frame\n", SPRITE_COUNT, hash_ms / frames);
+	printf("  frames that regenerate the SDF with the cache, of %d per phase, and fetches per frame:\n", PHASE_FRAMES);
+	printf("  %-8s", "divisor");
+	for (const Phase& phase : PHASES)
+		printf(" %10s", phase.name);
+	printf(" %16s %16s\n", "no cache (M)", "cache (M)");
+	for (int d = 0; d < SDF_RESOLUTION_DIVISOR_COUNT; d++) {
+		size_t total = 0;
+		printf("  %-8d", SDF_RESOLUTION_DIVISORS[d]);
+		for (size_t count : regenerated[d]) {
+			printf(" %10zu", count);
+			total += count;
+		}
+		printf(" %16.1f %16.1f\n", fetches[d] / 1e6, fetches[d] * total / frames / 1e6);
+	}
+
+	registry.clear_all_components();
+}
+
+}
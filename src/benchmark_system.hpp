@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string>
+
+// Headless stress benchmarks, run with `eclipse --benchmark <name>` (or `all`).
+// They drive the systems directly on the global registry, without a window or GL context,
+// and print their timings to stdout.
+namespace benchmark {
+
+// Runs the named benchmark; returns false if the name is unknown
+bool run(const std::string& name);
+
+// 5k moving colliders through PhysicsSystem::step, all-pairs vs. uniform-grid broadphase
+void physics_broadphase();
+
+// ComponentContainer insert/lookup/iterate/remove at 1k, 10k and 100k entities, per index backend
+void ecs_storage();
+
+// Flow field full rebuild, one-cell incremental update and cached step, per field radius
+void pathfinding_field();
+
+// Chunk cell probe throughput: per-probe chunk lookup vs. WorldCellQuery's cached get and rectangle fetch
+void world_cell_probes();
+
+// Perlin noise samples per second, one noise() call per point vs. noise_batch and noise_grid, plus chunk cell generation
+void noise_throughput();
+
+// Scene sprite draw calls per entity vs. SpriteBatchBuilder batches, batch build time and a draw order check
+void sprite_batching();
+
+// Light gather and tile binning time at 1, 50 and 500 lights, and the per-pixel lighting work
+// of one full-screen pass per light vs. the tiled pass
+void light_tiling();
+
+// Particles emitted and retired at 100k per second: one entity per particle vs. ParticlePool
+void particle_churn();
+
+// Boss minion flocking at 100, 1k and 5k minions: all-pairs through the registry vs. BoidSwarm
+void minion_swarm();
+
+// Horde soak test: enemies ramp from 250 to 3000 around the player while pathfinding, steering,
+// physics and sprite batching run; frame time percentiles per step of the ramp, LOD tier on vs. off
+void horde_soak();
+
+// AISystem::enemyStep at 1k, 10k and 100k enemies with a tenth hurt and a tenth dying, per-enemy
+// animation callbacks vs. the animation table; component size and swap-remove time
+void enemy_animation_step();
+
+// Saves and loads 1,000 serialized chunks as JSON and as the binary format: time, file size and a round-trip check
+void save_round_trip();
+
+// Explores 20k chunks with and without the chunk region store's resident budget: resident chunks
+// and bytes, eviction time, bytes on disk, page-in time per chunk and a check against the originals
+void region_paging();
+
+// Decodes the largest texture sheets serially with stbi_load, on TextureLoader threads, and through
+// TextureLoader with a cold and a warm decoded-texture cache
+void texture_decode();
+
+// Packs the enemy sheets into atlas pages of 2k, 4k and 8k: page count, occupancy, pack time and an
+// overlap/bounds check, then draw calls and texture binds for 2k enemy sprites with and without the atlas
+void atlas_packing();
+
+// Bakes the isoline tiles of 64 generated chunks into per-chunk meshes: bake time, vertex size and a
+// check against the blocks, then draw calls per view drawing block by block vs. one call per chunk
+void isoline_baking();
+
+// Texture fetches of one shadow SDF generation at each resolution divisor, then the occluder
+// signature's cost and how often the SDF cache regenerates along a scripted camera path
+void shadow_sdf_options();
+
+}
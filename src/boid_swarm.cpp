@@ -0,0 +1,112 @@
+// internal
+#include "boid_swarm.hpp"
+
+// stlib
+#include <algorithm>
+#include <cmath>
+
+void BoidSwarm::clear()
+{
+	positions.clear();
+	velocities.clear();
+	phases.clear();
+	scattering.clear();
+	position_sum = { 0.f, 0.f };
+}
+
+unsigned int BoidSwarm::add(vec2 position, vec2 velocity, float phase, bool is_scattering)
+{
+	const unsigned int index = (unsigned int)positions.size();
+	positions.push_back(position);
+	velocities.push_back(velocity);
+	phases.push_back(phase);
+	scattering.push_back(is_scattering);
+	position_sum += position;
+	return index;
+}
+
+vec2 BoidSwarm::center() const
+{
+	return positions.empty() ? vec2(0.f, 0.f) : position_sum / (float)positions.size();
+}
+
+void BoidSwarm::update(const BoidParams& params, vec2 target, float time)
+{
+	const unsigned int count = (unsigned int)positions.size();
+	if (count == 0)
+		return;
+
+	const float radius = std::max(params.desired_distance, std::max(params.cohesion_radius, params.align_radius));
+	grid.clear(radius);
+	for (const vec2& position : positions)
+		grid.add(position);
+	grid.build();
+
+	const vec2 swarm_center = center();
+	vec2 to_target = target - swarm_center;
+	const float target_length = sqrt(to_target.x * to_target.x + to_target.y * to_target.y);
+	if (target_length > 0.0001f)
+		to_target = to_target / target_length;
+
+	for (unsigned int i = 0; i < count; i++) {
+		const vec2 p = positions[i];
+
+		vec2 sep = { 0.f, 0.f };
+		vec2 coh = { 0.f, 0.f };
+		vec2 ali = { 0.f, 0.f };
+		int coh_count = 0;
+		int ali_count = 0;
+
+		grid.query_radius(p, radius, [&](unsigned int o) {
+			if (o == i)
+				return;
+			const vec2 d = positions[o] - p;
+			const float dsq = d.x * d.x + d.y * d.y;
+			if (dsq < 0.0001f)
+				return;
+
+			const float l = sqrt(dsq);
+			const vec2 nd = d / l;
+			if (l < params.desired_distance)
+				sep -= nd * (params.desired_distance - l);
+			if (l < params.cohesion_radius) {
+				coh += positions[o];
+				coh_count++;
+			}
+			if (l < params.align_radius) {
+				ali += velocities[o];
+				ali_count++;
+			}
+		});
+
+		if (coh_count > 0)
+			coh = coh / (float)coh_count - p;
+		if (ali_count > 0)
+			ali /= (float)ali_count;
+
+		if (scattering[i]) {
+			velocities[i] += sep * params.scatter_separation_weight;
+			continue;
+		}
+
+		const float wave_angle = time * params.wave_speed + phases[i];
+		const vec2 wave = vec2(cos(wave_angle), sin(wave_angle)) * params.wave_amplitude;
+
+		vec2 to_center = swarm_center - p;
+		const float center_length = sqrt(to_center.x * to_center.x + to_center.y * to_center.y);
+		if (center_length > 0.0001f)
+			to_center = to_center / center_length;
+
+		vec2 v = (to_target + to_center * params.center_weight) * params.max_speed;
+		v += sep * params.separation_weight;
+		v += coh * params.cohesion_weight;
+		v += ali * params.align_weight;
+		v += wave;
+
+		const float speed = sqrt(v.x * v.x + v.y * v.y);
+		if (speed > params.max_speed)
+			v = v * (params.max_speed / speed);
+
+		velocities[i] = v;
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "common.hpp"
+#include "spatial_grid.hpp"
+
+#include <vector>
+
+// Tuning of a BoidSwarm; distances in px, speeds in px/s
+struct BoidParams {
+	float max_speed = 250.f;
+	float desired_distance = 28.f;   // closer neighbors push each other apart
+	float cohesion_radius = 90.f;    // neighbors pulled towards within this distance
+	float align_radius = 50.f;       // neighbors matched in velocity within this distance
+	float separation_weight = 2.2f;
+	float cohesion_weight = 0.45f;
+	float align_weight = 0.25f;
+	float center_weight = 0.8f;      // pull back towards the swarm center
+	float wave_amplitude = 6.f;
+	float wave_speed = 2.5f;
+	float scatter_separation_weight = 3.f;  // scattering boids add this much of their separation instead of steering
+};
+
+// Separation, cohesion and alignment for a swarm chasing a target, with no ECS access of its own.
+//
+// The caller adds every boid's position and velocity once per frame; they are kept in packed
+// arrays and bucketed into a NeighborGrid whose cells match the largest interaction radius, so a
+// step only compares boids in neighboring cells instead of all pairs. The swarm center is summed
+// while the boids are added. Results are read back by the index add() returned.
+//
+// Boids are updated in place, in the order they were added: alignment sees the velocities the
+// boids before it took this frame, and the start-of-frame velocities of the ones after it.
+class BoidSwarm
+{
+public:
+	void clear();
+
+	// Adds a boid; phase offsets its wobble so the swarm does not sway in lockstep. A scattering
+	// boid is not steered and only gets pushed away from its neighbors.
+	unsigned int add(vec2 position, vec2 velocity, float phase, bool scattering = false);
+
+	// Computes every boid's new velocity, steering towards target at the given time in seconds
+	void update(const BoidParams& params, vec2 target, float time);
+
+	size_t size() const { return positions.size(); }
+	vec2 center() const;
+
+	// Velocity the boid takes this frame; capped to max_speed unless it is scattering
+	vec2 velocity(unsigned int i) const { return velocities[i]; }
+
+private:
+	std::vector<vec2> positions;
+	std::vector<vec2> velocities;
+	std::vector<float> phases;
+	std::vector<unsigned char> scattering;
+	vec2 position_sum = { 0.f, 0.f };
+	NeighborGrid grid;
+};
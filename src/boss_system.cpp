@@ -1,7 +1,9 @@
 #include "boss_system.hpp"
+#include "boid_swarm.hpp"
 #include "world_system.hpp"
 #include "components.hpp"
 #include "common.hpp"
+#include <algorithm>
 #include <iostream>
 
 namespace boss {
@@ -37,6 +39,7 @@ static float spin_speed = 0.f;
 
 // Swarm stuffs
 static std::vector<Entity> swarm;
+static BoidSwarm swarm_boids;
 static float enemy_spawn_timer = 0.f;
 static float next_enemy_spawn = 0.f;
 
@@ -81,6 +84,7 @@ void startBossFight() {
 
   registry.serial_chunks.clear();
   registry.chunks.clear();
+  renderer->releaseChunkMeshes();
   while (!registry.obstacles.entities.empty()) {
     Entity obstacle = registry.obstacles.entities.back();
     registry.remove_all_components_of(obstacle);
@@ -640,46 +644,18 @@ void updateMinionSpawn(float dt) {
   }
 }
 
-vec2 computeSwarmCenter() {
-  if (swarm.empty()) return center;
-  vec2 c = {0,0};
-  int n = 0;
-  for (Entity e : swarm) {
-    if (!registry.minions.has(e)) continue;
-    c += registry.motions.get(e).position;
-    n++;
-  }
-  if (n == 0) return center;
-  return c / (float)n;
-}
-
-vec2 computeSwarmDirection() {
-  if (swarm.empty()) return vec2(1,0);
-  vec2 v = {0,0};
-  int n = 0;
-  for (Entity e : swarm) {
-    if (!registry.minions.has(e)) continue;
-    v += registry.motions.get(e).velocity;
-    n++;
-  }
-  if (n == 0) return vec2(1,0);
-  float l = sqrt(v.x*v.x + v.y*v.y);
-  if (l < 0.0001f) return vec2(1,0);
-  return v / l;
-}
-
 void onMinionDeath(vec2 deathPos) {
   swarm_shock_pos = deathPos;
   swarm_shock_flag = true;
 }
 
 void updateMinionBehavior(float dt) {
+  // forget minions that have died since the last frame
+  swarm.erase(std::remove_if(swarm.begin(), swarm.end(), [](Entity e) { return !registry.minions.has(e); }), swarm.end());
   if (swarm.empty()) return;
 
   if (swarm_shock_flag) {
     for (Entity e : swarm) {
-      if (!registry.minions.has(e)) continue;
-
       Motion& m = registry.motions.get(e);
       vec2 p = m.position;
 
@@ -703,96 +679,40 @@ void updateMinionBehavior(float dt) {
     swarm_shock_flag = false;
   }
 
-  if (swarm.empty()) return;
-
-  vec2 pp = registry.motions.get(player).position;
-  vec2 swarm_center = computeSwarmCenter();
-  vec2 swarm_dir = computeSwarmDirection();
-
-  vec2 toPlayer = pp - swarm_center;
-  float pl = sqrt(toPlayer.x*toPlayer.x + toPlayer.y*toPlayer.y);
-  if (pl > 0.0001f) toPlayer = toPlayer / pl;
-
-  float t = glfwGetTime();
-
+  // one registry lookup per minion, then the flocking runs on the packed copy; a scattering
+  // minion's jitter goes in first so the minions after it align with it, as they always have
+  swarm_boids.clear();
   for (Entity e : swarm) {
-    if (!registry.minions.has(e)) continue;
-
-    Motion& m = registry.motions.get(e);
-    vec2 p = m.position;
-
-    vec2 sep = {0,0};
-    vec2 coh = {0,0};
-    vec2 ali = {0,0};
-    int cohN = 0;
-    int aliN = 0;
-
-    for (Entity o : swarm) {
-      if (o == e) continue;
-      if (!registry.minions.has(o)) continue;
-
-      Motion& om = registry.motions.get(o);
-      vec2 d = om.position - p;
-      float dsq = d.x*d.x + d.y*d.y;
-      if (dsq < 0.0001f) continue;
-
-      float l = sqrt(dsq);
-      vec2 nd = d / l;
-
-      if (l < DESIRED_DIST) {
-        sep -= nd * (DESIRED_DIST - l);
-      }
-
-      if (l < COHESION_WEIGHT * 200.f) {
-        coh += om.position;
-        cohN++;
-      }
-
-      if (l < ALIGN_WEIGHT * 200.f) {
-        ali += om.velocity;
-        aliN++;
-      }
+    const Motion& m = registry.motions.get(e);
+    const bool scattering = registry.minions.get(e).scatter_timer > 0.f;
+    vec2 velocity = m.velocity;
+    if (scattering) {
+      velocity.x += frand(-50.f, 50.f);
+      velocity.y += frand(-50.f, 50.f);
     }
+    swarm_boids.add(m.position, velocity, (float)e, scattering);
+  }
 
-    if (cohN > 0) {
-      coh /= (float)cohN;
-      coh = coh - p;
-    }
-
-    if (aliN > 0) {
-      ali /= (float)aliN;
-    }
-
-    vec2 wave = vec2(cos(t * WAVE_SPEED + (float)e), sin(t * WAVE_SPEED + (float)e)) * WAVE_AMPLITUDE;
-
-    vec2 toCenter = swarm_center - p;
-    float cl = sqrt(toCenter.x*toCenter.x + toCenter.y*toCenter.y);
-    if (cl > 0.0001f) toCenter = toCenter / cl;
-
-    vec2 base = toPlayer + toCenter * CENTER_WEIGHT;
-
-    vec2 v = base * MINION_SPEED;
-    v += sep * SEPARATION_WEIGHT;
-    v += coh * COHESION_WEIGHT;
-    v += ali * ALIGN_WEIGHT;
-    v += wave;
-
-    float vl = sqrt(v.x*v.x + v.y*v.y);
-    if (vl > MINION_SPEED) v = v * (MINION_SPEED / vl);
-
+  BoidParams params;
+  params.max_speed = MINION_SPEED;
+  params.desired_distance = DESIRED_DIST;
+  params.cohesion_radius = COHESION_WEIGHT * 200.f;
+  params.align_radius = ALIGN_WEIGHT * 200.f;
+  params.separation_weight = SEPARATION_WEIGHT;
+  params.cohesion_weight = COHESION_WEIGHT;
+  params.align_weight = ALIGN_WEIGHT;
+  params.center_weight = CENTER_WEIGHT;
+  params.wave_amplitude = WAVE_AMPLITUDE;
+  params.wave_speed = WAVE_SPEED;
+  swarm_boids.update(params, registry.motions.get(player).position, glfwGetTime());
+
+  for (unsigned int i = 0; i < swarm.size(); i++) {
+    Entity e = swarm[i];
     Minion& mn = registry.minions.get(e);
-
-    if (mn.scatter_timer > 0.f) {
+    if (mn.scatter_timer > 0.f)
       mn.scatter_timer -= dt;
 
-      m.velocity += sep * 3.0f;
-      m.velocity.x += frand(-50.f, 50.f);
-      m.velocity.y += frand(-50.f, 50.f);
-
-      continue;
-    }
-
-    m.velocity = v;
+    registry.motions.get(e).velocity = swarm_boids.velocity(i);
   }
 }
 
@@ -0,0 +1,142 @@
+// internal
+#include "chunk_generator.hpp"
+#include "tiny_ecs_registry.hpp"
+#include "world_init.hpp"
+
+// stlib
+#include <algorithm>
+
+ChunkGenerator::~ChunkGenerator()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	work_ready.notify_all();
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+void ChunkGenerator::start_workers()
+{
+	// leave a core for the main thread; generation is bursty, so two workers are plenty
+	unsigned int count = std::max(1u, std::min(2u, std::thread::hardware_concurrency() - 1));
+	for (unsigned int i = 0; i < count; i++)
+		workers.emplace_back(&ChunkGenerator::worker_loop, this);
+}
+
+void ChunkGenerator::reset(const PerlinNoiseGenerator& map_noise, unsigned int new_decorator_seed)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (workers.empty())
+		start_workers();
+
+	// running jobs finish against their own copy of the old noise and are discarded by epoch
+	jobs.clear();
+	queue.clear();
+	noise = std::make_shared<const PerlinNoiseGenerator>(map_noise);
+	decorator_seed = new_decorator_seed;
+	epoch++;
+}
+
+void ChunkGenerator::prefetch(ivec2 min_chunk, ivec2 max_chunk)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!noise)
+		return;
+
+	// forget work that scrolled out of range, except jobs a worker is busy with
+	for (auto it = jobs.begin(); it != jobs.end();) {
+		ivec2 pos = it->second.chunk_pos;
+		bool in_range = pos.x >= min_chunk.x && pos.x <= max_chunk.x && pos.y >= min_chunk.y && pos.y <= max_chunk.y;
+		if (!in_range && it->second.state != JobState::RUNNING)
+			it = jobs.erase(it);
+		else
+			++it;
+	}
+	queue.erase(std::remove_if(queue.begin(), queue.end(), [&](int k) { return jobs.count(k) == 0; }), queue.end());
+
+	bool queued = false;
+	for (int i = min_chunk.x; i <= max_chunk.x; i++) {
+		for (int j = min_chunk.y; j <= max_chunk.y; j++) {
+			ivec2 pos = { i, j };
+			if (registry.chunks.has((short)i, (short)j) || jobs.count(key(pos)))
+				continue;
+			Job& job = jobs[key(pos)];
+			job.chunk_pos = pos;
+			queue.push_back(key(pos));
+			queued = true;
+		}
+	}
+	if (queued)
+		work_ready.notify_all();
+}
+
+void ChunkGenerator::worker_loop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		work_ready.wait(lock, [&] { return stopping || !queue.empty(); });
+		if (stopping)
+			return;
+
+		int job_key = queue.front();
+		queue.pop_front();
+		auto it = jobs.find(job_key);
+		if (it == jobs.end() || it->second.state != JobState::QUEUED)
+			continue;
+		it->second.state = JobState::RUNNING;
+		ivec2 pos = it->second.chunk_pos;
+		std::shared_ptr<const PerlinNoiseGenerator> job_noise = noise;
+		unsigned int job_epoch = epoch;
+
+		lock.unlock();
+		ChunkCellGrid cells = generateChunkCells(vec2(pos), *job_noise);
+		lock.lock();
+
+		// a reset in the meantime invalidated this job
+		if (job_epoch != epoch)
+			continue;
+		it = jobs.find(job_key);
+		if (it != jobs.end() && it->second.state == JobState::RUNNING) {
+			it->second.cells = cells;
+			it->second.state = JobState::DONE;
+		}
+		work_done.notify_all();
+	}
+}
+
+// Copies the chunk's prefetched cells into `out`. Waits if a worker is on it right now;
+// returns false if nobody started on it, in which case the caller generates it itself.
+bool ChunkGenerator::take(ivec2 chunk_pos, ChunkCellGrid& out)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	auto it = jobs.find(key(chunk_pos));
+	if (it == jobs.end())
+		return false;
+	if (it->second.state == JobState::QUEUED) {
+		jobs.erase(it);
+		return false;
+	}
+
+	work_done.wait(lock, [&] { return jobs.find(key(chunk_pos))->second.state == JobState::DONE; });
+	it = jobs.find(key(chunk_pos));
+	out = it->second.cells;
+	jobs.erase(it);
+	return true;
+}
+
+Chunk& ChunkGenerator::materialize(RenderSystem* renderer, ivec2 chunk_pos, PerlinNoiseGenerator& map_noise, PerlinNoiseGenerator& decorator_noise,
+	bool is_spawn_chunk, bool is_boss_chunk)
+{
+	std::seed_seq seed{ decorator_seed, (unsigned int)chunk_pos.x, (unsigned int)chunk_pos.y };
+	std::default_random_engine chunk_rng(seed);
+
+	ChunkCellGrid cells;
+	if (take(chunk_pos, cells)) {
+		prefetch_hits++;
+		return generateChunk(renderer, vec2(chunk_pos), map_noise, decorator_noise, chunk_rng, is_spawn_chunk, is_boss_chunk, &cells);
+	}
+	prefetch_misses++;
+	return generateChunk(renderer, vec2(chunk_pos), map_noise, decorator_noise, chunk_rng, is_spawn_chunk, is_boss_chunk);
+}
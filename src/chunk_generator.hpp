@@ -0,0 +1,79 @@
+#pragma once
+
+// internal
+#include "common.hpp"
+#include "components.hpp"
+#include "noise_gen.hpp"
+
+// stlib
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class RenderSystem;
+
+// How much main-thread time chunk materialization may take per frame (at least one chunk always goes through)
+const float CHUNK_MATERIALIZE_BUDGET_MS = 3.f;
+// How many chunks beyond the needed area have their cells prefetched
+const int CHUNK_PREFETCH_RING = 1;
+
+// Runs the expensive, noise-only part of chunk generation (generateChunkCells) on worker threads
+// ahead of the camera, and hands the results to generateChunk when the main thread needs a chunk.
+//
+// Output only depends on the seeds and the chunk position: cells are a pure function of the map
+// noise, and each chunk's structures and trees draw from their own rng seeded by position rather
+// than from a shared stream whose state depends on the order chunks were visited in.
+class ChunkGenerator
+{
+public:
+	ChunkGenerator() {}
+	~ChunkGenerator();
+	ChunkGenerator(const ChunkGenerator&) = delete;
+	ChunkGenerator& operator=(const ChunkGenerator&) = delete;
+
+	// Drops all pending work and starts over with new seeds; call whenever the map noise is re-initialized
+	void reset(const PerlinNoiseGenerator& map_noise, unsigned int decorator_seed);
+
+	// Queues cell generation for every unloaded chunk in [min_chunk, max_chunk] and forgets
+	// queued or finished chunks that are no longer inside it
+	void prefetch(ivec2 min_chunk, ivec2 max_chunk);
+
+	// Creates the chunk's entities on the main thread, using prefetched cells when available
+	Chunk& materialize(RenderSystem* renderer, ivec2 chunk_pos, PerlinNoiseGenerator& map_noise, PerlinNoiseGenerator& decorator_noise,
+		bool is_spawn_chunk = false, bool is_boss_chunk = false);
+
+	// Chunks materialized with prefetched cells vs. generated on the spot, for tuning the ring
+	unsigned int prefetch_hits = 0;
+	unsigned int prefetch_misses = 0;
+
+private:
+	enum class JobState { QUEUED, RUNNING, DONE };
+	struct Job {
+		ivec2 chunk_pos = { 0, 0 };
+		JobState state = JobState::QUEUED;
+		ChunkCellGrid cells{};
+	};
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable work_ready;
+	std::condition_variable work_done;
+	bool stopping = false;
+
+	// Everything below is guarded by `mutex`
+	std::unordered_map<int, Job> jobs;
+	std::deque<int> queue;
+	std::shared_ptr<const PerlinNoiseGenerator> noise;
+	unsigned int epoch = 0;
+	unsigned int decorator_seed = 0;
+
+	void start_workers();
+	void worker_loop();
+	bool take(ivec2 chunk_pos, ChunkCellGrid& out);
+	static int key(ivec2 chunk_pos) { return chunk_pos.x + chunk_pos.y * 65536; }
+};
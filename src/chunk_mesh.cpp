@@ -0,0 +1,54 @@
+// internal
+#include "chunk_mesh.hpp"
+
+// stlib
+#include <algorithm>
+
+static unsigned char state_to_iso_bitmap(CHUNK_CELL_STATE state)
+{
+	if (state >= CHUNK_CELL_STATE::ISO_01 && state <= CHUNK_CELL_STATE::ISO_15)
+		return (unsigned char)state;
+	return 0;
+}
+
+// Where a unit texcoord of a tile lands in the texture column of its state; this is what
+// tiled.vs.glsl used to compute per vertex from the s_bit uniform
+static vec2 isoline_texcoord(unsigned char state, vec2 uv)
+{
+	const float state_width = 1.f / (float)ISOLINE_TEXTURE_STATES;
+	const float x_offset = 2.f / 512.f;
+	const float y_offset = 16.f / 64.f;
+	return vec2(((float)(state - 1) + uv.x) * state_width + (float)state * x_offset, uv.y / 2.f + y_offset);
+}
+
+size_t build_chunk_isoline_mesh(const ChunkCellGrid& cells, vec2 base_position, std::vector<TexturedVertex>& vertices)
+{
+	const float cell_size = (float)CHUNK_CELL_SIZE;
+	const float half_tile = cell_size * CHUNK_ISOLINE_SIZE / 2.f;
+	// corners in the order and orientation of the SPRITE quad, as two counterclockwise triangles
+	const vec2 corners[4] = { { -1.f, 1.f }, { 1.f, 1.f }, { 1.f, -1.f }, { -1.f, -1.f } };
+	const vec2 corner_uvs[4] = { { 0.f, 1.f }, { 1.f, 1.f }, { 1.f, 0.f }, { 0.f, 0.f } };
+	const int order[ISOLINE_TILE_VERTICES] = { 0, 3, 1, 1, 3, 2 };
+
+	size_t tiles = 0;
+	for (size_t i = 0; i < CHUNK_CELLS_PER_ROW; i += CHUNK_ISOLINE_SIZE) {
+		for (size_t j = 0; j < CHUNK_CELLS_PER_ROW; j += CHUNK_ISOLINE_SIZE) {
+			const size_t last = CHUNK_ISOLINE_SIZE - 1;
+			const unsigned char state = std::max(
+				std::max(state_to_iso_bitmap(cells[i][j]), state_to_iso_bitmap(cells[i][j + last])),
+				std::max(state_to_iso_bitmap(cells[i + last][j]), state_to_iso_bitmap(cells[i + last][j + last])));
+			if (state == 0)
+				continue;
+
+			const vec2 center = base_position + vec2((float)i * cell_size + half_tile, (float)j * cell_size + half_tile);
+			for (int k : order) {
+				TexturedVertex vertex;
+				vertex.position = vec3(center + corners[k] * half_tile, 0.f);
+				vertex.texcoord = isoline_texcoord(state, corner_uvs[k]);
+				vertices.push_back(vertex);
+			}
+			tiles++;
+		}
+	}
+	return tiles;
+}
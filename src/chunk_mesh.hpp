@@ -0,0 +1,17 @@
+#pragma once
+
+#include "common.hpp"
+#include "components.hpp"
+
+#include <vector>
+
+// Columns of the isoline rock texture, one per marching squares state (0, no rock, is unused)
+const int ISOLINE_TEXTURE_STATES = 16;
+// An isoline tile is two triangles, baked without an index buffer
+const int ISOLINE_TILE_VERTICES = 6;
+
+// Appends the isoline tiles of a chunk's cells to vertices as a world-space triangle list, each
+// tile with the texture coordinates of its state's column already applied, so a whole chunk draws
+// with the tiled effect in one call. base_position is the chunk's top-left corner in world units.
+// Pure CPU work; returns the number of tiles appended.
+size_t build_chunk_isoline_mesh(const ChunkCellGrid& cells, vec2 base_position, std::vector<TexturedVertex>& vertices);
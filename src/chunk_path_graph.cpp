@@ -0,0 +1,384 @@
+#include "chunk_path_graph.hpp"
+
+#include "pathfinding_system.hpp"
+#include "tiny_ecs_registry.hpp"
+#include "world_cells.hpp"
+
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+
+namespace {
+    constexpr int CHUNK_SIDE = (int)CHUNK_CELLS_PER_ROW;
+    constexpr int CHUNK_AREA = CHUNK_SIDE * CHUNK_SIDE;
+    constexpr uint16_t UNREACHABLE = 0xFFFF;
+    constexpr int GOAL_HOP = -2;
+    // Walkable border runs up to this long get a single portal in the middle, longer ones one at each end
+    constexpr int MAX_SINGLE_PORTAL_RUN = 6;
+    // A goal or waypoint hop can pass through several nodes sharing a cell (chunk corners)
+    constexpr int MAX_HOPS_PER_QUERY = 8;
+
+    inline int chunk_key(glm::ivec2 chunk) {
+        return chunk.x + chunk.y * 65536;
+    }
+
+    inline int local_index(glm::ivec2 local) {
+        return local.y * CHUNK_SIDE + local.x;
+    }
+
+    inline bool is_in_chunk(glm::ivec2 local) {
+        return local.x >= 0 && local.y >= 0 && local.x < CHUNK_SIDE && local.y < CHUNK_SIDE;
+    }
+
+    // Same rule as the flow field so enemies see one map when they cross into it
+    inline bool is_walkable(CHUNK_CELL_STATE state) {
+        return state != CHUNK_CELL_STATE::OBSTACLE;
+    }
+
+    inline bool is_walkable(Chunk& chunk, glm::ivec2 local) {
+        return is_walkable(chunk.cell_states[local.x][local.y]);
+    }
+}
+
+const ChunkPathGraph::ChunkPortals* ChunkPathGraph::find_chunk(glm::ivec2 chunk) const {
+    auto it = chunk_portals.find(chunk_key(chunk));
+    return it == chunk_portals.end() ? nullptr : &it->second;
+}
+
+void ChunkPathGraph::sync() {
+    if (synced && registry.chunks.version() == seen_chunks_version) return;
+    synced = true;
+    seen_chunks_version = registry.chunks.version();
+
+    std::unordered_map<int, size_t> loaded;
+    for (size_t i = 0; i < registry.chunks.size(); i++)
+        loaded[chunk_key({ registry.chunks.position_xs[i], registry.chunks.position_ys[i] })] = i;
+
+    // A chunk regenerated at the same position (e.g. after a restart) counts as removed and re-added
+    std::vector<int> removed;
+    for (const auto& entry : chunk_portals) {
+        auto it = loaded.find(entry.first);
+        if (it == loaded.end() || registry.chunks.components[it->second].id != entry.second.chunk_id)
+            removed.push_back(entry.first);
+    }
+    for (int key : removed)
+        remove_chunk(key);
+
+    for (const auto& entry : loaded) {
+        if (chunk_portals.count(entry.first)) continue;
+        size_t i = entry.second;
+        add_chunk({ registry.chunks.position_xs[i], registry.chunks.position_ys[i] }, registry.chunks.components[i].id);
+    }
+}
+
+int ChunkPathGraph::new_node(glm::ivec2 cell, glm::ivec2 chunk) {
+    int id;
+    if (!free_nodes.empty()) {
+        id = free_nodes.back();
+        free_nodes.pop_back();
+    } else {
+        id = (int)nodes.size();
+        nodes.emplace_back();
+    }
+    PortalNode& n = nodes[id];
+    n.cell = cell;
+    n.chunk = chunk;
+    n.partner = -1;
+    n.alive = true;
+    chunk_portals[chunk_key(chunk)].nodes.push_back(id);
+    return id;
+}
+
+void ChunkPathGraph::free_node(int id) {
+    PortalNode& n = nodes[id];
+    n.alive = false;
+    n.partner = -1;
+    CostField().swap(n.cost_to_here);
+    free_nodes.push_back(id);
+}
+
+void ChunkPathGraph::add_chunk(glm::ivec2 chunk, unsigned int chunk_id) {
+    ChunkPortals& portals = chunk_portals[chunk_key(chunk)];
+    portals.chunk = chunk;
+    portals.chunk_id = chunk_id;
+
+    // Portals on every border shared with an already loaded neighbour
+    std::vector<int> created;
+    const glm::ivec2 neighbours[] = { { 1, 0 }, { 0, 1 }, { -1, 0 }, { 0, -1 } };
+    for (const glm::ivec2& offset : neighbours) {
+        glm::ivec2 other = chunk + offset;
+        if (!find_chunk(other)) continue;
+        // borders are always built from the west/north chunk's point of view
+        if (offset.x + offset.y > 0)
+            add_border_portals(chunk, other, created);
+        else
+            add_border_portals(other, chunk, created);
+    }
+
+    // Cache per-cell costs for the new nodes, one chunk at a time so walkability is sampled once
+    std::vector<glm::ivec2> touched{ chunk };
+    for (int id : created)
+        if (nodes[id].chunk != chunk) touched.push_back(nodes[id].chunk);
+    for (const glm::ivec2& c : touched) {
+        bool sampled = false;
+        for (int id : created) {
+            PortalNode& n = nodes[id];
+            if (n.chunk != c || !n.cost_to_here.empty()) continue;
+            if (!sampled) {
+                sample_walkable(c);
+                sampled = true;
+            }
+            build_cost_field(n.cell - c * CHUNK_SIDE, n.cost_to_here);
+        }
+    }
+    graph_version++;
+}
+
+void ChunkPathGraph::remove_chunk(int key) {
+    auto it = chunk_portals.find(key);
+    if (it == chunk_portals.end()) return;
+
+    // Every node of this chunk takes its partner in the neighbouring chunk with it
+    for (int id : it->second.nodes) {
+        int partner = nodes[id].partner;
+        if (partner >= 0 && nodes[partner].alive) {
+            auto neighbour = chunk_portals.find(chunk_key(nodes[partner].chunk));
+            if (neighbour != chunk_portals.end()) {
+                std::vector<int>& list = neighbour->second.nodes;
+                for (size_t i = 0; i < list.size(); i++) {
+                    if (list[i] == partner) {
+                        list[i] = list.back();
+                        list.pop_back();
+                        break;
+                    }
+                }
+            }
+            free_node(partner);
+        }
+        free_node(id);
+    }
+    chunk_portals.erase(it);
+    graph_version++;
+}
+
+// `a` is the west (or north) chunk and `b` the east (or south) one
+void ChunkPathGraph::add_border_portals(glm::ivec2 a, glm::ivec2 b, std::vector<int>& created) {
+    if (!registry.chunks.has((short)a.x, (short)a.y) || !registry.chunks.has((short)b.x, (short)b.y))
+        return;
+    Chunk& chunk_a = registry.chunks.get((short)a.x, (short)a.y);
+    Chunk& chunk_b = registry.chunks.get((short)b.x, (short)b.y);
+
+    // Each side's first border cell and the step along the border
+    const bool east = (b.x != a.x);
+    const glm::ivec2 along = east ? glm::ivec2{ 0, 1 } : glm::ivec2{ 1, 0 };
+    const glm::ivec2 a_start = east ? glm::ivec2{ CHUNK_SIDE - 1, 0 } : glm::ivec2{ 0, CHUNK_SIDE - 1 };
+    const glm::ivec2 b_start{ 0, 0 };
+
+    auto add_portal = [&](int i) {
+        glm::ivec2 local_a = a_start + along * i;
+        glm::ivec2 local_b = b_start + along * i;
+        int node_a = new_node(a * CHUNK_SIDE + local_a, a);
+        int node_b = new_node(b * CHUNK_SIDE + local_b, b);
+        nodes[node_a].partner = node_b;
+        nodes[node_b].partner = node_a;
+        created.push_back(node_a);
+        created.push_back(node_b);
+    };
+
+    int run_start = -1;
+    for (int i = 0; i <= CHUNK_SIDE; i++) {
+        bool open = i < CHUNK_SIDE
+            && is_walkable(chunk_a, a_start + along * i)
+            && is_walkable(chunk_b, b_start + along * i);
+        if (open && run_start < 0) {
+            run_start = i;
+        } else if (!open && run_start >= 0) {
+            int run_end = i - 1;
+            if (run_end - run_start + 1 <= MAX_SINGLE_PORTAL_RUN) {
+                add_portal((run_start + run_end) / 2);
+            } else {
+                add_portal(run_start);
+                add_portal(run_end);
+            }
+            run_start = -1;
+        }
+    }
+}
+
+void ChunkPathGraph::sample_walkable(glm::ivec2 chunk) {
+    walkable.assign(CHUNK_AREA, 0);
+    if (!registry.chunks.has((short)chunk.x, (short)chunk.y)) return;
+    Chunk& c = registry.chunks.get((short)chunk.x, (short)chunk.y);
+    for (int y = 0; y < CHUNK_SIDE; y++)
+        for (int x = 0; x < CHUNK_SIDE; x++)
+            walkable[local_index({ x, y })] = is_walkable(c, { x, y });
+}
+
+// Dial's algorithm over one chunk, same as PathfindingSystem::build_flow_field.
+// Moves are symmetric, so the cost from `local_start` to a cell equals the cost back.
+void ChunkPathGraph::build_cost_field(glm::ivec2 local_start, CostField& cost) {
+    cost.assign(CHUNK_AREA, UNREACHABLE);
+    int start = local_index(local_start);
+    if (!walkable[start]) return;
+
+    const int bucket_count = DIAGONAL_COST + 1;
+    cost_buckets.resize(bucket_count);
+    for (auto& bucket : cost_buckets)
+        bucket.clear();
+
+    cost[start] = 0;
+    cost_buckets[0].push_back(start);
+    size_t pending = 1;
+
+    for (int curr_cost = 0; pending > 0; curr_cost++) {
+        std::vector<int>& bucket = cost_buckets[curr_cost % bucket_count];
+        for (int index : bucket) {
+            pending--;
+            if (curr_cost > cost[index]) continue;
+
+            glm::ivec2 curr_pos{ index % CHUNK_SIDE, index / CHUNK_SIDE };
+            for (const auto& dir : DIRECTIONS) {
+                glm::ivec2 next_pos = curr_pos + dir;
+                if (!is_in_chunk(next_pos)) continue;
+                int next = local_index(next_pos);
+                if (!walkable[next]) continue;
+
+                int next_cost = curr_cost + ((dir.x && dir.y) ? DIAGONAL_COST : CARDINAL_COST);
+                if (next_cost < cost[next]) {
+                    cost[next] = (uint16_t)next_cost;
+                    cost_buckets[next_cost % bucket_count].push_back(next);
+                    pending++;
+                }
+            }
+        }
+        bucket.clear();
+    }
+}
+
+void ChunkPathGraph::set_goal(glm::ivec2 cell) {
+    const bool graph_changed = goal_graph_version != graph_version;
+    if (goal_valid && cell == goal_cell && !graph_changed) return;
+
+    const glm::ivec2 chunk = chunk_of_cell(cell);
+    const bool chunk_changed = !goal_valid || chunk != goal_chunk;
+    goal_cell = cell;
+    goal_chunk = chunk;
+    goal_graph_version = graph_version;
+    goal_valid = true;
+
+    goal_cost.clear();
+    if (find_chunk(goal_chunk)) {
+        sample_walkable(goal_chunk);
+        build_cost_field(goal_cell - goal_chunk * CHUNK_SIDE, goal_cost);
+    }
+
+    // Moving within the goal chunk only refreshes goal_cost. Far enemies keep heading for the
+    // same portals, which is close enough until they enter the chunk and descend goal_cost.
+    if (chunk_changed || graph_changed || !goal_reachable)
+        search_from_goal();
+}
+
+// Backward Dijkstra over the abstract graph from a virtual node joined to every portal of the goal chunk
+void ChunkPathGraph::search_from_goal() {
+    node_dist.assign(nodes.size(), std::numeric_limits<int>::max());
+    node_next.assign(nodes.size(), -1);
+    goal_reachable = false;
+
+    const ChunkPortals* home = find_chunk(goal_chunk);
+    if (!home || goal_cost.empty()) return;
+
+    using QueueEntry = std::pair<int, int>;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> open;
+    for (int id : home->nodes) {
+        uint16_t cost = goal_cost[local_index(nodes[id].cell - goal_chunk * CHUNK_SIDE)];
+        if (cost == UNREACHABLE) continue;
+        node_dist[id] = cost;
+        node_next[id] = GOAL_HOP;
+        open.push({ cost, id });
+        goal_reachable = true;
+    }
+
+    while (!open.empty()) {
+        QueueEntry top = open.top();
+        open.pop();
+        int dist = top.first, id = top.second;
+        if (dist > node_dist[id]) continue;
+        const PortalNode& n = nodes[id];
+
+        auto relax = [&](int other, int step_cost) {
+            if (step_cost == UNREACHABLE) return;
+            if (dist + step_cost < node_dist[other]) {
+                node_dist[other] = dist + step_cost;
+                node_next[other] = id;
+                open.push({ node_dist[other], other });
+            }
+        };
+
+        if (n.partner >= 0)
+            relax(n.partner, CARDINAL_COST);
+        const ChunkPortals* portals = find_chunk(n.chunk);
+        if (!portals) continue;
+        for (int other : portals->nodes) {
+            if (other == id) continue;
+            relax(other, n.cost_to_here[local_index(nodes[other].cell - n.chunk * CHUNK_SIDE)]);
+        }
+    }
+}
+
+// Picks the walkable neighbour of `cell` with the lowest cost in the given field
+bool ChunkPathGraph::descend(const CostField& cost, glm::ivec2 cell, glm::ivec2 chunk, glm::ivec2& out) const {
+    glm::ivec2 local = cell - chunk * CHUNK_SIDE;
+    uint16_t best = cost[local_index(local)];
+    if (best == UNREACHABLE) return false;
+    bool found = false;
+    for (const auto& dir : DIRECTIONS) {
+        glm::ivec2 next = local + dir;
+        if (!is_in_chunk(next)) continue;
+        uint16_t next_cost = cost[local_index(next)];
+        if (next_cost < best) {
+            best = next_cost;
+            out = cell + dir;
+            found = true;
+        }
+    }
+    return found;
+}
+
+bool ChunkPathGraph::next_waypoint(glm::ivec2 cell, glm::ivec2& out) const {
+    if (!goal_valid || goal_graph_version != graph_version || goal_cost.empty()) return false;
+
+    glm::ivec2 chunk = chunk_of_cell(cell);
+    if (chunk == goal_chunk)
+        return descend(goal_cost, cell, chunk, out);
+
+    const ChunkPortals* portals = find_chunk(chunk);
+    if (!portals) return false;
+
+    // Cheapest way out of this chunk: walk to a portal node, then follow the shared abstract path
+    int local = local_index(cell - chunk * CHUNK_SIDE);
+    int best = -1;
+    int best_cost = std::numeric_limits<int>::max();
+    for (int id : portals->nodes) {
+        const PortalNode& n = nodes[id];
+        if (node_dist[id] == std::numeric_limits<int>::max() || n.cost_to_here[local] == UNREACHABLE) continue;
+        int total = n.cost_to_here[local] + node_dist[id];
+        if (total < best_cost) {
+            best_cost = total;
+            best = id;
+        }
+    }
+    if (best < 0) return false;
+
+    // Standing on the node already: move on to its next hop
+    for (int hops = 0; hops < MAX_HOPS_PER_QUERY && nodes[best].cell == cell; hops++) {
+        int next = node_next[best];
+        if (next < 0) return false;
+        if (nodes[next].chunk != chunk) {
+            out = nodes[next].cell;
+            return true;
+        }
+        best = next;
+    }
+    return descend(nodes[best].cost_to_here, cell, chunk, out);
+}
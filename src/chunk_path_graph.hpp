@@ -0,0 +1,83 @@
+#pragma once
+
+#include <glm/vec2.hpp>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Hierarchical (HPA*-style) abstraction over the loaded chunks, used to route enemies that are
+// outside the player's flow field.
+//
+// Every border shared by two loaded chunks gets portals: one per short walkable run, one at each
+// end of a long run. A portal is a pair of nodes, one on each side of the border. Each node caches
+// the cost from every cell of its own chunk to itself, which doubles as the intra-chunk edge cost
+// to the other nodes of that chunk. The graph is patched when chunks load or unload.
+//
+// A single backward search from the goal gives every node its remaining cost and next hop, so all
+// far enemies heading for the same goal share one abstract path computation.
+class ChunkPathGraph {
+public:
+	// Adds or drops chunks to match registry.chunks; cheap when nothing was (un)loaded
+	void sync();
+
+	// Routes towards the given global cell; recomputed only if the goal or the graph changed
+	void set_goal(glm::ivec2 goal_cell);
+
+	// Writes the next cell to walk towards from `cell`. Returns false if there is no known route,
+	// e.g. the cell is in an unloaded chunk or walled off from the goal.
+	bool next_waypoint(glm::ivec2 cell, glm::ivec2& out) const;
+
+	size_t node_count() const { return nodes.size() - free_nodes.size(); }
+
+private:
+	using CostField = std::vector<uint16_t>;
+
+	struct PortalNode {
+		glm::ivec2 cell{ 0, 0 };        // global cell coordinate
+		glm::ivec2 chunk{ 0, 0 };
+		int partner = -1;               // node on the other side of the border
+		bool alive = false;
+		CostField cost_to_here;         // cost from each cell of `chunk` to this node
+	};
+
+	struct ChunkPortals {
+		glm::ivec2 chunk{ 0, 0 };
+		unsigned int chunk_id = 0;      // Chunk::id when the portals were built
+		std::vector<int> nodes;
+	};
+
+	std::vector<PortalNode> nodes;
+	std::vector<int> free_nodes;
+	std::unordered_map<int, ChunkPortals> chunk_portals;
+	unsigned int seen_chunks_version = 0;
+	bool synced = false;
+	unsigned int graph_version = 0;
+
+	// Goal state, shared by every query until the goal or the graph changes
+	glm::ivec2 goal_cell{ 0, 0 };
+	glm::ivec2 goal_chunk{ 0, 0 };
+	bool goal_valid = false;
+	bool goal_reachable = false;        // some portal of the goal chunk reached the goal in the last search
+	unsigned int goal_graph_version = 0;
+	CostField goal_cost;                // cost from each cell of the goal chunk to the goal
+	std::vector<int> node_dist;         // cost from each node to the goal
+	std::vector<int> node_next;         // next hop towards the goal, or GOAL_HOP
+
+	// Scratch space reused between searches
+	std::vector<char> walkable;
+	std::vector<std::vector<int>> cost_buckets;
+
+	void add_chunk(glm::ivec2 chunk, unsigned int chunk_id);
+	void remove_chunk(int key);
+	void add_border_portals(glm::ivec2 a, glm::ivec2 b, std::vector<int>& created);
+	int new_node(glm::ivec2 cell, glm::ivec2 chunk);
+	void free_node(int id);
+
+	void sample_walkable(glm::ivec2 chunk);
+	void build_cost_field(glm::ivec2 local_start, CostField& cost);
+	void search_from_goal();
+
+	bool descend(const CostField& cost, glm::ivec2 cell, glm::ivec2 chunk, glm::ivec2& out) const;
+	const ChunkPortals* find_chunk(glm::ivec2 chunk) const;
+};
@@ -0,0 +1,405 @@
+// internal
+#include "chunk_region_store.hpp"
+#include "save_stream.hpp"
+#include "save_system.hpp"
+#include "tiny_ecs_registry.hpp"
+
+// stlib
+#include <algorithm>
+#include <exception>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <io.h>
+#else
+#include <dirent.h>
+#include <sys/mman.h>
+#endif
+
+ChunkRegionStore chunk_store;
+
+// Magic, version and the two seeds
+static const size_t REGION_HEADER_SIZE = 4 * sizeof(uint32_t);
+
+static int region_coordinate(int chunk)
+{
+	return chunk >= 0 ? chunk / CHUNK_REGION_SIZE : -((CHUNK_REGION_SIZE - 1 - chunk) / CHUNK_REGION_SIZE);
+}
+
+static long long region_key(int region_x, int region_y)
+{
+	return ((long long)region_x << 32) | (unsigned int)region_y;
+}
+
+static int entry_index(int x, int y)
+{
+	return (x - region_coordinate(x) * CHUNK_REGION_SIZE) + (y - region_coordinate(y) * CHUNK_REGION_SIZE) * CHUNK_REGION_SIZE;
+}
+
+ChunkRegionStore::~ChunkRegionStore()
+{
+	close();
+}
+
+void ChunkRegionStore::set_directory(const std::string& region_directory)
+{
+	close();
+	directory = region_directory;
+}
+
+void ChunkRegionStore::reset(unsigned int map_seed_arg, unsigned int decorator_seed_arg)
+{
+	close();
+	map_seed = map_seed_arg;
+	decorator_seed = decorator_seed_arg;
+	evictions = 0;
+	page_ins = 0;
+	bytes_written = 0;
+}
+
+void ChunkRegionStore::close()
+{
+	for (auto& it : regions) {
+		Region& region = *it.second;
+		unmap(region);
+		if (region.file)
+			fclose(region.file);
+	}
+	regions.clear();
+}
+
+std::string ChunkRegionStore::world_prefix() const
+{
+	return "w" + std::to_string(map_seed) + "_" + std::to_string(decorator_seed) + ".";
+}
+
+std::string ChunkRegionStore::region_path(int region_x, int region_y) const
+{
+	return directory + "/" + world_prefix() + std::to_string(region_x) + "." + std::to_string(region_y) + ".region";
+}
+
+void ChunkRegionStore::prune(const std::vector<std::string>& keep_worlds)
+{
+	if (!is_open())
+		return;
+
+	std::vector<std::string> names;
+#ifdef _WIN32
+	WIN32_FIND_DATAA found;
+	HANDLE search = FindFirstFileA((directory + "/*.region").c_str(), &found);
+	if (search != INVALID_HANDLE_VALUE) {
+		do {
+			names.push_back(found.cFileName);
+		} while (FindNextFileA(search, &found));
+		FindClose(search);
+	}
+#else
+	if (DIR* dir = opendir(directory.c_str())) {
+		while (dirent* entry = readdir(dir)) {
+			const std::string name = entry->d_name;
+			if (name.size() > 7 && name.compare(name.size() - 7, 7, ".region") == 0)
+				names.push_back(name);
+		}
+		closedir(dir);
+	}
+#endif
+
+	std::vector<std::string> kept = keep_worlds;
+	kept.push_back(world_prefix());
+	for (const std::string& name : names) {
+		const bool keep = std::any_of(kept.begin(), kept.end(), [&](const std::string& prefix) {
+			return name.compare(0, prefix.size(), prefix) == 0;
+		});
+		if (!keep)
+			std::remove((directory + "/" + name).c_str());
+	}
+}
+
+ChunkRegionStore::Region& ChunkRegionStore::region_of(int x, int y)
+{
+	const int region_x = region_coordinate(x);
+	const int region_y = region_coordinate(y);
+	std::unique_ptr<Region>& slot = regions[region_key(region_x, region_y)];
+	if (slot)
+		return *slot;
+
+	slot.reset(new Region());
+	Region& region = *slot;
+	region.x = region_x;
+	region.y = region_y;
+
+	FILE* file = fopen(region_path(region_x, region_y).c_str(), "r+b");
+	if (file == nullptr)
+		return region;
+
+	// the records already there stay for the saves that point at them; this session's table
+	// starts empty until read_tables fills it in
+	char header[REGION_HEADER_SIZE];
+	bool valid = fread(header, 1, sizeof(header), file) == sizeof(header);
+	if (valid) {
+		SaveReader in(header, sizeof(header));
+		valid = in.read_u32() == CHUNK_REGION_MAGIC && in.read_u32() == CHUNK_REGION_VERSION &&
+			in.read_u32() == map_seed && in.read_u32() == decorator_seed;
+	}
+	if (!valid) {
+		// another world's region, or a damaged one: replaced on the first write
+		fclose(file);
+		return region;
+	}
+	fseek(file, 0, SEEK_END);
+	region.file_size = (size_t)ftell(file);
+	region.file = file;
+	return region;
+}
+
+bool ChunkRegionStore::create_file(Region& region)
+{
+	const std::string path = region_path(region.x, region.y);
+	region.file = fopen(path.c_str(), "w+b");
+	if (region.file == nullptr) {
+		fprintf(stderr, "Failed to create chunk region file: %s\n", path.c_str());
+		return false;
+	}
+
+	SaveWriter header;
+	header.write_u32(CHUNK_REGION_MAGIC);
+	header.write_u32(CHUNK_REGION_VERSION);
+	header.write_u32(map_seed);
+	header.write_u32(decorator_seed);
+	region.entries.fill(RegionEntry());
+	region.file_size = fwrite(header.data().data(), 1, header.size(), region.file);
+	if (region.file_size != REGION_HEADER_SIZE) {
+		fprintf(stderr, "Failed to write chunk region file: %s\n", path.c_str());
+		fclose(region.file);
+		region.file = nullptr;
+		return false;
+	}
+	return true;
+}
+
+bool ChunkRegionStore::map(Region& region)
+{
+	unmap(region);
+	if (region.file == nullptr)
+		return false;
+#ifdef _WIN32
+	HANDLE file_handle = (HANDLE)_get_osfhandle(_fileno(region.file));
+	HANDLE mapping = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr)
+		return false;
+	const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == nullptr) {
+		CloseHandle(mapping);
+		return false;
+	}
+	region.mapping = mapping;
+	region.mapped = (const char*)view;
+#else
+	void* view = mmap(nullptr, region.file_size, PROT_READ, MAP_SHARED, fileno(region.file), 0);
+	if (view == MAP_FAILED)
+		return false;
+	region.mapped = (const char*)view;
+#endif
+	region.mapped_size = region.file_size;
+	return true;
+}
+
+void ChunkRegionStore::unmap(Region& region)
+{
+	if (region.mapped == nullptr)
+		return;
+#ifdef _WIN32
+	UnmapViewOfFile(region.mapped);
+	CloseHandle(region.mapping);
+	region.mapping = nullptr;
+#else
+	munmap((void*)region.mapped, region.mapped_size);
+#endif
+	region.mapped = nullptr;
+	region.mapped_size = 0;
+}
+
+void ChunkRegionStore::append(Region& region, const std::vector<ivec2>& chunks)
+{
+	if (region.file == nullptr && !create_file(region))
+		return;
+	// the file only grows, but Windows will not extend a mapped file
+	unmap(region);
+
+	const std::array<RegionEntry, CHUNK_REGION_CHUNKS> previous_entries = region.entries;
+	SaveWriter records;
+	for (ivec2 chunk : chunks) {
+		const size_t start = records.size();
+		write_serialized_chunk(records, registry.serial_chunks.get(chunk.x, chunk.y));
+		RegionEntry& entry = region.entries[entry_index(chunk.x, chunk.y)];
+		entry.offset = (uint32_t)(region.file_size + start);
+		entry.length = (uint32_t)(records.size() - start);
+	}
+
+	// only ever past the end, so the bytes every saved table points at stay as they were
+	bool ok = fseek(region.file, (long)region.file_size, SEEK_SET) == 0 &&
+		fwrite(records.data().data(), 1, records.size(), region.file) == records.size();
+	ok = fflush(region.file) == 0 && ok;
+	if (!ok) {
+		fprintf(stderr, "Failed to write chunk region file: %s\n", region_path(region.x, region.y).c_str());
+		region.entries = previous_entries;
+		return;
+	}
+	region.file_size += records.size();
+	bytes_written += records.size();
+}
+
+void ChunkRegionStore::store(std::vector<ivec2>& chunks)
+{
+	std::sort(chunks.begin(), chunks.end(), [](ivec2 a, ivec2 b) {
+		const long long key_a = region_key(region_coordinate(a.x), region_coordinate(a.y));
+		const long long key_b = region_key(region_coordinate(b.x), region_coordinate(b.y));
+		return key_a < key_b;
+	});
+
+	std::vector<ivec2> unstored;
+	size_t i = 0;
+	while (i < chunks.size()) {
+		Region& region = region_of(chunks[i].x, chunks[i].y);
+		unstored.clear();
+		for (; i < chunks.size() && &region_of(chunks[i].x, chunks[i].y) == &region; i++) {
+			if (region.entries[entry_index(chunks[i].x, chunks[i].y)].offset == 0)
+				unstored.push_back(chunks[i]);
+		}
+		if (!unstored.empty())
+			append(region, unstored);
+	}
+}
+
+bool ChunkRegionStore::is_stored(int x, int y) const
+{
+	// a region gets its entry in `regions` before any of its chunks is stored
+	auto it = regions.find(region_key(region_coordinate(x), region_coordinate(y)));
+	return it != regions.end() && it->second->entries[entry_index(x, y)].offset != 0;
+}
+
+bool ChunkRegionStore::page_in(int x, int y)
+{
+	if (registry.serial_chunks.has(x, y))
+		return true;
+	if (!is_open())
+		return false;
+
+	Region& region = region_of(x, y);
+	RegionEntry& entry = region.entries[entry_index(x, y)];
+	if (entry.offset == 0)
+		return false;
+	if ((size_t)entry.offset + entry.length > region.mapped_size && !map(region))
+		return false;
+
+	SerializedChunk chunk;
+	try {
+		SaveReader in(region.mapped + entry.offset, entry.length);
+		read_serialized_chunk(in, chunk);
+	} catch (const std::exception& e) {
+		// regenerated from the seeds instead
+		fprintf(stderr, "Bad chunk record (%d, %d) in %s: %s\n", x, y, region_path(region.x, region.y).c_str(), e.what());
+		entry = RegionEntry();
+		return false;
+	}
+	registry.serial_chunks.insert(x, y, std::move(chunk));
+	page_ins++;
+	return true;
+}
+
+void ChunkRegionStore::evict(ivec2 center_chunk)
+{
+	auto& serial_chunks = registry.serial_chunks;
+	if (!is_open() || serial_chunks.components.size() <= budget)
+		return;
+
+	// down to three quarters of the budget, so eviction does not run again a few chunks later
+	const size_t excess = serial_chunks.components.size() - (budget - budget / 4);
+	std::vector<std::pair<int, ivec2>> candidates;
+	candidates.reserve(serial_chunks.components.size());
+	for (size_t i = 0; i < serial_chunks.components.size(); i++) {
+		const ivec2 chunk(serial_chunks.position_xs[i], serial_chunks.position_ys[i]);
+		if (registry.chunks.has(chunk.x, chunk.y))
+			continue;
+		const ivec2 d = chunk - center_chunk;
+		candidates.push_back({ d.x * d.x + d.y * d.y, chunk });
+	}
+	if (candidates.size() > excess) {
+		std::nth_element(candidates.begin(), candidates.begin() + excess, candidates.end(),
+			[](const std::pair<int, ivec2>& a, const std::pair<int, ivec2>& b) { return a.first > b.first; });
+		candidates.resize(excess);
+	}
+
+	std::vector<ivec2> victims;
+	victims.reserve(candidates.size());
+	for (const auto& candidate : candidates)
+		victims.push_back(candidate.second);
+	store(victims);
+
+	// anything that failed to write stays resident
+	for (ivec2 chunk : victims) {
+		if (!is_stored(chunk.x, chunk.y))
+			continue;
+		serial_chunks.remove(chunk.x, chunk.y);
+		evictions++;
+	}
+}
+
+// Per region with stored chunks: i32 region x, i32 region y, u32 file length the table covers,
+// u32 entry count, per entry: u32 index in the region, u32 offset, u32 length
+void ChunkRegionStore::write_tables(SaveWriter& out) const
+{
+	out.write_u32(CHUNK_REGION_VERSION);
+	std::vector<std::pair<const Region*, uint32_t>> stored;
+	for (const auto& it : regions) {
+		const Region& region = *it.second;
+		const uint32_t count = (uint32_t)std::count_if(region.entries.begin(), region.entries.end(),
+			[](const RegionEntry& entry) { return entry.offset != 0; });
+		if (count > 0)
+			stored.push_back({ &region, count });
+	}
+	out.write_u32((uint32_t)stored.size());
+	for (const auto& it : stored) {
+		const Region& region = *it.first;
+		out.write_i32(region.x);
+		out.write_i32(region.y);
+		out.write_u32((uint32_t)region.file_size);
+		out.write_u32(it.second);
+		for (int i = 0; i < CHUNK_REGION_CHUNKS; i++) {
+			const RegionEntry& entry = region.entries[i];
+			if (entry.offset == 0)
+				continue;
+			out.write_u32((uint32_t)i);
+			out.write_u32(entry.offset);
+			out.write_u32(entry.length);
+		}
+	}
+}
+
+void ChunkRegionStore::read_tables(SaveReader& in)
+{
+	// an older layout points into files that no longer match; those chunks are regenerated
+	if (!is_open() || in.read_u32() != CHUNK_REGION_VERSION)
+		return;
+	const uint32_t region_count = in.read_count(16);
+	for (uint32_t r = 0; r < region_count; r++) {
+		const int region_x = in.read_i32();
+		const int region_y = in.read_i32();
+		const size_t covered = in.read_u32();
+		const uint32_t entry_count = in.read_count(12);
+		Region& region = region_of(region_x * CHUNK_REGION_SIZE, region_y * CHUNK_REGION_SIZE);
+		// a file that lost records the save needs keeps the ones still there
+		const size_t end = std::min(covered, region.file ? region.file_size : 0);
+		for (uint32_t e = 0; e < entry_count; e++) {
+			const uint32_t index = in.read_u32();
+			RegionEntry entry;
+			entry.offset = in.read_u32();
+			entry.length = in.read_u32();
+			if (index < (uint32_t)CHUNK_REGION_CHUNKS && entry.offset >= REGION_HEADER_SIZE &&
+				(size_t)entry.offset + entry.length <= end)
+				region.entries[index] = entry;
+		}
+	}
+}
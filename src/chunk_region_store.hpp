@@ -0,0 +1,124 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct SerializedChunk;
+class SaveWriter;
+class SaveReader;
+
+// Chunks per region file along each axis
+const int CHUNK_REGION_SIZE = 32;
+const int CHUNK_REGION_CHUNKS = CHUNK_REGION_SIZE * CHUNK_REGION_SIZE;
+// "ECRG" at the start of every region file
+const uint32_t CHUNK_REGION_MAGIC = 0x47524345;
+// Region file header and REGIONS save section layout
+const uint32_t CHUNK_REGION_VERSION = 2;
+// Serialized chunks kept in registry.serial_chunks before the farthest are evicted to disk
+const size_t CHUNK_RESIDENT_BUDGET = 512;
+
+// Disk store for the SerializedChunks of the current world, one file per
+// CHUNK_REGION_SIZE x CHUNK_REGION_SIZE block of chunks.
+//
+// A region file starts with its magic, version and the world seeds, followed by chunk records in
+// the layout save files use for serialized chunks. Files are append-only: a record is never
+// rewritten or moved, and a stored chunk is not written again. Where each chunk's record is lives
+// only in memory, in an {offset, length} table per region, and saves keep a copy of those tables
+// (write_tables) instead of the file holding one, so records appended after a save, or an append
+// cut short by a crash, never change what the save loads. Reads go through a read-only memory
+// mapping of the file, redone after the file has grown. A file that does not match the seeds is
+// treated as empty and replaced on the first write.
+//
+// Once registry.serial_chunks holds more chunks than the budget, the ones farthest from the player
+// are written out and dropped from it, and page_in brings a chunk back when it is needed again.
+// The files of a saved world are kept until the save is overwritten or deleted.
+class ChunkRegionStore
+{
+public:
+	~ChunkRegionStore();
+
+	// Directory holding the region files; the store does nothing until one is set
+	void set_directory(const std::string& directory);
+	// Starts over for a world with these seeds with nothing stored, closing every open region
+	void reset(unsigned int map_seed, unsigned int decorator_seed);
+	// Unmaps and closes every region file
+	void close();
+	// Deletes the region files of every world other than the current one and keep_worlds (given
+	// by world_prefix); call once no save on disk or in flight references them
+	void prune(const std::vector<std::string>& keep_worlds = std::vector<std::string>());
+	// Start of the current world's region file names; they start with the seeds, so worlds never share a file
+	std::string world_prefix() const;
+	bool is_open() const { return !directory.empty(); }
+
+	void set_budget(size_t chunks) { budget = chunks; }
+	size_t get_budget() const { return budget; }
+
+	// Brings a stored chunk back into registry.serial_chunks unless it is already there; returns
+	// whether serial_chunks has the chunk now
+	bool page_in(int x, int y);
+	// When over budget, writes out the serialized chunks farthest from center_chunk and drops
+	// them from RAM; chunks currently loaded are kept
+	void evict(ivec2 center_chunk);
+	// True if the chunk has a record on disk; never touches the files
+	bool is_stored(int x, int y) const;
+
+	// The offset table and covered file length of every region with stored chunks, for the
+	// REGIONS section of a save
+	void write_tables(SaveWriter& out) const;
+	// Replaces the tables with a save's after reset; records missing from the files are dropped
+	// and those chunks regenerated from the seeds
+	void read_tables(SaveReader& in);
+
+	// Totals since the last reset
+	size_t evicted_count() const { return evictions; }
+	size_t paged_in_count() const { return page_ins; }
+	size_t written_bytes() const { return bytes_written; }
+
+private:
+	struct RegionEntry {
+		uint32_t offset = 0;  // 0 when the chunk is not stored
+		uint32_t length = 0;
+	};
+
+	struct Region {
+		int x = 0, y = 0;
+		FILE* file = nullptr;       // null until the first write when there is no valid file
+		size_t file_size = 0;
+		std::array<RegionEntry, CHUNK_REGION_CHUNKS> entries{};
+		const char* mapped = nullptr;
+		size_t mapped_size = 0;
+#ifdef _WIN32
+		void* mapping = nullptr;
+#endif
+	};
+
+	Region& region_of(int x, int y);
+	std::string region_path(int region_x, int region_y) const;
+	bool create_file(Region& region);
+	bool map(Region& region);
+	void unmap(Region& region);
+	// Appends the given chunks, all from this region
+	void append(Region& region, const std::vector<ivec2>& chunks);
+	// Writes the resident chunks in `chunks` that have no record yet
+	void store(std::vector<ivec2>& chunks);
+
+	std::string directory;
+	unsigned int map_seed = 0;
+	unsigned int decorator_seed = 0;
+	size_t budget = CHUNK_RESIDENT_BUDGET;
+
+	std::unordered_map<long long, std::unique_ptr<Region>> regions;
+
+	size_t evictions = 0;
+	size_t page_ins = 0;
+	size_t bytes_written = 0;
+};
+
+extern ChunkRegionStore chunk_store;
@@ -1,5 +1,6 @@
 #pragma once
 #include "common.hpp"
+#include <array>
 #include <vector>
 #include <unordered_map>
 #include "../ext/stb_image/stb_image.h"
@@ -141,8 +142,8 @@ struct armour {
 struct Inventory {
 	std::vector<Entity> weapons;
 	std::vector<Entity> armours;
-	Entity equipped_weapon;
-	Entity equipped_armour;
+	Entity equipped_weapon = Entity::null();
+	Entity equipped_armour = Entity::null();
 	bool is_open = false;
 };
 
@@ -158,13 +159,22 @@ struct Boss
 	bool is_hurt = false;
 };
 
+// Row of the enemy animation table in ai_system.cpp: which hurt and death animations an enemy plays
+enum class EnemyAnimation : unsigned char {
+	DEFAULT,     // spin and shrink away on death, no hurt animation
+	MINION,      // DEFAULT, plus a shock through the boss swarm while dying
+	SLIME,       // death row of the sprite sheet
+	EVIL_PLANT,  // separate hurt and death sprite sheets
+	ANIMATION_COUNT
+};
+
 struct Enemy {
 	bool is_dead = false;
 	bool is_hurt = false;
 	bool death_handled = false;
 
-	std::function<void(Entity, float)> death_animation = NULL; 
-	std::function<void(Entity, float)> hurt_animation = NULL;
+	EnemyAnimation animation = EnemyAnimation::DEFAULT;
+	unsigned char variant = 0;  // level tier; offsets the animation's textures
 	float hurt_timer = 0.0f;
 	float healthbar_visibility_timer = 0.0f;  // Timer for healthbar visibility after taking damage
 
@@ -179,6 +189,8 @@ struct Steering {
 	float target_angle;
 	float rad_ms = 0.003;
 	float vel;
+	bool is_far = false;     // off screen: simplified steering, re-steered every few steps
+	bool skip_step = false;  // far and not due for an update this step
 };
 
 struct AccumulatedForce {
@@ -278,7 +290,7 @@ struct Deadly {
 };
 
 struct Feet {
-	Entity parent_player; // the player this feet belongs to
+	Entity parent_player = Entity::null(); // the player this feet belongs to
 	// visual rendering offset (does not affect collision)
 	vec2 render_offset = {0.0f, -6.0f};
 	bool transition_pending = false;
@@ -346,7 +358,7 @@ struct Collision
 {
 	// Note, the first object is stored in the ECS container.entities
 	Entity other; // the second object involved in the collision
-	Collision(Entity& other) { this->other = other; };
+	Collision(Entity& other) : other(other) {};
 };
 
 // Data structure for toggling debug mode
@@ -364,7 +376,7 @@ struct Light {
 	vec3 light_color = { 1.0f, 1.0f, 1.0f };
 	bool is_enabled = false;
 	float inner_cone_angle = 0.0f;
-	Entity follow_target;
+	Entity follow_target = Entity::null();
 	vec2 offset = { 0.0f, 0.0f };
 	bool use_target_angle = true;
 };
@@ -410,16 +422,6 @@ struct Mesh
 	std::vector<uint16_t> vertex_indices;
 };
 
-struct Particle {
-	vec3 position;
-	vec3 velocity;
-	vec4 color;
-	float size;
-	float lifetime;
-	float age;
-	bool alive;
-};
-
 struct Drop {
 	bool is_magnetized = false;
 	float magnet_timer = 0.f;
@@ -529,7 +531,8 @@ enum class EFFECT_ASSET_ID {
 	PARTICLE = HEALTHBAR + 1,
 	TRAIL = PARTICLE + 1,
 	GRASS_BACKGROUND = TRAIL + 1,
-	EFFECT_COUNT = GRASS_BACKGROUND + 1
+	SPRITE_BATCH = GRASS_BACKGROUND + 1,
+	EFFECT_COUNT = SPRITE_BATCH + 1
 };
 const int effect_count = (int)EFFECT_ASSET_ID::EFFECT_COUNT;
 
@@ -616,14 +619,24 @@ struct SerializedChunk
 	std::vector<IsolineFilter> iso_filters;
 };
 
+// Cell states of a chunk as one contiguous 64x64 block, indexed [x][y]; zero-initialized cells are EMPTY
+using ChunkCellGrid = std::array<std::array<CHUNK_CELL_STATE, CHUNK_CELLS_PER_ROW>, CHUNK_CELLS_PER_ROW>;
+
 // Chunk of the game world
 struct Chunk
 {
-	std::vector<std::vector<CHUNK_CELL_STATE>> cell_states;
+	// Unique per generated chunk, so a regenerated chunk can be told apart from the one it replaced
+	unsigned int id = next_id();
+	ChunkCellGrid cell_states{};
 	std::vector<Entity> trees;
 	std::vector<Entity> walls;
 	std::vector<IsolineFilter> iso_filters;
 	std::vector<IsolineData> isoline_data;
+
+	static unsigned int next_id() {
+		static unsigned int last_id = 0;
+		return ++last_id;
+	}
 };
 
 // Obstacles which cross into a chunk (from other chunks)
@@ -0,0 +1,266 @@
+// internal
+#include "gl_state.hpp"
+
+// stlib
+#include <algorithm>
+#include <vector>
+
+GlState gl_state;
+
+const GLuint GlState::UNKNOWN;
+
+// Active uniform or attribute names of a program, without the "[0]" GL appends to arrays
+static std::string active_name(const std::vector<char>& buffer, GLsizei length)
+{
+	std::string name(buffer.data(), (size_t)length);
+	const size_t bracket = name.find('[');
+	if (bracket != std::string::npos)
+		name.resize(bracket);
+	return name;
+}
+
+void ProgramReflection::reflect(GLuint program)
+{
+	handle = program;
+	uniforms.clear();
+	attributes.clear();
+
+	GLint count = 0, max_length = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+	std::vector<char> buffer((size_t)std::max(max_length, 1));
+	for (GLint i = 0; i < count; i++) {
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(program, (GLuint)i, (GLsizei)buffer.size(), &length, &size, &type, buffer.data());
+		// uniforms in blocks have no location
+		const GLint location = glGetUniformLocation(program, buffer.data());
+		if (location >= 0)
+			uniforms[active_name(buffer, length)] = location;
+	}
+
+	glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &count);
+	glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &max_length);
+	buffer.assign((size_t)std::max(max_length, 1), 0);
+	for (GLint i = 0; i < count; i++) {
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveAttrib(program, (GLuint)i, (GLsizei)buffer.size(), &length, &size, &type, buffer.data());
+		const GLint location = glGetAttribLocation(program, buffer.data());
+		if (location >= 0)
+			attributes[active_name(buffer, length)] = location;
+	}
+	gl_has_errors();
+}
+
+GLint ProgramReflection::uniform_location(const std::string& name) const
+{
+	auto it = uniforms.find(name);
+	return it == uniforms.end() ? -1 : it->second;
+}
+
+GLint ProgramReflection::attribute_location(const std::string& name) const
+{
+	auto it = attributes.find(name);
+	return it == attributes.end() ? -1 : it->second;
+}
+
+void EffectHandles::resolve(const ProgramReflection& reflection)
+{
+	program = reflection.program();
+	in_position = reflection.attribute_location("in_position");
+	in_texcoord = reflection.attribute_location("in_texcoord");
+	in_color = reflection.attribute_location("in_color");
+
+	transform = reflection.uniform<mat3>("transform");
+	projection = reflection.uniform<mat3>("projection");
+	fcolor = reflection.uniform<vec3>("fcolor");
+	is_hurt = reflection.uniform<int>("is_hurt");
+
+	total_row = reflection.uniform<int>("total_row");
+	curr_row = reflection.uniform<int>("curr_row");
+	total_frame = reflection.uniform<int>("total_frame");
+	curr_frame = reflection.uniform<int>("curr_frame");
+	should_flip = reflection.uniform<int>("should_flip");
+	uv_rect = reflection.uniform<vec4>("uv_rect");
+	viewport_size = reflection.uniform<vec2>("viewport_size");
+	camera_offset = reflection.uniform<vec2>("camera_offset");
+	ambient_light = reflection.uniform<float>("ambient_light");
+	alpha_mod = reflection.uniform<float>("alpha_mod");
+
+	trail_alpha = reflection.uniform<float>("u_alpha");
+	trail_color_mode = reflection.uniform<int>("u_colorMode");
+	alpha = reflection.uniform<float>("alpha");
+	screen_texture = reflection.uniform<int>("screen_texture");
+	grass_texture = reflection.uniform<int>("u_grass");
+	grass_camera = reflection.uniform<vec2>("u_camera");
+	grass_resolution = reflection.uniform<vec2>("u_resolution");
+	grass_tile_size = reflection.uniform<float>("u_tileSize");
+}
+
+bool GlState::change(GLuint& current, GLuint value)
+{
+	if (current == value) {
+		elided++;
+		return false;
+	}
+	current = value;
+	issued++;
+	return true;
+}
+
+void GlState::use_program(GLuint value)
+{
+	if (change(program, value))
+		glUseProgram(value);
+}
+
+void GlState::bind_vertex_array(GLuint vao)
+{
+	if (!change(vertex_array, vao))
+		return;
+	glBindVertexArray(vao);
+	// the element buffer binding belongs to the vertex array
+	element_buffer = UNKNOWN;
+}
+
+void GlState::bind_buffer(GLenum target, GLuint buffer)
+{
+	GLuint* current = target == GL_ARRAY_BUFFER ? &array_buffer :
+		target == GL_ELEMENT_ARRAY_BUFFER ? &element_buffer : nullptr;
+	if (current == nullptr) {
+		issued++;
+		glBindBuffer(target, buffer);
+	} else if (change(*current, buffer)) {
+		glBindBuffer(target, buffer);
+	}
+}
+
+void GlState::bind_texture(GLenum target, GLuint texture, int unit)
+{
+	if (change(active_unit, (GLuint)unit))
+		glActiveTexture(GL_TEXTURE0 + unit);
+
+	GLuint* current = nullptr;
+	if (unit < GL_STATE_TEXTURE_UNITS) {
+		if (target == GL_TEXTURE_2D)
+			current = &textures_2d[unit];
+		else if (target == GL_TEXTURE_BUFFER)
+			current = &texture_buffers[unit];
+	}
+	if (current == nullptr) {
+		issued++;
+		glBindTexture(target, texture);
+	} else if (change(*current, texture)) {
+		glBindTexture(target, texture);
+	}
+}
+
+void GlState::bind_framebuffer(GLenum target, GLuint framebuffer)
+{
+	if (target == GL_FRAMEBUFFER) {
+		// one call covers both, so it is skipped only when neither changes
+		if (draw_framebuffer == framebuffer && read_framebuffer == framebuffer) {
+			elided++;
+			return;
+		}
+		draw_framebuffer = read_framebuffer = framebuffer;
+		issued++;
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	} else if (change(target == GL_DRAW_FRAMEBUFFER ? draw_framebuffer : read_framebuffer, framebuffer)) {
+		glBindFramebuffer(target, framebuffer);
+	}
+}
+
+void GlState::set_blend(bool enabled)
+{
+	if (!change(blend, enabled ? 1 : 0))
+		return;
+	if (enabled)
+		glEnable(GL_BLEND);
+	else
+		glDisable(GL_BLEND);
+}
+
+void GlState::blend_func(GLenum source, GLenum destination)
+{
+	if (blend_source == source && blend_destination == destination) {
+		elided++;
+		return;
+	}
+	blend_source = source;
+	blend_destination = destination;
+	issued++;
+	glBlendFunc(source, destination);
+}
+
+void GlState::set_depth_test(bool enabled)
+{
+	if (!change(depth_test, enabled ? 1 : 0))
+		return;
+	if (enabled)
+		glEnable(GL_DEPTH_TEST);
+	else
+		glDisable(GL_DEPTH_TEST);
+}
+
+void GlState::invalidate()
+{
+	program = vertex_array = UNKNOWN;
+	array_buffer = element_buffer = UNKNOWN;
+	draw_framebuffer = read_framebuffer = UNKNOWN;
+	active_unit = UNKNOWN;
+	textures_2d.fill(UNKNOWN);
+	texture_buffers.fill(UNKNOWN);
+	blend = UNKNOWN;
+	blend_source = blend_destination = UNKNOWN;
+	depth_test = UNKNOWN;
+}
+
+void GpuTimer::init()
+{
+	glGenQueries(QUERY_COUNT, queries);
+	gl_has_errors();
+}
+
+void GpuTimer::destroy()
+{
+	glDeleteQueries(QUERY_COUNT, queries);
+	for (bool& p : pending)
+		p = false;
+}
+
+void GpuTimer::begin()
+{
+	timing = !pending[next];
+	if (timing)
+		glBeginQuery(GL_TIME_ELAPSED, queries[next]);
+}
+
+void GpuTimer::end()
+{
+	if (!timing)
+		return;
+	glEndQuery(GL_TIME_ELAPSED);
+	pending[next] = true;
+	next = (next + 1) % QUERY_COUNT;
+	timing = false;
+}
+
+bool GpuTimer::read(float& ms)
+{
+	if (!pending[oldest])
+		return false;
+	GLint available = 0;
+	glGetQueryObjectiv(queries[oldest], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available)
+		return false;
+	GLuint64 nanoseconds = 0;
+	glGetQueryObjectui64v(queries[oldest], GL_QUERY_RESULT, &nanoseconds);
+	pending[oldest] = false;
+	oldest = (oldest + 1) % QUERY_COUNT;
+	ms = (float)nanoseconds / 1e6f;
+	return true;
+}
@@ -0,0 +1,171 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <array>
+#include <string>
+#include <unordered_map>
+
+// Texture units GlState tracks; the lighting pass uses five
+const int GL_STATE_TEXTURE_UNITS = 8;
+
+// A uniform location of a known type, so the right glUniform* is picked at compile time.
+// Setting an inactive one (location -1) does nothing.
+template <class T>
+struct Uniform {
+	GLint location = -1;
+
+	bool active() const { return location >= 0; }
+	void set(const T& value) const;
+};
+
+template <> inline void Uniform<int>::set(const int& value) const { if (location >= 0) glUniform1i(location, value); }
+template <> inline void Uniform<float>::set(const float& value) const { if (location >= 0) glUniform1f(location, value); }
+template <> inline void Uniform<vec2>::set(const vec2& value) const { if (location >= 0) glUniform2fv(location, 1, (const float*)&value); }
+template <> inline void Uniform<vec3>::set(const vec3& value) const { if (location >= 0) glUniform3fv(location, 1, (const float*)&value); }
+template <> inline void Uniform<vec4>::set(const vec4& value) const { if (location >= 0) glUniform4fv(location, 1, (const float*)&value); }
+template <> inline void Uniform<mat3>::set(const mat3& value) const { if (location >= 0) glUniformMatrix3fv(location, 1, GL_FALSE, (const float*)&value); }
+
+// The active uniforms and vertex attributes of a linked program, enumerated once so draws never
+// look a location up by name through GL. Array uniforms are listed under their name without "[0]".
+class ProgramReflection
+{
+public:
+	void reflect(GLuint program);
+
+	GLuint program() const { return handle; }
+	// -1 when the program has no such active uniform or attribute
+	GLint uniform_location(const std::string& name) const;
+	GLint attribute_location(const std::string& name) const;
+
+	template <class T>
+	Uniform<T> uniform(const std::string& name) const
+	{
+		Uniform<T> result;
+		result.location = uniform_location(name);
+		return result;
+	}
+
+	size_t uniform_count() const { return uniforms.size(); }
+	size_t attribute_count() const { return attributes.size(); }
+
+private:
+	GLuint handle = 0;
+	std::unordered_map<std::string, GLint> uniforms;
+	std::unordered_map<std::string, GLint> attributes;
+};
+
+// Uniform and attribute handles of one EFFECT_ASSET_ID program, resolved from its reflection when
+// the effects are loaded. Each effect has a subset of them; the rest stay inactive.
+struct EffectHandles {
+	GLuint program = 0;
+	GLint in_position = -1;
+	GLint in_texcoord = -1;
+	GLint in_color = -1;
+
+	Uniform<mat3> transform;
+	Uniform<mat3> projection;
+	Uniform<vec3> fcolor;
+	Uniform<int> is_hurt;
+
+	// textured: sprite sheet frame, atlas rectangle and screen-space lighting inputs
+	Uniform<int> total_row, curr_row, total_frame, curr_frame, should_flip;
+	Uniform<vec4> uv_rect;
+	Uniform<vec2> viewport_size, camera_offset;
+	Uniform<float> ambient_light, alpha_mod;
+
+	// trail
+	Uniform<float> trail_alpha;
+	Uniform<int> trail_color_mode;
+	// health bar
+	Uniform<float> alpha;
+	// screen
+	Uniform<int> screen_texture;
+	// grass background
+	Uniform<int> grass_texture;
+	Uniform<vec2> grass_camera, grass_resolution;
+	Uniform<float> grass_tile_size;
+
+	void resolve(const ProgramReflection& reflection);
+};
+
+// Shadow copy of the GL binding state the renderer changes most, so redundant changes are skipped
+// without ever querying GL.
+//
+// A change made through it is compared with the value it last set and only reaches GL when they
+// differ. Anything that changes the same state behind its back (RmlUi, the UI systems) leaves the
+// copy stale; call invalidate() afterwards, and the next change of every kind is issued
+// unconditionally. Bindings to targets it does not track are passed straight through.
+class GlState
+{
+public:
+	GlState() { invalidate(); }
+
+	void use_program(GLuint program);
+	void bind_vertex_array(GLuint vao);
+	// Tracks GL_ARRAY_BUFFER and GL_ELEMENT_ARRAY_BUFFER
+	void bind_buffer(GLenum target, GLuint buffer);
+	// Tracks GL_TEXTURE_2D and GL_TEXTURE_BUFFER on the first GL_STATE_TEXTURE_UNITS units, making
+	// unit the active one first
+	void bind_texture(GLenum target, GLuint texture, int unit = 0);
+	// GL_FRAMEBUFFER binds both the draw and the read framebuffer
+	void bind_framebuffer(GLenum target, GLuint framebuffer);
+	void set_blend(bool enabled);
+	void blend_func(GLenum source, GLenum destination);
+	void set_depth_test(bool enabled);
+
+	// Forget everything; call after code outside the tracker has changed GL state
+	void invalidate();
+
+	// State changes that reached GL and that were skipped as redundant, since the last reset
+	size_t issued_count() const { return issued; }
+	size_t elided_count() const { return elided; }
+	void reset_counters() { issued = elided = 0; }
+
+private:
+	static const GLuint UNKNOWN = ~0u;
+
+	// Updates a tracked value; true when the change has to be issued
+	bool change(GLuint& current, GLuint value);
+
+	GLuint program;
+	GLuint vertex_array;
+	GLuint array_buffer;
+	GLuint element_buffer;
+	GLuint draw_framebuffer;
+	GLuint read_framebuffer;
+	GLuint active_unit;
+	std::array<GLuint, GL_STATE_TEXTURE_UNITS> textures_2d;
+	std::array<GLuint, GL_STATE_TEXTURE_UNITS> texture_buffers;
+	GLuint blend;
+	GLuint blend_source, blend_destination;
+	GLuint depth_test;
+
+	size_t issued = 0;
+	size_t elided = 0;
+};
+
+// Times the GPU work issued between begin() and end() with GL_TIME_ELAPSED queries. Results are read
+// back frames later, once the GPU has them, so timing never stalls the CPU; while every query is
+// still in flight a begin()/end() pair is skipped.
+class GpuTimer
+{
+public:
+	void init();
+	void destroy();
+
+	void begin();
+	void end();
+	// Takes the oldest finished measurement, in ms; false if none has finished yet
+	bool read(float& ms);
+
+private:
+	static const int QUERY_COUNT = 4;
+	GLuint queries[QUERY_COUNT] = {};
+	bool pending[QUERY_COUNT] = {};
+	int next = 0;      // query the next begin() uses
+	int oldest = 0;    // query read() checks
+	bool timing = false;
+};
+
+extern GlState gl_state;
@@ -0,0 +1,97 @@
+// internal
+#include "light_tiles.hpp"
+#include "tiny_ecs_registry.hpp"
+
+// stlib
+#include <algorithm>
+#include <cmath>
+
+void gather_screen_lights(vec2 camera_position, ivec2 screen_size, std::vector<ScreenLight>& out)
+{
+	out.clear();
+	for (Entity entity : registry.lights.entities)
+	{
+		if (!registry.motions.has(entity)) continue;
+
+		Motion& motion = registry.motions.get(entity);
+		Light& light = registry.lights.get(entity);
+
+		// Skip bonfire light when bonfire is in OFF state (check texture)
+		if (registry.renderRequests.has(entity) && registry.renderRequests.get(entity).used_texture == TEXTURE_ASSET_ID::BONFIRE_OFF)
+			continue;
+
+		ScreenLight screen_light;
+		screen_light.radius = light.range;
+		screen_light.color = light.light_color * light.brightness;
+		screen_light.cone_angle = light.cone_angle;
+		if (light.use_target_angle)
+			screen_light.direction = vec2(cos(motion.angle), sin(motion.angle));
+
+		if (registry.bullets.has(entity)) {
+			screen_light.radius = 70.0f;
+			screen_light.color *= 0.5f;
+			screen_light.cone_angle = 3.14159f;
+		}
+		screen_light.soft_shadows = screen_light.radius >= SOFT_SHADOW_MIN_RADIUS;
+
+		screen_light.position.x = motion.position.x - camera_position.x + (screen_size.x / 2.0f);
+		screen_light.position.y = motion.position.y - camera_position.y + (screen_size.y / 2.0f);
+
+		// lights that cannot reach the screen would not shade a single pixel
+		const vec2& p = screen_light.position;
+		const float r = screen_light.radius;
+		if (p.x + r < 0.f || p.y + r < 0.f || p.x - r > (float)screen_size.x || p.y - r > (float)screen_size.y)
+			continue;
+
+		out.push_back(screen_light);
+	}
+}
+
+template <typename Func>
+void LightTileGrid::for_each_tile(const ScreenLight& light, Func&& func) const
+{
+	const float size = (float)tile_size;
+	const int min_x = std::max(0, (int)std::floor((light.position.x - light.radius) / size));
+	const int max_x = std::min(tiles.x - 1, (int)std::floor((light.position.x + light.radius) / size));
+	const int min_y = std::max(0, (int)std::floor((light.position.y - light.radius) / size));
+	const int max_y = std::min(tiles.y - 1, (int)std::floor((light.position.y + light.radius) / size));
+	const float radius_sq = light.radius * light.radius;
+
+	for (int y = min_y; y <= max_y; y++) {
+		for (int x = min_x; x <= max_x; x++) {
+			// distance from the light to the closest point of the tile
+			vec2 tile_min = vec2(x, y) * size;
+			vec2 closest = clamp(light.position, tile_min, tile_min + size);
+			vec2 d = closest - light.position;
+			if (d.x * d.x + d.y * d.y <= radius_sq)
+				func(y * tiles.x + x);
+		}
+	}
+}
+
+void LightTileGrid::build(const std::vector<ScreenLight>& lights, ivec2 screen_size, int new_tile_size)
+{
+	tile_size = new_tile_size;
+	tiles = { (screen_size.x + tile_size - 1) / tile_size, (screen_size.y + tile_size - 1) / tile_size };
+	const size_t tile_total = (size_t)tiles.x * tiles.y;
+
+	// count the lights per tile; ranges hold (first, count) pairs
+	tile_ranges.assign(2 * tile_total, 0);
+	for (const ScreenLight& light : lights)
+		for_each_tile(light, [&](int tile) { tile_ranges[2 * tile + 1]++; });
+
+	uint32_t total = 0;
+	for (size_t t = 0; t < tile_total; t++) {
+		tile_ranges[2 * t] = total;
+		total += tile_ranges[2 * t + 1];
+		tile_ranges[2 * t + 1] = 0;
+	}
+
+	// fill, keeping the lights of each tile in their original order
+	light_indices.resize(total);
+	for (uint32_t i = 0; i < (uint32_t)lights.size(); i++) {
+		for_each_tile(lights[i], [&](int tile) {
+			light_indices[tile_ranges[2 * tile] + tile_ranges[2 * tile + 1]++] = i;
+		});
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// Side of a lighting tile, in framebuffer pixels
+const int LIGHT_TILE_SIZE = 32;
+// Lights with a smaller radius (bullet lights) are shaded without the soft shadow march
+const float SOFT_SHADOW_MIN_RADIUS = 100.f;
+
+// A light as the lighting pass sees it, in top-down framebuffer pixel coordinates
+struct ScreenLight {
+	vec2 position = { 0.f, 0.f };
+	float radius = 0.f;
+	float cone_angle = 3.14159f;       // 3 or more is a full circle
+	vec3 color = { 1.f, 1.f, 1.f };    // brightness already applied
+	float flicker = 1.f;
+	vec2 direction = { 1.f, 0.f };
+	float height = 0.4f;
+	bool soft_shadows = true;
+};
+
+// Collects the enabled lights in registry.lights that reach the screen, with the per-light
+// overrides the lighting pass applies (bonfires that are off are skipped, bullets get a small light)
+void gather_screen_lights(vec2 camera_position, ivec2 screen_size, std::vector<ScreenLight>& out);
+
+// Bins lights into square screen tiles so the lighting shader only loops over the lights that can
+// reach each pixel. Built on the CPU every frame with a counting sort: the lights of tile t are
+// indices()[ranges()[2t] .. ranges()[2t] + ranges()[2t+1]). Tiles are row-major, top row first.
+class LightTileGrid
+{
+public:
+	void build(const std::vector<ScreenLight>& lights, ivec2 screen_size, int tile_size = LIGHT_TILE_SIZE);
+
+	ivec2 tile_count() const { return tiles; }
+	int get_tile_size() const { return tile_size; }
+	const std::vector<uint32_t>& ranges() const { return tile_ranges; }
+	const std::vector<uint32_t>& indices() const { return light_indices; }
+
+	// Number of lights touching tile (x, y)
+	uint32_t count(int x, int y) const { return tile_ranges[2 * (y * tiles.x + x) + 1]; }
+
+private:
+	ivec2 tiles = { 0, 0 };
+	int tile_size = LIGHT_TILE_SIZE;
+	std::vector<uint32_t> tile_ranges;
+	std::vector<uint32_t> light_indices;
+
+	// Calls func(tile_index) for every tile the light's circle overlaps
+	template <typename Func>
+	void for_each_tile(const ScreenLight& light, Func&& func) const;
+};
@@ -11,7 +11,7 @@ LowHealthOverlaySystem::LowHealthOverlaySystem()
 void LowHealthOverlaySystem::init(
 	GLFWwindow* window_arg,
 	const std::array<GLuint, texture_count>& texture_gl_handles_arg,
-	const std::array<GLuint, effect_count>& effects_arg,
+	const std::array<EffectHandles, effect_count>& effects_arg,
 	const std::array<GLuint, geometry_count>& vertex_buffers_arg,
 	const std::array<GLuint, geometry_count>& index_buffers_arg,
 	HealthSystem* health_system_arg
@@ -138,26 +138,25 @@ void LowHealthOverlaySystem::drawOverlay(float scale)
 	int w, h;
 	glfwGetFramebufferSize(window, &w, &h);
 	
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	gl_state.bind_framebuffer(GL_FRAMEBUFFER, 0);
 	glViewport(0, 0, w, h);
 	gl_has_errors();
 	
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	glDisable(GL_DEPTH_TEST);
+	gl_state.set_blend(true);
+	gl_state.blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	gl_state.set_depth_test(false);
 	gl_has_errors();
 	
-	const GLuint program = effects->at((GLuint)EFFECT_ASSET_ID::TEXTURED);
-	glUseProgram(program);
+	const EffectHandles& effect = effects->at((GLuint)EFFECT_ASSET_ID::TEXTURED);
+	gl_state.use_program(effect.program);
 	gl_has_errors();
 	
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers->at((GLuint)GEOMETRY_BUFFER_ID::FULLSCREEN_QUAD));
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffers->at((GLuint)GEOMETRY_BUFFER_ID::FULLSCREEN_QUAD));
+	gl_state.bind_buffer(GL_ARRAY_BUFFER, vertex_buffers->at((GLuint)GEOMETRY_BUFFER_ID::FULLSCREEN_QUAD));
+	gl_state.bind_buffer(GL_ELEMENT_ARRAY_BUFFER, index_buffers->at((GLuint)GEOMETRY_BUFFER_ID::FULLSCREEN_QUAD));
 	gl_has_errors();
 	
-	GLint in_position_loc = glGetAttribLocation(program, "in_position");
-	GLint in_texcoord_loc = glGetAttribLocation(program, "in_texcoord");
-	gl_has_errors();
+	const GLint in_position_loc = effect.in_position;
+	const GLint in_texcoord_loc = effect.in_texcoord;
 	
 	glEnableVertexAttribArray(in_position_loc);
 	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE,
@@ -169,49 +168,27 @@ void LowHealthOverlaySystem::drawOverlay(float scale)
 						  (void *)sizeof(vec3));
 	gl_has_errors();
 	
-	GLint total_row_uloc = glGetUniformLocation(program, "total_row");
-	if (total_row_uloc >= 0) glUniform1i(total_row_uloc, 1);
-	
-	GLint curr_row_uloc = glGetUniformLocation(program, "curr_row");
-	if (curr_row_uloc >= 0) glUniform1i(curr_row_uloc, 0);
-	
-	GLint total_frame_uloc = glGetUniformLocation(program, "total_frame");
-	if (total_frame_uloc >= 0) glUniform1i(total_frame_uloc, 1);
-	
-	GLint curr_frame_uloc = glGetUniformLocation(program, "curr_frame");
-	if (curr_frame_uloc >= 0) glUniform1i(curr_frame_uloc, 0);
-	
-	GLint should_flip_uloc = glGetUniformLocation(program, "should_flip");
-	if (should_flip_uloc >= 0) glUniform1i(should_flip_uloc, 0);
-	
-	GLint is_hurt_uloc = glGetUniformLocation(program, "is_hurt");
-	if (is_hurt_uloc >= 0) glUniform1i(is_hurt_uloc, 0);
-	
-	GLint alpha_mod_uloc = glGetUniformLocation(program, "alpha_mod");
-	if (alpha_mod_uloc >= 0) glUniform1f(alpha_mod_uloc, 1.0f);
-	
-	glActiveTexture(GL_TEXTURE0);
-	GLuint texture_id = texture_gl_handles->at((GLuint)TEXTURE_ASSET_ID::LOW_HEALTH_BLOOD);
-	glBindTexture(GL_TEXTURE_2D, texture_id);
+	effect.total_row.set(1);
+	effect.curr_row.set(0);
+	effect.total_frame.set(1);
+	effect.curr_frame.set(0);
+	effect.should_flip.set(0);
+	// the blood overlay is not in an atlas, so sample all of it
+	effect.uv_rect.set(vec4(0.0f, 0.0f, 1.0f, 1.0f));
+	effect.is_hurt.set(0);
+	effect.alpha_mod.set(1.0f);
+	
+	gl_state.bind_texture(GL_TEXTURE_2D, texture_gl_handles->at((GLuint)TEXTURE_ASSET_ID::LOW_HEALTH_BLOOD));
 	gl_has_errors();
 	
-	GLint viewport_loc = glGetUniformLocation(program, "viewport_size");
-	if (viewport_loc >= 0) glUniform2f(viewport_loc, (float)w, (float)h);
-	
-	GLint ambient_loc = glGetUniformLocation(program, "ambient_light");
-	if (ambient_loc >= 0) glUniform1f(ambient_loc, 1.0f);
-	
-	GLint camera_offset_loc = glGetUniformLocation(program, "camera_offset");
-	if (camera_offset_loc >= 0) glUniform2f(camera_offset_loc, 0.0f, 0.0f);
+	effect.viewport_size.set(vec2((float)w, (float)h));
+	effect.ambient_light.set(1.0f);
+	effect.camera_offset.set(vec2(0.0f, 0.0f));
 	
 	mat3 transform = { {scale,0,0}, {0,scale,0}, {0,0,1} };
 	mat3 projection = { {1,0,0}, {0,1,0}, {0,0,1} };
-	
-	GLint transform_loc = glGetUniformLocation(program, "transform");
-	if (transform_loc >= 0) glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float*)&transform);
-	
-	GLint projection_loc = glGetUniformLocation(program, "projection");
-	if (projection_loc >= 0) glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float*)&projection);
+	effect.transform.set(transform);
+	effect.projection.set(projection);
 	
 	gl_has_errors();
 	
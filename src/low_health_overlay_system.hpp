@@ -2,6 +2,7 @@
 
 #include "common.hpp"
 #include "components.hpp"
+#include "gl_state.hpp"
 #include "tiny_ecs_registry.hpp"
 #include <array>
 
@@ -18,7 +19,7 @@ public:
 	void init(
 		GLFWwindow* window,
 		const std::array<GLuint, texture_count>& texture_gl_handles,
-		const std::array<GLuint, effect_count>& effects,
+		const std::array<EffectHandles, effect_count>& effects,
 		const std::array<GLuint, geometry_count>& vertex_buffers,
 		const std::array<GLuint, geometry_count>& index_buffers,
 		HealthSystem* health_system
@@ -47,7 +48,7 @@ private:
 	// OpenGL resources (references to avoid copying)
 	GLFWwindow* window = nullptr;
 	const std::array<GLuint, texture_count>* texture_gl_handles = nullptr;
-	const std::array<GLuint, effect_count>* effects = nullptr;
+	const std::array<EffectHandles, effect_count>* effects = nullptr;
 	const std::array<GLuint, geometry_count>* vertex_buffers = nullptr;
 	const std::array<GLuint, geometry_count>* index_buffers = nullptr;
 	
@@ -4,6 +4,7 @@
 
 // stlib
 #include <chrono>
+#include <cstdlib>
 #include <thread>
 #include <iostream>
 #include <string>
@@ -33,6 +34,7 @@
 #include "steering_system.hpp"
 #include "audio_system.hpp"
 #include "save_system.hpp"
+#include "benchmark_system.hpp"
 
 #ifdef HAVE_RMLUI
 #include <RmlUi/Core.h>
@@ -41,7 +43,7 @@
 using Clock = std::chrono::high_resolution_clock;
 
 // Entry point
-int main()
+int main(int argc, char* argv[])
 {
 #ifdef _WIN32
 	char exe_path_buf[MAX_PATH];
@@ -66,6 +68,10 @@ int main()
 		}
 	}
 #endif
+	// Headless benchmarks: eclipse --benchmark <name>
+	if (argc >= 3 && std::string(argv[1]) == "--benchmark")
+		return benchmark::run(argv[2]) ? EXIT_SUCCESS : EXIT_FAILURE;
+
 	// Global systems
 	WorldSystem world;
 	RenderSystem renderer;
@@ -94,7 +100,23 @@ int main()
 	}
 
 	// initialize the main systems
+	// --no-texture-cache decodes every PNG on each launch and leaves the texture cache alone
+	for (int i = 1; i < argc; i++)
+		if (std::string(argv[i]) == "--no-texture-cache")
+			renderer.use_texture_cache = false;
 	renderer.init(window);
+	// --sdf-divisor 2|4 generates the shadow SDF at half or quarter resolution, --no-sdf-cache regenerates
+	// it every frame, and --sdf-profile [frames] cycles through those options printing their GPU cost
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+		const bool has_value = i + 1 < argc && atoi(argv[i + 1]) > 0;
+		if (arg == "--sdf-divisor" && has_value)
+			renderer.setSdfResolutionDivisor(atoi(argv[++i]));
+		else if (arg == "--no-sdf-cache")
+			renderer.sdf_cache_enabled = false;
+		else if (arg == "--sdf-profile")
+			renderer.startSdfProfile(has_value ? atoi(argv[++i]) : 300);
+	}
 	inventory.init(window);
 	inventory.set_audio_system(&audio);
 	ai.init(&renderer, &audio);
@@ -139,6 +161,13 @@ int main()
 
 	world.init(&renderer, &inventory, &stats, &objectives, &currency, &menu_icons, &tutorial, &start_menu, &ai, &audio, &save_system, &death_screen);
 
+	// Horde mode: eclipse --horde [max enemies]
+	if (argc >= 2 && std::string(argv[1]) == "--horde") {
+		int max_enemies = argc >= 3 ? atoi(argv[2]) : 0;
+		world.set_max_enemies(max_enemies > 0 ? (size_t)max_enemies : HORDE_MAX_ENEMIES);
+		printf("Horde mode: up to %zu enemies\n", world.get_max_enemies());
+	}
+
 	// Initialize FPS history
 	float fps_history[60] = {0};
 	int fps_index = 0;
@@ -247,27 +276,12 @@ int main()
 		
 		renderer.draw(elapsed_ms, is_paused);
 
-		// Save OpenGL State before UI rendering
-		GLint saved_vao, saved_program, saved_framebuffer;
-		GLint saved_array_buffer, saved_element_buffer;
-		glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &saved_vao);
-		glGetIntegerv(GL_CURRENT_PROGRAM, &saved_program);
-		glGetIntegerv(GL_FRAMEBUFFER_BINDING, &saved_framebuffer);
-		glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &saved_array_buffer);
-		glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &saved_element_buffer);
-
+		// The UI draws through RmlUi, which changes GL state behind the renderer's back; the
+		// renderer invalidates its state tracker at the start of the next draw instead of this
+		// frame querying and restoring the bindings
 		stats.render();
 		inventory.render();
 		death_screen.render();
-
-		// The UI rendering was corrupting the OpenGL state
-		// So restore OpenGL state after UI rendering
-		// This is a bit hacky, but it works
-		glBindVertexArray(saved_vao);
-		glUseProgram(saved_program);
-		glBindFramebuffer(GL_FRAMEBUFFER, saved_framebuffer);
-		glBindBuffer(GL_ARRAY_BUFFER, saved_array_buffer);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, saved_element_buffer);
 		tutorial.render();
 
 		glfwSwapBuffers(window);
@@ -1,5 +1,13 @@
 #include "noise_gen.hpp"
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define NOISE_SIMD_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NOISE_SIMD_SSE2
+#endif
+
 const unsigned short PERMUTATION_SCALE = 10;
 const unsigned short PERMUTATION_LENGTH = 1 << PERMUTATION_SCALE;
 
@@ -31,11 +39,20 @@ void PerlinNoiseGenerator::init(unsigned int seed, unsigned int octaves) {
 
 		std::swap(permutation[i], permutation[j]);
     }
+	permutation_lanes.assign(permutation.begin(), permutation.end());
+
+	float amp = 0;
+	float curr_scale = 1;
+	for (unsigned int i = 1; i <= tot_oct; i++) {
+		amp += M_SQRT_2 / curr_scale;
+		curr_scale *= 2;
+	}
+	this->amplitude = amp;
 }
 
 // Improved method (from 2002 Perlin paper): get one of 4 consident gradients
 // https://doi.org/10.1145/566654.566636
-vec2 PerlinNoiseGenerator::getGradient(unsigned short perm_val) {
+vec2 PerlinNoiseGenerator::getGradient(unsigned short perm_val) const {
 	switch (perm_val % 4) {
 		case 0: return vec2(1, 1);
 		case 1: return vec2(1, -1);
@@ -44,7 +61,7 @@ vec2 PerlinNoiseGenerator::getGradient(unsigned short perm_val) {
 	}
 }
 
-float PerlinNoiseGenerator::raw_noise(float x, float y) {
+float PerlinNoiseGenerator::raw_noise(float x, float y) const {
 	// get nearest integers x, x+1, y, and y+1 (mod PERMUTATION_LENGTH)
 	float floor_x = std::fmod(floor(x), PERMUTATION_LENGTH);
 	float floor_y = std::fmod(floor(y), PERMUTATION_LENGTH);
@@ -88,14 +105,202 @@ float PerlinNoiseGenerator::raw_noise(float x, float y) {
 }
 
 // Sum multiple octaves of perlin noise, and normalize result
-float PerlinNoiseGenerator::noise(float x, float y) {
+float PerlinNoiseGenerator::noise(float x, float y) const {
 	float noise_val = 0;
-	float amp = 0;
 	float curr_scale = 1;
 	for (unsigned int i = 1; i <= tot_oct; i++) {
 		noise_val += raw_noise((float) curr_scale * x, (float) curr_scale * y) / (float) curr_scale;
-		amp += M_SQRT_2 / curr_scale;
 		curr_scale *= 2;
 	}
-    return noise_val / amp;
+    return noise_val / amplitude;
+}
+
+// Batched evaluation
+// The lane kernel below repeats raw_noise() operation for operation, in the same order and in
+// single precision, so every lane rounds exactly like the scalar code:
+// - fmod(floor(v), PERMUTATION_LENGTH) on an integer-valued float equals the two's complement
+//   (int) floor(v) & (PERMUTATION_LENGTH - 1), and fmod(v, 1) equals v - trunc(v) carrying v's sign
+// - the gradients are all (+-1, +-1), so each dot product term is a sign flip of a distance
+// Both int conversions are exact for |v| < 2^22; points whose scaled coordinates get that large go
+// through the scalar path instead. The build must not contract a * b + c into FMA for this file.
+#if defined(NOISE_SIMD_AVX2) || defined(NOISE_SIMD_SSE2)
+namespace {
+
+const float LANE_SAFE_LIMIT = 4194304.f; // 2^22
+
+#if defined(NOISE_SIMD_AVX2)
+struct Lanes {
+	enum { WIDTH = 8 };
+	typedef __m256 F;
+	typedef __m256i I;
+	static F load(const float* p) { return _mm256_loadu_ps(p); }
+	static void store(float* p, F v) { _mm256_storeu_ps(p, v); }
+	static F set1(float v) { return _mm256_set1_ps(v); }
+	static F add(F a, F b) { return _mm256_add_ps(a, b); }
+	static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+	static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+	static F div(F a, F b) { return _mm256_div_ps(a, b); }
+	static F bit_and(F a, F b) { return _mm256_and_ps(a, b); }
+	static F bit_or(F a, F b) { return _mm256_or_ps(a, b); }
+	static F bit_xor(F a, F b) { return _mm256_xor_ps(a, b); }
+	static F less(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	static F select(F mask, F a, F b) { return _mm256_blendv_ps(b, a, mask); }
+	static bool all(F mask) { return _mm256_movemask_ps(mask) == 0xFF; }
+	static I truncate(F a) { return _mm256_cvttps_epi32(a); }
+	static F to_float(I a) { return _mm256_cvtepi32_ps(a); }
+	static I as_int(F a) { return _mm256_castps_si256(a); }
+	static F as_float(I a) { return _mm256_castsi256_ps(a); }
+	static I iset1(int v) { return _mm256_set1_epi32(v); }
+	static I iadd(I a, I b) { return _mm256_add_epi32(a, b); }
+	static I iand(I a, I b) { return _mm256_and_si256(a, b); }
+	static I ishl(I a, int bits) { return _mm256_slli_epi32(a, bits); }
+	static I gather(const int* table, I index) { return _mm256_i32gather_epi32(table, index, 4); }
+};
+#else
+struct Lanes {
+	enum { WIDTH = 4 };
+	typedef __m128 F;
+	typedef __m128i I;
+	static F load(const float* p) { return _mm_loadu_ps(p); }
+	static void store(float* p, F v) { _mm_storeu_ps(p, v); }
+	static F set1(float v) { return _mm_set1_ps(v); }
+	static F add(F a, F b) { return _mm_add_ps(a, b); }
+	static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+	static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+	static F div(F a, F b) { return _mm_div_ps(a, b); }
+	static F bit_and(F a, F b) { return _mm_and_ps(a, b); }
+	static F bit_or(F a, F b) { return _mm_or_ps(a, b); }
+	static F bit_xor(F a, F b) { return _mm_xor_ps(a, b); }
+	static F less(F a, F b) { return _mm_cmplt_ps(a, b); }
+	static F select(F mask, F a, F b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+	static bool all(F mask) { return _mm_movemask_ps(mask) == 0xF; }
+	static I truncate(F a) { return _mm_cvttps_epi32(a); }
+	static F to_float(I a) { return _mm_cvtepi32_ps(a); }
+	static I as_int(F a) { return _mm_castps_si128(a); }
+	static F as_float(I a) { return _mm_castsi128_ps(a); }
+	static I iset1(int v) { return _mm_set1_epi32(v); }
+	static I iadd(I a, I b) { return _mm_add_epi32(a, b); }
+	static I iand(I a, I b) { return _mm_and_si128(a, b); }
+	static I ishl(I a, int bits) { return _mm_slli_epi32(a, bits); }
+	static I gather(const int* table, I index) {
+		alignas(16) int lanes[4];
+		_mm_store_si128((__m128i*)lanes, index);
+		return _mm_setr_epi32(table[lanes[0]], table[lanes[1]], table[lanes[2]], table[lanes[3]]);
+	}
+};
+#endif
+
+typedef Lanes::F F;
+typedef Lanes::I I;
+
+// floor() of each lane as an int
+inline I floor_int(F v) {
+	I t = Lanes::truncate(v);
+	// truncation rounded negative non-integers up; the all-ones compare mask is -1
+	return Lanes::iadd(t, Lanes::as_int(Lanes::less(v, Lanes::to_float(t))));
+}
+
+// fmod(v, 1), shifted into [0, 1] like raw_noise() does
+inline F fraction(F v) {
+	const F sign_bit = Lanes::set1(-0.f);
+	const F zero = Lanes::set1(0.f);
+	F r = Lanes::sub(v, Lanes::to_float(Lanes::truncate(v)));
+	r = Lanes::bit_or(r, Lanes::bit_and(v, sign_bit)); // fmod keeps the sign of v, even for zero
+	return Lanes::select(Lanes::less(r, zero), Lanes::add(r, Lanes::set1(1.f)), r);
+}
+
+// gradient . (dx, dy) for the gradient picked by hash % 4 (see getGradient)
+inline F gradient_dot(I hash, F dx, F dy) {
+	// bit 1 negates x, bit 0 negates y; move each onto the float sign bit
+	F flip_x = Lanes::as_float(Lanes::ishl(Lanes::iand(hash, Lanes::iset1(2)), 30));
+	F flip_y = Lanes::as_float(Lanes::ishl(Lanes::iand(hash, Lanes::iset1(1)), 31));
+	return Lanes::add(Lanes::bit_xor(dx, flip_x), Lanes::bit_xor(dy, flip_y));
+}
+
+// t^3 * (6t^2 - 15t + 10), evaluated as xr * xr * xr * ((6 * xr - 15) * xr + 10)
+inline F fade(F t) {
+	F cube = Lanes::mul(Lanes::mul(t, t), t);
+	F poly = Lanes::add(Lanes::mul(Lanes::sub(Lanes::mul(Lanes::set1(6.f), t), Lanes::set1(15.f)), t), Lanes::set1(10.f));
+	return Lanes::mul(cube, poly);
+}
+
+inline F raw_noise_lanes(const int* perm, F x, F y) {
+	const I wrap = Lanes::iset1(PERMUTATION_LENGTH - 1);
+	const I one = Lanes::iset1(1);
+	I x_0 = Lanes::iand(floor_int(x), wrap);
+	I y_0 = Lanes::iand(floor_int(y), wrap);
+	I x_1 = Lanes::iand(Lanes::iadd(x_0, one), wrap);
+	I y_1 = Lanes::iand(Lanes::iadd(y_0, one), wrap);
+
+	I perm_x_0 = Lanes::gather(perm, x_0);
+	I perm_x_1 = Lanes::gather(perm, x_1);
+	I ul = Lanes::gather(perm, Lanes::iand(Lanes::iadd(perm_x_0, y_0), wrap));
+	I ur = Lanes::gather(perm, Lanes::iand(Lanes::iadd(perm_x_1, y_0), wrap));
+	I dl = Lanes::gather(perm, Lanes::iand(Lanes::iadd(perm_x_0, y_1), wrap));
+	I dr = Lanes::gather(perm, Lanes::iand(Lanes::iadd(perm_x_1, y_1), wrap));
+
+	const F one_f = Lanes::set1(1.f);
+	F xr = fraction(x);
+	F yr = fraction(y);
+	F xr_inv = Lanes::sub(one_f, xr);
+	F yr_inv = Lanes::sub(one_f, yr);
+	F ul_dp = gradient_dot(ul, xr, yr);
+	F ur_dp = gradient_dot(ur, xr_inv, yr);
+	F dl_dp = gradient_dot(dl, xr, yr_inv);
+	F dr_dp = gradient_dot(dr, xr_inv, yr_inv);
+
+	F x_interp = fade(xr);
+	F y_interp = fade(yr);
+	F x_interp_inv = Lanes::sub(one_f, x_interp);
+	F upper = Lanes::add(Lanes::mul(x_interp_inv, ul_dp), Lanes::mul(x_interp, ur_dp));
+	F lower = Lanes::add(Lanes::mul(x_interp_inv, dl_dp), Lanes::mul(x_interp, dr_dp));
+	return Lanes::add(Lanes::mul(Lanes::sub(one_f, y_interp), upper), Lanes::mul(y_interp, lower));
+}
+
+}
+#endif
+
+void PerlinNoiseGenerator::noise_lanes(const float* xs, const float* ys, size_t y_stride, float* out, size_t n) const {
+	size_t i = 0;
+#if defined(NOISE_SIMD_AVX2) || defined(NOISE_SIMD_SSE2)
+	const int* perm = permutation_lanes.data();
+	float top_scale = 1;
+	for (unsigned int o = 1; o < tot_oct; o++)
+		top_scale *= 2;
+	const F limit = Lanes::set1(LANE_SAFE_LIMIT / top_scale);
+	const F abs_mask = Lanes::as_float(Lanes::iset1(0x7FFFFFFF));
+	const F amp = Lanes::set1(amplitude);
+	for (; i + Lanes::WIDTH <= n; i += Lanes::WIDTH) {
+		F x = Lanes::load(xs + i);
+		F y = y_stride ? Lanes::load(ys + i) : Lanes::set1(ys[0]);
+		if (!Lanes::all(Lanes::less(Lanes::bit_and(x, abs_mask), limit))
+			|| !Lanes::all(Lanes::less(Lanes::bit_and(y, abs_mask), limit)))
+		{
+			for (size_t k = i; k < i + Lanes::WIDTH; k++)
+				out[k] = noise(xs[k], ys[k * y_stride]);
+			continue;
+		}
+
+		F noise_val = Lanes::set1(0.f);
+		float curr_scale = 1;
+		for (unsigned int o = 1; o <= tot_oct; o++) {
+			F scale = Lanes::set1(curr_scale);
+			F raw = raw_noise_lanes(perm, Lanes::mul(scale, x), Lanes::mul(scale, y));
+			noise_val = Lanes::add(noise_val, Lanes::div(raw, scale));
+			curr_scale *= 2;
+		}
+		Lanes::store(out + i, Lanes::div(noise_val, amp));
+	}
+#endif
+	for (; i < n; i++)
+		out[i] = noise(xs[i], ys[i * y_stride]);
+}
+
+void PerlinNoiseGenerator::noise_batch(const float* xs, const float* ys, float* out, size_t n) const {
+	noise_lanes(xs, ys, 1, out, n);
+}
+
+void PerlinNoiseGenerator::noise_grid(const float* xs, size_t nx, const float* ys, size_t ny, float* out) const {
+	for (size_t j = 0; j < ny; j++)
+		noise_lanes(xs, ys + j, 0, out + j * nx, nx);
 }
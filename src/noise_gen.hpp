@@ -9,10 +9,14 @@
 class PerlinNoiseGenerator {
     private:
         std::vector<unsigned short> permutation;
+        std::vector<int> permutation_lanes; // same values widened for the SIMD gathers
         unsigned int tot_oct;
+        float amplitude; // normalization for tot_oct octaves, shared by noise() and the batch variants
 
-        float raw_noise(float x, float y);
-        vec2 getGradient(unsigned short perm_val);
+        float raw_noise(float x, float y) const;
+        vec2 getGradient(unsigned short perm_val) const;
+        // Batch kernel behind noise_batch/noise_grid; y_stride 0 evaluates every point at ys[0]
+        void noise_lanes(const float* xs, const float* ys, size_t y_stride, float* out, size_t n) const;
 
     public:
         // initialize generator
@@ -20,5 +24,13 @@ class PerlinNoiseGenerator {
         void init(unsigned int seed = 0, unsigned int octaves = 4);
 
         // Get noise function value at a given position
-        float noise(float x, float y);
+        // (read-only, so one generator can be sampled from several threads once initialized)
+        float noise(float x, float y) const;
+
+        // Noise at the n points (xs[i], ys[i]), written to out[i]. Evaluates several points at once
+        // with SSE2 (or AVX2 when compiled with it) and gives bit-identical results to noise().
+        void noise_batch(const float* xs, const float* ys, float* out, size_t n) const;
+
+        // Noise over the grid spanned by xs and ys: out[j * nx + i] = noise(xs[i], ys[j])
+        void noise_grid(const float* xs, size_t nx, const float* ys, size_t ny, float* out) const;
 };
@@ -0,0 +1,72 @@
+// internal
+#include "particle_pool.hpp"
+
+ParticlePool particle_pool;
+
+ParticlePool::ParticlePool(size_t capacity)
+	: max_count(capacity),
+	pos_x(capacity), pos_y(capacity),
+	vel_x(capacity), vel_y(capacity),
+	size_px(capacity),
+	age(capacity), lifetime(capacity),
+	color(capacity)
+{
+}
+
+bool ParticlePool::emit(vec2 position, vec2 velocity, vec4 particle_color, float particle_size, float particle_lifetime)
+{
+	if (count == max_count)
+		return false;
+	const size_t i = count++;
+	pos_x[i] = position.x;
+	pos_y[i] = position.y;
+	vel_x[i] = velocity.x;
+	vel_y[i] = velocity.y;
+	size_px[i] = particle_size;
+	age[i] = 0.f;
+	lifetime[i] = particle_lifetime;
+	color[i] = particle_color;
+	return true;
+}
+
+void ParticlePool::step(float elapsed_seconds)
+{
+	const size_t n = count;
+	float* __restrict px = pos_x.data();
+	float* __restrict py = pos_y.data();
+	float* __restrict vx = vel_x.data();
+	float* __restrict vy = vel_y.data();
+	float* __restrict ages = age.data();
+	const float* __restrict lifetimes = lifetime.data();
+	vec4* __restrict colors = color.data();
+
+	// integrate everything, including particles about to expire; they are dropped below
+	const float gravity_step = PARTICLE_GRAVITY * elapsed_seconds;
+	for (size_t i = 0; i < n; i++) {
+		ages[i] += elapsed_seconds;
+		vy[i] -= gravity_step;
+		px[i] += vx[i] * elapsed_seconds;
+		py[i] += vy[i] * elapsed_seconds;
+	}
+	// fade out over the lifetime
+	for (size_t i = 0; i < n; i++)
+		colors[i].a = 1.f - ages[i] / lifetimes[i];
+
+	// swap-remove the expired ones
+	size_t i = 0;
+	while (i < count) {
+		if (age[i] < lifetime[i]) {
+			i++;
+			continue;
+		}
+		const size_t last = --count;
+		pos_x[i] = pos_x[last];
+		pos_y[i] = pos_y[last];
+		vel_x[i] = vel_x[last];
+		vel_y[i] = vel_y[last];
+		size_px[i] = size_px[last];
+		age[i] = age[last];
+		lifetime[i] = lifetime[last];
+		color[i] = color[last];
+	}
+}
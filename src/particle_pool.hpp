@@ -0,0 +1,51 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <vector>
+
+// Most particles alive at once; emits past this are dropped
+const size_t PARTICLE_POOL_CAPACITY = 65536;
+// Downward pull on particle velocity, in px/s^2
+const float PARTICLE_GRAVITY = 60.f;
+
+// Short-lived visual particles, kept out of the ECS registry since nothing else ever queries them.
+//
+// Storage is a structure of arrays with a fixed capacity, allocated once: step() is a few flat
+// loops over floats that the compiler can vectorize, and an expired particle is removed by moving
+// the last live one into its slot, so live particles always occupy [0, size()). The renderer
+// uploads the position, size and color arrays as they are.
+class ParticlePool
+{
+public:
+	explicit ParticlePool(size_t capacity = PARTICLE_POOL_CAPACITY);
+
+	// Adds a particle; returns false (and drops it) when the pool is full
+	bool emit(vec2 position, vec2 velocity, vec4 color, float size, float lifetime);
+
+	// Ages, moves and fades every particle, then removes the expired ones
+	void step(float elapsed_seconds);
+
+	void clear() { count = 0; }
+
+	size_t size() const { return count; }
+	size_t capacity() const { return max_count; }
+
+	// Per-particle attributes, valid for [0, size())
+	const float* position_x() const { return pos_x.data(); }
+	const float* position_y() const { return pos_y.data(); }
+	const float* sizes() const { return size_px.data(); }
+	const vec4* colors() const { return color.data(); }
+
+private:
+	size_t count = 0;
+	size_t max_count;
+
+	std::vector<float> pos_x, pos_y;
+	std::vector<float> vel_x, vel_y;
+	std::vector<float> size_px;
+	std::vector<float> age, lifetime;
+	std::vector<vec4> color;
+};
+
+extern ParticlePool particle_pool;
@@ -2,22 +2,12 @@
 
 #include "tiny_ecs_registry.hpp"
 
-#include <queue>
 #include <utility>
 
 static inline bool is_in_bounds(const CellCoordinate& pos, int size) {
     return pos.x >= 0 && pos.y >= 0 && pos.x < size && pos.y < size;
 }
 
-// Doesn't actually do radius, it checks a square region.
-// Parameter `r` doesn't count for the center cell itself.
-static inline bool is_coordinate_in(const CellCoordinate& coordinate, const CellCoordinate& center, int r) {
-    // Both inclusive
-    CellCoordinate lower = center - r;
-    CellCoordinate upper = center + r;
-    return coordinate.x >= lower.x && coordinate.y >= lower.y && coordinate.x < upper.x && coordinate.y < upper.y;
-}
-
 static inline int move_cost(const CellCoordinate& dir) {
     return (dir.x && dir.y) ? DIAGONAL_COST : CARDINAL_COST;
 }
@@ -27,68 +17,111 @@ static inline CellCoordinate get_cell_coordinate(glm::vec2 world_pos) {
     return glm::floor(world_pos / static_cast<float>(CHUNK_CELL_SIZE));
 }
 
-static inline CHUNK_CELL_STATE get_cell_state(const CellCoordinate& cell_pos) {
-    if (registry.chunks.has(cell_pos.x / CHUNK_CELLS_PER_ROW, cell_pos.y / CHUNK_CELLS_PER_ROW)) {
-        const Chunk& chunk = registry.chunks.get(cell_pos.x / CHUNK_CELLS_PER_ROW, cell_pos.y / CHUNK_CELLS_PER_ROW);
-        return chunk.cell_states[cell_pos.x % CHUNK_CELLS_PER_ROW][cell_pos.y % CHUNK_CELLS_PER_ROW];
-    } else {
-        // chunk is not loaded, treat as having no obstacles
-        return CHUNK_CELL_STATE::EMPTY;
-    }
+void PathfindingSystem::set_field_radius(int radius) {
+    field_radius = radius;
+    field_size = radius * 2 + 1;
+    flow_field.assign(field_size * field_size, PathNode());
+    shifted_walkable.assign(field_size * field_size, true);
+    field_valid = false;
 }
 
-void PathfindingSystem::build_flow_field() {
+// Rebuilds the field only when the player changes cell or a chunk loads or unloads.
+// A move of a few cells reuses the overlapping walkability samples and only probes the new cells.
+void PathfindingSystem::update_flow_field() {
     const Entity& player = registry.players.entities[0];
     const Motion& mp = registry.motions.get(player);
-    CellCoordinate top_left = get_cell_coordinate(mp.position) - FIELD_RADIUS;
-
-    // Reset flow field with obstacle info from grid
-    for (int y = 0; y < FIELD_SIZE; y++) {
-        for (int x = 0; x < FIELD_SIZE; x++) {
-            flow_field[y][x] = {};
-            flow_field[y][x].walkable = (
-                get_cell_state(top_left + CellCoordinate{ x, y }) != CHUNK_CELL_STATE::OBSTACLE
-            );
+    CellCoordinate player_cell = get_cell_coordinate(mp.position);
+    CellCoordinate top_left = player_cell - field_radius;
+
+    if (!field_valid || registry.chunks.version() != seen_chunks_version) {
+        sample_walkable(top_left);
+    } else if (player_cell != field_center) {
+        CellCoordinate delta = player_cell - field_center;
+        if (glm::abs(delta.x) < field_size && glm::abs(delta.y) < field_size)
+            shift_walkable(top_left, delta);
+        else
+            sample_walkable(top_left);
+    } else {
+        return;
+    }
+
+    field_center = player_cell;
+    field_valid = true;
+    seen_chunks_version = registry.chunks.version();
+    build_flow_field();
+}
+
+// Reset flow field with obstacle info from grid, fetched as one rectangle
+void PathfindingSystem::sample_walkable(const CellCoordinate& top_left) {
+    sampled_cells.resize(flow_field.size());
+    world_cells.fetch_rect(top_left, field_size, field_size, sampled_cells.data());
+    for (size_t i = 0; i < flow_field.size(); i++)
+        flow_field[i].walkable = sampled_cells[i] != CHUNK_CELL_STATE::OBSTACLE;
+}
+
+// Moves the walkability samples by `delta` cells and probes only the cells that scrolled in
+void PathfindingSystem::shift_walkable(const CellCoordinate& top_left, const CellCoordinate& delta) {
+    for (int y = 0; y < field_size; y++) {
+        for (int x = 0; x < field_size; x++) {
+            CellCoordinate old_pos = CellCoordinate{ x, y } + delta;
+            shifted_walkable[y * field_size + x] = is_in_bounds(old_pos, field_size)
+                ? node(old_pos.x, old_pos.y).walkable
+                : world_cells.get(top_left + CellCoordinate{ x, y }) != CHUNK_CELL_STATE::OBSTACLE;
         }
     }
+    for (int i = 0; i < field_size * field_size; i++)
+        flow_field[i].walkable = shifted_walkable[i];
+}
+
+void PathfindingSystem::build_flow_field() {
+    for (PathNode& n : flow_field) {
+        n.cost = std::numeric_limits<int>::max();
+        n.dir = { 0, 0 };
+    }
 
-    CellCoordinate goal{ FIELD_RADIUS, FIELD_RADIUS };
-    if (!is_in_bounds(goal, FIELD_SIZE)) return;
-
-    // Order by min cost
-    auto cmp = [](const std::pair<float, CellCoordinate>& a, const std::pair<float, CellCoordinate>& b) {
-        return a.first > b.first;
-    };
-    std::priority_queue<std::pair<float, CellCoordinate>, std::vector<std::pair<float, CellCoordinate>>, decltype(cmp)> pq(cmp);
-
-    flow_field[goal.y][goal.x].cost = 0;
-    pq.push({ 0, goal });
-
-    while (!pq.empty()) {
-        const auto& curr = pq.top();
-        float curr_cost = curr.first;
-        CellCoordinate curr_pos = curr.second;
-        pq.pop();
-
-        // Not worth exploring, calculated cost greater than current min
-        if (curr_cost > flow_field[curr_pos.y][curr_pos.x].cost) continue;
-
-        // Explore all neighbours
-        for (const auto& dir : DIRECTIONS) {
-            CellCoordinate next_pos = curr_pos + dir;
-            if (!is_in_bounds(next_pos, FIELD_SIZE)) continue;
-
-            auto& neighbour = flow_field[next_pos.y][next_pos.x];
-            if (!neighbour.walkable) {
-                continue; }
-
-            int next_cost = curr_cost + move_cost(dir);
-            if (next_cost < neighbour.cost) { // Shorter path found
-                neighbour.cost = next_cost;
-                neighbour.dir = { -dir.x, -dir.y };
-                pq.push({ next_cost, next_pos });
+    CellCoordinate goal{ field_radius, field_radius };
+    if (!is_in_bounds(goal, field_size)) return;
+
+    // Dijkstra with a bucket queue (Dial's algorithm): step costs are only CARDINAL_COST or
+    // DIAGONAL_COST, so a ring of DIAGONAL_COST + 1 buckets indexed by cost replaces the heap.
+    const int bucket_count = DIAGONAL_COST + 1;
+    cost_buckets.resize(bucket_count);
+    for (auto& bucket : cost_buckets)
+        bucket.clear();
+
+    node(goal.x, goal.y).cost = 0;
+    cost_buckets[0].push_back(goal.y * field_size + goal.x);
+    size_t pending = 1;
+
+    for (int curr_cost = 0; pending > 0; curr_cost++) {
+        std::vector<int>& bucket = cost_buckets[curr_cost % bucket_count];
+        // Neighbours always land in other buckets since both step costs are below bucket_count
+        for (int index : bucket) {
+            pending--;
+            // Not worth exploring, a cheaper path was found after this entry was queued
+            if (curr_cost > flow_field[index].cost) continue;
+
+            CellCoordinate curr_pos{ index % field_size, index / field_size };
+
+            // Explore all neighbours
+            for (const auto& dir : DIRECTIONS) {
+                CellCoordinate next_pos = curr_pos + dir;
+                if (!is_in_bounds(next_pos, field_size)) continue;
+
+                auto& neighbour = node(next_pos.x, next_pos.y);
+                if (!neighbour.walkable) {
+                    continue; }
+
+                int next_cost = curr_cost + move_cost(dir);
+                if (next_cost < neighbour.cost) { // Shorter path found
+                    neighbour.cost = next_cost;
+                    neighbour.dir = { -dir.x, -dir.y };
+                    cost_buckets[next_cost % bucket_count].push_back(next_pos.y * field_size + next_pos.x);
+                    pending++;
+                }
             }
         }
+        bucket.clear();
     }
 }
 
@@ -96,7 +129,6 @@ void PathfindingSystem::add_path_force() {
     const Entity& player = registry.players.entities[0];
     auto& motions_registry = registry.motions;
     auto& dirs_registry = registry.enemy_dirs;
-    CellCoordinate player_cell = get_cell_coordinate(motions_registry.get(player).position);
     for (const auto& e : registry.enemies.entities) {
         if (!dirs_registry.has(e)) {
             dirs_registry.emplace(e);
@@ -105,20 +137,31 @@ void PathfindingSystem::add_path_force() {
         AccumulatedForce& af = dirs_registry.get(e);
         af.v = { 0, 0 };
 
-        CellCoordinate enemy_cell = get_cell_coordinate(motions_registry.get(e).position);
-        if (is_coordinate_in(enemy_cell, player_cell, FIELD_RADIUS)) {
-        //if (false) {
-            CellCoordinate field_pos = enemy_cell - (player_cell - FIELD_RADIUS);
-            af.v += glm::normalize(glm::vec2(flow_field[field_pos.y % CHUNK_CELLS_PER_ROW][field_pos.x % CHUNK_CELLS_PER_ROW].dir)) * 2000.f;
-        } else {
-            const Motion& mp = motions_registry.get(player);
-            const Motion& me = motions_registry.get(e);
-            af.v += glm::normalize(mp.position - me.position) * 2000.f;
+        const Motion& me = motions_registry.get(e);
+        CellCoordinate enemy_cell = get_cell_coordinate(me.position);
+        CellCoordinate field_pos = enemy_cell - (field_center - field_radius);
+        CellCoordinate waypoint;
+        if (is_in_bounds(field_pos, field_size)) {
+            // Cells with no direction (the goal itself, or walled off) fall back to direct pursuit
+            if (node(field_pos.x, field_pos.y).dir != CellCoordinate{ 0, 0 }) {
+                af.v += glm::normalize(glm::vec2(node(field_pos.x, field_pos.y).dir)) * 2000.f;
+                continue;
+            }
+        } else if (chunk_graph.next_waypoint(enemy_cell, waypoint)) {
+            // Far enemies follow the chunk graph, aiming for the center of the next waypoint cell
+            glm::vec2 target = (glm::vec2(waypoint) + 0.5f) * static_cast<float>(CHUNK_CELL_SIZE);
+            af.v += glm::normalize(target - me.position) * 2000.f;
+            continue;
         }
+
+        const Motion& mp = motions_registry.get(player);
+        af.v += glm::normalize(mp.position - me.position) * 2000.f;
     }
 }
 
 void PathfindingSystem::step(float elapsed_ms) {
-    build_flow_field();
+    update_flow_field();
+    chunk_graph.sync();
+    chunk_graph.set_goal(field_center);
     add_path_force();
-}
\ No newline at end of file
+}
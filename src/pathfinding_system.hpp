@@ -1,5 +1,8 @@
 #pragma once
 
+#include "chunk_path_graph.hpp"
+#include "world_cells.hpp"
+
 #include <glm/vec2.hpp>
 
 #include <limits>
@@ -7,8 +10,8 @@
 
 using CellCoordinate = glm::ivec2;
 
+// Default half-width of the flow field in cells; see PathfindingSystem::set_field_radius
 constexpr int FIELD_RADIUS = 16;
-constexpr int FIELD_SIZE = FIELD_RADIUS * 2 + 1;
 constexpr CellCoordinate DIRECTIONS[] = {
 	{ 1, 0 }, { 1, 1 }, { 0, 1 }, { -1, 1 },
 	{ -1, 0 }, { -1, -1 }, { 0, -1 }, { 1, -1 }
@@ -24,13 +27,41 @@ struct PathNode {
 
 class PathfindingSystem {
 public:
-	PathfindingSystem() : flow_field(FIELD_SIZE, std::vector<PathNode>(FIELD_SIZE)) {}
+	PathfindingSystem(int field_radius = FIELD_RADIUS) { set_field_radius(field_radius); }
 
 	void step(float elapsed_ms);
 
+	// Resizes the flow field to (2 * radius + 1)^2 cells; the next step rebuilds it
+	void set_field_radius(int radius);
+	int get_field_radius() const { return field_radius; }
+
+	// Forces the next step to resample every cell and rebuild the field
+	void invalidate() { field_valid = false; }
+
 private:
-	std::vector<std::vector<PathNode>> flow_field;
+	int field_radius = FIELD_RADIUS;
+	int field_size = FIELD_RADIUS * 2 + 1;
+
+	// Row-major, field_size * field_size, centered on field_center (the player's cell)
+	std::vector<PathNode> flow_field;
+	CellCoordinate field_center{ 0, 0 };
+	bool field_valid = false;
+	unsigned int seen_chunks_version = 0;
 
+	// Scratch space reused between rebuilds
+	WorldCellQuery world_cells;
+	std::vector<CHUNK_CELL_STATE> sampled_cells;
+	std::vector<bool> shifted_walkable;
+	std::vector<std::vector<int>> cost_buckets;
+
+	// Routes enemies outside the flow field across chunks
+	ChunkPathGraph chunk_graph;
+
+	PathNode& node(int x, int y) { return flow_field[y * field_size + x]; }
+
+	void update_flow_field();
+	void sample_walkable(const CellCoordinate& top_left);
+	void shift_walkable(const CellCoordinate& top_left, const CellCoordinate& delta);
 	void build_flow_field();
 	void add_path_force();
-};
\ No newline at end of file
+};
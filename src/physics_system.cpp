@@ -4,6 +4,7 @@
 #include <cmath>
 #include <algorithm>
 #include <unordered_map>
+#include <climits>
 
 // Returns the local bounding coordinates scaled by the current size of the entity
 vec2 get_bounding_box(const Motion& motion)
@@ -298,6 +299,254 @@ static bool sat_polygon_circle(const std::vector<vec2>& polygon,
     return true;
 }
 
+// Upper bound on the distance from motion.position to any point of the entity's collision
+// shape, covering every radius the dynamic-vs-dynamic narrowphase may use
+static float collider_extent(Entity e, const Motion& motion)
+{
+    vec2 half_bb = get_bounding_box(motion) / 2.f;
+    float extent = sqrtf(dot(half_bb, half_bb));
+    if (registry.collisionCircles.has(e))
+        extent = std::max(extent, registry.collisionCircles.get(e).radius);
+    if (registry.multiCircleColliders.has(e))
+        extent = std::max(extent, get_multi_circle_extent(registry.multiCircleColliders.get(e)));
+    if (registry.colliders.has(e)) {
+        // rotation preserves length, so only the scale matters
+        for (const vec2& pt : registry.colliders.get(e).local_points)
+            extent = std::max(extent, length(vec2(pt.x * motion.scale.x, pt.y * motion.scale.y)));
+    }
+    return extent;
+}
+
+// Damage detection and blocking/pushing between two moving entities
+static void collide_dynamic_pair(DynamicCollider& collider_i, DynamicCollider& collider_j)
+{
+    Entity entity_i = collider_i.entity;
+    Entity entity_j = collider_j.entity;
+    Motion& motion_i = *collider_i.motion;
+    Motion& motion_j = *collider_j.motion;
+
+    const bool has_col_i = collider_i.has_col;
+    const bool has_col_j = collider_j.has_col;
+    const bool has_circ_i = collider_i.has_circ;
+    const bool has_circ_j = collider_j.has_circ;
+    const bool is_bullet_i = collider_i.is_bullet;
+    const bool is_bullet_j = collider_j.is_bullet;
+    const bool is_player_i = collider_i.is_player;
+    const bool is_player_j = collider_j.is_player;
+
+    auto radius_from_motion = [&](const Motion& motion) {
+        vec2 half_bb = get_bounding_box(motion) / 2.f;
+        return sqrtf(dot(half_bb, half_bb));
+    };
+
+    auto radius_of = [&](Entity entity, const Motion& motion) {
+        if (registry.collisionCircles.has(entity))
+            return registry.collisionCircles.get(entity).radius;
+        if (registry.multiCircleColliders.has(entity))
+            return get_multi_circle_extent(registry.multiCircleColliders.get(entity));
+        return radius_from_motion(motion);
+    };
+
+    auto circle_circle_overlap = [&](const Motion& a_motion, float a_radius,
+                                     const Motion& b_motion, float b_radius) {
+        vec2 delta = a_motion.position - b_motion.position;
+        float distance_sq = dot(delta, delta);
+        float sum_radii = a_radius + b_radius;
+        return distance_sq < sum_radii * sum_radii;
+    };
+
+    auto poly_from = [&](Entity entity, const Motion& motion) {
+        std::vector<vec2> world_points;
+        transform_polygon(motion, registry.colliders.get(entity).local_points, world_points);
+        return world_points;
+    };
+
+    // damage detection
+    bool hit_for_damage = false;
+    const bool is_enemy_i = collider_i.is_enemy;
+    const bool is_enemy_j = collider_j.is_enemy;
+
+    if (has_col_i && has_col_j) {
+        auto pi = poly_from(entity_i, motion_i);
+        auto pj = poly_from(entity_j, motion_j);
+        vec2 mtv;
+        bool overlap = sat_overlap(pi, pj, mtv);
+        if (overlap)
+            hit_for_damage = true;
+    }
+    else if (has_col_i && has_circ_j) {
+        auto pi = poly_from(entity_i, motion_i);
+        float rj = registry.collisionCircles.get(entity_j).radius;
+        vec2 mtv;
+        bool overlap = sat_polygon_circle(pi, motion_j.position, rj, mtv);
+        if (overlap)
+            hit_for_damage = true;
+    }
+    else if (has_col_j && has_circ_i) {
+        auto pj = poly_from(entity_j, motion_j);
+        float ri = registry.collisionCircles.get(entity_i).radius;
+        vec2 mtv;
+        bool overlap = sat_polygon_circle(pj, motion_i.position, ri, mtv);
+        if (overlap)
+            hit_for_damage = true;
+    }
+
+
+    else if ((is_bullet_i && is_enemy_j) || (is_bullet_j && is_enemy_i)) {
+        float ri = radius_of(entity_i, motion_i);
+        float rj = radius_of(entity_j, motion_j);
+        bool overlap = circle_circle_overlap(motion_i, ri, motion_j, rj);
+        if (overlap)
+            hit_for_damage = true;
+    }
+
+    else if ((is_bullet_i && is_player_j) || (is_bullet_j && is_player_i)) {
+        // Only create collision events for enemy bullets (those with Deadly component)
+        // Player bullets should not collide with the player
+        bool is_enemy_bullet = (is_bullet_i && collider_i.is_deadly) || 
+                               (is_bullet_j && collider_j.is_deadly);
+        if (is_enemy_bullet) {
+            float ri = radius_of(entity_i, motion_i);
+            float rj = radius_of(entity_j, motion_j);
+            bool overlap = circle_circle_overlap(motion_i, ri, motion_j, rj);
+            if (overlap)
+                hit_for_damage = true;
+        }
+    }
+
+    // blocking/pushing
+    bool hit_for_blocking = false;
+    bool use_circ_i = (is_player_i && has_circ_i) || (!is_player_i && !has_col_i && has_circ_i);
+    bool use_circ_j = (is_player_j && has_circ_j) || (!is_player_j && !has_col_j && has_circ_j);
+
+    auto push_mesh_from_circle = [&](const Motion& circle_motion,
+                                     float circle_radius,
+                                     Entity mesh_entity,
+                                     Motion& mesh_motion) {
+        // compute world polygon for mesh
+        vec2 mtv;
+        std::vector<vec2> mesh_polygon = poly_from(mesh_entity, mesh_motion);
+        bool overlaps = sat_polygon_circle(mesh_polygon,
+                                            circle_motion.position,
+                                            circle_radius,
+                                            mtv);
+        if (!overlaps)
+            return false;
+
+        // find mesh polygon centroid to find push direction
+        vec2 centroid = { 0.f, 0.f };
+        for (const vec2& p : mesh_polygon) {
+            centroid.x += p.x;
+            centroid.y += p.y;
+        }
+        float count = (float) mesh_polygon.size();
+        centroid.x /= count;
+        centroid.y /= count;
+
+        // normalised direction from circle center to mesh centroid
+        vec2 dir = { centroid.x - circle_motion.position.x,
+                     centroid.y - circle_motion.position.y };
+        float dir_len = sqrtf(dot(dir, dir));
+        if (dir_len <= 0.00001f)
+            return false;
+        dir.x /= dir_len;
+        dir.y /= dir_len;
+
+        // push amount
+        float mtv_len = sqrtf(dot(mtv, mtv));
+        mesh_motion.position.x += dir.x * mtv_len;
+        mesh_motion.position.y += dir.y * mtv_len;
+        return true;
+    };
+
+    if (use_circ_i && use_circ_j)
+    {
+        auto radius_from = [&](Entity e){
+            if (registry.collisionCircles.has(e)) return registry.collisionCircles.get(e).radius;
+            vec2 bb = get_bounding_box(registry.motions.get(e)) / 2.f;
+            return sqrtf(dot(bb, bb));
+        };
+        float ri = radius_from(entity_i);
+        float rj = radius_from(entity_j);
+        vec2 dp = motion_i.position - motion_j.position;
+        float dist2 = dot(dp, dp);
+        float sumr = ri + rj;
+        if (dist2 < sumr*sumr)
+        {
+            hit_for_blocking = true;
+            float dist = sqrt(dist2);
+            vec2 n = dist > 0.0001f ? vec2{dp.x/dist, dp.y/dist} : vec2{1.f, 0.f};
+            float overlap = sumr - dist;
+
+            // push enemy out
+            if (is_player_i) {
+                motion_j.position -= n * overlap;  // push enemy away
+            } else if (is_player_j) {
+                motion_i.position += n * overlap;  // push enemy away
+            } else {
+                vec2 half = {n.x * overlap * 0.5f, n.y * overlap * 0.5f};
+                // for two non-player circles push symmetrically
+                motion_i.position += half;
+                motion_j.position -= half;
+        }
+    }
+    }
+    else if (use_circ_i && !use_circ_j && has_col_j) {
+        if (push_mesh_from_circle(motion_i, radius_of(entity_i, motion_i), entity_j, motion_j)) hit_for_blocking = true;
+    }
+
+    else if (use_circ_j && !use_circ_i && has_col_i) {
+        if (push_mesh_from_circle(motion_j, radius_of(entity_j, motion_j), entity_i, motion_i)) hit_for_blocking = true;
+    }
+    else if (!use_circ_i && !use_circ_j && has_col_i && has_col_j)
+    {
+        std::vector<vec2> poly_i, poly_j;
+        transform_polygon(motion_i, registry.colliders.get(entity_i).local_points, poly_i);
+        transform_polygon(motion_j, registry.colliders.get(entity_j).local_points, poly_j);
+        vec2 mtv;
+        if (sat_overlap(poly_i, poly_j, mtv))
+        {
+            hit_for_blocking = true;
+            vec2 half = { mtv.x*0.5f, mtv.y*0.5f };
+            motion_i.position -= half;
+            motion_j.position += half;
+        }
+    }
+    else if ((is_player_i || is_player_j) && !hit_for_blocking)
+    {
+        auto radius_from = [&](Entity e){
+            if (registry.collisionCircles.has(e)) return registry.collisionCircles.get(e).radius;
+            vec2 bb = get_bounding_box(registry.motions.get(e)) / 2.f;
+            return sqrtf(dot(bb, bb));
+        };
+        float ri = radius_from(entity_i);
+
+        float rj = radius_from(entity_j);
+        vec2 dp = motion_i.position - motion_j.position;
+        float dist2 = dot(dp, dp);
+        float sumr = ri + rj;
+
+        if (dist2 < sumr*sumr)
+        {
+            hit_for_blocking = true;
+            float dist = sqrt(dist2);
+            vec2 n = dist > 0.0001f ? vec2{dp.x/dist, dp.y/dist} : vec2{1.f, 0.f};
+            float overlap = sumr - dist;
+            if (is_player_i) {
+                motion_j.position -= n * overlap; 
+            } else {
+                motion_i.position += n * overlap;
+            }
+        }
+    }
+
+    if (hit_for_damage)
+    {
+        registry.collisions.emplace_with_duplicates(entity_i, entity_j);
+        registry.collisions.emplace_with_duplicates(entity_j, entity_i);
+    }
+}
+
 void PhysicsSystem::step(float elapsed_ms)
 {
 	// Move entities based on how much time has passed, this is to (partially) avoid
@@ -669,247 +918,112 @@ void PhysicsSystem::step(float elapsed_ms)
     }
 
 	// Check for collisions between all moving entities
-    ComponentContainer<Motion> &motion_container = registry.motions;
-	for(uint i = 0; i<motion_container.components.size(); i++)
-	{
-		Motion& motion_i = motion_container.components[i];
-		Entity entity_i = motion_container.entities[i];
-
-        if(registry.drops.has(entity_i)) continue;
-		
-		for(uint j = i+1; j<motion_container.components.size(); j++)
-		{
-            Motion& motion_j = motion_container.components[j];
-            Entity entity_j = motion_container.entities[j];
-
-            if(registry.drops.has(entity_j)) continue;
-
-            const bool has_col_i = registry.colliders.has(entity_i);
-            const bool has_col_j = registry.colliders.has(entity_j);
-            const bool has_circ_i = registry.collisionCircles.has(entity_i);
-            const bool has_circ_j = registry.collisionCircles.has(entity_j);
-            const bool is_bullet_i = registry.bullets.has(entity_i);
-            const bool is_bullet_j = registry.bullets.has(entity_j);
-            const bool is_player_i = registry.players.has(entity_i);
-            const bool is_player_j = registry.players.has(entity_j);
-            const bool is_feet_i = registry.feet.has(entity_i);
-            const bool is_feet_j = registry.feet.has(entity_j);
-            if (is_feet_i || is_feet_j) continue;
-            if (registry.obstacles.has(entity_i) || registry.obstacles.has(entity_j)) continue;
-            if (registry.nonColliders.has(entity_i) || registry.nonColliders.has(entity_j)) continue;
-
-            auto radius_from_motion = [&](const Motion& motion) {
-                vec2 half_bb = get_bounding_box(motion) / 2.f;
-                return sqrtf(dot(half_bb, half_bb));
-            };
-
-            auto radius_of = [&](Entity entity, const Motion& motion) {
-                if (registry.collisionCircles.has(entity))
-                    return registry.collisionCircles.get(entity).radius;
-                if (registry.multiCircleColliders.has(entity))
-                    return get_multi_circle_extent(registry.multiCircleColliders.get(entity));
-                return radius_from_motion(motion);
-            };
-
-            auto circle_circle_overlap = [&](const Motion& a_motion, float a_radius,
-                                             const Motion& b_motion, float b_radius) {
-                vec2 delta = a_motion.position - b_motion.position;
-                float distance_sq = dot(delta, delta);
-                float sum_radii = a_radius + b_radius;
-                return distance_sq < sum_radii * sum_radii;
-            };
-
-            auto poly_from = [&](Entity entity, const Motion& motion) {
-                std::vector<vec2> world_points;
-                transform_polygon(motion, registry.colliders.get(entity).local_points, world_points);
-                return world_points;
-            };
-
-            // damage detection
-            bool hit_for_damage = false;
-            const bool is_enemy_i = registry.enemies.has(entity_i) && !registry.enemies.get(entity_i).is_dead;
-            const bool is_enemy_j = registry.enemies.has(entity_j) && !registry.enemies.get(entity_j).is_dead;
-
-            if (has_col_i && has_col_j) {
-                auto pi = poly_from(entity_i, motion_i);
-                auto pj = poly_from(entity_j, motion_j);
-                vec2 mtv;
-                bool overlap = sat_overlap(pi, pj, mtv);
-                if (overlap)
-                    hit_for_damage = true;
-            }
-            else if (has_col_i && has_circ_j) {
-                auto pi = poly_from(entity_i, motion_i);
-                float rj = registry.collisionCircles.get(entity_j).radius;
-                vec2 mtv;
-                bool overlap = sat_polygon_circle(pi, motion_j.position, rj, mtv);
-                if (overlap)
-                    hit_for_damage = true;
-            }
-            else if (has_col_j && has_circ_i) {
-                auto pj = poly_from(entity_j, motion_j);
-                float ri = registry.collisionCircles.get(entity_i).radius;
-                vec2 mtv;
-                bool overlap = sat_polygon_circle(pj, motion_i.position, ri, mtv);
-                if (overlap)
-                    hit_for_damage = true;
-            }
-
-
-            else if ((is_bullet_i && is_enemy_j) || (is_bullet_j && is_enemy_i)) {
-                float ri = radius_of(entity_i, motion_i);
-                float rj = radius_of(entity_j, motion_j);
-                bool overlap = circle_circle_overlap(motion_i, ri, motion_j, rj);
-                if (overlap)
-                    hit_for_damage = true;
-            }
+	gather_dynamic_colliders();
+	if (use_broadphase)
+		collide_dynamic_broadphase();
+	else
+		collide_dynamic_all_pairs();
+}
 
-            else if ((is_bullet_i && is_player_j) || (is_bullet_j && is_player_i)) {
-                // Only create collision events for enemy bullets (those with Deadly component)
-                // Player bullets should not collide with the player
-                bool is_enemy_bullet = (is_bullet_i && registry.deadlies.has(entity_i)) || 
-                                       (is_bullet_j && registry.deadlies.has(entity_j));
-                if (is_enemy_bullet) {
-                    float ri = radius_of(entity_i, motion_i);
-                    float rj = radius_of(entity_j, motion_j);
-                    bool overlap = circle_circle_overlap(motion_i, ri, motion_j, rj);
-                    if (overlap)
-                        hit_for_damage = true;
-                }
-            }
+void PhysicsSystem::gather_dynamic_colliders()
+{
+	// The view keeps registry.motions order, which keeps the pair order stable
+	dynamic_colliders.clear();
+	moving_view.each([&](Entity entity, Motion& motion) {
+		dynamic_colliders.push_back({
+			entity,
+			&motion,
+			collider_extent(entity, motion),
+			registry.colliders.has(entity),
+			registry.collisionCircles.has(entity),
+			registry.bullets.has(entity),
+			registry.players.has(entity),
+			registry.enemies.has(entity) && !registry.enemies.get(entity).is_dead,
+			registry.deadlies.has(entity)
+		});
+	});
+}
 
-            // blocking/pushing
-            bool hit_for_blocking = false;
-            bool use_circ_i = (is_player_i && has_circ_i) || (!is_player_i && !has_col_i && has_circ_i);
-            bool use_circ_j = (is_player_j && has_circ_j) || (!is_player_j && !has_col_j && has_circ_j);
+void PhysicsSystem::collide_dynamic_all_pairs()
+{
+	for (size_t i = 0; i < dynamic_colliders.size(); i++)
+		for (size_t j = i + 1; j < dynamic_colliders.size(); j++)
+			collide_dynamic_pair(dynamic_colliders[i], dynamic_colliders[j]);
+}
 
-            auto push_mesh_from_circle = [&](const Motion& circle_motion,
-                                             float circle_radius,
-                                             Entity mesh_entity,
-                                             Motion& mesh_motion) {
-                // compute world polygon for mesh
-                vec2 mtv;
-                std::vector<vec2> mesh_polygon = poly_from(mesh_entity, mesh_motion);
-                bool overlaps = sat_polygon_circle(mesh_polygon,
-                                                    circle_motion.position,
-                                                    circle_radius,
-                                                    mtv);
-                if (!overlaps)
-                    return false;
-
-                // find mesh polygon centroid to find push direction
-                vec2 centroid = { 0.f, 0.f };
-                for (const vec2& p : mesh_polygon) {
-                    centroid.x += p.x;
-                    centroid.y += p.y;
-                }
-                float count = (float) mesh_polygon.size();
-                centroid.x /= count;
-                centroid.y /= count;
-
-                // normalised direction from circle center to mesh centroid
-                vec2 dir = { centroid.x - circle_motion.position.x,
-                             centroid.y - circle_motion.position.y };
-                float dir_len = sqrtf(dot(dir, dir));
-                if (dir_len <= 0.00001f)
-                    return false;
-                dir.x /= dir_len;
-                dir.y /= dir_len;
-
-                // push amount
-                float mtv_len = sqrtf(dot(mtv, mtv));
-                mesh_motion.position.x += dir.x * mtv_len;
-                mesh_motion.position.y += dir.y * mtv_len;
-                return true;
-            };
+// Whether a collider has been pushed further than the broadphase margin from where it was binned
+static bool beyond_margin(vec2 from, vec2 to)
+{
+	vec2 moved = abs(to - from);
+	return std::max(moved.x, moved.y) > PHYSICS_BROADPHASE_MARGIN;
+}
 
-            if (use_circ_i && use_circ_j)
-            {
-                auto radius_from = [&](Entity e){
-                    if (registry.collisionCircles.has(e)) return registry.collisionCircles.get(e).radius;
-                    vec2 bb = get_bounding_box(registry.motions.get(e)) / 2.f;
-                    return sqrtf(dot(bb, bb));
-                };
-                float ri = radius_from(entity_i);
-                float rj = radius_from(entity_j);
-                vec2 dp = motion_i.position - motion_j.position;
-                float dist2 = dot(dp, dp);
-                float sumr = ri + rj;
-                if (dist2 < sumr*sumr)
-                {
-                    hit_for_blocking = true;
-                    float dist = sqrt(dist2);
-                    vec2 n = dist > 0.0001f ? vec2{dp.x/dist, dp.y/dist} : vec2{1.f, 0.f};
-                    float overlap = sumr - dist;
-
-                    // push enemy out
-                    if (is_player_i) {
-                        motion_j.position -= n * overlap;  // push enemy away
-                    } else if (is_player_j) {
-                        motion_i.position += n * overlap;  // push enemy away
-                    } else {
-                        vec2 half = {n.x * overlap * 0.5f, n.y * overlap * 0.5f};
-                        // for two non-player circles push symmetrically
-                        motion_i.position += half;
-                        motion_j.position -= half;
-                }
-            }
-            }
-            else if (use_circ_i && !use_circ_j && has_col_j) {
-                if (push_mesh_from_circle(motion_i, radius_of(entity_i, motion_i), entity_j, motion_j)) hit_for_blocking = true;
-            }
+void PhysicsSystem::collide_dynamic_broadphase()
+{
+	// Bin every collider by its extent plus a margin that absorbs pushes applied earlier in the pass
+	broadphase_grid.clear(PHYSICS_BROADPHASE_CELL_SIZE);
+	binned_positions.resize(dynamic_colliders.size());
+	for (unsigned int i = 0; i < dynamic_colliders.size(); i++)
+	{
+		const DynamicCollider& collider = dynamic_colliders[i];
+		vec2 reach = vec2(collider.extent + PHYSICS_BROADPHASE_MARGIN);
+		binned_positions[i] = collider.motion->position;
+		broadphase_grid.insert(i, collider.motion->position - reach, collider.motion->position + reach);
+	}
+	broadphase_grid.build();
+
+	// A collider pushed further than the margin from its bin can be missed by the grid, so from
+	// then on it is tested against every later collider directly
+	drifted.clear();
+	is_drifted.assign(dynamic_colliders.size(), false);
+	auto note_drift = [&](unsigned int k) {
+		if (!is_drifted[k] && beyond_margin(binned_positions[k], dynamic_colliders[k].motion->position)) {
+			is_drifted[k] = true;
+			drifted.push_back(k);
+		}
+	};
 
-            else if (use_circ_j && !use_circ_i && has_col_i) {
-                if (push_mesh_from_circle(motion_j, radius_of(entity_j, motion_j), entity_i, motion_i)) hit_for_blocking = true;
-            }
-            else if (!use_circ_i && !use_circ_j && has_col_i && has_col_j)
-            {
-                std::vector<vec2> poly_i, poly_j;
-                transform_polygon(motion_i, registry.colliders.get(entity_i).local_points, poly_i);
-                transform_polygon(motion_j, registry.colliders.get(entity_j).local_points, poly_j);
-                vec2 mtv;
-                if (sat_overlap(poly_i, poly_j, mtv))
-                {
-                    hit_for_blocking = true;
-                    vec2 half = { mtv.x*0.5f, mtv.y*0.5f };
-                    motion_i.position -= half;
-                    motion_j.position += half;
-                }
-            }
-            else if ((is_player_i || is_player_j) && !hit_for_blocking)
-            {
-                auto radius_from = [&](Entity e){
-                    if (registry.collisionCircles.has(e)) return registry.collisionCircles.get(e).radius;
-                    vec2 bb = get_bounding_box(registry.motions.get(e)) / 2.f;
-                    return sqrtf(dot(bb, bb));
-                };
-                float ri = radius_from(entity_i);
-
-                float rj = radius_from(entity_j);
-                vec2 dp = motion_i.position - motion_j.position;
-                float dist2 = dot(dp, dp);
-                float sumr = ri + rj;
+	// Visit candidate pairs in the same (i, j) order as the all-pairs loop, since the
+	// pushes of earlier pairs feed into later ones
+	last_visited_by.assign(dynamic_colliders.size(), UINT_MAX);
+	for (unsigned int i = 0; i < dynamic_colliders.size(); i++)
+	{
+		const DynamicCollider& collider = dynamic_colliders[i];
+		vec2 reach = vec2(collider.extent + PHYSICS_BROADPHASE_MARGIN);
+		auto add_candidate = [&](unsigned int j) {
+			if (j > i && last_visited_by[j] != i) {
+				last_visited_by[j] = i;
+				broadphase_candidates.push_back(j);
+			}
+		};
 
-                if (dist2 < sumr*sumr)
-                {
-                    hit_for_blocking = true;
-                    float dist = sqrt(dist2);
-                    vec2 n = dist > 0.0001f ? vec2{dp.x/dist, dp.y/dist} : vec2{1.f, 0.f};
-                    float overlap = sumr - dist;
-                    if (is_player_i) {
-                        motion_j.position -= n * overlap; 
-                    } else {
-                        motion_i.position += n * overlap;
-                    }
-                }
-            }
+		broadphase_candidates.clear();
+		vec2 queried_at = collider.motion->position;
+		broadphase_grid.query(queried_at - reach, queried_at + reach, add_candidate);
+		for (unsigned int j : drifted)
+			add_candidate(j);
+		std::sort(broadphase_candidates.begin(), broadphase_candidates.end());
 
-            if (hit_for_damage)
-            {
-				registry.collisions.emplace_with_duplicates(entity_i, entity_j);
-				registry.collisions.emplace_with_duplicates(entity_j, entity_i);
+		for (size_t k = 0; k < broadphase_candidates.size(); k++)
+		{
+			unsigned int j = broadphase_candidates[k];
+			collide_dynamic_pair(dynamic_colliders[i], dynamic_colliders[j]);
+			note_drift(j);
+
+			// i's own pushes moved it away from where its candidates were found; query again for
+			// the pairs still ahead of it
+			if (beyond_margin(queried_at, collider.motion->position))
+			{
+				queried_at = collider.motion->position;
+				broadphase_grid.query(queried_at - reach, queried_at + reach, [&](unsigned int n) {
+					if (n > j)
+						add_candidate(n);
+				});
+				for (unsigned int n : drifted)
+					if (n > j)
+						add_candidate(n);
+				std::sort(broadphase_candidates.begin() + k + 1, broadphase_candidates.end());
 			}
 		}
 	}
-
-}
\ No newline at end of file
+}
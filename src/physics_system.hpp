@@ -4,6 +4,27 @@
 #include "tiny_ecs.hpp"
 #include "components.hpp"
 #include "tiny_ecs_registry.hpp"
+#include "spatial_grid.hpp"
+
+// Broadphase tuning for the dynamic-vs-dynamic pass
+const float PHYSICS_BROADPHASE_CELL_SIZE = 64.f;
+// Slack added to every extent so pushes applied earlier in the same pass rarely hide a pair; a
+// collider pushed further than this is re-queried or tested against every later collider
+const float PHYSICS_BROADPHASE_MARGIN = 16.f;
+
+// Per-entity data for the dynamic-vs-dynamic pass, gathered once per step instead of per pair
+struct DynamicCollider
+{
+	Entity entity;
+	Motion* motion;
+	float extent; // upper bound on the distance from the position to any point of the shape
+	bool has_col;
+	bool has_circ;
+	bool is_bullet;
+	bool is_player;
+	bool is_enemy; // alive enemies only
+	bool is_deadly;
+};
 
 // A simple physics system that moves rigid bodies and checks for collision
 class PhysicsSystem
@@ -11,7 +32,28 @@ class PhysicsSystem
 public:
 	void step(float elapsed_ms);
 
+	// When false, every pair of moving entities goes through the narrowphase (kept for benchmarking)
+	bool use_broadphase = true;
+
 	PhysicsSystem()
 	{
 	}
+
+private:
+	// Drops, feet, obstacles and non-colliders never take part in the dynamic-vs-dynamic pass
+	View<Motion> moving_view = registry.view(registry.motions)
+		.exclude(registry.drops, registry.feet, registry.obstacles, registry.nonColliders);
+
+	std::vector<DynamicCollider> dynamic_colliders;
+	SpatialGrid broadphase_grid;
+	std::vector<unsigned int> broadphase_candidates;
+	std::vector<unsigned int> last_visited_by;
+	// Where each collider was binned this pass, and those pushed beyond the margin since
+	std::vector<vec2> binned_positions;
+	std::vector<unsigned int> drifted;
+	std::vector<bool> is_drifted;
+
+	void gather_dynamic_colliders();
+	void collide_dynamic_all_pairs();
+	void collide_dynamic_broadphase();
 };
\ No newline at end of file
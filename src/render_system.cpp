@@ -5,31 +5,12 @@
 #include <SDL.h>
 #include <iostream>
 #include <cmath>
+#include <algorithm>
 
 #include "tiny_ecs_registry.hpp"
-
-static GLuint g_debug_line_vbo = 0;
-
-inline unsigned char state_to_iso_bitmap(CHUNK_CELL_STATE state) {
-	switch (state) {
-		case CHUNK_CELL_STATE::ISO_01: return 1;
-		case CHUNK_CELL_STATE::ISO_02: return 2;
-		case CHUNK_CELL_STATE::ISO_03: return 3;
-		case CHUNK_CELL_STATE::ISO_04: return 4;
-		case CHUNK_CELL_STATE::ISO_05: return 5;
-		case CHUNK_CELL_STATE::ISO_06: return 6;
-		case CHUNK_CELL_STATE::ISO_07: return 7;
-		case CHUNK_CELL_STATE::ISO_08: return 8;
-		case CHUNK_CELL_STATE::ISO_09: return 9;
-		case CHUNK_CELL_STATE::ISO_10: return 10;
-		case CHUNK_CELL_STATE::ISO_11: return 11;
-		case CHUNK_CELL_STATE::ISO_12: return 12;
-		case CHUNK_CELL_STATE::ISO_13: return 13;
-		case CHUNK_CELL_STATE::ISO_14: return 14;
-		case CHUNK_CELL_STATE::ISO_15: return 15;
-		default: return 0;
-	}
-}
+#include "particle_pool.hpp"
+#include "chunk_mesh.hpp"
+#include "shadow_sdf.hpp"
 
 void RenderSystem::drawTexturedMesh(Entity entity,
 									const mat3 &projection)
@@ -62,10 +43,10 @@ void RenderSystem::drawTexturedMesh(Entity entity,
 
 	const GLuint used_effect_enum = (GLuint)render_request.used_effect;
 	assert(used_effect_enum != (GLuint)EFFECT_ASSET_ID::EFFECT_COUNT);
-	const GLuint program = (GLuint)effects[used_effect_enum];
+	const EffectHandles& effect = effect_handles[used_effect_enum];
 
 	// Setting shaders
-	glUseProgram(program);
+	gl_state.use_program(effect.program);
 	gl_has_errors();
 
 	assert(render_request.used_geometry != GEOMETRY_BUFFER_ID::GEOMETRY_COUNT);
@@ -73,8 +54,8 @@ void RenderSystem::drawTexturedMesh(Entity entity,
 	const GLuint ibo = index_buffers[(GLuint)render_request.used_geometry];
 
 	// Setting vertex and index buffers
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+	gl_state.bind_buffer(GL_ARRAY_BUFFER, vbo);
+	gl_state.bind_buffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
 	gl_has_errors();
 
 	// Input data location as in the vertex buffer
@@ -82,473 +63,410 @@ void RenderSystem::drawTexturedMesh(Entity entity,
 	{
 		Sprite& sprite = registry.sprites.get(entity);
 
-		GLint total_row_uloc = glGetUniformLocation(program, "total_row");
-		assert(total_row_uloc >= 0);
-		glUniform1i(total_row_uloc, sprite.total_row);
-
-		GLint curr_row_uloc = glGetUniformLocation(program, "curr_row");
-		assert(curr_row_uloc >= 0);
-		glUniform1i(curr_row_uloc, sprite.curr_row);
-
-		GLint total_frame_uloc = glGetUniformLocation(program, "total_frame");
-		assert(total_frame_uloc >= 0);
-		glUniform1i(total_frame_uloc, sprite.total_frame);
+		assert(effect.total_row.active() && effect.curr_row.active() && effect.total_frame.active() && effect.curr_frame.active());
+		effect.total_row.set(sprite.total_row);
+		effect.curr_row.set(sprite.curr_row);
+		effect.total_frame.set(sprite.total_frame);
+		effect.curr_frame.set(sprite.curr_frame);
 
-		GLint curr_frame_uloc = glGetUniformLocation(program, "curr_frame");
-		assert(curr_frame_uloc >= 0);
-		glUniform1i(curr_frame_uloc, sprite.curr_frame);
+		// where the texture sits in its atlas page
+		effect.uv_rect.set(texture_atlas.uv_rects[(GLuint)render_request.used_texture]);
 
-		GLint should_flip_uloc = glGetUniformLocation(program, "should_flip");
-		assert(should_flip_uloc >= 0);
-		glUniform1i(should_flip_uloc, sprite.should_flip);
+		assert(effect.should_flip.active());
+		effect.should_flip.set(sprite.should_flip);
 
-		GLint is_hurt_uloc = glGetUniformLocation(program, "is_hurt");
-		assert(is_hurt_uloc >= 0);
+		assert(effect.is_hurt.active());
 		if (registry.enemies.has(entity)) {
 			Enemy& enemy = registry.enemies.get(entity);
-			glUniform1i(is_hurt_uloc, enemy.is_hurt ? 1 : 0);
+			effect.is_hurt.set(enemy.is_hurt ? 1 : 0);
 		} else if (registry.boss_parts.has(entity)) {
 			Boss& boss = registry.boss_parts.get(entity);
-			glUniform1i(is_hurt_uloc, boss.is_hurt ? 1 : 0);
+			effect.is_hurt.set(boss.is_hurt ? 1 : 0);
 		} else {
-			glUniform1i(is_hurt_uloc, 0);
+			effect.is_hurt.set(0);
 		}
 
-		GLint in_position_loc = glGetAttribLocation(program, "in_position");
-		GLint in_texcoord_loc = glGetAttribLocation(program, "in_texcoord");
-		gl_has_errors();
-		assert(in_texcoord_loc >= 0);
-
-		glEnableVertexAttribArray(in_position_loc);
-		glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE,
+		assert(effect.in_texcoord >= 0);
+		glEnableVertexAttribArray(effect.in_position);
+		glVertexAttribPointer(effect.in_position, 3, GL_FLOAT, GL_FALSE,
 							  sizeof(TexturedVertex), (void *)0);
 		gl_has_errors();
 
-		glEnableVertexAttribArray(in_texcoord_loc);
+		glEnableVertexAttribArray(effect.in_texcoord);
 		glVertexAttribPointer(
-			in_texcoord_loc, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex),
+			effect.in_texcoord, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex),
 			(void *)sizeof(
 				vec3)); // note the stride to skip the preceeding vertex position
 
 		// Enabling and binding texture to slot 0
-		glActiveTexture(GL_TEXTURE0);
-		gl_has_errors();
-
-		assert(registry.renderRequests.has(entity));
-		GLuint texture_id =
-			texture_gl_handles[(GLuint)registry.renderRequests.get(entity).used_texture];
-
-		glBindTexture(GL_TEXTURE_2D, texture_id);
+		gl_state.bind_texture(GL_TEXTURE_2D, texture_gl_handles[(GLuint)render_request.used_texture]);
 		gl_has_errors();
 
 		// Pass viewport size for screen UV calculation
 		int w, h;
 		glfwGetFramebufferSize(window, &w, &h);
-		GLint viewport_loc = glGetUniformLocation(program, "viewport_size");
-		if (viewport_loc >= 0) glUniform2f(viewport_loc, (float)w, (float)h);
-		gl_has_errors();
+		effect.viewport_size.set(vec2((float)w, (float)h));
 
 		// Pass ambient light level
-		GLint ambient_loc = glGetUniformLocation(program, "ambient_light");
-		if (ambient_loc >= 0) glUniform1f(ambient_loc, 0.3f);
-		gl_has_errors();
+		effect.ambient_light.set(0.3f);
 
 		// Pass camera offset
-		GLint camera_offset_loc = glGetUniformLocation(program, "camera_offset");
-		if (camera_offset_loc >= 0) {
-			glUniform2f(camera_offset_loc, 0.0f, 0.0f);
-		}
+		effect.camera_offset.set(vec2(0.f));
 		gl_has_errors();
 	}
 	else if (render_request.used_effect == EFFECT_ASSET_ID::COLOURED)
 	{
-		vec3 white = {1.0f, 1.0f, 1.0f};
-		GLint fcolor_uloc = glGetUniformLocation(program, "fcolor");
-		if (fcolor_uloc >= 0) glUniform3fv(fcolor_uloc, 1, (float*)&white);
+		effect.fcolor.set(vec3(1.f));
 
-		GLint in_position_loc = glGetAttribLocation(program, "in_position");
-		GLint in_color_loc = glGetAttribLocation(program, "in_color");
-		gl_has_errors();
-
-		glEnableVertexAttribArray(in_position_loc);
-		glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE,
+		glEnableVertexAttribArray(effect.in_position);
+		glVertexAttribPointer(effect.in_position, 3, GL_FLOAT, GL_FALSE,
 							  sizeof(ColoredVertex), (void *)0);
 		gl_has_errors();
 
-		glEnableVertexAttribArray(in_color_loc);
-		glVertexAttribPointer(in_color_loc, 3, GL_FLOAT, GL_FALSE,
+		glEnableVertexAttribArray(effect.in_color);
+		glVertexAttribPointer(effect.in_color, 3, GL_FLOAT, GL_FALSE,
 						  	sizeof(ColoredVertex), (void *)sizeof(vec3));
 		gl_has_errors();
 
-		GLint is_hurt_uloc = glGetUniformLocation(program, "is_hurt");
-		assert(is_hurt_uloc >= 0);
+		assert(effect.is_hurt.active());
 		if (registry.enemies.has(entity)) {
 			Enemy& enemy = registry.enemies.get(entity);
-			glUniform1i(is_hurt_uloc, enemy.is_hurt ? 1 : 0);
+			effect.is_hurt.set(enemy.is_hurt ? 1 : 0);
 		} else {
-			glUniform1i(is_hurt_uloc, 0);
+			effect.is_hurt.set(0);
 		}
 	}
 	else if (render_request.used_effect == EFFECT_ASSET_ID::TRAIL) {
 		Trail& trail = registry.trails.get(entity);
 
-		glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SPRITE]);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SPRITE]);
-
-		glUniformMatrix3fv(glGetUniformLocation(program, "transform"), 1, GL_FALSE, (float*)&transform);
-		glUniformMatrix3fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, (float*)&projection);
-
-		GLint alpha_loc = glGetUniformLocation(program, "u_alpha");
-		if (alpha_loc >= 0)
-			glUniform1f(alpha_loc, trail.alpha);
-
-		GLint mode_loc = glGetUniformLocation(program, "u_colorMode");
-		if (mode_loc >= 0)
-			glUniform1i(mode_loc, trail.is_red);
+		gl_state.bind_buffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SPRITE]);
+		gl_state.bind_buffer(GL_ELEMENT_ARRAY_BUFFER, index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SPRITE]);
 
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, texture_gl_handles[(GLuint)render_request.used_texture]);
+		effect.transform.set(transform.mat);
+		effect.projection.set(projection);
+		effect.trail_alpha.set(trail.alpha);
+		effect.trail_color_mode.set(trail.is_red);
 
-		GLint pos_loc = glGetAttribLocation(program, "in_position");
-		GLint uv_loc  = glGetAttribLocation(program, "in_texcoord");
+		gl_state.bind_texture(GL_TEXTURE_2D, texture_gl_handles[(GLuint)render_request.used_texture]);
 
-		glEnableVertexAttribArray(pos_loc);
-		glVertexAttribPointer(pos_loc, 3, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void*)0);
+		glEnableVertexAttribArray(effect.in_position);
+		glVertexAttribPointer(effect.in_position, 3, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void*)0);
 
-		glEnableVertexAttribArray(uv_loc);
-		glVertexAttribPointer(uv_loc, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void*)sizeof(vec3));
+		glEnableVertexAttribArray(effect.in_texcoord);
+		glVertexAttribPointer(effect.in_texcoord, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void*)sizeof(vec3));
 
 		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, nullptr);
 		return;
 	}
 
 	
-	// Getting uniform locations for glUniform* calls
-	GLint color_uloc = glGetUniformLocation(program, "fcolor");
+	// Setting uniform values to the bound program
 	const vec3 color = registry.colors.has(entity) ? registry.colors.get(entity) : vec3(1);
-	glUniform3fv(color_uloc, 1, (float *)&color);
+	effect.fcolor.set(color);
+	effect.transform.set(transform.mat);
+	effect.projection.set(projection);
 	gl_has_errors();
 
-	// Get number of indices from index buffer, which has elements uint16_t
-	GLint size = 0;
-	glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
-	gl_has_errors();
-
-	GLsizei num_indices = size / sizeof(uint16_t);
-	// GLsizei num_triangles = num_indices / 3;
-
-	GLint currProgram;
-	glGetIntegerv(GL_CURRENT_PROGRAM, &currProgram);
-	// Setting uniform values to the currently bound program
-	GLuint transform_loc = glGetUniformLocation(currProgram, "transform");
-	glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float *)&transform.mat);
-	GLuint projection_loc = glGetUniformLocation(currProgram, "projection");
-	glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float *)&projection);
-	gl_has_errors();
 	// Drawing of num_indices/3 triangles specified in the index buffer
-	glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr);
+	glDrawElements(GL_TRIANGLES, index_counts[(GLuint)render_request.used_geometry], GL_UNSIGNED_SHORT, nullptr);
 	gl_has_errors();
 }
 
-void RenderSystem::drawEnemyHealthbar(Entity enemy_entity, const mat3& projection)
+// Draws the batches built by sprite_batches: one instanced draw per batch of TEXTURED sprites,
+// with the rest going through drawTexturedMesh in between
+void RenderSystem::drawSpriteBatches(const mat3& projection)
 {
-	if (!registry.enemies.has(enemy_entity) || !registry.motions.has(enemy_entity))
-		return;
-	
-	Enemy& enemy = registry.enemies.get(enemy_entity);
-	Motion& motion = registry.motions.get(enemy_entity);
+	const std::vector<SpriteInstance>& instances = sprite_batches.instances();
+	if (!instances.empty()) {
+		gl_state.bind_buffer(GL_ARRAY_BUFFER, sprite_instance_vbo);
+		glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(SpriteInstance), instances.data(), GL_STREAM_DRAW);
+		gl_has_errors();
+	}
 
-	if (enemy.is_dead)
-		return;
+	const EffectHandles& effect = effect_handles[(GLuint)EFFECT_ASSET_ID::SPRITE_BATCH];
+	const GLint instance_sizes[SPRITE_INSTANCE_ATTRIBUTES] = { 3, 3, 3, 4, 2, 4 };
+	const size_t instance_offsets[SPRITE_INSTANCE_ATTRIBUTES] = {
+		offsetof(SpriteInstance, transform),
+		offsetof(SpriteInstance, transform) + sizeof(vec3),
+		offsetof(SpriteInstance, transform) + 2 * sizeof(vec3),
+		offsetof(SpriteInstance, frame),
+		offsetof(SpriteInstance, flags),
+		offsetof(SpriteInstance, uv_rect),
+	};
+	bool projection_set = false;
+
+	for (const SpriteBatch& batch : sprite_batches.batches()) {
+		if (!batch.instanced) {
+			drawTexturedMesh(batch.entity, projection);
+			continue;
+		}
 
-	float health_percent = (float)enemy.health / (float)enemy.max_health;
-	health_percent = glm::clamp(health_percent, 0.0f, 1.0f);
+		gl_state.use_program(effect.program);
+		if (!projection_set) {
+			effect.projection.set(projection);
+			projection_set = true;
+		}
 
-	if (health_percent >= 1.0f)
-		return;
+		gl_state.bind_buffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)batch.key.geometry]);
+		gl_state.bind_buffer(GL_ELEMENT_ARRAY_BUFFER, index_buffers[(GLuint)batch.key.geometry]);
+		glEnableVertexAttribArray(effect.in_position);
+		glVertexAttribPointer(effect.in_position, 3, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void*)0);
+		glEnableVertexAttribArray(effect.in_texcoord);
+		glVertexAttribPointer(effect.in_texcoord, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void*)sizeof(vec3));
+
+		// GL 3.3 has no base instance, so point the per-instance attributes at this batch's slice
+		gl_state.bind_buffer(GL_ARRAY_BUFFER, sprite_instance_vbo);
+		const size_t batch_offset = batch.first * sizeof(SpriteInstance);
+		for (int i = 0; i < SPRITE_INSTANCE_ATTRIBUTES; i++) {
+			glEnableVertexAttribArray(sprite_instance_attributes[i]);
+			glVertexAttribPointer(sprite_instance_attributes[i], instance_sizes[i], GL_FLOAT, GL_FALSE,
+				sizeof(SpriteInstance), (void*)(batch_offset + instance_offsets[i]));
+			glVertexAttribDivisor(sprite_instance_attributes[i], 1);
+		}
 
-	float alpha = 1.0f;
+		gl_state.bind_texture(GL_TEXTURE_2D, texture_gl_handles[(GLuint)batch.key.texture]);
 
-	float bar_width = 40.0f;  
-	float bar_height = 4.0f; 
-	float offset_y = motion.scale.y * 0.5f + bar_height * 0.5f + 5.0f;  // Position above enemy
-	
-	vec2 bar_center = motion.position;
-	bar_center.y += offset_y;
-	
-	const GLuint program = effects[(GLuint)EFFECT_ASSET_ID::HEALTHBAR];
-	glUseProgram(program);
-	gl_has_errors();
-	
-	const GLuint vbo = vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::HEALTH_BAR];
-	const GLuint ibo = index_buffers[(GLuint)GEOMETRY_BUFFER_ID::HEALTH_BAR];
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-	gl_has_errors();
-	
-	GLint in_position_loc = glGetAttribLocation(program, "in_position");
-	GLint in_color_loc = glGetAttribLocation(program, "in_color");
-	gl_has_errors();
-	
-	glEnableVertexAttribArray(in_position_loc);
-	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE,
-						  sizeof(ColoredVertex), (void *)0);
-	gl_has_errors();
-	
-	glEnableVertexAttribArray(in_color_loc);
-	glVertexAttribPointer(in_color_loc, 3, GL_FLOAT, GL_FALSE,
-						  sizeof(ColoredVertex), (void *)sizeof(vec3));
-	gl_has_errors();
-	
-	vec3 bar_color;
-	if (health_percent > 0.6f) {
-		bar_color = { 0.2f, 1.0f, 0.2f };  // Green
-	} else if (health_percent > 0.3f) {
-		bar_color = { 1.0f, 0.8f, 0.2f };  // Yellow
-	} else {
-		bar_color = { 1.0f, 0.2f, 0.2f };  // Red
+		glDrawElementsInstanced(GL_TRIANGLES, index_counts[(GLuint)batch.key.geometry], GL_UNSIGNED_SHORT, nullptr, (GLsizei)batch.count);
+		gl_has_errors();
+	}
+
+	// leave the shared VAO as the per-entity draws expect it
+	for (int i = 0; i < SPRITE_INSTANCE_ATTRIBUTES; i++) {
+		glVertexAttribDivisor(sprite_instance_attributes[i], 0);
+		glDisableVertexAttribArray(sprite_instance_attributes[i]);
 	}
-	
-	GLint fcolor_uloc = glGetUniformLocation(program, "fcolor");
-	GLint alpha_uloc = glGetUniformLocation(program, "alpha");
-	GLint transform_loc = glGetUniformLocation(program, "transform");
-	GLint projection_loc = glGetUniformLocation(program, "projection");
-	
-	if (alpha_uloc >= 0) glUniform1f(alpha_uloc, alpha);
-	
-	Transform bg_transform;
-	bg_transform.translate(bar_center);
-	bg_transform.scale({ bar_width, bar_height });
-	
-	vec3 bg_color = { 0.2f, 0.2f, 0.2f };  // Dark gray background
-	if (fcolor_uloc >= 0) glUniform3fv(fcolor_uloc, 1, (float*)&bg_color);
-	if (transform_loc >= 0) glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float *)&bg_transform.mat);
-	if (projection_loc >= 0) glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float *)&projection);
-	gl_has_errors();
-	
-	GLint size = 0;
-	glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
-	gl_has_errors();
-	GLsizei num_indices = size / sizeof(uint16_t);
-	glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr);
-	gl_has_errors();
-	
-	vec2 health_position = bar_center;
-	health_position.x -= bar_width * 0.5f * (1.0f - health_percent);  // Shift left as health decreases
-	
-	Transform health_transform;
-	health_transform.translate(health_position);
-	health_transform.scale({ bar_width * health_percent, bar_height });
-	
-	if (fcolor_uloc >= 0) glUniform3fv(fcolor_uloc, 1, (float*)&bar_color);
-	if (transform_loc >= 0) glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float *)&health_transform.mat);
-	glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr);
-	gl_has_errors();
 }
 
-void RenderSystem::drawIsocell(vec2 position, const mat3 &projection)
+// Health bars of the damaged enemies on screen, streamed as one triangle list and drawn at once
+void RenderSystem::drawEnemyHealthbars(const vec4& cam_view, const mat3& projection)
 {
-	Transform transform;
-	transform.translate(position);
-	//transform.rotate(0);
-	transform.scale(vec2(CHUNK_CELL_SIZE*CHUNK_ISOLINE_SIZE, CHUNK_CELL_SIZE*CHUNK_ISOLINE_SIZE));
+	const float bar_width = 40.0f;
+	const float bar_height = 4.0f;
+	const vec3 bg_color = { 0.2f, 0.2f, 0.2f };  // Dark gray background
+
+	std::vector<ColoredVertex>& vertices = healthbar_batch;
+	vertices.clear();
+	auto add_quad = [&](vec2 corner, vec2 size, vec3 color) {
+		const vec2 corners[6] = {
+			corner, corner + vec2(size.x, 0.f), corner + size,
+			corner, corner + size, corner + vec2(0.f, size.y),
+		};
+		for (vec2 c : corners) {
+			ColoredVertex v;
+			v.position = { c.x, c.y, 0.f };
+			v.color = color;
+			vertices.push_back(v);
+		}
+	};
 
-	// Get number of indices from index buffer, which has elements uint16_t
-	GLint size = 0;
-	glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
-	gl_has_errors();
+	for (uint i = 0; i < registry.enemies.size(); i++)
+	{
+		Entity entity = registry.enemies.entities[i];
+		const Enemy& enemy = registry.enemies.components[i];
+		if (enemy.is_dead || !registry.motions.has(entity))
+			continue;
 
-	GLsizei num_indices = size / sizeof(uint16_t);
-	// GLsizei num_triangles = num_indices / 3;
+		Motion& m = registry.motions.get(entity);
 
-	GLint currProgram;
-	glGetIntegerv(GL_CURRENT_PROGRAM, &currProgram);
-	// Setting uniform values to the currently bound program
-	GLuint transform_loc = glGetUniformLocation(currProgram, "transform");
-	glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float *)&transform.mat);
-	GLuint projection_loc = glGetUniformLocation(currProgram, "projection");
-	glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float *)&projection);
-	gl_has_errors();
+		// Only draw if enemy is on screen
+		if (m.position.x + abs(m.scale.x) < cam_view.x ||
+			m.position.x - abs(m.scale.x) > cam_view.y ||
+			m.position.y + abs(m.scale.y) < cam_view.z ||
+			m.position.y - abs(m.scale.y) > cam_view.w)
+			continue;
 
-	// Drawing of num_indices/3 triangles specified in the index buffer
-	glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr);
-	gl_has_errors();
-}
+		float health_percent = (float)enemy.health / (float)enemy.max_health;
+		health_percent = glm::clamp(health_percent, 0.0f, 1.0f);
+		if (health_percent >= 1.0f)
+			continue;
 
-// TODO: speed up rendering (currently VERY laggy)
-void RenderSystem::drawChunks(const mat3 &projection)
-{
-	vec4 cam_view = getCameraView();
-	float cells_per_row = (float) CHUNK_CELLS_PER_ROW;
-	float cell_size = (float) CHUNK_CELL_SIZE;
+		float offset_y = m.scale.y * 0.5f + bar_height * 0.5f + 5.0f;  // Position above enemy
+		vec2 bar_center = m.position;
+		bar_center.y += offset_y;
 
-	// Setting shaders
-	const GLuint used_effect_enum = (GLuint) EFFECT_ASSET_ID::TILED;
-	const GLuint program = (GLuint)effects[used_effect_enum];
-	glUseProgram(program);
-	gl_has_errors();
+		vec3 bar_color;
+		if (health_percent > 0.6f) {
+			bar_color = { 0.2f, 1.0f, 0.2f };  // Green
+		} else if (health_percent > 0.3f) {
+			bar_color = { 1.0f, 0.8f, 0.2f };  // Yellow
+		} else {
+			bar_color = { 1.0f, 0.2f, 0.2f };  // Red
+		}
 
-	// Setting vertex and index buffers
-	const GLuint vbo = vertex_buffers[(GLuint) GEOMETRY_BUFFER_ID::SPRITE];
-	const GLuint ibo = index_buffers[(GLuint) GEOMETRY_BUFFER_ID::SPRITE];
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-	gl_has_errors();
+		vec2 health_position = bar_center;
+		health_position.x -= bar_width * 0.5f * (1.0f - health_percent);  // Shift left as health decreases
 
-	GLint tot_states_uloc = glGetUniformLocation(program, "total_states");
-	GLint s_bit_uloc = glGetUniformLocation(program, "s_bit");
-	assert(tot_states_uloc >= 0);
-	assert(s_bit_uloc >= 0);
-	glUniform1i(tot_states_uloc, 16);
-	gl_has_errors();
+		add_quad(bar_center, { bar_width, bar_height }, bg_color);
+		add_quad(health_position, { bar_width * health_percent, bar_height }, bar_color);
+	}
+	if (vertices.empty())
+		return;
 
-	GLint in_position_loc = glGetAttribLocation(program, "in_position");
-	GLint in_texcoord_loc = glGetAttribLocation(program, "in_texcoord");
+	const GLintptr offset = stream_buffer.write(vertices.data(), vertices.size() * sizeof(ColoredVertex));
+	if (offset == StreamBuffer::WRITE_FAILED)
+		return;
+
+	const EffectHandles& effect = effect_handles[(GLuint)EFFECT_ASSET_ID::HEALTHBAR];
+	gl_state.use_program(effect.program);
 	gl_has_errors();
-	assert(in_texcoord_loc >= 0);
 
-	glEnableVertexAttribArray(in_position_loc);
-	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE,
-							sizeof(TexturedVertex), (void *)0);
-	glEnableVertexAttribArray(in_texcoord_loc);
-	glVertexAttribPointer(
-		in_texcoord_loc, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex),
-		(void *)sizeof(
-			vec3)); // note the stride to skip the preceeding vertex position
+	glEnableVertexAttribArray(effect.in_position);
+	glVertexAttribPointer(effect.in_position, 3, GL_FLOAT, GL_FALSE,
+						  sizeof(ColoredVertex), (void *)offset);
+	glEnableVertexAttribArray(effect.in_color);
+	glVertexAttribPointer(effect.in_color, 3, GL_FLOAT, GL_FALSE,
+						  sizeof(ColoredVertex), (void *)(offset + sizeof(vec3)));
 	gl_has_errors();
 
-	glActiveTexture(GL_TEXTURE0);
-	GLuint texture_id = texture_gl_handles[(GLuint) TEXTURE_ASSET_ID::ISOROCK];
-	glBindTexture(GL_TEXTURE_2D, texture_id);
+	// the vertex colors carry the bar colors, already in world space
+	const mat3 identity = { {1,0,0}, {0,1,0}, {0,0,1} };
+	effect.fcolor.set(vec3(1.f));
+	effect.alpha.set(1.0f);
+	effect.transform.set(identity);
+	effect.projection.set(projection);
 	gl_has_errors();
 
-	// Pass viewport size for screen UV calculation
-	int w, h;
-	glfwGetFramebufferSize(window, &w, &h);
-	GLint viewport_loc = glGetUniformLocation(program, "viewport_size");
-	if (viewport_loc >= 0) glUniform2f(viewport_loc, (float)w, (float)h);
+	glDrawArrays(GL_TRIANGLES, 0, (GLsizei)vertices.size());
 	gl_has_errors();
+}
+
+void RenderSystem::drawChunks(const mat3 &projection)
+{
+	vec4 cam_view = getCameraView();
+	float chunk_size = (float) (CHUNK_CELLS_PER_ROW * CHUNK_CELL_SIZE);
 
-	// Pass ambient light level
-	GLint ambient_loc = glGetUniformLocation(program, "ambient_light");
-	if (ambient_loc >= 0) glUniform1f(ambient_loc, 0.3f);  // Base ambient lighting
+	// Setting shaders
+	const EffectHandles& effect = effect_handles[(GLuint)EFFECT_ASSET_ID::TILED];
+	gl_state.use_program(effect.program);
+	effect.projection.set(projection);
+	effect.fcolor.set(vec3(1));
 	gl_has_errors();
 
-	// Getting uniform locations for glUniform* calls
-	GLint color_uloc = glGetUniformLocation(program, "fcolor");
-	const vec3 color = vec3(1);
-	glUniform3fv(color_uloc, 1, (float *)&color);
+	assert(effect.in_texcoord >= 0);
+	glEnableVertexAttribArray(effect.in_position);
+	glEnableVertexAttribArray(effect.in_texcoord);
+
+	gl_state.bind_texture(GL_TEXTURE_2D, texture_gl_handles[(GLuint) TEXTURE_ASSET_ID::ISOROCK]);
 	gl_has_errors();
 
+	// One draw of the baked mesh per chunk on screen
+	drawn_chunk_ids.clear();
 	for (size_t n = 0; n < registry.chunks.size(); n++) {
-		short chunk_pos_x = registry.chunks.position_xs[n];
-		short chunk_pos_y = registry.chunks.position_ys[n];
-		Chunk& chunk = registry.chunks.components[n];
-		vec2 base_pos = vec2(chunk_pos_x*cells_per_row*cell_size, chunk_pos_y*cells_per_row*cell_size);
-		
-		for (size_t i = 0; i < CHUNK_CELLS_PER_ROW; i += 4) {
-			if (base_pos.x + (i+4)*CHUNK_CELL_SIZE < cam_view.x ||
-				base_pos.x + i*CHUNK_CELL_SIZE > cam_view.y)
-			{
-				continue;
-			}
-			
-			for (size_t j = 0; j < CHUNK_CELLS_PER_ROW; j += 4) {
-				if (base_pos.y + (j+4)*CHUNK_CELL_SIZE < cam_view.z ||
-					base_pos.y + j*CHUNK_CELL_SIZE > cam_view.w)
-				{
-					continue;
-				}
+		auto mesh = chunk_meshes.find(registry.chunks.components[n].id);
+		if (mesh == chunk_meshes.end() || mesh->second.vertex_count == 0)
+			continue;
 
-				unsigned char s_bit_1 = state_to_iso_bitmap(chunk.cell_states[i][j]);
-				unsigned char s_bit_2 = state_to_iso_bitmap(chunk.cell_states[i][j+3]);
-				unsigned char s_bit_3 = state_to_iso_bitmap(chunk.cell_states[i+3][j]);
-				unsigned char s_bit_4 = state_to_iso_bitmap(chunk.cell_states[i+3][j+3]);
-				unsigned char max_bit = max(max(max(s_bit_1, s_bit_2), s_bit_3), s_bit_4);
-				if (max_bit != 0) {
-					glUniform1i(s_bit_uloc, max_bit);
-					vec2 pos = base_pos + vec2(i*cell_size + cell_size*2 , j*cell_size + cell_size*2);
-					drawIsocell(pos, projection);
-				}
-			}
+		vec2 base_pos = vec2(registry.chunks.position_xs[n], registry.chunks.position_ys[n]) * chunk_size;
+		if (base_pos.x + chunk_size < cam_view.x || base_pos.x > cam_view.y ||
+			base_pos.y + chunk_size < cam_view.z || base_pos.y > cam_view.w)
+		{
+			continue;
 		}
+
+		drawn_chunk_ids.push_back(mesh->first);
+		gl_state.bind_buffer(GL_ARRAY_BUFFER, mesh->second.vbo);
+		glVertexAttribPointer(effect.in_position, 3, GL_FLOAT, GL_FALSE,
+								sizeof(TexturedVertex), (void *)0);
+		glVertexAttribPointer(
+			effect.in_texcoord, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex),
+			(void *)sizeof(
+				vec3)); // note the stride to skip the preceeding vertex position
+		glDrawArrays(GL_TRIANGLES, 0, mesh->second.vertex_count);
+		gl_has_errors();
 	}
 }
 
-void RenderSystem::draw_particles() {
-	auto& particles = registry.particles;
-	if (particles.size() == 0)
-			return;
-
-	const GLuint program = effects[(GLuint)EFFECT_ASSET_ID::PARTICLE];
-	glUseProgram(program);
-
-	mat3 projection = createProjectionMatrix();
-	GLint projection_loc = glGetUniformLocation(program, "projection");
-	glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float*)&projection);
+void RenderSystem::bakeChunkMesh(short chunk_x, short chunk_y, const Chunk& chunk)
+{
+	const float chunk_size = (float) (CHUNK_CELLS_PER_ROW * CHUNK_CELL_SIZE);
+	chunk_mesh_vertices.clear();
+	build_chunk_isoline_mesh(chunk.cell_states, vec2(chunk_x, chunk_y) * chunk_size, chunk_mesh_vertices);
+
+	releaseChunkMesh(chunk);
+	ChunkMesh& mesh = chunk_meshes[chunk.id];
+	mesh.vertex_count = (GLsizei)chunk_mesh_vertices.size();
+	// chunks without rock need no buffer
+	if (mesh.vertex_count == 0)
+		return;
 
-	std::vector<ParticleInstanceData> instances;
-	instances.reserve(particles.size());
+	glGenBuffers(1, &mesh.vbo);
+	gl_state.bind_buffer(GL_ARRAY_BUFFER, mesh.vbo);
+	glBufferData(GL_ARRAY_BUFFER, chunk_mesh_vertices.size() * sizeof(TexturedVertex), chunk_mesh_vertices.data(), GL_STATIC_DRAW);
+	gl_has_errors();
+}
 
-	for (Entity e : particles.entities) {
-		Particle& p = particles.get(e);
-		if (!p.alive) continue;
+void RenderSystem::releaseChunkMesh(const Chunk& chunk)
+{
+	auto mesh = chunk_meshes.find(chunk.id);
+	if (mesh == chunk_meshes.end())
+		return;
+	deleteChunkMeshBuffer(mesh->second);
+	chunk_meshes.erase(mesh);
+}
 
-		ParticleInstanceData inst;
-		inst.pos = p.position;
-		inst.size = p.size;
-		inst.color = p.color;
+void RenderSystem::releaseChunkMeshes()
+{
+	for (auto& mesh : chunk_meshes)
+		deleteChunkMeshBuffer(mesh.second);
+	chunk_meshes.clear();
+}
 
-		instances.push_back(inst);
-	}
+void RenderSystem::deleteChunkMeshBuffer(ChunkMesh& mesh)
+{
+	if (mesh.vbo == 0)
+		return;
+	// a deleted name can be handed out again, so the tracker must not think it is still bound
+	gl_state.bind_buffer(GL_ARRAY_BUFFER, 0);
+	glDeleteBuffers(1, &mesh.vbo);
+	mesh.vbo = 0;
+}
 
-	if (instances.empty()) return;
+void RenderSystem::draw_particles() {
+	const size_t count = particle_pool.size();
+	if (count == 0)
+			return;
 
-	glBindBuffer(GL_ARRAY_BUFFER, particle_instance_vbo);
-	glBufferData(GL_ARRAY_BUFFER,
-								instances.size() * sizeof(ParticleInstanceData),
-								instances.data(),
-								GL_DYNAMIC_DRAW);
+	const EffectHandles& effect = effect_handles[(GLuint)EFFECT_ASSET_ID::PARTICLE];
+	gl_state.use_program(effect.program);
+	effect.projection.set(createProjectionMatrix());
+
+	// The pool's arrays are copied into the stream buffer as they are: x, y, size, then color
+	const size_t floats_size = count * sizeof(float);
+	const GLintptr offsets[] = {
+		stream_buffer.write(particle_pool.position_x(), floats_size),
+		stream_buffer.write(particle_pool.position_y(), floats_size),
+		stream_buffer.write(particle_pool.sizes(), floats_size),
+		stream_buffer.write(particle_pool.colors(), count * sizeof(vec4)),
+	};
+	for (GLintptr offset : offsets)
+		if (offset == StreamBuffer::WRITE_FAILED)
+			return;
 
 	const GLuint vbo = vertex_buffers[(int)GEOMETRY_BUFFER_ID::BULLET_CIRCLE];
 	const GLuint ibo = index_buffers[(int)GEOMETRY_BUFFER_ID::BULLET_CIRCLE];
 
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-
-	GLint loc_pos = glGetAttribLocation(program, "in_position");
+	gl_state.bind_buffer(GL_ARRAY_BUFFER, vbo);
+	gl_state.bind_buffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
 
-	glEnableVertexAttribArray(loc_pos);
-	glVertexAttribPointer(loc_pos, 3, GL_FLOAT, GL_FALSE,
+	glEnableVertexAttribArray(particle_attributes[0]);
+	glVertexAttribPointer(particle_attributes[0], 3, GL_FLOAT, GL_FALSE,
 												sizeof(vec3), (void*)0);
 
-	glBindBuffer(GL_ARRAY_BUFFER, particle_instance_vbo);
-
-	GLint loc_ipos   = glGetAttribLocation(program, "instance_pos");
-	GLint loc_isize  = glGetAttribLocation(program, "instance_size");
-	GLint loc_icolor = glGetAttribLocation(program, "instance_color");
-
-	glEnableVertexAttribArray(loc_ipos);
-	glVertexAttribPointer(loc_ipos, 3, GL_FLOAT, GL_FALSE,
-			sizeof(ParticleInstanceData), (void*)offsetof(ParticleInstanceData, pos));
-	glVertexAttribDivisor(loc_ipos, 1);
+	gl_state.bind_buffer(GL_ARRAY_BUFFER, stream_buffer.buffer());
 
-	glEnableVertexAttribArray(loc_isize);
-	glVertexAttribPointer(loc_isize, 1, GL_FLOAT, GL_FALSE,
-			sizeof(ParticleInstanceData), (void*)offsetof(ParticleInstanceData, size));
-	glVertexAttribDivisor(loc_isize, 1);
-
-	glEnableVertexAttribArray(loc_icolor);
-	glVertexAttribPointer(loc_icolor, 4, GL_FLOAT, GL_FALSE,
-			sizeof(ParticleInstanceData), (void*)offsetof(ParticleInstanceData, color));
-	glVertexAttribDivisor(loc_icolor, 1);
+	const GLint instance_components[] = { 1, 1, 1, 4 };
+	for (int i = 0; i < 4; i++) {
+		const GLint attribute = particle_attributes[i + 1];
+		glEnableVertexAttribArray(attribute);
+		glVertexAttribPointer(attribute, instance_components[i], GL_FLOAT, GL_FALSE, 0, (void*)offsets[i]);
+		glVertexAttribDivisor(attribute, 1);
+	}
 
-	GLsizei num_indices;
-	glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &num_indices);
-	num_indices /= sizeof(uint16_t);
+	glDrawElementsInstanced(GL_TRIANGLES, particle_index_count, GL_UNSIGNED_SHORT,
+													nullptr, (GLsizei)count);
 
-	glDrawElementsInstanced(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT,
-													nullptr, instances.size());
+	for (int i = 1; i < 5; i++)
+		glVertexAttribDivisor(particle_attributes[i], 0);
 }
 
 
@@ -557,12 +475,13 @@ void RenderSystem::draw_particles() {
 void RenderSystem::drawToScreen()
 {
 	// Screen UV Shader
-	glUseProgram(effects[(GLuint)EFFECT_ASSET_ID::SCREEN]);
+	const EffectHandles& effect = effect_handles[(GLuint)EFFECT_ASSET_ID::SCREEN];
+	gl_state.use_program(effect.program);
 	gl_has_errors();
 
 	int w, h;
 	glfwGetFramebufferSize(window, &w, &h);
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	gl_state.bind_framebuffer(GL_FRAMEBUFFER, 0);
 	glViewport(0, 0, w, h);
 	glDepthRange(0, 10);
 	glClearColor(0.1f, 0.1f, 0.1f, 1.0);
@@ -570,30 +489,20 @@ void RenderSystem::drawToScreen()
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	gl_has_errors();
 
-	glDisable(GL_BLEND);
-	glDisable(GL_DEPTH_TEST);
+	gl_state.set_blend(false);
+	gl_state.set_depth_test(false);
 
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]);
+	gl_state.bind_buffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]);
+	gl_state.bind_buffer(GL_ELEMENT_ARRAY_BUFFER, index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]);
 	gl_has_errors();
 
-	// Get the shader program used for rendering the final screen quad
-	const GLuint screen_program = effects[(GLuint)EFFECT_ASSET_ID::SCREEN];
-
-	GLint in_position_loc = glGetAttribLocation(screen_program, "in_position");
-	glEnableVertexAttribArray(in_position_loc);
-	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (void *)0);
+	glEnableVertexAttribArray(effect.in_position);
+	glVertexAttribPointer(effect.in_position, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (void *)0);
 	gl_has_errors();
 
-	glActiveTexture(GL_TEXTURE0);
-
 	// Bind the frame buffer texture (final lit scene) to the screen texture slot
-	glBindTexture(GL_TEXTURE_2D, off_screen_render_buffer_color);
-
-	GLint screen_texture_uloc = glGetUniformLocation(screen_program, "screen_texture");
-	
-	// Set the screen texture slot to the texture we bound
-	glUniform1i(screen_texture_uloc, 0);
+	gl_state.bind_texture(GL_TEXTURE_2D, off_screen_render_buffer_color);
+	effect.screen_texture.set(0);
 	gl_has_errors();
 
 	// Draw the screen quad
@@ -610,12 +519,26 @@ void RenderSystem::draw(float elapsed_ms, bool is_paused)
 	// This prevents UI errors from crashing the game renderer
 	while (glGetError() != GL_NO_ERROR);
 
+	// The UI has changed GL state since the last frame without telling the tracker, so nothing
+	// it remembers holds; this also rebinds the VAO RmlUi unbinds
+	gl_state.invalidate();
+	gl_state.reset_counters();
+	gl_state.bind_vertex_array(vao);
+
+	stream_buffer.begin_frame();
+
+	if (sdf_profiler.active()) {
+		const SdfOptions options = sdf_profiler.current();
+		setSdfResolutionDivisor(options.divisor);
+		sdf_cache_enabled = options.cache;
+	}
+
 	// Getting size of window
 	int w, h;
 	glfwGetFramebufferSize(window, &w, &h); // Note, this will be 2x the resolution given to glfwCreateWindow on retina displays
 
 	// Render to the custom framebuffer
-	glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer);
+	gl_state.bind_framebuffer(GL_FRAMEBUFFER, frame_buffer);
 	gl_has_errors();
 	// Clearing backbuffer
 	glViewport(0, 0, w, h);
@@ -623,9 +546,9 @@ void RenderSystem::draw(float elapsed_ms, bool is_paused)
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0);
 	glClearDepth(10.f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	glDisable(GL_DEPTH_TEST); // native OpenGL does not work with a depth buffer
+	gl_state.set_blend(true);
+	gl_state.blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	gl_state.set_depth_test(false); // native OpenGL does not work with a depth buffer
 							  // and alpha blending, one would have to sort
 							  // sprites back to front
 	gl_has_errors();
@@ -683,11 +606,11 @@ void RenderSystem::draw(float elapsed_ms, bool is_paused)
 	
 	// Render player and feet directly to frame_buffer after lighting so they appear with normal colors
 	// This ensures they are not affected by the lighting system
-	glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer);
+	gl_state.bind_framebuffer(GL_FRAMEBUFFER, frame_buffer);
 	glViewport(0, 0, w, h);
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	glDisable(GL_DEPTH_TEST);
+	gl_state.set_blend(true);
+	gl_state.blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	gl_state.set_depth_test(false);
 	
 	vec4 cam_view_after_lighting = getCameraView();
 	mat3 projection_2D_after_lighting = createProjectionMatrix();
@@ -716,22 +639,7 @@ void RenderSystem::draw(float elapsed_ms, bool is_paused)
 	draw_particles();
 
 	// Draw enemy healthbars after lighting so they're always visible
-	for (Entity entity : registry.enemies.entities)
-	{
-		if (!registry.motions.has(entity))
-			continue;
-		
-		Motion& m = registry.motions.get(entity);
-		
-		// Only draw if enemy is on screen
-		if (m.position.x + abs(m.scale.x) >= cam_view_after_lighting.x &&
-			m.position.x - abs(m.scale.x) <= cam_view_after_lighting.y &&
-			m.position.y + abs(m.scale.y) >= cam_view_after_lighting.z &&
-			m.position.y - abs(m.scale.y) <= cam_view_after_lighting.w)
-		{
-			drawEnemyHealthbar(entity, projection_2D_after_lighting);
-		}
-	}
+	drawEnemyHealthbars(cam_view_after_lighting, projection_2D_after_lighting);
 	
 	// Render arrow at screen center pointing toward bonfire (same pattern as finding bonfire)
 	for (Entity entity : registry.renderRequests.entities)
@@ -787,39 +695,28 @@ void RenderSystem::draw(float elapsed_ms, bool is_paused)
 					
 					vec2 arrow_position = camera_position + normalized_direction * offset_distance;
 					
-					// Save current color mask state
-					GLboolean color_mask[4];
-					glGetBooleanv(GL_COLOR_WRITEMASK, color_mask);
-					
 					// Set arrow alpha based on pause state (disable color writing when paused)
 					if (is_paused) {
 						glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
 					}
 					
 					// Draw triangle with black outline and white fill
-					const GLuint program = effects[(GLuint)EFFECT_ASSET_ID::COLOURED];
-					glUseProgram(program);
+					const EffectHandles& effect = effect_handles[(GLuint)EFFECT_ASSET_ID::COLOURED];
+					gl_state.use_program(effect.program);
 					
 					const GLuint vbo = vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::ARROW_TRIANGLE];
 					const GLuint ibo = index_buffers[(GLuint)GEOMETRY_BUFFER_ID::ARROW_TRIANGLE];
 					
-					glBindBuffer(GL_ARRAY_BUFFER, vbo);
-					glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+					gl_state.bind_buffer(GL_ARRAY_BUFFER, vbo);
+					gl_state.bind_buffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
 					
-					GLint in_position_loc = glGetAttribLocation(program, "in_position");
-					GLint in_color_loc = glGetAttribLocation(program, "in_color");
-					GLint fcolor_uloc = glGetUniformLocation(program, "fcolor");
-					GLint is_hurt_uloc = glGetUniformLocation(program, "is_hurt");
+					effect.is_hurt.set(0);
 					
-					if (is_hurt_uloc >= 0) {
-						glUniform1i(is_hurt_uloc, 0);
-					}
-					
-					glEnableVertexAttribArray(in_position_loc);
-					glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE,
+					glEnableVertexAttribArray(effect.in_position);
+					glVertexAttribPointer(effect.in_position, 3, GL_FLOAT, GL_FALSE,
 										sizeof(ColoredVertex), (void *)0);
-					glEnableVertexAttribArray(in_color_loc);
-					glVertexAttribPointer(in_color_loc, 3, GL_FLOAT, GL_FALSE,
+					glEnableVertexAttribArray(effect.in_color);
+					glVertexAttribPointer(effect.in_color, 3, GL_FLOAT, GL_FALSE,
 										sizeof(ColoredVertex), (void *)sizeof(vec3));
 					
 					Transform transform;
@@ -828,11 +725,7 @@ void RenderSystem::draw(float elapsed_ms, bool is_paused)
 					float arrow_size = 30.0f;
 					transform.scale({arrow_size, arrow_size});
 					
-					GLint transform_loc = glGetUniformLocation(program, "transform");
-					GLint projection_loc = glGetUniformLocation(program, "projection");
-					
-					vec3 black = {0.0f, 0.0f, 0.0f};
-					if (fcolor_uloc >= 0) glUniform3fv(fcolor_uloc, 1, (float*)&black);
+					effect.fcolor.set(vec3(0.f));
 					
 					Transform outline_transform;
 					outline_transform.translate(arrow_position);
@@ -840,21 +733,20 @@ void RenderSystem::draw(float elapsed_ms, bool is_paused)
 					float outline_size = arrow_size * 1.15f;
 					outline_transform.scale({outline_size, outline_size});
 					
-					if (transform_loc >= 0) glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float *)&outline_transform.mat);
-					if (projection_loc >= 0) glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float *)&projection_2D_after_lighting);
+					effect.transform.set(outline_transform.mat);
+					effect.projection.set(projection_2D_after_lighting);
 					
-					GLint size = 0;
-					glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
-					GLsizei num_indices = size / sizeof(uint16_t);
+					const GLsizei num_indices = index_counts[(GLuint)GEOMETRY_BUFFER_ID::ARROW_TRIANGLE];
 					glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr);
 					
-					vec3 white = {1.0f, 1.0f, 1.0f};
-					if (fcolor_uloc >= 0) glUniform3fv(fcolor_uloc, 1, (float*)&white);
-					
-					if (transform_loc >= 0) glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float *)&transform.mat);
+					effect.fcolor.set(vec3(1.f));
+					effect.transform.set(transform.mat);
 					glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr);
 					
-					glColorMask(color_mask[0], color_mask[1], color_mask[2], color_mask[3]);
+					// nothing else masks colors, so writing is back on for everything else
+					if (is_paused) {
+						glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+					}
 				}
 			}
 		}
@@ -872,31 +764,28 @@ void RenderSystem::draw(float elapsed_ms, bool is_paused)
 	if (show_player_hitbox_debug) {
 		int w, h;
 		glfwGetFramebufferSize(window, &w, &h);
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		gl_state.bind_framebuffer(GL_FRAMEBUFFER, 0);
 		glViewport(0, 0, w, h);
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-		glDisable(GL_DEPTH_TEST);
+		gl_state.set_blend(true);
+		gl_state.blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		gl_state.set_depth_test(false);
 		
-		if (g_debug_line_vbo == 0) glGenBuffers(1, &g_debug_line_vbo);
-		const GLuint program = effects[(GLuint)EFFECT_ASSET_ID::COLOURED];
-		glUseProgram(program);
-		GLint posLoc = glGetAttribLocation(program, "in_position");
-		GLint colLoc = glGetAttribLocation(program, "in_color");
-		GLint transform_loc = glGetUniformLocation(program, "transform");
-		GLint projection_loc = glGetUniformLocation(program, "projection");
+		const EffectHandles& effect = effect_handles[(GLuint)EFFECT_ASSET_ID::COLOURED];
+		gl_state.use_program(effect.program);
+		const GLint posLoc = effect.in_position;
+		const GLint colLoc = effect.in_color;
 		mat3 I = { {1,0,0}, {0,1,0}, {0,0,1} };
 		mat3 projection_2D = createProjectionMatrix();
-		if (transform_loc >= 0) glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float*)&I);
-		if (projection_loc >= 0) glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float *)&projection_2D);
+		effect.transform.set(I);
+		effect.projection.set(projection_2D);
 
 		auto uploadAndDraw = [&](const std::vector<ColoredVertex>& verts){
-			glBindBuffer(GL_ARRAY_BUFFER, g_debug_line_vbo);
-			glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(verts.size()*sizeof(ColoredVertex)), verts.data(), GL_DYNAMIC_DRAW);
+			const GLintptr offset = stream_buffer.write(verts.data(), verts.size()*sizeof(ColoredVertex));
+			if (offset == StreamBuffer::WRITE_FAILED) return;
 			glEnableVertexAttribArray(posLoc);
-			glVertexAttribPointer(posLoc, 3, GL_FLOAT, GL_FALSE, sizeof(ColoredVertex), (void*)0);
+			glVertexAttribPointer(posLoc, 3, GL_FLOAT, GL_FALSE, sizeof(ColoredVertex), (void*)offset);
 			glEnableVertexAttribArray(colLoc);
-			glVertexAttribPointer(colLoc, 3, GL_FLOAT, GL_FALSE, sizeof(ColoredVertex), (void*)sizeof(vec3));
+			glVertexAttribPointer(colLoc, 3, GL_FLOAT, GL_FALSE, sizeof(ColoredVertex), (void*)(offset + sizeof(vec3)));
 			glDrawArrays(GL_LINE_STRIP, 0, (GLsizei)verts.size());
 		};
 
@@ -977,7 +866,11 @@ void RenderSystem::draw(float elapsed_ms, bool is_paused)
 		}
 	}
 
+	stream_buffer.end_frame();
 	gl_has_errors();
+
+	frame_state_issued = gl_state.issued_count();
+	frame_state_elided = gl_state.elided_count();
 }
 
 // vector of 4 components: LEFT, RIGHT, TOP, BOTTOM
@@ -1019,13 +912,13 @@ void RenderSystem::renderSceneToColorTexture()
 	int w, h;
 	glfwGetFramebufferSize(window, &w, &h);
 
-	glBindFramebuffer(GL_FRAMEBUFFER, scene_fb);
+	gl_state.bind_framebuffer(GL_FRAMEBUFFER, scene_fb);
 	glViewport(0, 0, w, h);
 	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
 	glClear(GL_COLOR_BUFFER_BIT);
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	glDisable(GL_DEPTH_TEST);
+	gl_state.set_blend(true);
+	gl_state.blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	gl_state.set_depth_test(false);
 
 	mat3 projection_2D = createProjectionMatrix();
 	vec4 cam_view = getCameraView();
@@ -1038,30 +931,29 @@ void RenderSystem::renderSceneToColorTexture()
 
 	// Loop through all entities and render them to the color texture
 	// Exclude background (already rendered), player and feet so they don't get affected by lighting
-	for (Entity entity : registry.renderRequests.entities)
-	{
-		if (!registry.motions.has(entity))
-			continue;
-		if (!registry.renderRequests.has(entity))
-			continue;
-		// Skip background (already rendered), player, feet, and arrow
-		if (registry.renderRequests.get(entity).used_geometry == GEOMETRY_BUFFER_ID::BACKGROUND_QUAD)
-			continue;
-		if (registry.players.has(entity) || registry.feet.has(entity) || registry.arrows.has(entity))
-			continue;
+	sprite_batches.clear();
+	scene_view.each([&](Entity entity, RenderRequest& request, Motion& m) {
+		// Skip background (already rendered); player, feet, and arrow are excluded by the view
+		if (request.used_geometry == GEOMETRY_BUFFER_ID::BACKGROUND_QUAD)
+			return;
 
 		// Do not draw entities that are off-screen
-		Motion& m = registry.motions.get(entity);
 		if (m.position.x + abs(m.scale.x) < cam_view.x ||
 			m.position.x - abs(m.scale.x) > cam_view.y ||
 			m.position.y + abs(m.scale.y) < cam_view.z ||
 			m.position.y - abs(m.scale.y) > cam_view.w)
 		{
-			continue;
+			return;
 		}
 
-		drawTexturedMesh(entity, projection_2D);
-	}
+		sprite_batches.add_entity(entity, request, m);
+	});
+	sprite_batches.finish();
+	drawSpriteBatches(projection_2D);
+
+	// what the SDF seed pass will see, so an unchanged scene can keep last frame's SDF
+	if (sdf_cache_enabled)
+		occluder_hash = occluder_signature(sprite_batches, drawn_chunk_ids);
 
 	gl_has_errors();
 }
@@ -1072,21 +964,20 @@ void RenderSystem::drawGrassBackground()
 	glfwGetFramebufferSize(window, &w, &h);
 	
 	// Use the grass background shader
-	const GLuint program = effects[(GLuint)EFFECT_ASSET_ID::GRASS_BACKGROUND];
-	assert(program != 0 && "Grass background shader not loaded!");
-	glUseProgram(program);
+	const EffectHandles& effect = effect_handles[(GLuint)EFFECT_ASSET_ID::GRASS_BACKGROUND];
+	assert(effect.program != 0 && "Grass background shader not loaded!");
+	gl_state.use_program(effect.program);
 	gl_has_errors();
 	
 	// Bind the fullscreen quad
 	const GLuint vbo = vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::FULLSCREEN_QUAD];
 	const GLuint ibo = index_buffers[(GLuint)GEOMETRY_BUFFER_ID::FULLSCREEN_QUAD];
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+	gl_state.bind_buffer(GL_ARRAY_BUFFER, vbo);
+	gl_state.bind_buffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
 	gl_has_errors();
 	
 	// Set up vertex attributes
-	GLint in_position_loc = glGetAttribLocation(program, "in_position");
-	gl_has_errors();
+	const GLint in_position_loc = effect.in_position;
 	assert(in_position_loc >= 0 && "in_position attribute not found in grass background shader!");
 	
 	glEnableVertexAttribArray(in_position_loc);
@@ -1095,45 +986,30 @@ void RenderSystem::drawGrassBackground()
 	gl_has_errors();
 	
 	// Bind the grass texture
-	glActiveTexture(GL_TEXTURE0);
-	GLuint texture_id = texture_gl_handles[(GLuint)TEXTURE_ASSET_ID::GRASS];
-	glBindTexture(GL_TEXTURE_2D, texture_id);
+	gl_state.bind_texture(GL_TEXTURE_2D, texture_gl_handles[(GLuint)TEXTURE_ASSET_ID::GRASS]);
 	gl_has_errors();
 	
-	// Set uniforms
-	GLint u_grass_loc = glGetUniformLocation(program, "u_grass");
-	if (u_grass_loc >= 0) {
-		glUniform1i(u_grass_loc, 0);
-	} else {
-		fprintf(stderr, "Warning: u_grass uniform not found in grass background shader!\n");
-	}
-	
-	GLint u_camera_loc = glGetUniformLocation(program, "u_camera");
-	assert(u_camera_loc >= 0 && "u_camera uniform not found!");
-	glUniform2f(u_camera_loc, camera_position.x, camera_position.y);
-	
-	GLint u_resolution_loc = glGetUniformLocation(program, "u_resolution");
-	assert(u_resolution_loc >= 0 && "u_resolution uniform not found!");
-	glUniform2f(u_resolution_loc, (float)w, (float)h);
+	// Set uniforms (presence was checked when the effects were loaded)
+	effect.grass_texture.set(0);
+	effect.grass_camera.set(camera_position);
+	effect.grass_resolution.set(vec2((float)w, (float)h));
 	
 	// Use texture dimensions as tile size (in world units/pixels)
 	// This makes each texture tile match its pixel size
 	float tile_size = (float)texture_dimensions[(GLuint)TEXTURE_ASSET_ID::GRASS].x;
 	assert(tile_size > 0 && "Grass texture dimensions invalid!");
-	GLint u_tileSize_loc = glGetUniformLocation(program, "u_tileSize");
-	assert(u_tileSize_loc >= 0 && "u_tileSize uniform not found!");
-	glUniform1f(u_tileSize_loc, tile_size);
+	effect.grass_tile_size.set(tile_size);
 	
 	gl_has_errors();
 
 	// Disable blending so grass RGB is written directly (alpha=0 is still written for SDF to ignore)
-	glDisable(GL_BLEND);
+	gl_state.set_blend(false);
 
 	// Draw the fullscreen quad
-	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, nullptr);
+	glDrawElements(GL_TRIANGLES, index_counts[(GLuint)GEOMETRY_BUFFER_ID::FULLSCREEN_QUAD], GL_UNSIGNED_SHORT, nullptr);
 
 	// Re-enable blending for subsequent draws
-	glEnable(GL_BLEND);
+	gl_state.set_blend(true);
 	gl_has_errors();
 
 	// Disable vertex attributes
@@ -1154,61 +1030,134 @@ void RenderSystem::renderLightingWithShadows()
 	int w, h;
 	glfwGetFramebufferSize(window, &w, &h);
 
-	glDisable(GL_DEPTH_TEST);
-	glDisable(GL_BLEND);
+	gl_state.set_depth_test(false);
+	gl_state.set_blend(false);
 
 	GLuint quad_vbo = vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::FULLSCREEN_QUAD];
 	GLuint quad_ibo = index_buffers[(GLuint)GEOMETRY_BUFFER_ID::FULLSCREEN_QUAD];
 
-	glBindBuffer(GL_ARRAY_BUFFER, quad_vbo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quad_ibo);
+	gl_state.bind_buffer(GL_ARRAY_BUFFER, quad_vbo);
+	gl_state.bind_buffer(GL_ELEMENT_ARRAY_BUFFER, quad_ibo);
 
-	// Query attribute location (screen.vs.glsl only takes position, generates texcoords)
-	GLint in_position_loc = glGetAttribLocation(sdf_seed_program, "in_position");
+	// All four passes share screen.vs.glsl, which only takes position and generates texcoords
+	const GLint in_position_loc = lighting.in_position;
 
 	glEnableVertexAttribArray(in_position_loc);
 	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void*)0);
 
-	// STEP 1: Generate SDF seeds from occluders
-	glBindFramebuffer(GL_FRAMEBUFFER, sdf_voronoi_fb1);
+	// The SDF is screen-space, so it holds for as long as no occluder changed and the view moved
+	// less than one of its texels; the point light pass shifts its lookups by the rest
+	const vec2 camera_px = camera_position * ((float)w / (float)window_width_px);
+	const bool reuse_sdf = sdf_cache_enabled &&
+		sdf_cache.can_reuse(occluder_hash, camera_px, sdf_size, sdf_resolution_divisor);
+	sdf_cache.count(reuse_sdf);
+	if (!reuse_sdf) {
+		sdf_timer.begin();
+		generateSdf();
+		sdf_timer.end();
+		sdf_cache.store(occluder_hash, camera_px, sdf_size);
+	}
+	float sdf_ms;
+	while (sdf_timer.read(sdf_ms)) {
+		sdf_gpu_ms = sdf_ms;
+		sdf_profiler.record_gpu_ms(sdf_ms);
+	}
+	sdf_profiler.record_frame(!reuse_sdf);
+
+	// Render point lights with soft shadows using our sdf map
+	gl_state.bind_framebuffer(GL_FRAMEBUFFER, lighting_fb);
 	glViewport(0, 0, w, h);
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 	glClear(GL_COLOR_BUFFER_BIT);
 
-	glUseProgram(sdf_seed_program);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, scene_texture);
-	GLint uv_scene_loc = glGetUniformLocation(sdf_seed_program, "scene_texture");
-	if (uv_scene_loc >= 0) glUniform1i(uv_scene_loc, 0);
+	gl_state.set_blend(true);
+	gl_state.blend_func(GL_ONE, GL_ONE);
+
+	// Bin the visible lights into screen tiles, then shade every tile with only its own lights in one pass
+	gather_screen_lights(camera_position, { w, h }, screen_lights);
+	light_tiles.build(screen_lights, { w, h });
+	uploadLightTiles();
+
+	gl_state.use_program(point_light_program);
+
+	gl_state.bind_texture(GL_TEXTURE_2D, scene_texture, 0);
+	lighting.light_scene_texture.set(0);
+
+	gl_state.bind_texture(GL_TEXTURE_2D, sdf_texture, 1);
+	lighting.light_sdf_texture.set(1);
+	lighting.sdf_offset.set(sdf_cache.offset(camera_px));
+
+	gl_state.bind_texture(GL_TEXTURE_BUFFER, light_data_texture, 2);
+	lighting.light_data.set(2);
+
+	gl_state.bind_texture(GL_TEXTURE_BUFFER, tile_range_texture, 3);
+	lighting.tile_ranges.set(3);
+
+	gl_state.bind_texture(GL_TEXTURE_BUFFER, tile_index_texture, 4);
+	lighting.tile_light_indices.set(4);
+
+	lighting.tile_size.set(light_tiles.get_tile_size());
+	lighting.tiles_per_row.set(light_tiles.tile_count().x);
+	lighting.screen_size.set(vec2((float)w, (float)h));
+
+	float time = (float)glfwGetTime();
+	lighting.time.set(time);
+
+	if (!screen_lights.empty())
+		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, nullptr);
+
+	gl_has_errors();
+
+	gl_state.set_blend(false);
+
+	glDisableVertexAttribArray(in_position_loc);
+
+	gl_state.bind_framebuffer(GL_READ_FRAMEBUFFER, lighting_fb);
+	gl_state.bind_framebuffer(GL_DRAW_FRAMEBUFFER, frame_buffer);
+	glBlitFramebuffer(0, 0, w, h, 0, 0, w, h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+	gl_state.set_blend(true);
+}
+
+// Seeds, jump floods and converts the occluders of scene_texture into sdf_texture, at sdf_size.
+// Expects the fullscreen quad bound and blending off.
+void RenderSystem::generateSdf()
+{
+	const int sw = sdf_size.x, sh = sdf_size.y;
+
+	// STEP 1: Generate SDF seeds from occluders
+	gl_state.bind_framebuffer(GL_FRAMEBUFFER, sdf_voronoi_fb1);
+	glViewport(0, 0, sw, sh);
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	gl_state.use_program(sdf_seed_program);
+	gl_state.bind_texture(GL_TEXTURE_2D, scene_texture, 0);
+	lighting.seed_scene_texture.set(0);
+	lighting.seed_footprint.set(sdf_resolution_divisor);
 
 	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, nullptr);
 
 	// Build Voronoi from seeds
-	int max_steps = (int)ceil(log2(fmax(w, h)));
+	int max_steps = (int)ceil(log2(fmax(sw, sh)));
 	GLuint read_tex = sdf_voronoi_texture1;
 	GLuint write_fb = sdf_voronoi_fb2;
 	GLuint write_tex = sdf_voronoi_texture2;
 
-	glUseProgram(sdf_jump_flood_program);
-	GLint jf_prev_loc = glGetUniformLocation(sdf_jump_flood_program, "previous_texture");
-	GLint jf_step_loc = glGetUniformLocation(sdf_jump_flood_program, "step_size");
-	GLint jf_aspect_loc = glGetUniformLocation(sdf_jump_flood_program, "aspect");
-
+	gl_state.use_program(sdf_jump_flood_program);
+	lighting.jump_flood_previous_texture.set(0);
+	lighting.jump_flood_aspect.set(vec2(1.0f / (float)sw, 1.0f / (float)sh));
 
 	for (int i = max_steps - 1; i >= 0; i--)
 	{
 		float step_size = pow(2.0f, (float)i);
 
-		glBindFramebuffer(GL_FRAMEBUFFER, write_fb);
-		glViewport(0, 0, w, h);
+		gl_state.bind_framebuffer(GL_FRAMEBUFFER, write_fb);
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT);
 
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, read_tex);
-		if (jf_prev_loc >= 0) glUniform1i(jf_prev_loc, 0);
-		if (jf_step_loc >= 0) glUniform1f(jf_step_loc, step_size);
-		if (jf_aspect_loc >= 0) glUniform2f(jf_aspect_loc, 1.0f / (float)w, 1.0f / (float)h);
+		gl_state.bind_texture(GL_TEXTURE_2D, read_tex, 0);
+		lighting.jump_flood_step_size.set(step_size);
 
 		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, nullptr);
 
@@ -1221,116 +1170,79 @@ void RenderSystem::renderLightingWithShadows()
 
 	// Convert Voronoi diagram to a distance field
 	// Effectively a map of the distance to the nearest occluder
-	glBindFramebuffer(GL_FRAMEBUFFER, sdf_fb);
-	glViewport(0, 0, w, h);
+	gl_state.bind_framebuffer(GL_FRAMEBUFFER, sdf_fb);
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 	glClear(GL_COLOR_BUFFER_BIT);
 
-	glUseProgram(sdf_distance_program);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, read_tex);
-	GLint df_voronoi_loc = glGetUniformLocation(sdf_distance_program, "voronoi_texture");
-	if (df_voronoi_loc >= 0) glUniform1i(df_voronoi_loc, 0);
+	gl_state.use_program(sdf_distance_program);
+	gl_state.bind_texture(GL_TEXTURE_2D, read_tex, 0);
+	lighting.distance_voronoi_texture.set(0);
 	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, nullptr);
+	gl_has_errors();
+}
 
-	// Render point lights with soft shadows using our sdf map
-	glBindFramebuffer(GL_FRAMEBUFFER, lighting_fb);
-	glViewport(0, 0, w, h);
-	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-	glClear(GL_COLOR_BUFFER_BIT);
-
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_ONE, GL_ONE);
-
-	glUseProgram(point_light_program);
-
-	// Get the inputs for the point light shader
-	GLint pl_scene_loc = glGetUniformLocation(point_light_program, "scene_texture");
-	GLint pl_sdf_loc = glGetUniformLocation(point_light_program, "sdf_texture");
-	GLint pl_light_pos_loc = glGetUniformLocation(point_light_program, "light_position");
-	GLint pl_light_color_loc = glGetUniformLocation(point_light_program, "light_color");
-	GLint pl_light_radius_loc = glGetUniformLocation(point_light_program, "light_radius");
-	GLint pl_screen_size_loc = glGetUniformLocation(point_light_program, "screen_size");
-	GLint pl_flicker_loc = glGetUniformLocation(point_light_program, "flicker_intensity");
-	GLint pl_time_loc = glGetUniformLocation(point_light_program, "time");
-	GLint pl_direction_loc = glGetUniformLocation(point_light_program, "light_direction");
-	GLint pl_cone_angle_loc = glGetUniformLocation(point_light_program, "cone_angle");
-	GLint pl_height_loc = glGetUniformLocation(point_light_program, "light_height");
-
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, scene_texture);
-	if (pl_scene_loc >= 0) glUniform1i(pl_scene_loc, 0);
-
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, sdf_texture);
-	if (pl_sdf_loc >= 0) glUniform1i(pl_sdf_loc, 1);
-
-	if (pl_screen_size_loc >= 0) glUniform2f(pl_screen_size_loc, (float)w, (float)h);
-
-	float time = (float)glfwGetTime();
-	if (pl_time_loc >= 0) glUniform1f(pl_time_loc, time);
-
-	// Loop through all lights
-	for (Entity entity : registry.lights.entities)
-	{
-		if (!registry.motions.has(entity)) continue;
-
-		Motion& motion = registry.motions.get(entity);
-		Light& light = registry.lights.get(entity);
-		
-		// Skip bonfire light when bonfire is in OFF state (check texture)
-		if (registry.renderRequests.has(entity)) {
-			RenderRequest& req = registry.renderRequests.get(entity);
-			if (req.used_texture == TEXTURE_ASSET_ID::BONFIRE_OFF) {
-				continue;
-			}
-		}
-
-		// Get the lights component settings
-		float radius = light.range;
-		vec3 color = light.light_color * light.brightness; // Apply brightness to light color
-		float flicker = 1.0f;
-		float coneAngle = light.cone_angle;
-		vec2 direction = vec2(1.0f, 0.0f);
-
-		if (light.use_target_angle) {
-			direction = vec2(cos(motion.angle), sin(motion.angle));
-		}
-
-		if (registry.bullets.has(entity)) {
-			radius = 70.0f;
-			color *= 0.5f;
-			coneAngle = 3.14159f;
-		}
-
-		float lightHeight = 0.4f;
-
-		vec2 screen_light_pos;
-		screen_light_pos.x = motion.position.x - camera_position.x + (w / 2.0f);
-		screen_light_pos.y = motion.position.y - camera_position.y + (h / 2.0f);
-
-		// Set the inputs for the point light shader
-		if (pl_light_pos_loc >= 0) glUniform2f(pl_light_pos_loc, screen_light_pos.x, screen_light_pos.y);
-		if (pl_light_color_loc >= 0) glUniform3f(pl_light_color_loc, color.r, color.g, color.b);
-		if (pl_light_radius_loc >= 0) glUniform1f(pl_light_radius_loc, radius);
-		if (pl_flicker_loc >= 0) glUniform1f(pl_flicker_loc, flicker);
-		if (pl_direction_loc >= 0) glUniform2f(pl_direction_loc, direction.x, direction.y);
-		if (pl_cone_angle_loc >= 0) glUniform1f(pl_cone_angle_loc, coneAngle);
-		if (pl_height_loc >= 0) glUniform1f(pl_height_loc, lightHeight);
-
-		// Draw the point light
-		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, nullptr);
+void RenderSystem::setSdfResolutionDivisor(int divisor)
+{
+	if (divisor == sdf_resolution_divisor && sdf_size.x > 0)
+		return;
+	if (!is_sdf_resolution_divisor(divisor)) {
+		fprintf(stderr, "Unsupported SDF resolution divisor %d, keeping %d\n", divisor, sdf_resolution_divisor);
+		return;
 	}
+	sdf_resolution_divisor = divisor;
 
-	glDisable(GL_BLEND);
+	int w, h;
+	glfwGetFramebufferSize(window, &w, &h);
+	sdf_size = sdf_target_size({ w, h }, divisor);
+	// the framebuffers stay attached to the same textures through the reallocation
+	for (GLuint texture : { sdf_voronoi_texture1, sdf_voronoi_texture2, sdf_texture }) {
+		gl_state.bind_texture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, sdf_size.x, sdf_size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	}
+	sdf_cache.invalidate();
+	gl_has_errors();
+}
 
-	glDisableVertexAttribArray(in_position_loc);
+// Uploads into a buffer texture's storage, reallocating only when the data outgrows it
+static void upload_texture_buffer(GLuint buffer, GLsizeiptr& capacity, const void* data, GLsizeiptr size)
+{
+	glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+	if (size > capacity) {
+		capacity = std::max(size, capacity * 2);
+		glBufferData(GL_TEXTURE_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+	}
+	glBufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+}
 
-	glBindFramebuffer(GL_READ_FRAMEBUFFER, lighting_fb);
-	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, frame_buffer);
-	glBlitFramebuffer(0, 0, w, h, 0, 0, w, h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+// Streams this frame's lights and tile lists into the buffer textures read by point_light.fs.glsl
+void RenderSystem::uploadLightTiles()
+{
+	// 3 texels per light: (position, radius, cone angle), (color, flicker), (direction, height, soft shadows)
+	light_texels.clear();
+	for (const ScreenLight& light : screen_lights) {
+		light_texels.push_back(vec4(light.position, light.radius, light.cone_angle));
+		light_texels.push_back(vec4(light.color, light.flicker));
+		light_texels.push_back(vec4(light.direction, light.height, light.soft_shadows ? 1.f : 0.f));
+	}
 
-	glEnable(GL_BLEND);
+	const std::vector<uint32_t>& ranges = light_tiles.ranges();
+	const std::vector<uint32_t>& indices = light_tiles.indices();
+	// buffer textures must not be empty
+	if (light_texels.empty())
+		light_texels.push_back(vec4(0.f));
+	const uint32_t no_index = 0;
+
+	upload_texture_buffer(light_data_buffer, light_data_capacity,
+		light_texels.data(), light_texels.size() * sizeof(vec4));
+	upload_texture_buffer(tile_range_buffer, tile_range_capacity,
+		ranges.data(), ranges.size() * sizeof(uint32_t));
+	if (indices.empty())
+		upload_texture_buffer(tile_index_buffer, tile_index_capacity, &no_index, sizeof(uint32_t));
+	else
+		upload_texture_buffer(tile_index_buffer, tile_index_capacity,
+			indices.data(), indices.size() * sizeof(uint32_t));
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	gl_has_errors();
 }
 
 void RenderSystem::set_health_system(HealthSystem* health_system)
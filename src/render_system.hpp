@@ -1,11 +1,18 @@
 #pragma once
 
 #include <array>
+#include <unordered_map>
 #include <utility>
 
 #include "common.hpp"
 #include "components.hpp"
+#include "gl_state.hpp"
+#include "light_tiles.hpp"
+#include "shadow_sdf.hpp"
+#include "sprite_batch.hpp"
+#include "stream_buffer.hpp"
 #include "tiny_ecs.hpp"
+#include "tiny_ecs_registry.hpp"
 
 // Forward declaration
 class LowHealthOverlaySystem;
@@ -89,6 +96,8 @@ class RenderSystem {
 	};
 
 	std::array<GLuint, effect_count> effects;
+	// Locations of every effect, reflected once when it is loaded
+	std::array<EffectHandles, effect_count> effect_handles;
 	// Make sure these paths remain in sync with the associated enumerators.
 	const std::array<std::string, effect_count> effect_paths = {
 		shader_path("coloured"),
@@ -99,10 +108,13 @@ class RenderSystem {
 		shader_path("particle"),
 		shader_path("trail"),
 		shader_path("grass_background"),
+		shader_path("sprite_batch"),
 	};
 
 	std::array<GLuint, geometry_count> vertex_buffers;
 	std::array<GLuint, geometry_count> index_buffers;
+	// Indices uploaded to each index buffer, so draws never query the buffer size
+	std::array<GLsizei, geometry_count> index_counts = {};
 	std::array<Mesh, geometry_count> meshes;
 
 public:
@@ -112,6 +124,11 @@ public:
 	// Set health system for low health overlay
 	void set_health_system(class HealthSystem* health_system);
 
+	// Decoded textures are cached as raw RGBA under texture_cache_path() and mapped on the next
+	// launch instead of inflating the PNGs; set before init
+	bool use_texture_cache = true;
+	static std::string texture_cache_path() { return data_path() + "/cache/textures"; }
+
 	// global world lighting
 	float global_ambient_brightness = 0.01f;
 
@@ -122,6 +139,7 @@ public:
 	template <class T>
 	void bindVBOandIBO(GEOMETRY_BUFFER_ID gid, std::vector<T> vertices, std::vector<uint16_t> indices);
 
+	// Decodes the textures on worker threads, uploads them on this one and prints the time each phase took
 	void initializeGlTextures();
 
 	void initializeGlEffects();
@@ -158,16 +176,43 @@ public:
 		}
 	}
 
+	// Draw calls the last frame's lit scene pass took, and the entities it drew
+	size_t getSceneDrawCalls() const { return sprite_batches.draw_calls(); }
+	size_t getSceneSpriteCount() const { return sprite_batches.item_count(); }
+	// Lights the last frame's lighting pass shaded
+	size_t getScreenLightCount() const { return screen_lights.size(); }
+	// GL state changes the last frame issued, and the redundant ones gl_state skipped
+	size_t getStateChangesIssued() const { return frame_state_issued; }
+	size_t getStateChangesElided() const { return frame_state_elided; }
+
+	// The shadow SDF is generated at the framebuffer size divided by one of SDF_RESOLUTION_DIVISORS,
+	// and, with the cache on, only on frames where an occluder changed or the view moved a texel
+	void setSdfResolutionDivisor(int divisor);
+	int getSdfResolutionDivisor() const { return sdf_resolution_divisor; }
+	bool sdf_cache_enabled = true;
+	const SdfCache& getSdfCache() const { return sdf_cache; }
+	// GPU time of the latest measured SDF generation, or -1 before the first result arrives
+	float getSdfGpuMs() const { return sdf_gpu_ms; }
+	// Cycles through the SDF options, frames_per_option frames each, printing their GPU cost per cycle
+	void startSdfProfile(int frames_per_option) { sdf_profiler.start(frames_per_option); }
+
+	// Bakes a chunk's isoline tiles into one static vertex buffer that drawChunks draws in a single
+	// call; generateChunk calls it once the chunk's cells are final
+	void bakeChunkMesh(short chunk_x, short chunk_y, const Chunk& chunk);
+	// Frees the baked mesh of a chunk being culled, or of every chunk when they are all cleared
+	void releaseChunkMesh(const Chunk& chunk);
+	void releaseChunkMeshes();
+
 	// toggle player hitbox debug rendering
 	void togglePlayerHitboxDebug() { show_player_hitbox_debug = !show_player_hitbox_debug; }
 
 private:
 	// Internal drawing functions for each entity type
 	void drawTexturedMesh(Entity entity, const mat3& projection);
-	void drawIsocell(vec2 position, const mat3& projection);
+	void drawSpriteBatches(const mat3& projection);
 	void drawChunks(const mat3 &projection);
 	void drawToScreen();
-	void drawEnemyHealthbar(Entity enemy_entity, const mat3& projection);
+	void drawEnemyHealthbars(const vec4& cam_view, const mat3& projection);
 	void draw_particles();
 	void drawGrassBackground();
 
@@ -195,7 +240,69 @@ private:
 	GLuint sdf_distance_program;          // Converts Voronoi to distance field
 	GLuint point_light_program;           // Renders lights with soft shadows using SDF
 
-	GLuint particle_instance_vbo = 0;
+	// Locations of the shadow shaders, which all share screen.vs.glsl
+	struct LightingHandles {
+		GLint in_position = -1;
+		Uniform<int> seed_scene_texture;
+		Uniform<int> seed_footprint;
+		Uniform<int> jump_flood_previous_texture;
+		Uniform<float> jump_flood_step_size;
+		Uniform<vec2> jump_flood_aspect;
+		Uniform<int> distance_voronoi_texture;
+		Uniform<int> light_scene_texture, light_sdf_texture;
+		Uniform<vec2> sdf_offset;
+		Uniform<int> light_data, tile_ranges, tile_light_indices;
+		Uniform<int> tile_size, tiles_per_row;
+		Uniform<vec2> screen_size;
+		Uniform<float> time;
+	} lighting;
+
+	// Shadow SDF generation: its current size and divisor, the cache that lets frames skip it, and the
+	// timer and profiler measuring it
+	int sdf_resolution_divisor = 1;
+	ivec2 sdf_size = { 0, 0 };
+	SdfCache sdf_cache;
+	uint64_t occluder_hash = 0;
+	// Chunks drawChunks drew this frame, part of the occluder signature
+	std::vector<unsigned int> drawn_chunk_ids;
+	GpuTimer sdf_timer;
+	SdfProfiler sdf_profiler;
+	float sdf_gpu_ms = -1.f;
+	void generateSdf();
+
+	// Tiled lighting: the visible lights, binned into screen tiles, as buffer textures for point_light_program
+	std::vector<ScreenLight> screen_lights;
+	LightTileGrid light_tiles;
+	GLuint light_data_buffer = 0, light_data_texture = 0;
+	GLuint tile_range_buffer = 0, tile_range_texture = 0;
+	GLuint tile_index_buffer = 0, tile_index_texture = 0;
+	// allocated sizes of the three buffers above, grown on demand and reused across frames
+	GLsizeiptr light_data_capacity = 0, tile_range_capacity = 0, tile_index_capacity = 0;
+	std::vector<vec4> light_texels;
+
+	// Baked isoline meshes of the loaded chunks, by Chunk::id
+	struct ChunkMesh {
+		GLuint vbo = 0;
+		GLsizei vertex_count = 0;
+	};
+	std::unordered_map<unsigned int, ChunkMesh> chunk_meshes;
+	std::vector<TexturedVertex> chunk_mesh_vertices;
+	void deleteChunkMeshBuffer(ChunkMesh& mesh);
+
+	GLuint sprite_instance_vbo = 0;
+	// sprite_batch.vs.glsl's per-instance attributes: the three transform columns, frame, flags and atlas rectangle
+	static const int SPRITE_INSTANCE_ATTRIBUTES = 6;
+	GLint sprite_instance_attributes[SPRITE_INSTANCE_ATTRIBUTES] = { -1, -1, -1, -1, -1, -1 };
+
+	// Per-frame dynamic geometry (particles, health bars, debug lines) is streamed through this
+	StreamBuffer stream_buffer;
+	// in_position, then the per-instance x, y, size and color
+	GLint particle_attributes[5] = { -1, -1, -1, -1, -1 };
+	GLsizei particle_index_count = 0;
+	std::vector<ColoredVertex> healthbar_batch;
+
+	size_t frame_state_issued = 0;
+	size_t frame_state_elided = 0;
 
 	vec2 camera_position = {0.f, 0.f};
 	vec2 initial_camera_position = {0.f, 0.f};
@@ -203,11 +310,23 @@ private:
 
 	bool initShadowTextures();
 	bool initShadowShaders();
+	void initLightTileBuffers();
+	void initStreamBuffers();
+	void uploadLightTiles();
 	void renderLightingWithShadows();
 	void renderSceneToColorTexture();
 
 	Entity screen_state_entity;
 
+	// Lit scene entities, in render request order; the player, feet and arrow are drawn separately
+	View<RenderRequest, Motion> scene_view = registry.view(registry.renderRequests, registry.motions)
+		.exclude(registry.players, registry.feet, registry.arrows)
+		.ordered();
+	// The scene view's entities regrouped into instanced draws, rebuilt every frame
+	SpriteBatchBuilder sprite_batches;
+	// Page and rectangle of every texture packed into an atlas at load, see is_atlas_texture
+	TextureAtlasTable texture_atlas;
+
 	// debug flag for drawing player hitboxes
 	bool show_player_hitbox_debug = false;
 	
@@ -216,10 +335,4 @@ private:
 };
 
 bool loadEffectFromFile(
-	const std::string& vs_path, const std::string& fs_path, GLuint& out_program);
-
-struct ParticleInstanceData {
-    vec3 pos;
-    float size;
-    vec4 color;
-};
\ No newline at end of file
+	const std::string& vs_path, const std::string& fs_path, GLuint& out_program);
\ No newline at end of file
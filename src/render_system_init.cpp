@@ -1,8 +1,10 @@
 // internal
 #include "render_system.hpp"
 #include "low_health_overlay_system.hpp"
+#include "texture_loader.hpp"
 
 #include <array>
+#include <chrono>
 #include <fstream>
 #include <cmath>
 
@@ -60,38 +62,96 @@ bool RenderSystem::init(GLFWwindow* window_arg)
 		return false;
 	}
     initializeGlTextures();
+	sprite_batches.set_atlas(&texture_atlas);
 	initializeGlEffects();
 	initializeGlGeometryBuffers();
+	initStreamBuffers();
 	
 	// Initialize low health overlay system
 	low_health_overlay_system = new LowHealthOverlaySystem();
-	low_health_overlay_system->init(window, texture_gl_handles, effects, vertex_buffers, index_buffers, nullptr);
+	low_health_overlay_system->init(window, texture_gl_handles, effect_handles, vertex_buffers, index_buffers, nullptr);
 
 	return true;
 }
 
 void RenderSystem::initializeGlTextures()
 {
+	using Clock = std::chrono::steady_clock;
+	const auto start = Clock::now();
     glGenTextures((GLsizei)texture_gl_handles.size(), texture_gl_handles.data());
 
+	// PNGs decode on worker threads while this thread uploads each one as soon as it is ready
+	TextureLoader loader(std::vector<std::string>(texture_paths.begin(), texture_paths.end()),
+		use_texture_cache ? texture_cache_path() : std::string());
+	// The enemy sheets go into shared atlas pages so their sprites batch into one draw; the layout
+	// only needs the PNG headers, so the pages exist before the first sheet is decoded
+	std::vector<TEXTURE_ASSET_ID> atlas_textures;
+	std::vector<ivec2> atlas_sizes;
+	for (int i = 0; i < texture_count; i++) {
+		ivec2 size;
+		int channels;
+		if (is_atlas_texture((TEXTURE_ASSET_ID)i) && stbi_info(texture_paths[i].c_str(), &size.x, &size.y, &channels)) {
+			atlas_textures.push_back((TEXTURE_ASSET_ID)i);
+			atlas_sizes.push_back(size);
+		}
+	}
+	GLint max_texture_size = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+	const AtlasLayout atlas_layout = pack_atlas(atlas_sizes, std::min((int)max_texture_size, ATLAS_MAX_PAGE_SIZE));
+	std::vector<GLuint> atlas_pages(atlas_layout.page_sizes.size());
+	if (!atlas_pages.empty())
+		glGenTextures((GLsizei)atlas_pages.size(), atlas_pages.data());
+	for (size_t p = 0; p < atlas_pages.size(); p++) {
+		// cleared explicitly, the padding between images must stay transparent
+		const ivec2 page_size = atlas_layout.page_sizes[p];
+		const std::vector<unsigned char> clear((size_t)page_size.x * page_size.y * 4, 0);
+		glBindTexture(GL_TEXTURE_2D, atlas_pages[p]);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, page_size.x, page_size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, clear.data());
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+	texture_atlas.assign(atlas_textures, atlas_layout);
+	std::array<const AtlasPlacement*, texture_count> atlas_placements{};
+	for (size_t a = 0; a < atlas_textures.size(); a++)
+		if (atlas_layout.placements[a].page >= 0)
+			atlas_placements[(size_t)atlas_textures[a]] = &atlas_layout.placements[a];
+	gl_has_errors();
+
+	float upload_ms = 0.f;
     for(uint i = 0; i < texture_paths.size(); i++)
     {
 		const std::string& path = texture_paths[i];
 		ivec2& dimensions = texture_dimensions[i];
 
-		stbi_uc* data;
-		data = stbi_load(path.c_str(), &dimensions.x, &dimensions.y, NULL, 4);
-
-		if (data == NULL)
+		const DecodedTexture& texture = loader.wait(i);
+		if (texture.pixels == nullptr)
 		{
 			const std::string message = "Could not load the file " + path + ".";
 			fprintf(stderr, "%s", message.c_str());
 			assert(false);
 		}
-		glBindTexture(GL_TEXTURE_2D, texture_gl_handles[i]);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, dimensions.x, dimensions.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		dimensions = texture.size;
+
+		const auto upload_start = Clock::now();
+		const AtlasPlacement* placement = atlas_placements[i];
+		if (placement) {
+			// the layout came from the same PNG's header
+			assert(placement->size == dimensions);
+			// draw through the page from now on; the texture's own name is not needed
+			const GLuint page = atlas_pages[placement->page];
+			glBindTexture(GL_TEXTURE_2D, page);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, placement->position.x, placement->position.y, dimensions.x, dimensions.y,
+				GL_RGBA, GL_UNSIGNED_BYTE, texture.pixels);
+			glDeleteTextures(1, &texture_gl_handles[i]);
+			texture_gl_handles[i] = page;
+		} else {
+			glBindTexture(GL_TEXTURE_2D, texture_gl_handles[i]);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, dimensions.x, dimensions.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, texture.pixels);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		}
 		
 		// Enable texture repeating for grass texture (for tiling)
 		if (i == (uint)TEXTURE_ASSET_ID::GRASS) {
@@ -100,9 +160,15 @@ void RenderSystem::initializeGlTextures()
 		}
 		
 		gl_has_errors();
-		stbi_image_free(data);
+		upload_ms += (float)(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - upload_start)).count() / 1000;
+		loader.release(i);
     }
 	gl_has_errors();
+
+	const float total_ms = (float)(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start)).count() / 1000;
+	printf("Textures: %zu loaded (%zu from cache) on %u threads, decode %.1f ms, upload %.1f ms, total %.1f ms\n",
+		texture_paths.size(), loader.cache_hits(), loader.threads(), loader.load_ms(), upload_ms, total_ms);
+	printf("Texture atlas: %zu enemy sheets on %zu pages\n", atlas_textures.size(), atlas_pages.size());
 }
 
 void RenderSystem::initializeGlEffects()
@@ -114,7 +180,25 @@ void RenderSystem::initializeGlEffects()
 
 		bool is_valid = loadEffectFromFile(vertex_shader_name, fragment_shader_name, effects[i]);
 		assert(is_valid && (GLuint)effects[i] != 0);
+
+		ProgramReflection reflection;
+		reflection.reflect(effects[i]);
+		effect_handles[i].resolve(reflection);
 	}
+
+	const EffectHandles& grass = effect_handles[(GLuint)EFFECT_ASSET_ID::GRASS_BACKGROUND];
+	if (!grass.grass_texture.active())
+		fprintf(stderr, "Warning: u_grass uniform not found in grass background shader!\n");
+	assert(grass.grass_camera.active() && grass.grass_resolution.active() && grass.grass_tile_size.active());
+
+	ProgramReflection sprite_batch;
+	sprite_batch.reflect(effects[(GLuint)EFFECT_ASSET_ID::SPRITE_BATCH]);
+	const char* instance_names[SPRITE_INSTANCE_ATTRIBUTES] = {
+		"instance_transform_0", "instance_transform_1", "instance_transform_2",
+		"instance_frame", "instance_flags", "instance_uv_rect",
+	};
+	for (int i = 0; i < SPRITE_INSTANCE_ATTRIBUTES; i++)
+		sprite_instance_attributes[i] = sprite_batch.attribute_location(instance_names[i]);
 }
 
 // One could merge the following two functions as a template function...
@@ -129,6 +213,7 @@ void RenderSystem::bindVBOandIBO(GEOMETRY_BUFFER_ID gid, std::vector<T> vertices
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffers[(uint)gid]);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER,
 		sizeof(indices[0]) * indices.size(), indices.data(), GL_STATIC_DRAW);
+	index_counts[(uint)gid] = (GLsizei)indices.size();
 	gl_has_errors();
 }
 
@@ -154,7 +239,7 @@ void RenderSystem::initializeGlGeometryBuffers()
 {
 	// Vertex Buffer creation.
 	glGenBuffers((GLsizei)vertex_buffers.size(), vertex_buffers.data());
-	glGenBuffers(1, &particle_instance_vbo);
+	glGenBuffers(1, &sprite_instance_vbo);
 	
 	// Index Buffer creation.
 	glGenBuffers((GLsizei)index_buffers.size(), index_buffers.data());
@@ -314,6 +399,9 @@ RenderSystem::~RenderSystem()
 	// but it's polite to clean after yourself.
 	glDeleteBuffers((GLsizei)vertex_buffers.size(), vertex_buffers.data());
 	glDeleteBuffers((GLsizei)index_buffers.size(), index_buffers.data());
+	glDeleteBuffers(1, &sprite_instance_vbo);
+	releaseChunkMeshes();
+	stream_buffer.destroy();
 	glDeleteTextures((GLsizei)texture_gl_handles.size(), texture_gl_handles.data());
 	glDeleteTextures(1, &off_screen_render_buffer_color);
 	glDeleteRenderbuffers(1, &off_screen_render_buffer_depth);
@@ -330,6 +418,11 @@ RenderSystem::~RenderSystem()
 	glDeleteProgram(sdf_seed_program);
 	glDeleteProgram(sdf_jump_flood_program);
 	glDeleteProgram(sdf_distance_program);
+	sdf_timer.destroy();
+	GLuint light_tile_textures[] = { light_data_texture, tile_range_texture, tile_index_texture };
+	GLuint light_tile_buffers[] = { light_data_buffer, tile_range_buffer, tile_index_buffer };
+	glDeleteTextures(3, light_tile_textures);
+	glDeleteBuffers(3, light_tile_buffers);
 	gl_has_errors();
 
 	for(uint i = 0; i < effect_count; i++) {
@@ -491,10 +584,13 @@ bool RenderSystem::initShadowTextures()
 	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, scene_texture, 0);
 	gl_has_errors();
 
+	// The SDF passes run at a fraction of the framebuffer resolution, see setSdfResolutionDivisor
+	sdf_size = sdf_target_size({ framebuffer_width, framebuffer_height }, sdf_resolution_divisor);
+
 	// Jump Texture 1
 	glGenTextures(1, &sdf_voronoi_texture1);
 	glBindTexture(GL_TEXTURE_2D, sdf_voronoi_texture1);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, framebuffer_width, framebuffer_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, sdf_size.x, sdf_size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -507,7 +603,7 @@ bool RenderSystem::initShadowTextures()
 	// Jump Texture 2
 	glGenTextures(1, &sdf_voronoi_texture2);
 	glBindTexture(GL_TEXTURE_2D, sdf_voronoi_texture2);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, framebuffer_width, framebuffer_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, sdf_size.x, sdf_size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -520,7 +616,7 @@ bool RenderSystem::initShadowTextures()
 	// Distance Field Texture
 	glGenTextures(1, &sdf_texture);
 	glBindTexture(GL_TEXTURE_2D, sdf_texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, framebuffer_width, framebuffer_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, sdf_size.x, sdf_size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST); 
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -576,5 +672,67 @@ bool RenderSystem::initShadowShaders()
 	fprintf(stderr, "Loaded point light shader\n");
 	fprintf(stderr, "All SDF shadow shaders loaded successfully!\n");
 
+	ProgramReflection reflection;
+	reflection.reflect(sdf_seed_program);
+	lighting.in_position = reflection.attribute_location("in_position");
+	lighting.seed_scene_texture = reflection.uniform<int>("scene_texture");
+	lighting.seed_footprint = reflection.uniform<int>("footprint");
+	reflection.reflect(sdf_jump_flood_program);
+	lighting.jump_flood_previous_texture = reflection.uniform<int>("previous_texture");
+	lighting.jump_flood_step_size = reflection.uniform<float>("step_size");
+	lighting.jump_flood_aspect = reflection.uniform<vec2>("aspect");
+	reflection.reflect(sdf_distance_program);
+	lighting.distance_voronoi_texture = reflection.uniform<int>("voronoi_texture");
+	reflection.reflect(point_light_program);
+	lighting.light_scene_texture = reflection.uniform<int>("scene_texture");
+	lighting.light_sdf_texture = reflection.uniform<int>("sdf_texture");
+	lighting.sdf_offset = reflection.uniform<vec2>("sdf_offset");
+	lighting.light_data = reflection.uniform<int>("light_data");
+	lighting.tile_ranges = reflection.uniform<int>("tile_ranges");
+	lighting.tile_light_indices = reflection.uniform<int>("tile_light_indices");
+	lighting.tile_size = reflection.uniform<int>("tile_size");
+	lighting.tiles_per_row = reflection.uniform<int>("tiles_per_row");
+	lighting.screen_size = reflection.uniform<vec2>("screen_size");
+	lighting.time = reflection.uniform<float>("time");
+
+	initLightTileBuffers();
+	sdf_timer.init();
+
 	return true;
 }
+
+// Buffer textures the tiled point light shader reads the per-frame light lists from
+void RenderSystem::initLightTileBuffers()
+{
+	GLuint* buffers[] = { &light_data_buffer, &tile_range_buffer, &tile_index_buffer };
+	GLuint* textures[] = { &light_data_texture, &tile_range_texture, &tile_index_texture };
+	GLsizeiptr* capacities[] = { &light_data_capacity, &tile_range_capacity, &tile_index_capacity };
+	const GLenum formats[] = { GL_RGBA32F, GL_RG32UI, GL_R32UI };
+	for (int i = 0; i < 3; i++) {
+		glGenBuffers(1, buffers[i]);
+		glBindBuffer(GL_TEXTURE_BUFFER, *buffers[i]);
+		// a buffer texture needs storage before it is attached
+		glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+		*capacities[i] = 16;
+		glGenTextures(1, textures[i]);
+		glBindTexture(GL_TEXTURE_BUFFER, *textures[i]);
+		glTexBuffer(GL_TEXTURE_BUFFER, formats[i], *buffers[i]);
+	}
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	gl_has_errors();
+}
+
+// Streaming buffer for per-frame geometry, and the particle draw state that never changes
+void RenderSystem::initStreamBuffers()
+{
+	stream_buffer.init();
+
+	ProgramReflection particle;
+	particle.reflect(effects[(GLuint)EFFECT_ASSET_ID::PARTICLE]);
+	const char* attribute_names[] = { "in_position", "instance_x", "instance_y", "instance_size", "instance_color" };
+	for (int i = 0; i < 5; i++)
+		particle_attributes[i] = particle.attribute_location(attribute_names[i]);
+	particle_index_count = (GLsizei)meshes[(int)GEOMETRY_BUFFER_ID::BULLET_CIRCLE].vertex_indices.size();
+	gl_has_errors();
+}
@@ -0,0 +1,171 @@
+// internal
+#include "save_stream.hpp"
+
+// stlib
+#include <cstring>
+#include <stdexcept>
+
+SaveWriter::SaveWriter(std::ostream* out)
+	: out(out)
+{
+	buffer.reserve(SAVE_WRITER_BUFFER_SIZE);
+}
+
+void SaveWriter::write_header()
+{
+	write_u32(SAVE_MAGIC);
+	write_u32(SAVE_VERSION);
+}
+
+void SaveWriter::begin_section(SaveSection section)
+{
+	if (in_section)
+		end_section();
+	write_u32((uint32_t)section);
+	section_start = size();
+	write_u32(0);
+	in_section = true;
+}
+
+void SaveWriter::end_section()
+{
+	if (!in_section)
+		return;
+	const size_t body_start = section_start + sizeof(uint32_t);
+	patch_u32(section_start, (uint32_t)(size() - body_start));
+	in_section = false;
+}
+
+void SaveWriter::finish()
+{
+	begin_section(SaveSection::END);
+	end_section();
+	flush();
+	if (out)
+		out->flush();
+}
+
+void SaveWriter::write_u8(uint8_t value)
+{
+	buffer.push_back((char)value);
+	if (buffer.size() >= SAVE_WRITER_BUFFER_SIZE)
+		flush();
+}
+
+void SaveWriter::write_u32(uint32_t value)
+{
+	const char le[4] = { (char)(value & 0xff), (char)((value >> 8) & 0xff), (char)((value >> 16) & 0xff), (char)(value >> 24) };
+	buffer.insert(buffer.end(), le, le + 4);
+	if (buffer.size() >= SAVE_WRITER_BUFFER_SIZE)
+		flush();
+}
+
+void SaveWriter::write_f32(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	write_u32(bits);
+}
+
+void SaveWriter::write_string(const std::string& value)
+{
+	write_u32((uint32_t)value.size());
+	buffer.insert(buffer.end(), value.begin(), value.end());
+	if (buffer.size() >= SAVE_WRITER_BUFFER_SIZE)
+		flush();
+}
+
+void SaveWriter::flush()
+{
+	if (out == nullptr || buffer.empty())
+		return;
+	out->write(buffer.data(), (std::streamsize)buffer.size());
+	flushed += buffer.size();
+	buffer.clear();
+}
+
+void SaveWriter::patch_u32(size_t offset, uint32_t value)
+{
+	const char le[4] = { (char)(value & 0xff), (char)((value >> 8) & 0xff), (char)((value >> 16) & 0xff), (char)(value >> 24) };
+	if (offset >= flushed) {
+		memcpy(buffer.data() + (offset - flushed), le, 4);
+		return;
+	}
+	// already in the stream: write it in place and come back to the end
+	flush();
+	out->seekp((std::streamoff)offset);
+	out->write(le, 4);
+	out->seekp((std::streamoff)flushed);
+}
+
+SaveReader::SaveReader(const char* data, size_t size)
+	: bytes(data), size(size)
+{
+	section_end = size;
+}
+
+void SaveReader::read_header()
+{
+	if (read_u32() != SAVE_MAGIC)
+		throw std::runtime_error("not a binary save file");
+	file_version = read_u32();
+	if (file_version > SAVE_VERSION)
+		throw std::runtime_error("save file version " + std::to_string(file_version) + " is newer than " + std::to_string(SAVE_VERSION));
+	// the first section starts right here
+	section_end = pos;
+}
+
+SaveSection SaveReader::next_section()
+{
+	pos = section_end;
+	section_end = size;
+	const SaveSection section = (SaveSection)read_u32();
+	const uint32_t length = read_u32();
+	need(length);
+	section_end = pos + length;
+	return section;
+}
+
+void SaveReader::need(size_t count) const
+{
+	if (count > section_end - pos)
+		throw std::runtime_error("save file is truncated");
+}
+
+uint8_t SaveReader::read_u8()
+{
+	need(1);
+	return (uint8_t)bytes[pos++];
+}
+
+uint32_t SaveReader::read_u32()
+{
+	need(4);
+	const unsigned char* p = (const unsigned char*)bytes + pos;
+	pos += 4;
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+float SaveReader::read_f32()
+{
+	const uint32_t bits = read_u32();
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+std::string SaveReader::read_string()
+{
+	const uint32_t length = read_u32();
+	need(length);
+	std::string value(bytes + pos, length);
+	pos += length;
+	return value;
+}
+
+uint32_t SaveReader::read_count(size_t record_size)
+{
+	const uint32_t count = read_u32();
+	need((size_t)count * record_size);
+	return count;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// "ECLS" at the start of every binary save
+const uint32_t SAVE_MAGIC = 0x534c4345;
+// Bump when a section's layout changes; saves from a newer version are rejected
+const uint32_t SAVE_VERSION = 2;
+// Staged bytes a SaveWriter hands to its stream at once
+const size_t SAVE_WRITER_BUFFER_SIZE = 64 * 1024;
+
+// Top-level blocks of a binary save, in the order WorldSystem writes them. Each is stored as its
+// tag, the byte length of its body and the body, so readers can skip sections they do not know
+// and fields appended to the end of a section in a later version. END closes the file.
+enum class SaveSection : uint32_t {
+	END = 0,
+	PLAYER = 1,
+	WORLD = 2,          // map and decorator seeds
+	CHUNKS = 3,         // chunks loaded when saving, read back from their live entities
+	SERIAL_CHUNKS = 4,  // chunks already unloaded to SerializedChunk
+	INVENTORY = 5,
+	LEVEL = 6,          // level, objectives, bonfire and tutorial state
+	REGIONS = 7         // offset tables into the chunk region files holding the serialized chunks (version 2)
+};
+
+// Streaming little-endian writer for binary saves.
+//
+// Values go into a SAVE_WRITER_BUFFER_SIZE staging buffer that is written to the output stream
+// whenever it fills, so the save never has to exist in memory as a whole. A section's length is
+// patched in when it ends, in the buffer if it is still there or with a seek otherwise. Without
+// an output stream nothing is flushed and data() holds the whole save.
+class SaveWriter
+{
+public:
+	explicit SaveWriter(std::ostream* out = nullptr);
+
+	// Magic and version; call first
+	void write_header();
+	void begin_section(SaveSection section);
+	void end_section();
+	// Writes the END section and flushes everything to the stream
+	void finish();
+
+	void write_u8(uint8_t value);
+	void write_bool(bool value) { write_u8(value ? 1 : 0); }
+	void write_u32(uint32_t value);
+	void write_i32(int32_t value) { write_u32((uint32_t)value); }
+	void write_f32(float value);
+	void write_vec2(vec2 value) { write_f32(value.x); write_f32(value.y); }
+	void write_string(const std::string& value);
+
+	// Bytes written so far, flushed or not
+	size_t size() const { return flushed + buffer.size(); }
+	// The unflushed bytes; the whole save when there is no output stream
+	const std::vector<char>& data() const { return buffer; }
+	// Moves the unflushed bytes out, leaving the writer empty
+	std::vector<char> take_data() { std::vector<char> bytes; bytes.swap(buffer); return bytes; }
+	bool good() const { return out == nullptr || out->good(); }
+
+private:
+	void flush();
+	void patch_u32(size_t offset, uint32_t value);
+
+	std::ostream* out;
+	std::vector<char> buffer;
+	size_t flushed = 0;        // bytes already handed to out
+	size_t section_start = 0;  // offset of the open section's length field
+	bool in_section = false;
+};
+
+// Reader for saves written by SaveWriter, over bytes already in memory. Reading past the end of
+// the data or the current section, a bad magic or a newer version throw std::runtime_error.
+class SaveReader
+{
+public:
+	SaveReader(const char* data, size_t size);
+
+	// Checks magic and version; call first
+	void read_header();
+	// Moves to the next section, skipping whatever is left of the current one, and returns its tag
+	SaveSection next_section();
+
+	uint8_t read_u8();
+	bool read_bool() { return read_u8() != 0; }
+	uint32_t read_u32();
+	int32_t read_i32() { return (int32_t)read_u32(); }
+	float read_f32();
+	vec2 read_vec2() { float x = read_f32(); return vec2(x, read_f32()); }
+	std::string read_string();
+	// Reads an element count and checks that many records of record_size bytes can follow
+	uint32_t read_count(size_t record_size);
+
+	// Version the save was written with
+	uint32_t version() const { return file_version; }
+	// True once the current section's body has been read
+	bool section_done() const { return pos >= section_end; }
+
+private:
+	void need(size_t bytes) const;
+
+	const char* bytes;
+	size_t size;
+	size_t pos = 0;
+	size_t section_end = 0;
+	uint32_t file_version = 0;
+};
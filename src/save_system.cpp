@@ -1,23 +1,123 @@
 #include "save_system.hpp"
+#include "chunk_region_store.hpp"
+#include "save_stream.hpp"
 #include "world_system.hpp"
 
+#include <algorithm>
+#include <cstdio>
 #include <fstream>
 #include <iostream>
+#include <vector>
 
 #ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
 #include <direct.h>
+#include <io.h>
 #define MKDIR(path) _mkdir(path)
+#define FSYNC(fd) _commit(fd)
 #else
 #include <sys/stat.h>
+#include <unistd.h>
 #define MKDIR(path) mkdir(path, 0755)
+#define FSYNC(fd) fsync(fd)
 #endif
 
+using Clock = std::chrono::steady_clock;
+
+static float elapsed_ms_since(Clock::time_point start)
+{
+	return (float)(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start)).count() / 1000;
+}
+
 SaveSystem::SaveSystem()
 {
+	worker = std::thread(&SaveSystem::worker_loop, this);
 }
 
 SaveSystem::~SaveSystem()
 {
+	// a save queued on the way out still gets written
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	work_ready.notify_all();
+	worker.join();
+}
+
+void SaveSystem::wait_for_saves()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	work_done.wait(lock, [this] { return !pending && !running; });
+}
+
+void SaveSystem::worker_loop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		work_ready.wait(lock, [this] { return stopping || pending; });
+		if (!pending)
+			return;
+
+		running = std::move(pending);
+		lock.unlock();
+
+		const SaveJob& job = *running;
+		const bool written = write_file_atomically(job.filepath, job.bytes);
+		if (written)
+		{
+			// an older JSON save would otherwise be picked up if this one is deleted
+			std::remove(job.json_filepath.c_str());
+			printf("Game saved successfully to: %s (%zu bytes, snapshot %.2f ms, total %.2f ms)\n",
+			       job.filepath.c_str(), job.bytes.size(), job.snapshot_ms, elapsed_ms_since(job.start));
+		}
+
+		lock.lock();
+		if (written)
+		{
+			saved_regions_known = true;
+			saved_regions_world = job.regions_world;
+		}
+		running.reset();
+		work_done.notify_all();
+	}
+}
+
+bool SaveSystem::write_file_atomically(const std::string& filepath, const std::vector<char>& bytes)
+{
+	const std::string temp_filepath = filepath + ".tmp";
+	FILE* file = fopen(temp_filepath.c_str(), "wb");
+	if (!file)
+	{
+		fprintf(stderr, "Failed to open save file for writing: %s\n", temp_filepath.c_str());
+		return false;
+	}
+
+	bool ok = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+	// the data has to reach the disk before the rename can
+	ok = ok && fflush(file) == 0 && FSYNC(fileno(file)) == 0;
+	ok = fclose(file) == 0 && ok;
+	if (!ok)
+	{
+		fprintf(stderr, "Failed to write save file: %s\n", temp_filepath.c_str());
+		std::remove(temp_filepath.c_str());
+		return false;
+	}
+
+#ifdef _WIN32
+	ok = MoveFileExA(temp_filepath.c_str(), filepath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	ok = std::rename(temp_filepath.c_str(), filepath.c_str()) == 0;
+#endif
+	if (!ok)
+	{
+		fprintf(stderr, "Failed to replace save file: %s\n", filepath.c_str());
+		std::remove(temp_filepath.c_str());
+	}
+	return ok;
 }
 
 std::string SaveSystem::get_save_directory() const
@@ -25,7 +125,17 @@ std::string SaveSystem::get_save_directory() const
 	return data_path() + "/saves";
 }
 
+std::string SaveSystem::get_region_directory() const
+{
+	return get_save_directory() + "/regions";
+}
+
 std::string SaveSystem::get_save_filepath(const std::string& save_name) const
+{
+	return get_save_directory() + "/" + save_name + ".sav";
+}
+
+std::string SaveSystem::get_json_filepath(const std::string& save_name) const
 {
 	return get_save_directory() + "/" + save_name + ".json";
 }
@@ -39,21 +149,59 @@ bool SaveSystem::ensure_save_directory_exists() const
 	{
 		MKDIR(save_dir.c_str());
 	}
+	std::ifstream region_test(get_region_directory());
+	if (!region_test.good())
+	{
+		MKDIR(get_region_directory().c_str());
+	}
 
 	return true;
 }
 
 bool SaveSystem::has_save_file(const std::string& save_name) const
 {
-	std::string filepath = get_save_filepath(save_name);
-	std::ifstream file(filepath);
-	return file.good();
+	{
+		// a save still being written counts
+		std::lock_guard<std::mutex> lock(mutex);
+		const std::string filepath = get_save_filepath(save_name);
+		if ((pending && pending->filepath == filepath) || (running && running->filepath == filepath))
+			return true;
+	}
+
+	std::ifstream file(get_save_filepath(save_name));
+	std::ifstream json_file(get_json_filepath(save_name));
+	return file.good() || json_file.good();
 }
 
 void SaveSystem::delete_save(const std::string& save_name)
 {
-	std::string filepath = get_save_filepath(save_name);
-	std::remove(filepath.c_str());
+	// otherwise a save in flight would land right after the delete
+	wait_for_saves();
+	std::remove(get_save_filepath(save_name).c_str());
+	std::remove(get_json_filepath(save_name).c_str());
+	// only the live world's chunk regions are still needed
+	chunk_store.prune();
+	std::lock_guard<std::mutex> lock(mutex);
+	saved_regions_known = true;
+	saved_regions_world.clear();
+}
+
+void SaveSystem::prune_regions()
+{
+	// Other worlds' regions are only dropped once the save that replaced theirs is on disk, so a
+	// failed write keeps the previous save together with its evicted chunks
+	std::vector<std::string> keep_worlds;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!saved_regions_known)
+			return;
+		keep_worlds.push_back(saved_regions_world);
+		for (const std::unique_ptr<SaveJob>* job : { &pending, &running })
+			if (*job)
+				keep_worlds.push_back((*job)->regions_world);
+	}
+	keep_worlds.erase(std::remove(keep_worlds.begin(), keep_worlds.end(), std::string()), keep_worlds.end());
+	chunk_store.prune(keep_worlds);
 }
 
 
@@ -71,11 +219,61 @@ bool SaveSystem::save_game(const std::string& save_name)
 		return false;
 	}
 
+	try
+	{
+		std::unique_ptr<SaveJob> job(new SaveJob());
+		job->start = Clock::now();
+		job->filepath = get_save_filepath(save_name);
+		job->json_filepath = get_json_filepath(save_name);
+		if (chunk_store.is_open())
+			job->regions_world = chunk_store.world_prefix();
+		prune_regions();
+
+		SaveWriter writer;
+		writer.write_header();
+		world_system->write_save(writer);
+		writer.finish();
+		job->bytes = writer.take_data();
+		job->snapshot_ms = elapsed_ms_since(job->start);
+
+		printf("Save snapshot took %.2f ms (%zu bytes), writing in the background\n", job->snapshot_ms, job->bytes.size());
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			pending = std::move(job);
+		}
+		work_ready.notify_one();
+		return true;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Error saving game: " << e.what() << std::endl;
+		return false;
+	}
+}
+
+bool SaveSystem::export_json(const std::string& save_name)
+{
+	// a save still in flight removes the JSON file of its name once it lands, which would take
+	// this export with it
+	wait_for_saves();
+
+	if (!world_system)
+	{
+		std::cerr << "Cannot export: WorldSystem not set" << std::endl;
+		return false;
+	}
+
+	if (!ensure_save_directory_exists())
+	{
+		std::cerr << "Failed to create save directory" << std::endl;
+		return false;
+	}
+
 	try
 	{
 		json save_data = world_system->serialize();
 
-		std::string filepath = get_save_filepath(save_name);
+		std::string filepath = get_json_filepath(save_name);
 		std::ofstream file(filepath);
 
 		if (!file.is_open())
@@ -87,12 +285,12 @@ bool SaveSystem::save_game(const std::string& save_name)
 		file << save_data.dump(4);
 		file.close();
 
-		std::cout << "Game saved successfully to: " << filepath << std::endl;
+		std::cout << "Game exported to: " << filepath << std::endl;
 		return true;
 	}
 	catch (const std::exception& e)
 	{
-		std::cerr << "Error saving game: " << e.what() << std::endl;
+		std::cerr << "Error exporting game: " << e.what() << std::endl;
 		return false;
 	}
 }
@@ -105,15 +303,46 @@ bool SaveSystem::load_game(const std::string& save_name)
 		return false;
 	}
 
+	// load what was saved last, not what is on disk right now
+	wait_for_saves();
+
 	if (!has_save_file(save_name))
 	{
 		std::cerr << "Save file not found: " << save_name << std::endl;
 		return false;
 	}
 
+	std::string filepath = get_save_filepath(save_name);
+	std::ifstream file(filepath, std::ios::binary);
+	if (!file.is_open())
+		return load_json(get_json_filepath(save_name));
+
+	try
+	{
+		file.seekg(0, std::ios::end);
+		std::vector<char> bytes((size_t)file.tellg());
+		file.seekg(0);
+		file.read(bytes.data(), (std::streamsize)bytes.size());
+		file.close();
+
+		SaveReader reader(bytes.data(), bytes.size());
+		reader.read_header();
+		world_system->read_save(reader);
+
+		std::cout << "Game loaded successfully from: " << filepath << std::endl;
+		return true;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Error loading game: " << e.what() << std::endl;
+		return false;
+	}
+}
+
+bool SaveSystem::load_json(const std::string& filepath)
+{
 	try
 	{
-		std::string filepath = get_save_filepath(save_name);
 		std::ifstream file(filepath);
 
 		if (!file.is_open())
@@ -136,3 +365,317 @@ bool SaveSystem::load_game(const std::string& save_name)
 		return false;
 	}
 }
+
+static json iso_filter_to_json(const IsolineFilter& iso_filter)
+{
+	json iso_filter_json;
+	iso_filter_json["reconstruct_upper"] = iso_filter.reconstruct_upper;
+	iso_filter_json["reconstruct_lower"] = iso_filter.reconstruct_lower;
+	iso_filter_json["reconstruct_left"] = iso_filter.reconstruct_left;
+	iso_filter_json["reconstruct_right"] = iso_filter.reconstruct_right;
+	iso_filter_json["upper_left_cell"]["x"] = iso_filter.upper_left_cell.x;
+	iso_filter_json["upper_left_cell"]["y"] = iso_filter.upper_left_cell.y;
+	iso_filter_json["lower_right_cell"]["x"] = iso_filter.lower_right_cell.x;
+	iso_filter_json["lower_right_cell"]["y"] = iso_filter.lower_right_cell.y;
+	return iso_filter_json;
+}
+
+static bool is_saved_obstacle(Entity entity)
+{
+	return registry.motions.has(entity) && registry.obstacles.has(entity);
+}
+
+json serialize_chunks()
+{
+	json chunks = json::array();
+
+	for (size_t i = 0; i < registry.chunks.components.size(); i++)
+	{
+		Chunk& chunk = registry.chunks.components[i];
+		int x = registry.chunks.position_xs[i];
+		int y = registry.chunks.position_ys[i];
+
+		json chunk_json;
+		chunk_json["x"] = x;
+		chunk_json["y"] = y;
+		chunk_json["decorated"] = true;
+		chunk_json["trees"] = json::array();
+		chunk_json["walls"] = json::array();
+		chunk_json["iso_filters"] = json::array();
+
+		for (Entity tree_entity : chunk.trees)
+		{
+			if (is_saved_obstacle(tree_entity))
+			{
+				Motion& tree_motion = registry.motions.get(tree_entity);
+				json tree_json;
+				tree_json["position"]["x"] = tree_motion.position.x;
+				tree_json["position"]["y"] = tree_motion.position.y;
+				tree_json["scale"] = tree_motion.scale.x;
+				chunk_json["trees"].push_back(tree_json);
+			}
+		}
+		for (Entity wall_entity : chunk.walls)
+		{
+			if (is_saved_obstacle(wall_entity))
+			{
+				Motion& wall_motion = registry.motions.get(wall_entity);
+				json wall_json;
+				wall_json["position"]["x"] = wall_motion.position.x;
+				wall_json["position"]["y"] = wall_motion.position.y;
+				wall_json["scale"]["x"] = wall_motion.scale.x;
+				wall_json["scale"]["y"] = wall_motion.scale.y;
+				chunk_json["walls"].push_back(wall_json);
+			}
+		}
+		for (const IsolineFilter& iso_filter : chunk.iso_filters)
+			chunk_json["iso_filters"].push_back(iso_filter_to_json(iso_filter));
+
+		chunks.push_back(chunk_json);
+	}
+
+	for (size_t i = 0; i < registry.serial_chunks.components.size(); i++)
+	{
+		SerializedChunk& chunk = registry.serial_chunks.components[i];
+		int x = registry.serial_chunks.position_xs[i];
+		int y = registry.serial_chunks.position_ys[i];
+
+		json chunk_json;
+		chunk_json["x"] = x;
+		chunk_json["y"] = y;
+		chunk_json["decorated"] = chunk.decorated;
+		chunk_json["trees"] = json::array();
+		chunk_json["walls"] = json::array();
+		chunk_json["iso_filters"] = json::array();
+
+		for (const SerializedTree& tree : chunk.serial_trees)
+		{
+			json tree_json;
+			tree_json["position"]["x"] = tree.position.x;
+			tree_json["position"]["y"] = tree.position.y;
+			tree_json["scale"] = tree.scale;
+			chunk_json["trees"].push_back(tree_json);
+		}
+		for (const SerializedWall& wall : chunk.serial_walls)
+		{
+			json wall_json;
+			wall_json["position"]["x"] = wall.position.x;
+			wall_json["position"]["y"] = wall.position.y;
+			wall_json["scale"]["x"] = wall.scale.x;
+			wall_json["scale"]["y"] = wall.scale.y;
+			chunk_json["walls"].push_back(wall_json);
+		}
+		for (const IsolineFilter& iso_filter : chunk.iso_filters)
+			chunk_json["iso_filters"].push_back(iso_filter_to_json(iso_filter));
+
+		chunks.push_back(chunk_json);
+	}
+
+	return chunks;
+}
+
+void deserialize_chunks(const json& chunks)
+{
+	for (const auto& chunk_json : chunks)
+	{
+		int x = chunk_json["x"];
+		int y = chunk_json["y"];
+
+		// Skip if chunk already exists to handle duplicates in save file
+		if (registry.serial_chunks.has(x, y)) {
+			continue;
+		}
+
+		SerializedChunk& chunk = registry.serial_chunks.emplace(x, y);
+
+		if (chunk_json.contains("decorated")) {
+			chunk.decorated = chunk_json["decorated"];
+		} else {
+			chunk.decorated = true;
+		}
+
+		for (const auto& tree_json : chunk_json["trees"])
+		{
+			SerializedTree tree;
+			tree.position.x = tree_json["position"]["x"];
+			tree.position.y = tree_json["position"]["y"];
+			tree.scale = tree_json["scale"];
+			chunk.serial_trees.push_back(tree);
+		}
+
+		if (chunk_json.contains("walls")) {
+			for (const auto& wall_json : chunk_json["walls"])
+			{
+				SerializedWall wall;
+				wall.position.x = wall_json["position"]["x"];
+				wall.position.y = wall_json["position"]["y"];
+				wall.scale.x = wall_json["scale"]["x"];
+				wall.scale.y = wall_json["scale"]["y"];
+				chunk.serial_walls.push_back(wall);
+			}
+		}
+		if (chunk_json.contains("iso_filters")) {
+			for (const auto& iso_filter_json : chunk_json["iso_filters"])
+			{
+				IsolineFilter iso_filter;
+				iso_filter.reconstruct_upper = iso_filter_json["reconstruct_upper"];
+				iso_filter.reconstruct_lower = iso_filter_json["reconstruct_lower"];
+				iso_filter.reconstruct_left = iso_filter_json["reconstruct_left"];
+				iso_filter.reconstruct_right = iso_filter_json["reconstruct_right"];
+				iso_filter.upper_left_cell.x = iso_filter_json["upper_left_cell"]["x"];
+				iso_filter.upper_left_cell.y = iso_filter_json["upper_left_cell"]["y"];
+				iso_filter.lower_right_cell.x = iso_filter_json["lower_right_cell"]["x"];
+				iso_filter.lower_right_cell.y = iso_filter_json["lower_right_cell"]["y"];
+				chunk.iso_filters.push_back(iso_filter);
+			}
+		}
+	}
+}
+
+// Chunk record layout, shared by both chunk sections; region files store it without x and y:
+//   i32 x, i32 y, bool decorated,
+//   u32 tree count, per tree: vec2 position, f32 scale
+//   u32 wall count, per wall: vec2 position, vec2 scale
+//   u32 filter count, per filter: u8 reconstruct flags (upper, lower, left, right), vec2 upper left, vec2 lower right
+static void write_iso_filters(SaveWriter& out, const std::vector<IsolineFilter>& iso_filters)
+{
+	out.write_u32((uint32_t)iso_filters.size());
+	for (const IsolineFilter& iso_filter : iso_filters)
+	{
+		out.write_u8((uint8_t)(iso_filter.reconstruct_upper | iso_filter.reconstruct_lower << 1 |
+			iso_filter.reconstruct_left << 2 | iso_filter.reconstruct_right << 3));
+		out.write_vec2(iso_filter.upper_left_cell);
+		out.write_vec2(iso_filter.lower_right_cell);
+	}
+}
+
+void write_chunk_sections(SaveWriter& out)
+{
+	out.begin_section(SaveSection::CHUNKS);
+	out.write_u32((uint32_t)registry.chunks.components.size());
+	for (size_t i = 0; i < registry.chunks.components.size(); i++)
+	{
+		const Chunk& chunk = registry.chunks.components[i];
+		out.write_i32(registry.chunks.position_xs[i]);
+		out.write_i32(registry.chunks.position_ys[i]);
+		out.write_bool(true);
+
+		uint32_t tree_count = 0;
+		for (Entity tree_entity : chunk.trees)
+			tree_count += is_saved_obstacle(tree_entity);
+		out.write_u32(tree_count);
+		for (Entity tree_entity : chunk.trees)
+		{
+			if (!is_saved_obstacle(tree_entity))
+				continue;
+			const Motion& tree_motion = registry.motions.get(tree_entity);
+			out.write_vec2(tree_motion.position);
+			out.write_f32(tree_motion.scale.x);
+		}
+
+		uint32_t wall_count = 0;
+		for (Entity wall_entity : chunk.walls)
+			wall_count += is_saved_obstacle(wall_entity);
+		out.write_u32(wall_count);
+		for (Entity wall_entity : chunk.walls)
+		{
+			if (!is_saved_obstacle(wall_entity))
+				continue;
+			const Motion& wall_motion = registry.motions.get(wall_entity);
+			out.write_vec2(wall_motion.position);
+			out.write_vec2(wall_motion.scale);
+		}
+
+		write_iso_filters(out, chunk.iso_filters);
+	}
+	out.end_section();
+
+	// chunks with a record in the region files are only referenced, through the save's own copy
+	// of the offset tables; the rest go inline rather than being written out to the region files
+	// here, so the snapshot does no file I/O on the game thread
+	const auto& serial_chunks = registry.serial_chunks;
+	uint32_t inline_count = 0;
+	for (size_t i = 0; i < serial_chunks.components.size(); i++)
+		inline_count += !chunk_store.is_stored(serial_chunks.position_xs[i], serial_chunks.position_ys[i]);
+
+	out.begin_section(SaveSection::SERIAL_CHUNKS);
+	out.write_u32(inline_count);
+	for (size_t i = 0; i < serial_chunks.components.size(); i++)
+	{
+		if (chunk_store.is_stored(serial_chunks.position_xs[i], serial_chunks.position_ys[i]))
+			continue;
+		out.write_i32(serial_chunks.position_xs[i]);
+		out.write_i32(serial_chunks.position_ys[i]);
+		write_serialized_chunk(out, serial_chunks.components[i]);
+	}
+	out.end_section();
+
+	if (chunk_store.is_open())
+	{
+		out.begin_section(SaveSection::REGIONS);
+		chunk_store.write_tables(out);
+		out.end_section();
+	}
+}
+
+void write_serialized_chunk(SaveWriter& out, const SerializedChunk& chunk)
+{
+	out.write_bool(chunk.decorated);
+	out.write_u32((uint32_t)chunk.serial_trees.size());
+	for (const SerializedTree& tree : chunk.serial_trees)
+	{
+		out.write_vec2(tree.position);
+		out.write_f32(tree.scale);
+	}
+	out.write_u32((uint32_t)chunk.serial_walls.size());
+	for (const SerializedWall& wall : chunk.serial_walls)
+	{
+		out.write_vec2(wall.position);
+		out.write_vec2(wall.scale);
+	}
+	write_iso_filters(out, chunk.iso_filters);
+}
+
+void read_serialized_chunk(SaveReader& in, SerializedChunk& chunk)
+{
+	chunk.decorated = in.read_bool();
+	chunk.serial_trees.resize(in.read_count(12));
+	for (SerializedTree& tree : chunk.serial_trees)
+	{
+		tree.position = in.read_vec2();
+		tree.scale = in.read_f32();
+	}
+	chunk.serial_walls.resize(in.read_count(16));
+	for (SerializedWall& wall : chunk.serial_walls)
+	{
+		wall.position = in.read_vec2();
+		wall.scale = in.read_vec2();
+	}
+	chunk.iso_filters.resize(in.read_count(17));
+	for (IsolineFilter& iso_filter : chunk.iso_filters)
+	{
+		const uint8_t flags = in.read_u8();
+		iso_filter.reconstruct_upper = (flags & 1) != 0;
+		iso_filter.reconstruct_lower = (flags & 2) != 0;
+		iso_filter.reconstruct_left = (flags & 4) != 0;
+		iso_filter.reconstruct_right = (flags & 8) != 0;
+		iso_filter.upper_left_cell = in.read_vec2();
+		iso_filter.lower_right_cell = in.read_vec2();
+	}
+}
+
+void read_chunk_section(SaveReader& in)
+{
+	// x, y and decorated, then the three counts
+	const uint32_t chunk_count = in.read_count(21);
+	SerializedChunk scratch;
+	for (uint32_t c = 0; c < chunk_count; c++)
+	{
+		const int x = in.read_i32();
+		const int y = in.read_i32();
+
+		// a duplicate is still read through, into a chunk that is thrown away
+		const bool duplicate = registry.serial_chunks.has(x, y);
+		read_serialized_chunk(in, duplicate ? scratch : registry.serial_chunks.emplace(x, y));
+	}
+}
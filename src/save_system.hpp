@@ -2,11 +2,21 @@
 
 #include "common.hpp"
 #include <json.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 using json = nlohmann::json;
 
 class WorldSystem;
+class SaveWriter;
+class SaveReader;
+struct SerializedChunk;
 
 class SaveSystem
 {
@@ -14,17 +24,70 @@ public:
 	SaveSystem();
 	~SaveSystem();
 
+	// Saves are binary (save_stream.hpp); a JSON save of the same name is still loaded when there is no binary one.
+	// save_game only snapshots the world into memory on the calling thread; a worker thread writes the
+	// snapshot to a temporary file and renames it over the save, so a crash mid-write keeps the old save.
+	// A newer snapshot replaces one still waiting for the worker.
 	bool save_game(const std::string& save_name = "savegame");
 	bool load_game(const std::string& save_name = "savegame");
+	// Blocks until every queued save is on disk
+	void wait_for_saves();
+	// Readable JSON copy of the current game, for debugging
+	bool export_json(const std::string& save_name = "savegame");
 	bool has_save_file(const std::string& save_name = "savegame") const;
 	void delete_save(const std::string& save_name = "savegame");
 
 	void set_world_system(WorldSystem* world) { world_system = world; }
 
+	// Region files of the chunk region store; created along with the save directory
+	std::string get_region_directory() const;
+	bool ensure_save_directory_exists() const;
+
 private:
 	std::string get_save_directory() const;
 	std::string get_save_filepath(const std::string& save_name) const;
-	bool ensure_save_directory_exists() const;
+	std::string get_json_filepath(const std::string& save_name) const;
+	bool load_json(const std::string& filepath);
+
+	struct SaveJob {
+		std::string filepath;
+		std::string json_filepath;  // removed once the binary save is in place
+		std::string regions_world;  // world_prefix of the region files the save shares, if any
+		std::vector<char> bytes;
+		float snapshot_ms = 0.f;
+		std::chrono::steady_clock::time_point start;
+	};
+
+	void worker_loop();
+	// Deletes the region files no save on disk or in flight and not the live world refers to
+	void prune_regions();
+	static bool write_file_atomically(const std::string& filepath, const std::vector<char>& bytes);
 
 	WorldSystem* world_system = nullptr;
+
+	std::thread worker;
+	mutable std::mutex mutex;
+	std::condition_variable work_ready;
+	std::condition_variable work_done;
+	bool stopping = false;
+
+	// Guarded by `mutex`
+	std::unique_ptr<SaveJob> pending;  // next snapshot to write
+	std::unique_ptr<SaveJob> running;  // snapshot being written
+	// Regions of the save last written successfully; until one is, the save on disk is unknown
+	bool saved_regions_known = false;
+	std::string saved_regions_world;
 };
+
+// Chunk records, shared by WorldSystem's save paths and the save benchmark. Loaded chunks are
+// saved from their live tree and wall entities; every chunk loads back as a SerializedChunk.
+json serialize_chunks();
+void deserialize_chunks(const json& chunks);
+// Writes the CHUNKS section, SERIAL_CHUNKS with the serialized chunks that have no record in the
+// chunk region store, and REGIONS with the store's offset tables when it is open
+void write_chunk_sections(SaveWriter& out);
+// Reads the body of either chunk section
+void read_chunk_section(SaveReader& in);
+// A SerializedChunk's record without its position, as stored in chunk sections and region files
+void write_serialized_chunk(SaveWriter& out, const SerializedChunk& chunk);
+void read_serialized_chunk(SaveReader& in, SerializedChunk& chunk);
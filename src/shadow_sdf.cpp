@@ -0,0 +1,151 @@
+// internal
+#include "shadow_sdf.hpp"
+#include "tiny_ecs_registry.hpp"
+
+// stlib
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+bool is_sdf_resolution_divisor(int divisor)
+{
+	for (int d : SDF_RESOLUTION_DIVISORS)
+		if (d == divisor)
+			return true;
+	return false;
+}
+
+ivec2 sdf_target_size(ivec2 framebuffer_size, int divisor)
+{
+	return (framebuffer_size + ivec2(divisor - 1)) / divisor;
+}
+
+// FNV-1a over 8-byte words rather than bytes; the instance array is the bulk of it
+static uint64_t hash_bytes(uint64_t hash, const void* data, size_t size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	size_t i = 0;
+	for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+		uint64_t word;
+		memcpy(&word, bytes + i, sizeof(word));
+		hash ^= word;
+		hash *= 1099511628211ull;
+	}
+	for (; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+template <class T>
+static uint64_t hash_value(uint64_t hash, const T& value)
+{
+	return hash_bytes(hash, &value, sizeof(value));
+}
+
+uint64_t occluder_signature(const SpriteBatchBuilder& sprites, const std::vector<unsigned int>& chunk_ids)
+{
+	uint64_t hash = 14695981039346656037ull;
+	const std::vector<SpriteInstance>& instances = sprites.instances();
+	if (!instances.empty())
+		hash = hash_bytes(hash, instances.data(), instances.size() * sizeof(SpriteInstance));
+
+	for (const SpriteBatch& batch : sprites.batches()) {
+		hash = hash_value(hash, batch.key);
+		if (batch.instanced)
+			continue;
+		// drawn through drawTexturedMesh, from its components
+		const Entity entity = batch.entity;
+		const Motion& motion = registry.motions.get(entity);
+		hash = hash_value(hash, motion.position);
+		hash = hash_value(hash, motion.scale);
+		hash = hash_value(hash, motion.angle);
+		if (registry.sprites.has(entity)) {
+			const Sprite& sprite = registry.sprites.get(entity);
+			hash = hash_value(hash, sprite.curr_frame);
+			hash = hash_value(hash, sprite.curr_row);
+		}
+		// trails fade out, and the seed pass only keeps texels above half alpha
+		if (registry.trails.has(entity))
+			hash = hash_value(hash, registry.trails.get(entity).alpha);
+	}
+
+	for (unsigned int id : chunk_ids)
+		hash = hash_value(hash, id);
+	return hash;
+}
+
+bool SdfCache::can_reuse(uint64_t signature, vec2 camera, ivec2 sdf_size, int divisor) const
+{
+	if (!valid || signature != generated_signature || sdf_size != generated_size)
+		return false;
+	const vec2 moved = abs(camera - generated_camera);
+	return moved.x < (float)divisor && moved.y < (float)divisor;
+}
+
+void SdfCache::store(uint64_t signature, vec2 camera, ivec2 sdf_size)
+{
+	valid = true;
+	generated_signature = signature;
+	generated_camera = camera;
+	generated_size = sdf_size;
+}
+
+void SdfProfiler::start(int frames)
+{
+	frames_per_option = frames;
+	option = 0;
+	frame = 0;
+	for (Totals& t : totals)
+		t = Totals();
+}
+
+SdfOptions SdfProfiler::current() const
+{
+	SdfOptions options;
+	options.divisor = SDF_RESOLUTION_DIVISORS[option / 2];
+	options.cache = option % 2 == 1;
+	return options;
+}
+
+void SdfProfiler::record_frame(bool regenerated)
+{
+	if (!active())
+		return;
+	if (frame >= WARMUP_FRAMES) {
+		totals[option].frames++;
+		totals[option].regenerated += regenerated;
+	}
+	if (++frame < frames_per_option)
+		return;
+
+	frame = 0;
+	if (++option == OPTION_COUNT) {
+		print();
+		for (Totals& t : totals)
+			t = Totals();
+		option = 0;
+	}
+}
+
+void SdfProfiler::record_gpu_ms(float ms)
+{
+	if (!active() || frame < WARMUP_FRAMES)
+		return;
+	totals[option].gpu_samples++;
+	totals[option].gpu_ms += ms;
+}
+
+void SdfProfiler::print() const
+{
+	printf("[sdf profile] %d frames per option\n", frames_per_option);
+	printf("  %-8s %-6s %12s %14s %16s\n", "divisor", "cache", "regenerated", "SDF GPU ms", "GPU ms/frame");
+	for (int i = 0; i < OPTION_COUNT; i++) {
+		const Totals& t = totals[i];
+		const float regenerated = t.frames ? (float)t.regenerated / t.frames : 0.f;
+		const float pass_ms = t.gpu_samples ? (float)(t.gpu_ms / t.gpu_samples) : 0.f;
+		printf("  %-8d %-6s %11.1f%% %14.3f %16.3f\n", SDF_RESOLUTION_DIVISORS[i / 2], i % 2 ? "on" : "off",
+			100.f * regenerated, pass_ms, pass_ms * regenerated);
+	}
+}
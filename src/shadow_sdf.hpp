@@ -0,0 +1,90 @@
+#pragma once
+
+#include "common.hpp"
+#include "sprite_batch.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// Divisors of the framebuffer size the shadow SDF can be generated at
+const int SDF_RESOLUTION_DIVISORS[] = { 1, 2, 4 };
+const int SDF_RESOLUTION_DIVISOR_COUNT = 3;
+bool is_sdf_resolution_divisor(int divisor);
+
+// Size of the SDF render targets for a framebuffer, rounded up so the edge pixels are covered
+ivec2 sdf_target_size(ivec2 framebuffer_size, int divisor);
+
+// Fingerprint of everything the SDF seed pass sees: the scene sprite batches (instances are in world
+// space, so a camera move alone leaves it unchanged), the entities drawn one at a time, and the chunks
+// whose baked rock was drawn. The grass is left out; it writes no occluder alpha.
+uint64_t occluder_signature(const SpriteBatchBuilder& sprites, const std::vector<unsigned int>& chunk_ids);
+
+// Decides when the lighting pass can reuse the SDF it generated on an earlier frame. The SDF is in
+// screen space, so it stays valid while no occluder changed and the camera has not moved a whole
+// SDF texel since; the point light shader shifts its lookups by offset() to cover the sub-texel part.
+class SdfCache
+{
+public:
+	// camera is the camera position in framebuffer pixels
+	bool can_reuse(uint64_t signature, vec2 camera, ivec2 sdf_size, int divisor) const;
+	void store(uint64_t signature, vec2 camera, ivec2 sdf_size);
+	void invalidate() { valid = false; }
+
+	// Pixels the view has moved since the cached SDF was generated
+	vec2 offset(vec2 camera) const { return valid ? camera - generated_camera : vec2(0.f); }
+
+	// Frames that reused the SDF and that generated it, since the last reset
+	size_t hit_count() const { return hits; }
+	size_t miss_count() const { return misses; }
+	void count(bool hit) { hit ? hits++ : misses++; }
+	void reset_counts() { hits = misses = 0; }
+
+private:
+	bool valid = false;
+	uint64_t generated_signature = 0;
+	vec2 generated_camera = { 0.f, 0.f };
+	ivec2 generated_size = { 0, 0 };
+	size_t hits = 0;
+	size_t misses = 0;
+};
+
+// One combination of the SDF options
+struct SdfOptions {
+	int divisor = 1;
+	bool cache = true;
+};
+
+// Frame-by-frame comparison of the SDF options in a running game: steps through every resolution
+// divisor with the cache off and on, frames_per_option frames each, and prints the GPU time the SDF
+// passes took under each. The GPU timings arrive a few frames late and are credited to the option
+// current when they come in, so the first frames of each option are left out.
+class SdfProfiler
+{
+public:
+	void start(int frames_per_option);
+	bool active() const { return frames_per_option > 0; }
+	SdfOptions current() const;
+
+	// One frame under current(); regenerated is whether it ran the SDF passes
+	void record_frame(bool regenerated);
+	// A finished GPU measurement of the SDF passes
+	void record_gpu_ms(float ms);
+
+private:
+	static const int OPTION_COUNT = SDF_RESOLUTION_DIVISOR_COUNT * 2;
+	static const int WARMUP_FRAMES = 8;
+
+	struct Totals {
+		int frames = 0;
+		int regenerated = 0;
+		int gpu_samples = 0;
+		double gpu_ms = 0.0;
+	};
+
+	int frames_per_option = 0;
+	int option = 0;
+	int frame = 0;
+	Totals totals[OPTION_COUNT];
+
+	void print() const;
+};
@@ -0,0 +1,58 @@
+// internal
+#include "spatial_grid.hpp"
+
+#include <cmath>
+
+void SpatialGrid::clear()
+{
+	entries.clear();
+	sorted.clear();
+	bucket_start.clear();
+}
+
+void SpatialGrid::clear(float new_cell_size)
+{
+	clear();
+	cell_size = new_cell_size;
+	inv_cell_size = 1.f / new_cell_size;
+}
+
+int SpatialGrid::cell_coord(float v) const
+{
+	return (int)std::floor(v * inv_cell_size);
+}
+
+void SpatialGrid::insert(unsigned int item, glm::vec2 min, glm::vec2 max)
+{
+	const int min_cx = cell_coord(min.x), max_cx = cell_coord(max.x);
+	const int min_cy = cell_coord(min.y), max_cy = cell_coord(max.y);
+	for (int cy = min_cy; cy <= max_cy; cy++)
+		for (int cx = min_cx; cx <= max_cx; cx++)
+			entries.push_back({ cx, cy, item });
+}
+
+void SpatialGrid::insert(unsigned int item, glm::vec2 point)
+{
+	entries.push_back({ cell_coord(point.x), cell_coord(point.y), item });
+}
+
+void SpatialGrid::build()
+{
+	// keep the table at least twice the entry count so buckets stay short
+	unsigned int bucket_count = 64;
+	while (bucket_count < entries.size() * 2)
+		bucket_count <<= 1;
+	bucket_mask = bucket_count - 1;
+
+	// counting sort: histogram, exclusive prefix sum, scatter
+	bucket_start.assign(bucket_count + 1, 0);
+	for (const Entry& entry : entries)
+		bucket_start[bucket_of(entry.cx, entry.cy) + 1]++;
+	for (unsigned int b = 0; b < bucket_count; b++)
+		bucket_start[b + 1] += bucket_start[b];
+
+	sorted.resize(entries.size());
+	bucket_cursor.assign(bucket_start.begin(), bucket_start.end() - 1);
+	for (const Entry& entry : entries)
+		sorted[bucket_cursor[bucket_of(entry.cx, entry.cy)]++] = entry;
+}
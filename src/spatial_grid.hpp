@@ -0,0 +1,126 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/vec2.hpp>
+
+// A uniform grid over world space that is rebuilt from scratch every frame.
+// Items are registered with insert(), then build() buckets them by hashed cell using a
+// counting sort, so a rebuild is linear in the number of items and the whole grid lives
+// in two flat arrays. Items are plain indices into whatever array the caller owns.
+class SpatialGrid
+{
+public:
+	explicit SpatialGrid(float cell_size = 64.f) : cell_size(cell_size), inv_cell_size(1.f / cell_size) {}
+
+	// Drop all items and optionally change the cell size
+	void clear();
+	void clear(float new_cell_size);
+
+	// Register an item that occupies the box [min, max]; it lands in every cell the box touches
+	void insert(unsigned int item, glm::vec2 min, glm::vec2 max);
+	// Register an item that occupies a single point
+	void insert(unsigned int item, glm::vec2 point);
+
+	// Sort the inserted items into their buckets; call once after the last insert and before any query
+	void build();
+
+	// Calls func(item) for every item sharing a cell with the box [min, max].
+	// An item covering several cells may be reported once per shared cell, so callers that
+	// need unique results should de-duplicate.
+	template <typename Func>
+	void query(glm::vec2 min, glm::vec2 max, Func&& func) const
+	{
+		if (bucket_start.empty())
+			return;
+		const int min_cx = cell_coord(min.x), max_cx = cell_coord(max.x);
+		const int min_cy = cell_coord(min.y), max_cy = cell_coord(max.y);
+		for (int cy = min_cy; cy <= max_cy; cy++) {
+			for (int cx = min_cx; cx <= max_cx; cx++) {
+				const unsigned int bucket = bucket_of(cx, cy);
+				for (unsigned int k = bucket_start[bucket]; k < bucket_start[bucket + 1]; k++) {
+					const Entry& entry = sorted[k];
+					// different cells can hash into the same bucket
+					if (entry.cx == cx && entry.cy == cy)
+						func(entry.item);
+				}
+			}
+		}
+	}
+
+	// Calls func(item) for every item whose cell overlaps the circle's bounding box
+	template <typename Func>
+	void query_radius(glm::vec2 center, float radius, Func&& func) const
+	{
+		query(center - glm::vec2(radius), center + glm::vec2(radius), func);
+	}
+
+	float get_cell_size() const { return cell_size; }
+	size_t entry_count() const { return entries.size(); }
+
+private:
+	struct Entry {
+		int cx;
+		int cy;
+		unsigned int item;
+	};
+
+	float cell_size;
+	float inv_cell_size;
+
+	std::vector<Entry> entries;                 // in insertion order
+	std::vector<Entry> sorted;                  // grouped by bucket after build()
+	std::vector<unsigned int> bucket_start;     // bucket b holds sorted[bucket_start[b], bucket_start[b + 1])
+	std::vector<unsigned int> bucket_cursor;    // scratch for the scatter pass, kept to avoid reallocating
+	unsigned int bucket_mask = 0;
+
+	int cell_coord(float v) const;
+	unsigned int bucket_of(int cx, int cy) const
+	{
+		// large primes from Teschner et al., "Optimized Spatial Hashing for Collision Detection"
+		return ((unsigned int)cx * 73856093u ^ (unsigned int)cy * 19349663u) & bucket_mask;
+	}
+};
+
+// Points bucketed into a SpatialGrid, for exact "everything within r" queries such as flocking.
+// Points are added in order and referred to by that index, so callers keep their per-point data
+// (entity, velocity, ...) in parallel arrays. Any number of points may share a cell.
+class NeighborGrid
+{
+public:
+	// Queries are cheapest when the cell size is about the usual query radius
+	explicit NeighborGrid(float cell_size = 64.f) : grid(cell_size) {}
+
+	void clear() { grid.clear(); points.clear(); }
+	void clear(float new_cell_size) { grid.clear(new_cell_size); points.clear(); }
+
+	// Adds a point and returns its index; call build() after the last one
+	unsigned int add(glm::vec2 point)
+	{
+		const unsigned int index = (unsigned int)points.size();
+		points.push_back(point);
+		grid.insert(index, point);
+		return index;
+	}
+
+	void build() { grid.build(); }
+
+	// Calls func(index) for every point within radius of center, the point at center included
+	template <typename Func>
+	void query_radius(glm::vec2 center, float radius, Func&& func) const
+	{
+		const float radius_sq = radius * radius;
+		grid.query_radius(center, radius, [&](unsigned int index) {
+			const glm::vec2 d = points[index] - center;
+			if (d.x * d.x + d.y * d.y <= radius_sq)
+				func(index);
+		});
+	}
+
+	const glm::vec2& point(unsigned int index) const { return points[index]; }
+	size_t size() const { return points.size(); }
+
+private:
+	SpatialGrid grid;
+	std::vector<glm::vec2> points;
+};
@@ -0,0 +1,233 @@
+// internal
+#include "sprite_batch.hpp"
+#include "tiny_ecs_registry.hpp"
+
+// stlib
+#include <algorithm>
+
+// Overlap grid used by assign_layers; cells grow when the sprites are spread wider than the grid
+const float LAYER_CELL_SIZE = 32.f;
+const int LAYER_GRID_MAX_SIDE = 256;
+const unsigned int UNIQUE_CODE_BIT = 0x80000000u;
+const unsigned int NO_CODE = 0xFFFFFFFFu; // matches LayerCell::top_code of an empty cell
+
+static bool same_key(const SpriteBatchKey& a, const SpriteBatchKey& b)
+{
+	return a.effect == b.effect && a.texture == b.texture && a.geometry == b.geometry;
+}
+
+static bool key_less(const SpriteBatchKey& a, const SpriteBatchKey& b)
+{
+	if (a.effect != b.effect)
+		return a.effect < b.effect;
+	if (a.texture != b.texture)
+		return a.texture < b.texture;
+	return a.geometry < b.geometry;
+}
+
+TextureAtlasTable::TextureAtlasTable()
+{
+	for (int i = 0; i < texture_count; i++) {
+		bind_as[i] = (TEXTURE_ASSET_ID)i;
+		uv_rects[i] = { 0.f, 0.f, 1.f, 1.f };
+	}
+}
+
+void TextureAtlasTable::assign(const std::vector<TEXTURE_ASSET_ID>& textures, const AtlasLayout& layout)
+{
+	std::vector<int> page_owner(layout.page_sizes.size(), -1);
+	for (size_t i = 0; i < textures.size(); i++) {
+		const AtlasPlacement& placement = layout.placements[i];
+		if (placement.page < 0)
+			continue;
+		const size_t id = (size_t)textures[i];
+		if (page_owner[placement.page] < 0)
+			page_owner[placement.page] = (int)id;
+		const vec2 page_size = layout.page_sizes[placement.page];
+		bind_as[id] = (TEXTURE_ASSET_ID)page_owner[placement.page];
+		uv_rects[id] = vec4(vec2(placement.position) / page_size, vec2(placement.size) / page_size);
+	}
+}
+
+bool is_atlas_texture(TEXTURE_ASSET_ID id)
+{
+	return (id >= TEXTURE_ASSET_ID::XY_CRAB && id <= TEXTURE_ASSET_ID::PLANT_DEATH_3) ||
+		(id >= TEXTURE_ASSET_ID::ENEMY1 && id <= TEXTURE_ASSET_ID::ENEMY1_DMG3);
+}
+
+void SpriteBatchBuilder::clear()
+{
+	items.clear();
+	queued_instances.clear();
+	out_batches.clear();
+	out_instances.clear();
+}
+
+void SpriteBatchBuilder::add(const SpriteBatchKey& key, const SpriteInstance& instance, vec2 center, vec2 half_extent)
+{
+	Item item;
+	item.key = key;
+	item.min = center - half_extent;
+	item.max = center + half_extent;
+	item.instance = (unsigned int)queued_instances.size();
+	queued_instances.push_back(instance);
+	items.push_back(item);
+}
+
+void SpriteBatchBuilder::add_entity(Entity entity, const RenderRequest& request, const Motion& motion)
+{
+	SpriteBatchKey key;
+	key.effect = request.used_effect;
+	key.texture = request.used_texture;
+	key.geometry = request.used_geometry;
+
+	if (request.used_effect != EFFECT_ASSET_ID::TEXTURED || !registry.sprites.has(entity)) {
+		Item item;
+		item.key = key;
+		item.instanced = false;
+		item.entity = entity;
+		// as generous as the off-screen test, since these meshes are not all unit quads
+		item.min = motion.position - abs(motion.scale);
+		item.max = motion.position + abs(motion.scale);
+		items.push_back(item);
+		return;
+	}
+
+	// same transform as drawTexturedMesh; enemy sprites are not rotated
+	const Sprite& sprite = registry.sprites.get(entity);
+	const bool rotated = !registry.enemies.has(entity);
+	Transform transform;
+	transform.translate(motion.position);
+	if (rotated)
+		transform.rotate(motion.angle);
+	transform.scale(motion.scale);
+
+	bool is_hurt = false;
+	if (registry.enemies.has(entity))
+		is_hurt = registry.enemies.get(entity).is_hurt;
+	else if (registry.boss_parts.has(entity))
+		is_hurt = registry.boss_parts.get(entity).is_hurt;
+
+	SpriteInstance instance;
+	instance.transform[0] = transform.mat[0];
+	instance.transform[1] = transform.mat[1];
+	instance.transform[2] = transform.mat[2];
+	instance.frame = { (float)sprite.curr_frame, (float)sprite.total_frame, (float)sprite.curr_row, (float)sprite.total_row };
+	instance.flags = { sprite.should_flip ? 1.f : 0.f, is_hurt ? 1.f : 0.f };
+	instance.uv_rect = { 0.f, 0.f, 1.f, 1.f };
+	if (atlas) {
+		instance.uv_rect = atlas->uv_rects[(size_t)request.used_texture];
+		key.texture = atlas->bind_as[(size_t)request.used_texture];
+	}
+
+	// the unit quad spans +-0.5; a rotated one fits in the circle around its corners
+	vec2 half_extent = rotated ? vec2(0.5f * length(motion.scale)) : 0.5f * abs(motion.scale);
+	add(key, instance, motion.position, half_extent);
+}
+
+void SpriteBatchBuilder::assign_layers()
+{
+	if (items.empty())
+		return;
+
+	vec2 world_min = items[0].min, world_max = items[0].max;
+	for (const Item& item : items) {
+		world_min = min(world_min, item.min);
+		world_max = max(world_max, item.max);
+	}
+	vec2 extent = world_max - world_min;
+	float cell_size = std::max(LAYER_CELL_SIZE, std::max(extent.x, extent.y) / LAYER_GRID_MAX_SIDE);
+	int side_x = std::min(LAYER_GRID_MAX_SIDE, (int)(extent.x / cell_size) + 1);
+	int side_y = std::min(LAYER_GRID_MAX_SIDE, (int)(extent.y / cell_size) + 1);
+	cells.assign(side_x * side_y, LayerCell());
+
+	auto cell_of = [&](float v, float origin, int side) {
+		return std::min(side - 1, std::max(0, (int)((v - origin) / cell_size)));
+	};
+
+	for (unsigned int i = 0; i < items.size(); i++) {
+		Item& item = items[i];
+		// non-instanced items get a code no other item shares
+		const unsigned int code = item.instanced
+			? ((unsigned int)item.key.effect << 16) | ((unsigned int)item.key.texture << 8) | (unsigned int)item.key.geometry
+			: UNIQUE_CODE_BIT | i;
+		const int min_cx = cell_of(item.min.x, world_min.x, side_x), max_cx = cell_of(item.max.x, world_min.x, side_x);
+		const int min_cy = cell_of(item.min.y, world_min.y, side_y), max_cy = cell_of(item.max.y, world_min.y, side_y);
+
+		// Sharing a cell counts as overlapping. Same-code items keep their order inside the batch,
+		// so they only need the same layer; anything else must be on a lower one.
+		unsigned int layer = 0;
+		for (int cy = min_cy; cy <= max_cy; cy++) {
+			for (int cx = min_cx; cx <= max_cx; cx++) {
+				const LayerCell& cell = cells[cy * side_x + cx];
+				if (cell.top_code == NO_CODE)
+					continue;
+				if (cell.top_code != code)
+					layer = std::max(layer, cell.top_layer + 1);
+				else
+					layer = std::max(layer, std::max(cell.top_layer, cell.other_layer_end));
+			}
+		}
+		item.layer = layer;
+
+		for (int cy = min_cy; cy <= max_cy; cy++) {
+			for (int cx = min_cx; cx <= max_cx; cx++) {
+				LayerCell& cell = cells[cy * side_x + cx];
+				if (cell.top_code == code || cell.top_code == NO_CODE) {
+					cell.top_code = code;
+					cell.top_layer = layer;
+				} else {
+					// layer is above everything in the cell, so the old top becomes the best other code
+					cell.other_layer_end = cell.top_layer + 1;
+					cell.top_code = code;
+					cell.top_layer = layer;
+				}
+			}
+		}
+	}
+}
+
+void SpriteBatchBuilder::finish()
+{
+	out_batches.clear();
+	out_instances.clear();
+	assign_layers();
+
+	order.resize(items.size());
+	for (unsigned int i = 0; i < items.size(); i++)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) {
+		const Item& ia = items[a];
+		const Item& ib = items[b];
+		if (ia.layer != ib.layer)
+			return ia.layer < ib.layer;
+		if (ia.instanced != ib.instanced)
+			return ia.instanced;
+		return key_less(ia.key, ib.key);
+	});
+
+	out_instances.reserve(queued_instances.size());
+	for (unsigned int i : order) {
+		const Item& item = items[i];
+		if (!item.instanced) {
+			SpriteBatch batch;
+			batch.key = item.key;
+			batch.instanced = false;
+			batch.count = 1;
+			batch.entity = item.entity;
+			out_batches.push_back(batch);
+			continue;
+		}
+
+		// a batch may run on into the next layer, which is still drawn after the previous one
+		bool extends = !out_batches.empty() && out_batches.back().instanced && same_key(out_batches.back().key, item.key);
+		if (!extends) {
+			SpriteBatch batch;
+			batch.key = item.key;
+			batch.first = (unsigned int)out_instances.size();
+			out_batches.push_back(batch);
+		}
+		out_batches.back().count++;
+		out_instances.push_back(queued_instances[item.instance]);
+	}
+}
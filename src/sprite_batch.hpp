@@ -0,0 +1,114 @@
+#pragma once
+
+#include "common.hpp"
+#include "components.hpp"
+#include "texture_atlas.hpp"
+#include "tiny_ecs.hpp"
+
+#include <array>
+#include <vector>
+
+// What a group of sprites must share to go out in a single instanced draw
+struct SpriteBatchKey {
+	EFFECT_ASSET_ID effect = EFFECT_ASSET_ID::EFFECT_COUNT;
+	TEXTURE_ASSET_ID texture = TEXTURE_ASSET_ID::TEXTURE_COUNT;
+	GEOMETRY_BUFFER_ID geometry = GEOMETRY_BUFFER_ID::GEOMETRY_COUNT;
+};
+
+// Per-instance vertex attributes of the sprite batch shader; mirrors the textured shader's uniforms
+struct SpriteInstance {
+	vec3 transform[3];  // model matrix columns
+	vec4 frame;         // curr_frame, total_frame, curr_row, total_row
+	vec2 flags;         // should_flip, is_hurt
+	vec4 uv_rect;       // where the texture sits in its atlas page, see TextureAtlasTable
+};
+
+// GL texture and UV rectangle each texture samples once some share atlas pages. By default every
+// texture is bound as itself and sampled whole.
+struct TextureAtlasTable {
+	std::array<TEXTURE_ASSET_ID, texture_count> bind_as;  // texture whose GL handle holds this one
+	std::array<vec4, texture_count> uv_rects;             // offset in xy, scale in zw
+
+	TextureAtlasTable();
+
+	// Points each packed texture at the first texture on its page and at its rectangle there;
+	// textures is in the order layout was packed, and ones left off every page keep their defaults
+	void assign(const std::vector<TEXTURE_ASSET_ID>& textures, const AtlasLayout& layout);
+};
+
+// Textures packed into shared atlas pages at load: the enemy sheets, which only the TEXTURED
+// effect samples
+bool is_atlas_texture(TEXTURE_ASSET_ID id);
+
+// A run of instances to draw with one call, or a single entity the caller draws the old way
+struct SpriteBatch {
+	SpriteBatchKey key;
+	bool instanced = true;
+	unsigned int first = 0;          // into instances(), when instanced
+	unsigned int count = 0;
+	Entity entity = Entity::null();  // when not instanced
+};
+
+// Builds the per-frame sprite batches on the CPU; needs no GL context, so it can be driven headless.
+//
+// Entities are added in back-to-front order. finish() then regroups them by effect, texture and
+// geometry without changing what ends up on screen: sprites only move past each other when their
+// bounds do not overlap. Each sprite gets a layer one above the highest layer of any earlier,
+// overlapping sprite with a different key (equal to it for the same key, since those stay in order
+// inside one batch); layers are drawn in order and each layer is sorted by key. Overlap is tested
+// conservatively, on a grid of small cells.
+class SpriteBatchBuilder
+{
+public:
+	void clear();
+
+	// Textures sharing an atlas page batch together; null draws every texture on its own
+	void set_atlas(const TextureAtlasTable* table) { atlas = table; }
+
+	// Queues a scene entity. TEXTURED sprites are batched; anything else becomes its own
+	// non-instanced batch so the caller can hand it to the regular per-entity draw.
+	void add_entity(Entity entity, const RenderRequest& request, const Motion& motion);
+
+	// Queues a prepared instance occupying the box center +- half_extent
+	void add(const SpriteBatchKey& key, const SpriteInstance& instance, vec2 center, vec2 half_extent);
+
+	// Assigns layers, sorts and groups everything added since clear()
+	void finish();
+
+	const std::vector<SpriteBatch>& batches() const { return out_batches; }
+	const std::vector<SpriteInstance>& instances() const { return out_instances; }
+
+	// Draw calls needed for the queued entities, and how many they were
+	size_t draw_calls() const { return out_batches.size(); }
+	size_t item_count() const { return items.size(); }
+
+private:
+	struct Item {
+		SpriteBatchKey key;
+		bool instanced = true;
+		Entity entity = Entity::null();
+		vec2 min = { 0.f, 0.f };
+		vec2 max = { 0.f, 0.f };
+		unsigned int instance = 0;  // into queued_instances
+		unsigned int layer = 0;
+	};
+
+	std::vector<Item> items;
+	std::vector<SpriteInstance> queued_instances;
+	std::vector<unsigned int> order;
+	std::vector<SpriteBatch> out_batches;
+	std::vector<SpriteInstance> out_instances;
+	const TextureAtlasTable* atlas = nullptr;
+
+	// Grid cell summarizing the items assigned so far that touch it. The latest item always has
+	// the highest layer in the cell, so remembering its batch code, its layer and the highest
+	// layer among other codes is enough to place the next item.
+	struct LayerCell {
+		unsigned int top_code = 0xFFFFFFFFu;
+		unsigned int top_layer = 0;
+		unsigned int other_layer_end = 0;  // highest layer of any other code, plus one
+	};
+	std::vector<LayerCell> cells;
+
+	void assign_layers();
+};
@@ -1,11 +1,11 @@
 #include "steering_system.hpp"
 
+#include "spatial_grid.hpp"
 #include "tiny_ecs_registry.hpp"
+#include "world_cells.hpp"
 
-#define GLM_ENABLE_EXPERIMENTAL
 #include <glm/common.hpp>
 #include <glm/trigonometric.hpp>
-#include <glm/gtx/hash.hpp>
 
 // TODO copied from pathfinding, make it common
 constexpr glm::ivec2 DIRECTIONS[] = {
@@ -26,15 +26,8 @@ static inline glm::vec2 get_world_pos(const glm::ivec2& cell_coordinate) {
     return cell_coordinate * static_cast<int>(CHUNK_CELL_SIZE) + static_cast<int>(CHUNK_CELL_SIZE) / 2;
 }
 
-static inline CHUNK_CELL_STATE get_cell_state(const glm::ivec2& cell_pos) {
-    if (registry.chunks.has(cell_pos.x / CHUNK_CELLS_PER_ROW, cell_pos.y / CHUNK_CELLS_PER_ROW)) {
-        const Chunk& chunk = registry.chunks.get(cell_pos.x / CHUNK_CELLS_PER_ROW, cell_pos.y / CHUNK_CELLS_PER_ROW);
-        return chunk.cell_states[cell_pos.x % CHUNK_CELLS_PER_ROW][cell_pos.y % CHUNK_CELLS_PER_ROW];
-    } else {
-        // chunk is not loaded, treat as having no obstacles
-        return CHUNK_CELL_STATE::EMPTY;
-    }
-}
+// Shared by all probes so consecutive cells in the same chunk skip the chunk lookup
+static WorldCellQuery world_cells;
 
 static inline float normalize_angle(float angle) {
     angle = std::fmod(angle, 2.0f * M_PI);
@@ -59,7 +52,8 @@ static inline float detect_obstacle(float angle, const glm::vec2& origin) {
     glm::ivec2 origin_cell = get_cell_coordinate(origin);
     for (int i = 1; i <= 5; i++) {
         glm::ivec2 check_cell = origin_cell + ahead_dir * i;
-        if (get_cell_state(check_cell) != CHUNK_CELL_STATE::EMPTY && get_cell_state(check_cell) != CHUNK_CELL_STATE::NO_OBSTACLE_AREA) {
+        CHUNK_CELL_STATE state = world_cells.get(check_cell);
+        if (state != CHUNK_CELL_STATE::EMPTY && state != CHUNK_CELL_STATE::NO_OBSTACLE_AREA) {
             return glm::length(get_world_pos(check_cell) - origin);
         }
     }
@@ -67,12 +61,36 @@ static inline float detect_obstacle(float angle, const glm::vec2& origin) {
     return -1.0f;
 }
 
+// Per enemy_dirs index, refreshed at the start of every step
+static std::vector<unsigned char> lod_far;   // off screen
+static std::vector<unsigned char> lod_skip;  // far and not due for an update this step
+
+static void assign_lod_tiers(bool use_lod, unsigned int step_count) {
+    const auto& dirs_registry = registry.enemy_dirs;
+    const size_t count = dirs_registry.components.size();
+    lod_far.assign(count, 0);
+    lod_skip.assign(count, 0);
+    if (!use_lod) return;
+
+    const glm::vec2 player_pos = registry.motions.get(registry.players.entities[0]).position;
+    const glm::vec2 half_view = glm::vec2(window_width_px, window_height_px) * 0.5f + LOD_SCREEN_MARGIN;
+    for (unsigned int k = 0; k < count; k++) {
+        const Entity e = dirs_registry.entities[k];
+        const glm::vec2 d = glm::abs(registry.motions.get(e).position - player_pos);
+        lod_far[k] = d.x > half_view.x || d.y > half_view.y;
+        // staggered by the entity's slot, which unlike k survives other enemies being swap-removed
+        lod_skip[k] = lod_far[k] && (e.index() + step_count) % LOD_FAR_INTERVAL != 0;
+    }
+}
+
 static void add_avoid_force() {
     auto& motions_registry = registry.motions;
     auto& dirs_registry = registry.enemy_dirs;
-    for (const auto& e : registry.enemies.entities) {
-        const Motion& me = motions_registry.get(e);
-        AccumulatedForce& af = dirs_registry.get(e);
+    for (unsigned int k = 0; k < dirs_registry.components.size(); k++) {
+        // far enemies follow their path force as is
+        if (lod_far[k]) continue;
+        const Motion& me = motions_registry.get(dirs_registry.entities[k]);
+        AccumulatedForce& af = dirs_registry.components[k];
         
         glm::vec2 avoid{ 0.0f, 0.0f };
         //glm::ivec2 obstacle_dir = snap_octagonal(glm::atan(af.v.y, af.v.x));
@@ -131,60 +149,63 @@ static void add_avoid_force() {
     }
 }
 
-static std::unordered_map<glm::ivec2, Entity> find_neighbours() {
-    std::unordered_map<glm::ivec2, Entity> neighbour_map;
+// Enemies within this distance of each other flock together
+constexpr float FLOCKING_RADIUS = 3.5f * CHUNK_CELL_SIZE;
 
+// Rebuilt every step from the enemies' positions; velocities are kept alongside by index
+static NeighborGrid flock_grid(FLOCKING_RADIUS);
+static std::vector<glm::vec2> flock_velocities;
+
+static void find_neighbours() {
+    flock_grid.clear();
+    flock_velocities.clear();
     for (const auto& e : registry.enemy_dirs.entities) {
         const auto& me = registry.motions.get(e);
-        neighbour_map[get_cell_coordinate(me.position)] = e;
+        flock_grid.add(me.position);
+        flock_velocities.push_back(me.velocity);
     }
-
-    return neighbour_map;
+    flock_grid.build();
 }
 
 static void add_flocking_force() {
-    std::unordered_map<glm::ivec2, Entity> neighbour_map = find_neighbours();
-    auto& motion_registry = registry.motions;
+    find_neighbours();
     auto& dirs_registry = registry.enemy_dirs;
-    const auto& mp = motion_registry.get(registry.players.entities[0]);
-    for (const auto& e : registry.enemy_dirs.entities) {
-        auto& me = motion_registry.get(e);
-        auto& af = dirs_registry.get(e);
+    const auto& mp = registry.motions.get(registry.players.entities[0]);
+    for (unsigned int k = 0; k < dirs_registry.components.size(); k++) {
+        // far enemies are still in the grid for their neighbours, but do not flock themselves
+        if (lod_far[k]) continue;
+        auto& af = dirs_registry.components[k];
+        const glm::vec2 position = flock_grid.point(k);
+        const glm::vec2 velocity = flock_velocities[k];
 
         glm::vec2 separation{ 0, 0 };
         glm::vec2 alignment{ 0, 0 };
         glm::vec2 cohesion{ 0, 0 };
 
         int n_neighbours = 0;
-        for (int i = -3; i <= 3; i++) {
-            for (int j = -3; j <= 3; j++) {
-                if (!i && !j) continue;
-
-                glm::ivec2 curr_cell = get_cell_coordinate(me.position) + glm::ivec2{ i, j };
-                if (neighbour_map.count(curr_cell)) {
-                    const Entity& neighbour = neighbour_map[curr_cell];
-                    auto& mn = motion_registry.get(neighbour);
-                    // Separation force
-                    glm::vec2 diff = me.position - mn.position;
-                    float len = glm::length(diff);
-                    if (len > 0.001f) {
-                        diff = glm::normalize(diff) / len * SEPARATION_WEIGHT;
-                        separation += diff;
-                    }
-
-                    // Alignment force
-                    alignment += mn.velocity;
-                    
-                    // Cohesion force
-                    cohesion += mn.position;
-
-                    n_neighbours++;
-                }
+        flock_grid.query_radius(position, FLOCKING_RADIUS, [&](unsigned int n) {
+            if (n == k) return;
+            const glm::vec2 neighbour_position = flock_grid.point(n);
+
+            // Separation force
+            glm::vec2 diff = position - neighbour_position;
+            float len = glm::length(diff);
+            if (len > 0.001f) {
+                diff = glm::normalize(diff) / len * SEPARATION_WEIGHT;
+                separation += diff;
             }
-        }
+
+            // Alignment force
+            alignment += flock_velocities[n];
+
+            // Cohesion force
+            cohesion += neighbour_position;
+
+            n_neighbours++;
+        });
 
         // Cancel cohesion at about 45 deg deviation
-        if (glm::dot(me.velocity, mp.position - me.position) < 0.7) {
+        if (glm::dot(velocity, mp.position - position) < 0.7) {
             alignment = { 0.f, 0.f };
             cohesion = { 0.f, 0.f };
         }
@@ -202,10 +223,15 @@ static void add_steering() {
         //printf("%f %f\n", afv.x, afv.y);
         const Entity& e = dirs_registry.entities[i];
         if (steering_registry.has(e)) {
-            steering_registry.get(e).target_angle = glm::atan(afv.y, afv.x);
-            steering_registry.get(e).vel = glm::length(afv);
+            Steering& steering = steering_registry.get(e);
+            steering.skip_step = lod_skip[i];
+            if (steering.skip_step) continue;
+            steering.target_angle = glm::atan(afv.y, afv.x);
+            steering.vel = glm::length(afv);
+            steering.is_far = lod_far[i];
         } else {
-            registry.enemy_steerings.insert(e, { glm::atan(afv.y, afv.x), 0.003, glm::length(afv) });
+            Steering& steering = registry.enemy_steerings.insert(e, { glm::atan(afv.y, afv.x), 0.003, glm::length(afv) });
+            steering.is_far = lod_far[i];
         }
     }
 }
@@ -244,9 +270,7 @@ static bool is_in_flashlight_beam(const glm::vec2& enemy_pos) {
     return false;
 }
 
-static void update_motion(float elapsed_ms) {
-    const auto& steering_registry = registry.enemy_steerings;
-
+void SteeringSystem::update_motion(float elapsed_ms) {
     Entity player = registry.players.entities[0];
     Motion& player_motion = registry.motions.get(player);
 
@@ -255,8 +279,6 @@ static void update_motion(float elapsed_ms) {
     constexpr float LUNGE_SPEED = 500.f;
     constexpr float LUNGE_RADIUS = 150.f;
 
-    float step_seconds = elapsed_ms / 1000.f;
-
     int flashlight_slow_level = 0;
     int flashlight_damage_level = 0;
     if (registry.playerUpgrades.has(player)) {
@@ -272,28 +294,17 @@ static void update_motion(float elapsed_ms) {
     // Calculate flat flashlight damage based on upgrade level (1, 2, 3, or 4 damage per second)
     int flat_damage = flashlight_damage_level; // 1 for level 1, 2 for level 2, etc.
 
-    for (int i = 0; i < steering_registry.components.size(); i++) {
-        Entity e = steering_registry.entities[i];
-        if (registry.arrows.has(e)) {
-            continue;
-        }
-
-        if (registry.boss_parts.has(e)) {
-            continue;
-        }
-
-        if (registry.minions.has(e)) {
-            continue;
-        }
+    steered_view.each([&](Entity e, const Steering& steering_comp, Motion& motion_comp) {
+        // far enemies keep their velocity between updates and catch up on the skipped time
+        if (steering_comp.skip_step) return;
+        const float tier_ms = steering_comp.is_far ? elapsed_ms * LOD_FAR_INTERVAL : elapsed_ms;
+        const float tier_seconds = tier_ms / 1000.f;
 
         if(registry.enemies.has(e)) {
             Enemy& enemy = registry.enemies.get(e);
-            if(enemy.is_hurt) continue;
+            if(enemy.is_hurt) return;
         }
 
-        Motion& motion_comp = registry.motions.get(e);
-        const Steering& steering_comp = steering_registry.components[i];
-
         if (!registry.enemy_lunges.has(e)) {
             registry.enemy_lunges.emplace(e);
         }
@@ -301,14 +312,14 @@ static void update_motion(float elapsed_ms) {
 
         // Tick down lunge cooldown
         if (lunge.lunge_cooldown > 0.f) {
-            lunge.lunge_cooldown -= step_seconds;
+            lunge.lunge_cooldown -= tier_seconds;
         }
 
         // Get direction and distance to player
         glm::vec2 diff = player_motion.position - motion_comp.position;
         float dist = glm::length(diff);
 
-        bool in_flashlight = is_in_flashlight_beam(motion_comp.position);
+        bool in_flashlight = !steering_comp.is_far && is_in_flashlight_beam(motion_comp.position);
 
         // Handle flashlight burn damage timer if enemy is in flashlight and player has the upgrade
         if (in_flashlight && flat_damage > 0 && registry.enemies.has(e)) {
@@ -321,7 +332,7 @@ static void update_motion(float elapsed_ms) {
                 FlashlightBurnTimer& burn_timer = registry.flashlightBurnTimers.get(e);
                 
                 // Update timer
-                burn_timer.timer += step_seconds;
+                burn_timer.timer += tier_seconds;
                 
                 // When 1 second has passed, set damage to apply
                 if (burn_timer.timer >= 1.0f) {
@@ -338,7 +349,7 @@ static void update_motion(float elapsed_ms) {
 
         // Handle lunge attack movement
         if (lunge.is_lunging) {
-            lunge.lunge_timer -= step_seconds;
+            lunge.lunge_timer -= tier_seconds;
             if (lunge.lunge_timer <= 0.f) {
                 lunge.is_lunging = false;
                 lunge.lunge_cooldown = EnemyLunge::LUNGE_COOLDOWN;
@@ -348,7 +359,7 @@ static void update_motion(float elapsed_ms) {
             float angle_diff = steering_comp.target_angle - motion_comp.angle;
             float shortest_diff = glm::atan(glm::sin(angle_diff), glm::cos(angle_diff));
 
-            float max_rad = steering_comp.rad_ms * elapsed_ms;
+            float max_rad = steering_comp.rad_ms * tier_ms;
             float frame_rad = glm::min(glm::abs(shortest_diff), max_rad);
 
             motion_comp.angle = normalize_angle(motion_comp.angle + frame_rad * glm::sign(shortest_diff));
@@ -376,10 +387,13 @@ static void update_motion(float elapsed_ms) {
             }
         }
 
+        // Nothing below shows off screen
+        if (steering_comp.is_far) return;
+
         // Squish animation for moving enemies
         if (registry.movementAnimations.has(e)) {
             MovementAnimation& anim = registry.movementAnimations.get(e);
-            anim.animation_timer += step_seconds;
+            anim.animation_timer += tier_seconds;
 
             float speed = glm::length(motion_comp.velocity);
             if (speed > 10.f) {
@@ -417,10 +431,11 @@ static void update_motion(float elapsed_ms) {
                 }
             }
         }
-    }
+    });
 }
 
 void SteeringSystem::step(float elapsed_ms) {
+    assign_lod_tiers(use_lod, step_count++);
     add_avoid_force();
     add_flocking_force();
     add_steering();
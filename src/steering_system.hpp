@@ -1,8 +1,28 @@
 #pragma once
 
+#include "tiny_ecs_registry.hpp"
+
 constexpr float ROTATE_EPSILON = 0.001f;
 
+// Enemies farther than this past the screen edge around the player are in the far LOD tier
+constexpr float LOD_SCREEN_MARGIN = 160.f;
+// Far enemies are re-steered once every this many steps, staggered so the work spreads evenly
+constexpr int LOD_FAR_INTERVAL = 4;
+
 class SteeringSystem {
 public:
 	void step(float elapsed_ms);
+
+	// Far enemies skip obstacle probes, flocking and cosmetic updates, and only turn every
+	// LOD_FAR_INTERVAL steps; on by default, exposed so benchmarks can compare
+	bool use_lod = true;
+
+private:
+	unsigned int step_count = 0;
+
+	// Arrows, boss parts and minions have their own movement
+	View<Steering, Motion> steered_view = registry.view(registry.enemy_steerings, registry.motions)
+		.exclude(registry.arrows, registry.boss_parts, registry.minions);
+
+	void update_motion(float elapsed_ms);
 };
\ No newline at end of file
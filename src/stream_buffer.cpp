@@ -0,0 +1,111 @@
+// internal
+#include "stream_buffer.hpp"
+#include "gl_state.hpp"
+
+// stlib
+#include <cstring>
+
+// Writes start on this boundary so every attribute array is suitably aligned
+static const size_t STREAM_BUFFER_ALIGNMENT = 16;
+
+static bool has_buffer_storage()
+{
+	if (glBufferStorage == nullptr)
+		return false;
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	if (major > 4 || (major == 4 && minor >= 4))
+		return true;
+
+	GLint extension_count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &extension_count);
+	for (GLint i = 0; i < extension_count; i++) {
+		const char* name = (const char*)glGetStringi(GL_EXTENSIONS, i);
+		if (name && strcmp(name, "GL_ARB_buffer_storage") == 0)
+			return true;
+	}
+	return false;
+}
+
+void StreamBuffer::init(size_t frame_size)
+{
+	frame_capacity = frame_size;
+	glGenBuffers(1, &handle);
+	glBindBuffer(GL_ARRAY_BUFFER, handle);
+
+	if (has_buffer_storage()) {
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		const GLsizeiptr total = (GLsizeiptr)(frame_capacity * STREAM_BUFFER_FRAMES);
+		glBufferStorage(GL_ARRAY_BUFFER, total, nullptr, flags);
+		mapped = (char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, total, flags);
+		if (mapped == nullptr) {
+			// storage is immutable now, so start over with a fresh buffer
+			glDeleteBuffers(1, &handle);
+			glGenBuffers(1, &handle);
+			glBindBuffer(GL_ARRAY_BUFFER, handle);
+		}
+	}
+	if (!is_persistent())
+		glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)frame_capacity, nullptr, GL_STREAM_DRAW);
+	gl_has_errors();
+}
+
+void StreamBuffer::destroy()
+{
+	for (GLsync& fence : fences) {
+		if (fence)
+			glDeleteSync(fence);
+		fence = nullptr;
+	}
+	if (is_persistent()) {
+		glBindBuffer(GL_ARRAY_BUFFER, handle);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		mapped = nullptr;
+	}
+	glDeleteBuffers(1, &handle);
+	handle = 0;
+}
+
+void StreamBuffer::begin_frame()
+{
+	used = 0;
+	if (is_persistent()) {
+		frame = (frame + 1) % STREAM_BUFFER_FRAMES;
+		// the GPU may still be drawing from this region
+		GLsync& fence = fences[frame];
+		if (fence) {
+			GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+			while (result == GL_TIMEOUT_EXPIRED)
+				result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+	} else {
+		gl_state.bind_buffer(GL_ARRAY_BUFFER, handle);
+		glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)frame_capacity, nullptr, GL_STREAM_DRAW);
+	}
+}
+
+void StreamBuffer::end_frame()
+{
+	if (is_persistent() && used > 0)
+		fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+GLintptr StreamBuffer::write(const void* data, size_t size)
+{
+	const size_t start = (used + STREAM_BUFFER_ALIGNMENT - 1) & ~(STREAM_BUFFER_ALIGNMENT - 1);
+	if (start + size > frame_capacity)
+		return WRITE_FAILED;
+	used = start + size;
+
+	const GLintptr offset = frame_offset() + (GLintptr)start;
+	// the draws bind their own vertex buffers in between, so this is usually a real rebind
+	gl_state.bind_buffer(GL_ARRAY_BUFFER, handle);
+	if (is_persistent())
+		memcpy(mapped + offset, data, size);
+	else
+		glBufferSubData(GL_ARRAY_BUFFER, offset, (GLsizeiptr)size, data);
+	return offset;
+}
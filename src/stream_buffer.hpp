@@ -0,0 +1,49 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <array>
+
+// Bytes one frame may stream; enough for a full particle pool plus health bars and debug lines
+const size_t STREAM_BUFFER_FRAME_SIZE = 4 * 1024 * 1024;
+// Frames the GPU may still be reading from while the CPU writes the next one
+const int STREAM_BUFFER_FRAMES = 3;
+
+// A GL_ARRAY_BUFFER for per-frame dynamic vertex data: particles, health bars, debug lines.
+//
+// With buffer storage (GL 4.4 or ARB_buffer_storage) it is one persistently mapped buffer split
+// into STREAM_BUFFER_FRAMES regions used round robin; write() copies straight into mapped memory and
+// each region is fenced after its frame, so the CPU only waits if it gets that many frames ahead.
+// Otherwise the buffer is orphaned at the start of every frame and written with glBufferSubData,
+// which lets the driver hand out fresh storage instead of stalling on the previous frame's draws.
+class StreamBuffer
+{
+public:
+	// Returned by write() when the frame's region is full
+	static const GLintptr WRITE_FAILED = -1;
+
+	void init(size_t frame_size = STREAM_BUFFER_FRAME_SIZE);
+	void destroy();
+
+	// Call once per frame before any write()
+	void begin_frame();
+	// Call once per frame after the last draw that reads from this frame's writes
+	void end_frame();
+
+	// Copies data into this frame's region and returns its offset in buffer(), for
+	// glVertexAttribPointer. Leaves buffer() bound to GL_ARRAY_BUFFER.
+	GLintptr write(const void* data, size_t size);
+
+	GLuint buffer() const { return handle; }
+	bool is_persistent() const { return mapped != nullptr; }
+
+private:
+	GLuint handle = 0;
+	size_t frame_capacity = 0;
+	int frame = 0;
+	size_t used = 0;         // bytes written into the current frame's region
+	char* mapped = nullptr;  // whole buffer, when persistently mapped
+	std::array<GLsync, STREAM_BUFFER_FRAMES> fences = {};
+
+	GLintptr frame_offset() const { return is_persistent() ? (GLintptr)(frame * frame_capacity) : 0; }
+};
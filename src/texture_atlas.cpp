@@ -0,0 +1,119 @@
+// internal
+#include "texture_atlas.hpp"
+
+// stlib
+#include <algorithm>
+#include <numeric>
+
+void SkylinePacker::reset(int width, int height)
+{
+	page_width = width;
+	page_height = height;
+	used = { 0, 0 };
+	skyline.assign(1, { 0, 0, width });
+}
+
+int SkylinePacker::fit(size_t index, int w, int h) const
+{
+	const int x = skyline[index].x;
+	if (x + w > page_width)
+		return -1;
+
+	// the rectangle rests on the highest segment it spans
+	int y = 0;
+	int width_left = w;
+	for (size_t i = index; width_left > 0; i++) {
+		y = std::max(y, skyline[i].y);
+		if (y + h > page_height)
+			return -1;
+		width_left -= skyline[i].width;
+	}
+	return y;
+}
+
+bool SkylinePacker::insert(int w, int h, ivec2& position)
+{
+	if (w <= 0 || h <= 0)
+		return false;
+
+	size_t best_index = skyline.size();
+	int best_top = 0;
+	int best_width = 0;
+	for (size_t i = 0; i < skyline.size(); i++) {
+		const int y = fit(i, w, h);
+		if (y < 0)
+			continue;
+		if (best_index == skyline.size() || y + h < best_top || (y + h == best_top && skyline[i].width < best_width)) {
+			best_index = i;
+			best_top = y + h;
+			best_width = skyline[i].width;
+		}
+	}
+	if (best_index == skyline.size())
+		return false;
+
+	position = ivec2(skyline[best_index].x, best_top - h);
+	skyline.insert(skyline.begin() + best_index, { position.x, best_top, w });
+
+	// cut the segments the new one covers
+	for (size_t i = best_index + 1; i < skyline.size();) {
+		Segment& segment = skyline[i];
+		const int covered = position.x + w - segment.x;
+		if (covered <= 0)
+			break;
+		if (covered < segment.width) {
+			segment.x += covered;
+			segment.width -= covered;
+			break;
+		}
+		skyline.erase(skyline.begin() + i);
+	}
+	// and join neighbors at the same height
+	for (size_t i = 0; i + 1 < skyline.size();) {
+		if (skyline[i].y == skyline[i + 1].y) {
+			skyline[i].width += skyline[i + 1].width;
+			skyline.erase(skyline.begin() + i + 1);
+		} else {
+			i++;
+		}
+	}
+
+	used = max(used, position + ivec2(w, h));
+	return true;
+}
+
+AtlasLayout pack_atlas(const std::vector<ivec2>& sizes, int max_page_size, int padding)
+{
+	AtlasLayout layout;
+	layout.placements.resize(sizes.size());
+
+	std::vector<size_t> order(sizes.size());
+	std::iota(order.begin(), order.end(), (size_t)0);
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+		return sizes[a].y != sizes[b].y ? sizes[a].y > sizes[b].y : sizes[a].x > sizes[b].x;
+	});
+
+	std::vector<SkylinePacker> pages;
+	for (size_t i : order) {
+		AtlasPlacement& placement = layout.placements[i];
+		placement.size = sizes[i];
+		const ivec2 padded = sizes[i] + ivec2(padding);
+		if (padded.x > max_page_size || padded.y > max_page_size)
+			continue;
+
+		for (size_t p = 0; p < pages.size() && placement.page < 0; p++) {
+			if (pages[p].insert(padded.x, padded.y, placement.position))
+				placement.page = (int)p;
+		}
+		if (placement.page < 0) {
+			pages.emplace_back();
+			pages.back().reset(max_page_size, max_page_size);
+			pages.back().insert(padded.x, padded.y, placement.position);
+			placement.page = (int)pages.size() - 1;
+		}
+	}
+
+	for (const SkylinePacker& page : pages)
+		layout.page_sizes.push_back(page.used_size());
+	return layout;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <vector>
+
+// Largest atlas page, whatever GL_MAX_TEXTURE_SIZE allows
+const int ATLAS_MAX_PAGE_SIZE = 4096;
+// Transparent texels kept right of and below every packed image, so linear filtering at its
+// edges never picks up a neighbor
+const int ATLAS_PADDING = 2;
+
+// Skyline bottom-left rectangle packer for one fixed-size page.
+//
+// The free space is tracked as the skyline of everything placed so far: left-to-right segments,
+// each with the height up to which the page is used. A rectangle goes where its top edge ends
+// lowest, preferring the narrower segment on ties, and raises the skyline under it. Space below
+// the skyline that a wider rectangle stepped over is not reused, which costs little when the
+// rectangles are inserted tallest first.
+class SkylinePacker
+{
+public:
+	void reset(int width, int height);
+
+	// Places a w x h rectangle; false when it does not fit
+	bool insert(int w, int h, ivec2& position);
+
+	int width() const { return page_width; }
+	int height() const { return page_height; }
+	// Bounding box of everything placed so far
+	ivec2 used_size() const { return used; }
+
+private:
+	struct Segment {
+		int x, y, width;
+	};
+
+	// y a w x h rectangle would sit at with its left edge on segment index, or -1 if it does not fit
+	int fit(size_t index, int w, int h) const;
+
+	int page_width = 0;
+	int page_height = 0;
+	ivec2 used = { 0, 0 };
+	std::vector<Segment> skyline;
+};
+
+// Where pack_atlas put one image
+struct AtlasPlacement {
+	int page = -1;              // -1 if it is larger than a page
+	ivec2 position = { 0, 0 };  // top-left texel on the page
+	ivec2 size = { 0, 0 };
+};
+
+struct AtlasLayout {
+	std::vector<ivec2> page_sizes;           // each trimmed to what it holds
+	std::vector<AtlasPlacement> placements;  // in the order of the sizes packed
+};
+
+// Packs images of the given sizes into as few pages of at most max_page_size texels a side as
+// it can, tallest first, with padding texels right of and below each one. Pure CPU work with no
+// GL calls, so layouts can be computed and checked headless.
+AtlasLayout pack_atlas(const std::vector<ivec2>& sizes, int max_page_size, int padding = ATLAS_PADDING);
@@ -0,0 +1,264 @@
+// internal
+#include "texture_loader.hpp"
+#include "save_stream.hpp"
+
+// stlib
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+
+#include <stb_image.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <direct.h>
+#define MKDIR(path) _mkdir(path)
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MKDIR(path) mkdir(path, 0755)
+#endif
+
+// Magic, version, mtime and file size as two words each, path length, width and height
+static const size_t CACHE_HEADER_WORDS = 9;
+
+using Clock = std::chrono::steady_clock;
+
+bool MappedFile::open(const std::string& path)
+{
+	close();
+#ifdef _WIN32
+	HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (handle == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(handle, &file_size) || file_size.QuadPart == 0) {
+		CloseHandle(handle);
+		return false;
+	}
+	HANDLE map_handle = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	const void* view = map_handle ? MapViewOfFile(map_handle, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (view == nullptr) {
+		if (map_handle)
+			CloseHandle(map_handle);
+		CloseHandle(handle);
+		return false;
+	}
+	file = handle;
+	mapping = map_handle;
+	bytes = (const unsigned char*)view;
+	length = (size_t)file_size.QuadPart;
+#else
+	const int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0) {
+		::close(fd);
+		return false;
+	}
+	void* view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// the mapping stays valid without the descriptor
+	::close(fd);
+	if (view == MAP_FAILED)
+		return false;
+	bytes = (const unsigned char*)view;
+	length = (size_t)info.st_size;
+#endif
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (bytes == nullptr)
+		return;
+#ifdef _WIN32
+	UnmapViewOfFile(bytes);
+	CloseHandle(mapping);
+	CloseHandle(file);
+	mapping = nullptr;
+	file = nullptr;
+#else
+	munmap((void*)bytes, length);
+#endif
+	bytes = nullptr;
+	length = 0;
+}
+
+// Modification time and size of a file; false if it cannot be read
+static bool source_stamp(const std::string& path, uint64_t& mtime, uint64_t& file_size)
+{
+#ifdef _WIN32
+	struct _stat64 info;
+	if (_stat64(path.c_str(), &info) != 0)
+		return false;
+#else
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0)
+		return false;
+#endif
+	mtime = (uint64_t)info.st_mtime;
+	file_size = (uint64_t)info.st_size;
+	return true;
+}
+
+std::string TextureLoader::cache_path(const std::string& cache_directory, const std::string& source_path)
+{
+	// FNV-1a
+	uint64_t hash = 14695981039346656037ull;
+	for (char c : source_path) {
+		hash ^= (unsigned char)c;
+		hash *= 1099511628211ull;
+	}
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.rgba", (unsigned long long)hash);
+	return cache_directory + "/" + name;
+}
+
+TextureLoader::TextureLoader(const std::vector<std::string>& paths, const std::string& cache_directory, unsigned int thread_count)
+	: paths(paths), cache_directory(cache_directory), textures(paths.size()), done(paths.size(), 0), start(Clock::now())
+{
+	if (!cache_directory.empty()) {
+		// parents first; both fail harmlessly when they exist
+		const size_t slash = cache_directory.find_last_of('/');
+		if (slash != std::string::npos)
+			MKDIR(cache_directory.substr(0, slash).c_str());
+		MKDIR(cache_directory.c_str());
+	}
+
+	if (thread_count == 0)
+		thread_count = std::min(std::max(1u, std::thread::hardware_concurrency()), TEXTURE_LOADER_MAX_THREADS);
+	thread_count = std::max(1u, std::min(thread_count, (unsigned int)paths.size()));
+	if (paths.empty())
+		return;
+	for (unsigned int i = 0; i < thread_count; i++)
+		workers.emplace_back(&TextureLoader::worker_loop, this);
+}
+
+TextureLoader::~TextureLoader()
+{
+	for (std::thread& worker : workers)
+		worker.join();
+	for (size_t i = 0; i < textures.size(); i++)
+		release(i);
+}
+
+void TextureLoader::worker_loop()
+{
+	for (size_t i = next++; i < paths.size(); i = next++) {
+		load(i);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		done[i] = 1;
+		if (++done_count == paths.size())
+			finished_ms = (float)(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start)).count() / 1000;
+		loaded.notify_all();
+	}
+}
+
+const DecodedTexture& TextureLoader::wait(size_t i)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	loaded.wait(lock, [&]() { return done[i] != 0; });
+	return textures[i];
+}
+
+void TextureLoader::wait_all()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	loaded.wait(lock, [&]() { return done_count == paths.size(); });
+}
+
+void TextureLoader::release(size_t i)
+{
+	DecodedTexture& texture = textures[i];
+	if (texture.decoded)
+		stbi_image_free(texture.decoded);
+	texture.decoded = nullptr;
+	texture.cache_file.close();
+	texture.pixels = nullptr;
+}
+
+void TextureLoader::load(size_t i)
+{
+	uint64_t mtime = 0, file_size = 0;
+	const bool use_cache = !cache_directory.empty() && source_stamp(paths[i], mtime, file_size);
+	if (use_cache && load_cached(i, mtime, file_size)) {
+		hits++;
+		return;
+	}
+
+	DecodedTexture& texture = textures[i];
+	texture.decoded = stbi_load(paths[i].c_str(), &texture.size.x, &texture.size.y, NULL, 4);
+	texture.pixels = texture.decoded;
+	if (texture.pixels && use_cache)
+		write_cache(i, mtime, file_size);
+}
+
+bool TextureLoader::load_cached(size_t i, uint64_t mtime, uint64_t file_size)
+{
+	DecodedTexture& texture = textures[i];
+	if (!texture.cache_file.open(cache_path(cache_directory, paths[i])))
+		return false;
+
+	const MappedFile& blob = texture.cache_file;
+	try {
+		SaveReader in((const char*)blob.data(), blob.size());
+		const bool valid = in.read_u32() == TEXTURE_CACHE_MAGIC && in.read_u32() == TEXTURE_CACHE_VERSION &&
+			in.read_u32() == (uint32_t)mtime && in.read_u32() == (uint32_t)(mtime >> 32) &&
+			in.read_u32() == (uint32_t)file_size && in.read_u32() == (uint32_t)(file_size >> 32) &&
+			in.read_string() == paths[i];
+		const int width = in.read_i32();
+		const int height = in.read_i32();
+		const size_t header_size = CACHE_HEADER_WORDS * sizeof(uint32_t) + paths[i].size();
+		if (valid && width > 0 && height > 0 && blob.size() == header_size + (size_t)width * height * 4) {
+			texture.size = ivec2(width, height);
+			texture.pixels = blob.data() + header_size;
+			texture.from_cache = true;
+			return true;
+		}
+	} catch (const std::exception&) {
+		// too short to be a cache blob
+	}
+	texture.cache_file.close();
+	return false;
+}
+
+void TextureLoader::write_cache(size_t i, uint64_t mtime, uint64_t file_size)
+{
+	const DecodedTexture& texture = textures[i];
+	SaveWriter header;
+	header.write_u32(TEXTURE_CACHE_MAGIC);
+	header.write_u32(TEXTURE_CACHE_VERSION);
+	header.write_u32((uint32_t)mtime);
+	header.write_u32((uint32_t)(mtime >> 32));
+	header.write_u32((uint32_t)file_size);
+	header.write_u32((uint32_t)(file_size >> 32));
+	header.write_string(paths[i]);
+	header.write_i32(texture.size.x);
+	header.write_i32(texture.size.y);
+
+	// written aside and renamed over, so a half-written blob is never mapped
+	const std::string path = cache_path(cache_directory, paths[i]);
+	const std::string temp_path = path + ".tmp";
+	FILE* file = fopen(temp_path.c_str(), "wb");
+	if (file == nullptr)
+		return;
+	const size_t pixel_bytes = (size_t)texture.size.x * texture.size.y * 4;
+	bool ok = fwrite(header.data().data(), 1, header.size(), file) == header.size() &&
+		fwrite(texture.pixels, 1, pixel_bytes, file) == pixel_bytes;
+	ok = fclose(file) == 0 && ok;
+#ifdef _WIN32
+	ok = ok && MoveFileExA(temp_path.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	ok = ok && std::rename(temp_path.c_str(), path.c_str()) == 0;
+#endif
+	if (!ok) {
+		fprintf(stderr, "Failed to cache texture %s\n", paths[i].c_str());
+		std::remove(temp_path.c_str());
+	}
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// "ECTX" at the start of every cached texture
+const uint32_t TEXTURE_CACHE_MAGIC = 0x58544345;
+const uint32_t TEXTURE_CACHE_VERSION = 1;
+// Most decode threads a TextureLoader starts
+const unsigned int TEXTURE_LOADER_MAX_THREADS = 8;
+
+// Read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	~MappedFile() { close(); }
+
+	bool open(const std::string& path);
+	void close();
+
+	const unsigned char* data() const { return bytes; }
+	size_t size() const { return length; }
+
+private:
+	const unsigned char* bytes = nullptr;
+	size_t length = 0;
+#ifdef _WIN32
+	void* file = nullptr;
+	void* mapping = nullptr;
+#endif
+};
+
+// RGBA8 pixels of one texture, either decoded from its PNG or mapped from the texture cache
+struct DecodedTexture
+{
+	ivec2 size = { 0, 0 };
+	const unsigned char* pixels = nullptr;  // size.x * size.y * 4 bytes; null if loading failed
+	bool from_cache = false;
+
+	unsigned char* decoded = nullptr;       // stb_image buffer behind pixels on a cache miss
+	MappedFile cache_file;                  // mapping behind pixels on a cache hit
+};
+
+// Decodes a list of images on worker threads, in order, so the caller can upload each one to GL
+// on its own thread as soon as it is ready.
+//
+// With a cache directory, every decoded image is also written there as a raw RGBA blob keyed by
+// the source path, modification time and file size; the next load maps the blob instead of
+// inflating the PNG. A stale or damaged blob is decoded again and rewritten.
+class TextureLoader
+{
+public:
+	// An empty cache_directory disables the cache; thread_count 0 picks one per core
+	TextureLoader(const std::vector<std::string>& paths, const std::string& cache_directory, unsigned int thread_count = 0);
+	~TextureLoader();
+
+	// Blocks until texture i is loaded
+	const DecodedTexture& wait(size_t i);
+	// Frees texture i's pixels, e.g. once they are uploaded
+	void release(size_t i);
+	// Blocks until every texture is loaded
+	void wait_all();
+
+	unsigned int threads() const { return (unsigned int)workers.size(); }
+	size_t cache_hits() const { return hits; }
+	// Wall time from construction until the last texture was loaded
+	float load_ms() const { return finished_ms; }
+
+	// Cache blob for a source file, named after a hash of its path
+	static std::string cache_path(const std::string& cache_directory, const std::string& source_path);
+
+private:
+	void worker_loop();
+	void load(size_t i);
+	bool load_cached(size_t i, uint64_t mtime, uint64_t file_size);
+	void write_cache(size_t i, uint64_t mtime, uint64_t file_size);
+
+	std::vector<std::string> paths;
+	std::string cache_directory;
+	std::vector<DecodedTexture> textures;
+	std::vector<std::thread> workers;
+	std::atomic<size_t> next{ 0 };
+	std::atomic<size_t> hits{ 0 };
+
+	std::mutex mutex;
+	std::condition_variable loaded;
+	std::vector<char> done;    // guarded by mutex
+	size_t done_count = 0;     // guarded by mutex
+	float finished_ms = 0.f;   // guarded by mutex
+	std::chrono::steady_clock::time_point start;
+};
@@ -1,5 +1,66 @@
 // internal
 #include "tiny_ecs.hpp"
 
-// All we need to store besides the containers is the id of every entity and callbacks to be able to remove entities across containers
-unsigned int Entity::id_count = 1;
\ No newline at end of file
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+
+// All we need to store besides the containers is the slot allocator for entity ids.
+// It lives in a function-local static so entities constructed during static initialization
+// of other translation units (e.g. the boss_system globals) are safe.
+namespace {
+
+// Freed slots are only handed out again once this many are queued. Together with the FIFO
+// order this spreads re-use across slots, so a generation takes long to wrap around.
+const size_t MIN_FREE_SLOTS_BEFORE_REUSE = 1024;
+
+struct EntityAllocator
+{
+	std::vector<unsigned int> generations = { 0 }; // slot 0 is reserved for the null entity
+	std::deque<unsigned int> free_slots;
+};
+
+EntityAllocator& entity_allocator()
+{
+	static EntityAllocator allocator;
+	return allocator;
+}
+
+}
+
+unsigned int Entity::allocate_id()
+{
+	EntityAllocator& allocator = entity_allocator();
+	unsigned int index;
+	if (allocator.free_slots.size() > MIN_FREE_SLOTS_BEFORE_REUSE) {
+		index = allocator.free_slots.front();
+		allocator.free_slots.pop_front();
+	} else {
+		index = (unsigned int)allocator.generations.size();
+		// past INDEX_MASK the index would spill into the generation bits and alias live entities,
+		// so stop here in release builds too rather than hand out a broken id
+		if (index > INDEX_MASK) {
+			fprintf(stderr, "Ran out of entity slots: all %u are in use\n", (unsigned int)INDEX_MASK);
+			abort();
+		}
+		allocator.generations.push_back(0);
+	}
+	return (allocator.generations[index] << INDEX_BITS) | index;
+}
+
+bool Entity::is_alive() const
+{
+	const EntityAllocator& allocator = entity_allocator();
+	unsigned int i = index();
+	return i != 0 && i < allocator.generations.size() && allocator.generations[i] == generation();
+}
+
+void Entity::release(Entity e)
+{
+	if (!e.is_alive())
+		return;
+	EntityAllocator& allocator = entity_allocator();
+	unsigned int i = e.index();
+	allocator.generations[i] = (allocator.generations[i] + 1) & GENERATION_MASK;
+	allocator.free_slots.push_back(i);
+}
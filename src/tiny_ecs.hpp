@@ -6,20 +6,48 @@
 #include <set>
 #include <functional>
 #include <typeindex>
+#include <memory>
+#include <array>
+#include <tuple>
+#include <utility>
 #include <assert.h>
 
 // Unique identifyer for all entities
+// The id packs a slot index (low bits) and a generation (high bits). Slots of destroyed entities
+// are recycled, and their generation is bumped on release, so a handle kept after its entity was
+// destroyed (e.g. Collision::other) no longer matches the slot's current occupant.
 class Entity
 {
 	unsigned int id;
-	static unsigned int id_count; // starts from 1, entit 0 is the default initialization
+	struct NullTag {};
+	Entity(NullTag) : id(0) {}
+
+	static unsigned int allocate_id();
 public:
+	enum : unsigned int {
+		INDEX_BITS = 20,
+		INDEX_MASK = (1u << INDEX_BITS) - 1,
+		GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1
+	};
+
 	Entity()
 	{
-		id = id_count++;
-		// Note, indices of already deleted entities arent re-used in this simple implementation.
+		id = allocate_id();
 	}
+	// A handle that refers to no entity, for members that are only assigned later.
+	// Unlike Entity(), this does not use up a slot. Slot 0 is never handed out.
+	static Entity null() { return Entity(NullTag()); }
+
 	operator unsigned int() { return id; } // this enables automatic casting to int
+
+	unsigned int index() const { return id & INDEX_MASK; }
+	unsigned int generation() const { return id >> INDEX_BITS; }
+
+	// False for the null handle and for handles whose entity was released
+	bool is_alive() const;
+
+	// Return the entity's slot for re-use. Releasing a stale or null handle does nothing.
+	static void release(Entity e);
 };
 
 // Common interface to refer to all containers in the ECS registry
@@ -34,6 +62,8 @@ struct ContainerInterface : public ContainerInterfaceBase
 {
 	virtual void remove(Entity e) = 0;
 	virtual bool has(Entity entity) = 0;
+	// Bumped whenever entities are added, removed or reordered; used by View to reuse its matches
+	virtual unsigned int version() = 0;
 };
 
 // Common interface to refer to all position-based containers in the ECS registry
@@ -43,13 +73,91 @@ struct PositionalContainerInterface : public ContainerInterfaceBase
 	virtual bool has(short x, short y) = 0;
 };
 
+// Entity -> component index lookup backed by a hash map.
+// This was the original ComponentContainer storage; it is kept around for benchmarking.
+class HashMapEntityIndex
+{
+	std::unordered_map<unsigned int, unsigned int> map_entity_componentID; // the entity is cast to uint to be hashable.
+public:
+	bool contains(unsigned int id) const { return map_entity_componentID.count(id) > 0; }
+	unsigned int get(unsigned int id) const { return map_entity_componentID.at(id); }
+	void set(unsigned int id, unsigned int cID) { map_entity_componentID[id] = cID; }
+	void erase(unsigned int id) { map_entity_componentID.erase(id); }
+	void clear() { map_entity_componentID.clear(); }
+};
+
+// Entity -> component index lookup backed by a paged sparse array indexed by the entity's slot.
+// A lookup is a bounds check and two loads instead of a hash probe. Pages are allocated on
+// first use and released once they no longer hold any entity, so memory follows the live slots.
+// The generation is not stored here; ComponentContainer::has checks it against its entity list.
+class PagedSparseEntityIndex
+{
+	enum : unsigned int {
+		PAGE_BITS = 10,
+		PAGE_SIZE = 1u << PAGE_BITS,
+		PAGE_MASK = PAGE_SIZE - 1,
+		INVALID = ~0u
+	};
+
+	struct Page
+	{
+		unsigned int componentID[PAGE_SIZE];
+		unsigned int count = 0;
+		Page() { std::fill(componentID, componentID + PAGE_SIZE, INVALID); }
+	};
+	std::vector<std::unique_ptr<Page>> pages;
+
+public:
+	bool contains(unsigned int id) const
+	{
+		id &= Entity::INDEX_MASK;
+		unsigned int p = id >> PAGE_BITS;
+		return p < pages.size() && pages[p] && pages[p]->componentID[id & PAGE_MASK] != INVALID;
+	}
+	unsigned int get(unsigned int id) const
+	{
+		assert(contains(id));
+		id &= Entity::INDEX_MASK;
+		return pages[id >> PAGE_BITS]->componentID[id & PAGE_MASK];
+	}
+	void set(unsigned int id, unsigned int cID)
+	{
+		id &= Entity::INDEX_MASK;
+		unsigned int p = id >> PAGE_BITS;
+		if (p >= pages.size())
+			pages.resize(p + 1);
+		if (!pages[p])
+			pages[p].reset(new Page());
+		unsigned int& slot = pages[p]->componentID[id & PAGE_MASK];
+		if (slot == INVALID)
+			pages[p]->count++;
+		slot = cID;
+	}
+	void erase(unsigned int id)
+	{
+		id &= Entity::INDEX_MASK;
+		unsigned int p = id >> PAGE_BITS;
+		if (p >= pages.size() || !pages[p])
+			return;
+		unsigned int& slot = pages[p]->componentID[id & PAGE_MASK];
+		if (slot == INVALID)
+			return;
+		slot = INVALID;
+		if (--pages[p]->count == 0)
+			pages[p].reset();
+	}
+	void clear() { pages.clear(); }
+};
+
 // A container that stores components of type 'Component' and associated entities
-template <typename Component> // A component can be any class
+// The components and entities are stored densely; 'Index' maps an entity to its slot.
+template <typename Component, typename Index = PagedSparseEntityIndex> // A component can be any class
 class ComponentContainer : public ContainerInterface
 {
 private:
-	// The hash map from Entity -> array index.
-	std::unordered_map<unsigned int, unsigned int> map_entity_componentID; // the entity is cast to uint to be hashable.
+	// The map from Entity -> array index.
+	Index map_entity_componentID;
+	unsigned int modification_count = 0;
 	bool registered = false;
 public:
 	// Container of all components of type 'Component'
@@ -68,10 +176,13 @@ public:
 	{
 		// Usually, every entity should only have one instance of each component type
 		assert(!(check_for_duplicates && has(e)) && "Entity already contained in ECS registry");
+		// A destroyed entity's slot may already belong to someone else
+		assert(e.is_alive() && "Entity was already removed from the ECS registry");
 
-		map_entity_componentID[e] = (unsigned int)components.size();
+		map_entity_componentID.set(e, (unsigned int)components.size());
 		components.push_back(std::move(c)); // the move enforces move instead of copy constructor
 		entities.push_back(e);
+		modification_count++;
 		return components.back();
 	};
 
@@ -88,12 +199,21 @@ public:
 	// A wrapper to return the component of an entity
 	Component& get(Entity e) {
 		assert(has(e) && "Entity not contained in ECS registry");
-		return components[map_entity_componentID[e]];
+		return components[map_entity_componentID.get(e)];
 	}
 
 	// Check if entity has a component of type 'Component'
+	// The index only knows the slot, so a stale handle to a recycled slot fails the entity check
 	bool has(Entity entity) {
-		return map_entity_componentID.count(entity) > 0;
+		return map_entity_componentID.contains(entity) && entities[map_entity_componentID.get(entity)] == entity;
+	}
+
+	// Combined has() and lookup of the component's position in 'components'
+	bool find(Entity entity, unsigned int& cID) {
+		if (!has(entity))
+			return false;
+		cID = map_entity_componentID.get(entity);
+		return true;
 	}
 
 	// Remove an component and pack the container to re-use the empty space
@@ -102,19 +222,19 @@ public:
 		if (has(e))
 		{
 			// Get the current position
-			int cID = map_entity_componentID[e];
+			int cID = map_entity_componentID.get(e);
 
 			// Move the last element to position cID using the move operator
 			// Note, components[cID] = components.back() would trigger the copy instead of move operator
 			components[cID] = std::move(components.back());
 			entities[cID] = entities.back(); // the entity is only a single index, copy it.
-			map_entity_componentID[entities.back()] = cID;
+			map_entity_componentID.set(entities.back(), cID);
 
 			// Erase the old component and free its memory
 			map_entity_componentID.erase(e);
 			components.pop_back();
 			entities.pop_back();
-			// Note, one could mark the id for re-use
+			modification_count++;
 		}
 	};
 
@@ -124,6 +244,7 @@ public:
 		map_entity_componentID.clear();
 		components.clear();
 		entities.clear();
+		modification_count++;
 	}
 
 	// Report the number of components of type 'Component'
@@ -132,6 +253,11 @@ public:
 		return components.size();
 	}
 
+	unsigned int version()
+	{
+		return modification_count;
+	}
+
 	// Sort the components and associated entity assignment structures by the comparisonFunction, see std::sort
 	template <class Compare>
 	void sort(Compare comparisonFunction)
@@ -140,14 +266,159 @@ public:
 		std::sort(entities.begin(), entities.end(), comparisonFunction);
 		// Now re-arrange the components (Note, creates a new vector, which may be slow! Not sure if in-place could be faster: https://stackoverflow.com/questions/63703637/how-to-efficiently-permute-an-array-in-place-using-stdswap)
 		std::vector<Component> components_new; components_new.reserve(components.size());
-		std::transform(entities.begin(), entities.end(), std::back_inserter(components_new), [&](Entity e) { return std::move(get(e)); }); // note, the get still uses the old hash map (on purpose!)
+		std::transform(entities.begin(), entities.end(), std::back_inserter(components_new), [&](Entity e) { return std::move(get(e)); }); // note, the get still uses the old index (on purpose!)
 		components = std::move(components_new); // note, we use move operations to not create unneccesary copies of objects, but memory is still allocated for the new vector
-		// Fill the new hashmap
+		// Fill the new index
 		for (unsigned int i = 0; i < entities.size(); i++)
-			map_entity_componentID[entities[i]] = i;
+			map_entity_componentID.set(entities[i], i);
+		modification_count++;
 	}
 };
 
+// A query over the entities that have a component in every one of the given containers and none
+// in the excluded ones, e.g. registry.view(registry.motions, registry.enemies).exclude(registry.feet).
+// Iteration is driven by the smallest container. The matching entities and the positions of their
+// components are cached until one of the involved containers gains, loses or reorders entities, so
+// a view kept across frames only re-probes after spawns and removals.
+// Adding or removing components of the viewed or excluded types from inside each() is not allowed;
+// other containers may be modified freely.
+template <typename... Components>
+class View
+{
+	static const size_t COUNT = sizeof...(Components);
+	typedef std::index_sequence_for<Components...> Indices;
+
+	std::tuple<ComponentContainer<Components>*...> containers;
+	std::vector<ContainerInterface*> excluded;
+	bool keep_order = false;
+
+	// Cached matches; versions holds the included then the excluded containers' versions
+	std::vector<Entity> matches;
+	std::vector<std::array<unsigned int, COUNT>> match_cIDs;
+	std::vector<unsigned int> versions;
+
+	template <size_t... I>
+	std::array<ContainerInterface*, COUNT> included(std::index_sequence<I...>) {
+		return {{ std::get<I>(containers)... }};
+	}
+
+	template <size_t... I>
+	std::array<std::vector<Entity>*, COUNT> entity_lists(std::index_sequence<I...>) {
+		return {{ &std::get<I>(containers)->entities... }};
+	}
+
+	template <size_t... I>
+	bool find_all(Entity e, std::array<unsigned int, COUNT>& cIDs, std::index_sequence<I...>) {
+		bool found = true;
+		int expand[] = { 0, (found = found && std::get<I>(containers)->find(e, cIDs[I]), 0)... };
+		(void)expand;
+		return found;
+	}
+
+	template <typename Func, size_t... I>
+	void invoke(Func& func, size_t k, std::index_sequence<I...>) {
+		func(matches[k], std::get<I>(containers)->components[match_cIDs[k][I]]...);
+	}
+
+	template <size_t... I>
+	std::tuple<Entity, Components&...> make_tuple_at(size_t k, std::index_sequence<I...>) {
+		return std::tuple<Entity, Components&...>(matches[k], std::get<I>(containers)->components[match_cIDs[k][I]]...);
+	}
+
+	bool is_up_to_date() {
+		std::array<ContainerInterface*, COUNT> inc = included(Indices());
+		if (versions.size() != COUNT + excluded.size())
+			return false;
+		for (size_t i = 0; i < COUNT; i++)
+			if (versions[i] != inc[i]->version())
+				return false;
+		for (size_t i = 0; i < excluded.size(); i++)
+			if (versions[COUNT + i] != excluded[i]->version())
+				return false;
+		return true;
+	}
+
+public:
+	View(ComponentContainer<Components>&... components) : containers(&components...) {}
+
+	// Skip entities that have a component in any of the given containers
+	template <typename... Others>
+	View& exclude(Others&... others) {
+		int expand[] = { 0, (excluded.push_back(&others), 0)... };
+		(void)expand;
+		versions.clear();
+		return *this;
+	}
+
+	// Iterate in the order of the first container instead of the smallest, e.g. for draw order
+	View& ordered() {
+		keep_order = true;
+		versions.clear();
+		return *this;
+	}
+
+	// Rebuild the match list if any involved container changed since the last call
+	void refresh() {
+		if (is_up_to_date())
+			return;
+
+		std::array<ContainerInterface*, COUNT> inc = included(Indices());
+		std::array<std::vector<Entity>*, COUNT> lists = entity_lists(Indices());
+		size_t lead = 0;
+		if (!keep_order)
+			for (size_t i = 1; i < COUNT; i++)
+				if (inc[i]->size() < inc[lead]->size())
+					lead = i;
+
+		matches.clear();
+		match_cIDs.clear();
+		std::array<unsigned int, COUNT> cIDs;
+		for (Entity e : *lists[lead]) {
+			bool skip = false;
+			for (ContainerInterface* other : excluded)
+				if (other->has(e)) { skip = true; break; }
+			if (skip || !find_all(e, cIDs, Indices()))
+				continue;
+			matches.push_back(e);
+			match_cIDs.push_back(cIDs);
+		}
+
+		versions.clear();
+		for (ContainerInterface* c : inc)
+			versions.push_back(c->version());
+		for (ContainerInterface* c : excluded)
+			versions.push_back(c->version());
+	}
+
+	// Calls func(Entity, Components&...) for every match
+	template <typename Func>
+	void each(Func&& func) {
+		refresh();
+		for (size_t k = 0; k < matches.size(); k++)
+			invoke(func, k, Indices());
+	}
+
+	// The matching entities, e.g. for counting or handing to code that takes entity lists
+	const std::vector<Entity>& entities() {
+		refresh();
+		return matches;
+	}
+
+	// Range-for support; dereferencing yields std::tuple<Entity, Components&...>
+	class iterator
+	{
+		View* view;
+		size_t k;
+	public:
+		iterator(View* view, size_t k) : view(view), k(k) {}
+		std::tuple<Entity, Components&...> operator*() { return view->make_tuple_at(k, Indices()); }
+		iterator& operator++() { k++; return *this; }
+		bool operator!=(const iterator& other) const { return k != other.k; }
+	};
+	iterator begin() { refresh(); return iterator(this, 0); }
+	iterator end() { return iterator(this, matches.size()); }
+};
+
 // A container that stores components of type 'Component' and associated world positions
 // Used for components that are properties of world positions rather than entities
 template <typename Component> // A component can be any class
@@ -156,6 +427,7 @@ class PositionalComponentContainer : public PositionalContainerInterface
 private:
 	// The hash map from position -> array index.
 	std::unordered_map<int, unsigned int> map_pos_componentID;
+	unsigned int modification_count = 0;
 
 	bool registered = false;
 
@@ -187,6 +459,7 @@ public:
 		components.push_back(std::move(c)); // the move enforces move instead of copy constructor
 		position_xs.push_back(x);
 		position_ys.push_back(y);
+		modification_count++;
 
 		return components.back();
 	};
@@ -236,6 +509,7 @@ public:
 			components.pop_back();
 			position_xs.pop_back();
 			position_ys.pop_back();
+			modification_count++;
 		}
 	};
 
@@ -246,6 +520,7 @@ public:
 		components.clear();
 		position_xs.clear();
 		position_ys.clear();
+		modification_count++;
 	}
 
 	// Report the number of components of type 'Component'
@@ -254,6 +529,12 @@ public:
 		return components.size();
 	}
 
+	// Bumped whenever positions are added or removed, e.g. so systems can notice chunk (un)loads
+	unsigned int version()
+	{
+		return modification_count;
+	}
+
 	// Sort the components and associated positions assignment structures by the comparisonFunction, see std::sort
 	/*template <class Compare>
 	void sort(Compare comparisonFunction)
@@ -48,7 +48,6 @@ public:
 	ComponentContainer<MovementAnimation> movementAnimations;
 	ComponentContainer<Deadly> deadlies;
 	ComponentContainer<StationaryEnemy> stationaryEnemies;
-	ComponentContainer<Particle> particles;
 	ComponentContainer<Drop> drops;
 	ComponentContainer<Trail> trails;
 	ComponentContainer<Boss> boss_parts;
@@ -99,7 +98,6 @@ public:
 		registry_list.push_back(&movementAnimations);
 		registry_list.push_back(&deadlies);
 		registry_list.push_back(&stationaryEnemies);
-		registry_list.push_back(&particles);
 		registry_list.push_back(&drops);
 		registry_list.push_back(&trails);
 		registry_list.push_back(&boss_parts);
@@ -110,6 +108,12 @@ public:
 		positional_registry_list.push_back(&serial_chunks);
 	}
 
+	// Query helper; see View in tiny_ecs.hpp
+	template <typename... Components>
+	View<Components...> view(ComponentContainer<Components>&... containers) {
+		return View<Components...>(containers...);
+	}
+
 	void clear_all_components() {
 		for (ContainerInterface* reg : registry_list)
 			reg->clear();
@@ -142,9 +146,12 @@ public:
 				(void)reg; // Suppress unused warning
 	}
 
+	// Destroys the entity: its components are removed and its slot is returned for re-use,
+	// after which any remaining copies of the handle are stale
 	void remove_all_components_of(Entity e) {
 		for (ContainerInterface* reg : registry_list)
 			reg->remove(e);
+		Entity::release(e);
 	}
 	void remove_all_components_of(short x, short y) {
 		for (PositionalContainerInterface* reg : positional_registry_list)
@@ -930,10 +930,10 @@ void InventorySystem::ProcessEvent(Rml::Event& event)
 	}
 	
 	if (target->HasAttribute("data-weapon-id")) {
-		unsigned int weapon_id = std::stoi(target->GetAttribute("data-weapon-id")->Get<Rml::String>());
+		unsigned int weapon_id = (unsigned int)std::stoul(target->GetAttribute("data-weapon-id")->Get<Rml::String>());
 		Entity player = registry.players.entities[0];
 		
-		Entity weapon_entity;
+		Entity weapon_entity = Entity::null();
 		bool found = false;
 		for (Entity entity : registry.weapons.entities) {
 			if ((unsigned int)entity == weapon_id) {
@@ -960,12 +960,12 @@ void InventorySystem::ProcessEvent(Rml::Event& event)
 		// Format: "weapon_id:upgrade_type"
 		size_t colon_pos = upgrade_data.find(':');
 		if (colon_pos != std::string::npos) {
-			unsigned int weapon_id = std::stoi(upgrade_data.substr(0, colon_pos));
+			unsigned int weapon_id = (unsigned int)std::stoul(upgrade_data.substr(0, colon_pos));
 			std::string upgrade_type = upgrade_data.substr(colon_pos + 1);
 			
 			Entity player = registry.players.entities[0];
 			
-			Entity weapon_entity;
+			Entity weapon_entity = Entity::null();
 			bool found = false;
 			for (Entity entity : registry.weapons.entities) {
 				if ((unsigned int)entity == weapon_id) {
@@ -982,10 +982,10 @@ void InventorySystem::ProcessEvent(Rml::Event& event)
 		}
 	}
 	else if (target->HasAttribute("data-armour-id")) {
-		unsigned int armour_id = std::stoi(target->GetAttribute("data-armour-id")->Get<Rml::String>());
+		unsigned int armour_id = (unsigned int)std::stoul(target->GetAttribute("data-armour-id")->Get<Rml::String>());
 		Entity player = registry.players.entities[0];
 
-		Entity armour_entity;
+		Entity armour_entity = Entity::null();
 		bool found = false;
 		for (Entity entity : registry.armours.entities) {
 			if ((unsigned int)entity == armour_id) {
@@ -0,0 +1,45 @@
+// internal
+#include "world_cells.hpp"
+
+#include <algorithm>
+
+const Chunk* WorldCellQuery::lookup(glm::ivec2 chunk)
+{
+	last_chunk = chunk;
+	seen_version = registry.chunks.version();
+	has_last = true;
+	short x = (short)chunk.x, y = (short)chunk.y;
+	last_hit = registry.chunks.has(x, y) ? &registry.chunks.get(x, y) : nullptr;
+	return last_hit;
+}
+
+void WorldCellQuery::fetch_rect(glm::ivec2 min, int width, int height, CHUNK_CELL_STATE* out)
+{
+	if (width <= 0 || height <= 0)
+		return;
+	const int side = (int)CHUNK_CELLS_PER_ROW;
+	const glm::ivec2 max = min + glm::ivec2(width - 1, height - 1);
+	const glm::ivec2 min_chunk = chunk_of_cell(min);
+	const glm::ivec2 max_chunk = chunk_of_cell(max);
+
+	for (int cy = min_chunk.y; cy <= max_chunk.y; cy++) {
+		for (int cx = min_chunk.x; cx <= max_chunk.x; cx++) {
+			// part of the rectangle covered by this chunk, in global cells
+			const glm::ivec2 origin(cx * side, cy * side);
+			const glm::ivec2 lo = glm::max(min, origin);
+			const glm::ivec2 hi = glm::min(max, origin + side - 1);
+			const Chunk* chunk = find({ cx, cy });
+
+			for (int y = lo.y; y <= hi.y; y++) {
+				CHUNK_CELL_STATE* row = out + (y - min.y) * width + (lo.x - min.x);
+				if (!chunk) {
+					std::fill(row, row + (hi.x - lo.x + 1), CHUNK_CELL_STATE::EMPTY);
+					continue;
+				}
+				const int ly = y - origin.y;
+				for (int x = lo.x; x <= hi.x; x++)
+					*row++ = chunk->cell_states[x - origin.x][ly];
+			}
+		}
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "components.hpp"
+#include "tiny_ecs_registry.hpp"
+
+#include <glm/vec2.hpp>
+
+// Chunk containing a global cell coordinate; rounds towards negative infinity so cell -1 is in chunk -1
+inline glm::ivec2 chunk_of_cell(glm::ivec2 cell)
+{
+	const int side = (int)CHUNK_CELLS_PER_ROW;
+	return {
+		(cell.x >= 0 ? cell.x : cell.x - side + 1) / side,
+		(cell.y >= 0 ? cell.y : cell.y - side + 1) / side
+	};
+}
+
+// Position of a global cell coordinate inside its chunk, in [0, CHUNK_CELLS_PER_ROW)
+inline glm::ivec2 local_cell(glm::ivec2 cell)
+{
+	return cell - chunk_of_cell(cell) * (int)CHUNK_CELLS_PER_ROW;
+}
+
+// Reads chunk cell states by global cell coordinate; cells of unloaded chunks read as EMPTY.
+// The last chunk looked up is remembered, so runs of nearby probes skip the positional hash lookup.
+// The cache is dropped whenever registry.chunks changes, since that may move the chunks in memory.
+class WorldCellQuery
+{
+public:
+	CHUNK_CELL_STATE get(glm::ivec2 cell)
+	{
+		const Chunk* chunk = find(chunk_of_cell(cell));
+		if (!chunk)
+			return CHUNK_CELL_STATE::EMPTY;
+		const glm::ivec2 local = local_cell(cell);
+		return chunk->cell_states[local.x][local.y];
+	}
+
+	// Copies the states of the width x height rectangle whose top-left cell is `min` into `out`,
+	// row-major (out[y * width + x]). Each chunk overlapping the rectangle is looked up once.
+	void fetch_rect(glm::ivec2 min, int width, int height, CHUNK_CELL_STATE* out);
+
+	// Forget the cached chunk
+	void reset() { has_last = false; }
+
+private:
+	glm::ivec2 last_chunk{ 0, 0 };
+	const Chunk* last_hit = nullptr;
+	bool has_last = false;
+	unsigned int seen_version = 0;
+
+	const Chunk* find(glm::ivec2 chunk)
+	{
+		if (has_last && chunk == last_chunk && registry.chunks.version() == seen_version)
+			return last_hit;
+		return lookup(chunk);
+	}
+	const Chunk* lookup(glm::ivec2 chunk);
+};
@@ -1,7 +1,8 @@
 #include "common.hpp"
 #include "world_init.hpp"
 #include "tiny_ecs_registry.hpp"
-#include "boss_system.hpp"
+#include "particle_pool.hpp"
+#include "chunk_region_store.hpp"
 #include <utility>
 
 Entity createPlayer(RenderSystem* renderer, vec2 pos)
@@ -286,12 +287,9 @@ Entity createArrow(RenderSystem* renderer)
 
 void createBloodParticles(vec2 pos, vec2 bullet_vel, int count) {
   for (int i = 0; i < count; i++) {
-    auto entity = Entity();
-    Particle& p = registry.particles.emplace(entity);
-
     float ox = ((rand() / (float)RAND_MAX) - 0.5f) * 10.f;
     float oy = ((rand() / (float)RAND_MAX) - 0.5f) * 10.f;
-    p.position = vec3(pos.x + ox, pos.y + oy, 0);
+    vec2 position = vec2(pos.x + ox, pos.y + oy);
 
     float base = atan2(bullet_vel.y, bullet_vel.x);
 
@@ -304,46 +302,32 @@ void createBloodParticles(vec2 pos, vec2 bullet_vel, int count) {
 
     float speed = 200.f + (rand() / (float)RAND_MAX) * 150.f;
 
-    p.velocity = vec3(dir.x * speed, dir.y * speed, 0);
-    p.color = vec4(0.7f, 0.05f, 0.05f, 1.f);
-    p.size = 8.f;
-
-    p.lifetime = 0.3f + (rand() / (float)RAND_MAX) * 0.3f;
-    p.age = 0.f;
-    p.alive = true;
+    float lifetime = 0.3f + (rand() / (float)RAND_MAX) * 0.3f;
+    particle_pool.emit(position, dir * speed, vec4(0.7f, 0.05f, 0.05f, 1.f), 8.f, lifetime);
   }
 }
 
 void createBossBloodParticles(vec2 pos, int count) {
   for (int i = 0; i < count; i++) {
-    auto entity = Entity();
-    Particle& p = registry.particles.emplace(entity);
-
     float radius = 20.f + ((float)rand() / RAND_MAX) * 20.f;
     float a = ((float)rand() / RAND_MAX) * 2.f * M_PI;
     float r = radius * sqrt((float)rand() / RAND_MAX);
 
     float ox = cos(a) * r;
     float oy = sin(a) * r;
-    p.position = vec3(pos.x + ox, pos.y + oy, 0);
+    vec2 position = vec2(pos.x + ox, pos.y + oy);
 
     float angle = ((float)rand() / RAND_MAX) * 2.f * M_PI;
     vec2 dir = normalize(vec2(cos(angle), sin(angle)));
 
     float speed = 150.f + ((float)rand() / RAND_MAX) * 400.f;
-    p.velocity = vec3(dir.x * speed, dir.y * speed, 0);
 
     float size = 10.f + ((float)rand() / RAND_MAX) * 10.f;
-    p.size = size;
 
     float lifetime = 0.3f + ((float)rand() / RAND_MAX) * 0.8f;
-    p.lifetime = lifetime;
 
     float c = 0.7f + ((float)rand() / RAND_MAX) * 0.1f;
-    p.color = vec4(c, 0.05f, 0.05f, 1.f);
-
-    p.age = 0.f;
-    p.alive = true;
+    particle_pool.emit(position, dir * speed, vec4(c, 0.05f, 0.05f, 1.f), size, lifetime);
   }
 }
 
@@ -362,23 +346,11 @@ void createBeamParticlesCone(vec2 origin, vec2 dir, int count, vec4 col) {
   float minR = coneLen * 0.05f;
   int real_count = count * 15;
   for (int i = 0; i < real_count; i++) {
-    auto entity = Entity();
-    Particle& p = registry.particles.emplace(entity);
-
     vec2 pos = randomPointInCone(origin, dir, 0.3f, minR, coneLen);
-    float z = ((rand() / (float)RAND_MAX) - 0.5f) * 0.001f;
-    p.position = vec3(pos.x, pos.y, z);
 
     vec2 v = normalize(pos - origin);
     float speed = 4.f + (rand() / (float)RAND_MAX) * 4.f;
-    p.velocity = vec3(v.x * speed, v.y * speed, 0);
-
-    p.color = col;
-    p.size = 7.f;
-
-    p.lifetime = 0.5f;
-    p.age = 0.f;
-    p.alive = true;
+    particle_pool.emit(pos, v * speed, col, 7.f, 0.5f);
   }
 }
 
@@ -388,9 +360,6 @@ void createDashParticles(vec2 pos, vec2 dash_dir) {
   int particle_count = 6 + (rand() % 5); // 6-10 particles per call (increased from 3-5)
   
   for (int i = 0; i < particle_count; i++) {
-    auto entity = Entity();
-    Particle& p = registry.particles.emplace(entity);
-    
     // Position particles behind the player with some spread
     float offset_dist = 20.f + ((rand() / (float)RAND_MAX) * 30.f);
     float spread_angle = ((rand() / (float)RAND_MAX) - 0.5f) * 0.4f;
@@ -405,24 +374,22 @@ void createDashParticles(vec2 pos, vec2 dash_dir) {
     ox += cos(perp_angle) * perp_spread;
     oy += sin(perp_angle) * perp_spread;
     
-    p.position = vec3(pos.x + ox, pos.y + oy, 0);
+    vec2 position = vec2(pos.x + ox, pos.y + oy);
     
     // Velocity points backward (opposite of dash direction) with some randomness
     vec2 vel_dir = normalize(vec2(cos(angle), sin(angle)));
     float speed = 50.f + (rand() / (float)RAND_MAX) * 100.f;
-    p.velocity = vec3(vel_dir.x * speed, vel_dir.y * speed, 0);
     
     float blue_intensity = 0.6f + (rand() / (float)RAND_MAX) * 0.4f; // 0.6 to 1.0
     float green_tint = 0.3f + (rand() / (float)RAND_MAX) * 0.3f; // 0.3 to 0.6 for cyan-blue
-    p.color = vec4(0.2f, green_tint, blue_intensity, 1.f);
+    vec4 color = vec4(0.2f, green_tint, blue_intensity, 1.f);
     
     // Size variation
-    p.size = 6.f + (rand() / (float)RAND_MAX) * 8.f; // 6 to 14
+    float size = 6.f + (rand() / (float)RAND_MAX) * 8.f; // 6 to 14
     
     // Lifetime - particles fade out
-    p.lifetime = 0.3f + (rand() / (float)RAND_MAX) * 0.2f; // 0.3 to 0.5 seconds
-    p.age = 0.f;
-    p.alive = true;
+    float lifetime = 0.3f + (rand() / (float)RAND_MAX) * 0.2f; // 0.3 to 0.5 seconds
+    particle_pool.emit(position, vel_dir * speed, color, size, lifetime);
   }
 }
 
@@ -589,19 +556,7 @@ Entity createMinion(RenderSystem* renderer, vec2 pos)
 	enemy.max_health = 0;
 	enemy.damage = 5;
 	enemy.xylarite_drop = 0;
-	enemy.death_animation = [](Entity entity, float step_seconds) {
-		Motion& m = registry.motions.get(entity);
-
-		vec2 dpos = m.position;
-		boss::onMinionDeath(dpos);
-
-		m.angle += 3.f * M_PI * step_seconds;
-		m.velocity = vec2(0.f, 0.f);
-		m.scale -= vec2(30.f) * step_seconds;
-
-		if (m.scale.x < 0.f || m.scale.y < 0.f)
-			registry.remove_all_components_of(entity);
-	};
+	enemy.animation = EnemyAnimation::MINION;
 
 	registry.collisionCircles.emplace(entity).radius = 20.f;
 	Minion& mn = registry.minions.emplace(entity);
@@ -721,19 +676,7 @@ Entity createSlime(RenderSystem* renderer, vec2 pos, const LevelManager& level_m
 	enemy.max_health = final_health;
 	enemy.damage = final_damage;
 	enemy.xylarite_drop = level;
-	enemy.death_animation = [renderer, motion](Entity entity, float step_seconds) {
-		Sprite& sprite = registry.sprites.get(entity);
-		
-		if(sprite.curr_row == 0) {
-			sprite.curr_row = 1;
-			sprite.curr_frame = 0;
-			sprite.step_seconds_acc = 0.0f;
-		}
-
-		if (sprite.step_seconds_acc > sprite.total_frame) {
-			registry.remove_all_components_of(entity);
-		}
-	};
+	enemy.animation = EnemyAnimation::SLIME;
 
 	// collision circle decoupled from visuals
 	registry.collisionCircles.emplace(entity).radius = 18.f;
@@ -778,14 +721,6 @@ Entity createEvilPlant(RenderSystem* renderer, vec2 pos, const LevelManager& lev
 		static_cast<int>(TEXTURE_ASSET_ID::PLANT_IDLE_1) + (std::min(3, level) - 1) * 4
 	);
 
-	TEXTURE_ASSET_ID hurt_texure_id = static_cast<TEXTURE_ASSET_ID>(
-		static_cast<int>(TEXTURE_ASSET_ID::PLANT_HURT_1) + (std::min(3, level) - 1) * 4
-	);
-
-	TEXTURE_ASSET_ID death_texure_id = static_cast<TEXTURE_ASSET_ID>(
-		static_cast<int>(TEXTURE_ASSET_ID::PLANT_DEATH_1) + (std::min(3, level) - 1) * 4
-	);
-
 	Enemy& enemy = registry.enemies.emplace(entity);
 	
 	// Base stats for evil plant enemy type (stronger, stationary)
@@ -802,50 +737,8 @@ Entity createEvilPlant(RenderSystem* renderer, vec2 pos, const LevelManager& lev
 	enemy.max_health = final_health;
 	enemy.damage = final_damage;
 	enemy.xylarite_drop = level;
-	enemy.death_animation = [death_texure_id](Entity entity, float step_seconds) {
-		RenderRequest& render = registry.renderRequests.get(entity);
-		Sprite& sprite = registry.sprites.get(entity);
-
-		if (render.used_texture != death_texure_id) {
-			render.used_texture = death_texure_id;
-			sprite.total_row = 4;
-			sprite.total_frame = 10;
-			sprite.curr_frame = 0;
-			sprite.step_seconds_acc = 0.0f;
-		}
-
-		if (sprite.step_seconds_acc > sprite.total_frame - 1) {
-			registry.remove_all_components_of(entity);
-		}
-	};
-
-	enemy.hurt_animation = [hurt_texure_id, idle_texure_id](Entity entity, float step_seconds) {
-		RenderRequest& render = registry.renderRequests.get(entity);
-		Sprite& sprite = registry.sprites.get(entity);
-		Enemy& enemy = registry.enemies.get(entity);
-
-		if (render.used_texture != hurt_texure_id) {
-			render.used_texture = hurt_texure_id;
-			sprite.total_row = 4;
-			sprite.total_frame = 5;
-			sprite.curr_frame = 0;
-			sprite.step_seconds_acc = 0.0f;
-			sprite.animation_speed = 25.f;
-		}
-
-		if (sprite.step_seconds_acc > sprite.total_frame - 1) {
-			enemy.is_hurt = false;
-		}
-
-		if (!enemy.is_hurt) {
-			render.used_texture = idle_texure_id;
-			sprite.total_row = 4;
-			sprite.total_frame = 4;
-			sprite.curr_frame = 0;
-			sprite.step_seconds_acc = 0.0f;
-			sprite.animation_speed = 10.f;
-		}
-	};
+	enemy.animation = EnemyAnimation::EVIL_PLANT;
+	enemy.variant = (unsigned char)(std::min(3, level) - 1);
 
 	StationaryEnemy& stat_enemy = registry.stationaryEnemies.emplace(entity);
 	stat_enemy.position = pos;
@@ -1175,7 +1068,7 @@ bool cell_has_obstacle(vec2 chunk_pos, vec2 cell_pos) {
 	if (registry.chunks.has(chunk_pos_x, chunk_pos_y)) {
 		Chunk& chunk = registry.chunks.get(chunk_pos_x, chunk_pos_y);
 		return is_obstacle(chunk.cell_states[(size_t) cell_pos.x][(size_t) cell_pos.y]);
-	} else if (registry.serial_chunks.has(chunk_pos_x, chunk_pos_y)) {
+	} else if (chunk_store.page_in(chunk_pos_x, chunk_pos_y)) {
 		float cell_size = (float) CHUNK_CELL_SIZE;
 		float chunk_size = cell_size * (float) CHUNK_CELLS_PER_ROW;
 
@@ -1225,57 +1118,38 @@ ChunkBoundary& get_chunk_bound(vec2 chunk_pos) {
 	}
 }
 
-// Generate a section of the world
-Chunk& generateChunk(RenderSystem* renderer, vec2 chunk_pos, PerlinNoiseGenerator& map_noise, PerlinNoiseGenerator& decorator_noise, std::default_random_engine& rng, bool is_spawn_chunk, bool is_boss_chunk) {
-	/////////////////////////
-	// INITIALIZATION STEP //
-	/////////////////////////
-
-	// Check if chunk has already been generated
-	short chunk_pos_x = (short) chunk_pos.x;
-	short chunk_pos_y = (short) chunk_pos.y;
-	if (registry.chunks.has(chunk_pos_x, chunk_pos_y))
-		return registry.chunks.get(chunk_pos_x, chunk_pos_y);
-
-	std::uniform_real_distribution<float> uniform_dist;
+// Noise-derived cell states of a chunk. Reads nothing but the noise generator, so it is safe to
+// run on a worker thread and always gives the same cells for the same seed and position.
+ChunkCellGrid generateChunkCells(vec2 chunk_pos, const PerlinNoiseGenerator& map_noise) {
 	float cell_size = (float) CHUNK_CELL_SIZE;
-	float cells_per_row = (float) CHUNK_CELLS_PER_ROW;
-	float chunk_width = cells_per_row * cell_size;
-	float chunk_height = cells_per_row * cell_size;
-
-	vec2 base_world_pos = vec2(chunk_width*((float) chunk_pos_x), chunk_height*((float) chunk_pos_y));
+	float chunk_width = (float) CHUNK_CELLS_PER_ROW * cell_size;
+	float chunk_height = (float) CHUNK_CELLS_PER_ROW * cell_size;
+	vec2 base_world_pos = vec2(chunk_width*((float) (short) chunk_pos.x), chunk_height*((float) (short) chunk_pos.y));
 	float noise_scale = (float) CHUNK_NOISE_PER_CHUNK / chunk_width;
 
-	// initialize new chunk
-	Chunk& chunk = registry.chunks.emplace(chunk_pos_x, chunk_pos_y);
-	chunk.cell_states.resize(CHUNK_CELLS_PER_ROW);
-	for (int i = 0; i < CHUNK_CELLS_PER_ROW; i++) {
-		chunk.cell_states[i].assign(CHUNK_CELLS_PER_ROW, CHUNK_CELL_STATE::EMPTY);
+	// Sample the isoline corners shared by neighbouring 4x4 regions once, as one grid
+	const size_t corners_per_row = CHUNK_CELLS_PER_ROW / CHUNK_ISOLINE_SIZE + 1;
+	float corner_xs[corners_per_row];
+	float corner_ys[corners_per_row];
+	for (size_t k = 0; k < corners_per_row; k++) {
+		double offset = (double) (k * CHUNK_ISOLINE_SIZE) + 0.5;
+		corner_xs[k] = (float) (noise_scale * (base_world_pos.x + cell_size*offset));
+		corner_ys[k] = (float) (noise_scale * (base_world_pos.y + cell_size*offset));
 	}
+	float corner_noise[corners_per_row * corners_per_row];
+	map_noise.noise_grid(corner_xs, corners_per_row, corner_ys, corners_per_row, corner_noise);
 
-	// populate chunk cell data
-	for (size_t i = 0; i < CHUNK_CELLS_PER_ROW; i += CHUNK_ISOLINE_SIZE) {
-		for (int u = 0; u < CHUNK_ISOLINE_SIZE; u++) {
-			chunk.cell_states[i+u].resize(CHUNK_CELLS_PER_ROW);
-		}
-	}
-
-	//////////////////
-	// ISOLINE STEP //
-	//////////////////
-
+	ChunkCellGrid cells{};
 	// Compute marching quad (isoline) obstacle data over 4x4 regions of the chunk
 	for (size_t i = 0; i < CHUNK_CELLS_PER_ROW; i += CHUNK_ISOLINE_SIZE) {
 		for (size_t j = 0; j < CHUNK_CELLS_PER_ROW; j += CHUNK_ISOLINE_SIZE) {
 			unsigned char iso_quad_state = 0;
-			float noise_a = map_noise.noise(noise_scale * (base_world_pos.x + cell_size*((float) i+0.5)),
-								noise_scale * (base_world_pos.y + cell_size*((float) j+0.5)));
-			float noise_b = map_noise.noise(noise_scale * (base_world_pos.x + cell_size*((float) i+4.5)),
-								noise_scale * (base_world_pos.y + cell_size*((float) j+0.5)));
-			float noise_c = map_noise.noise(noise_scale * (base_world_pos.x + cell_size*((float) i+4.5)),
-								noise_scale * (base_world_pos.y + cell_size*((float) j+4.5)));
-			float noise_d = map_noise.noise(noise_scale * (base_world_pos.x + cell_size*((float) i+0.5)),
-								noise_scale * (base_world_pos.y + cell_size*((float) j+4.5)));
+			size_t ci = i / CHUNK_ISOLINE_SIZE;
+			size_t cj = j / CHUNK_ISOLINE_SIZE;
+			float noise_a = corner_noise[cj * corners_per_row + ci];
+			float noise_b = corner_noise[cj * corners_per_row + ci + 1];
+			float noise_c = corner_noise[(cj + 1) * corners_per_row + ci + 1];
+			float noise_d = corner_noise[(cj + 1) * corners_per_row + ci];
 			
 			if (noise_a > CHUNK_ISOLINE_THRESHOLD)
 				iso_quad_state += 1;
@@ -1289,56 +1163,114 @@ Chunk& generateChunk(RenderSystem* renderer, vec2 chunk_pos, PerlinNoiseGenerato
 			// partition cells into "isoline" and "non-isoline" groups
 			CHUNK_CELL_STATE state = iso_bitmap_to_state(iso_quad_state);
 			
-			chunk.cell_states[i][j] = ((iso_quad_state & 1) == 1)
+			cells[i][j] = ((iso_quad_state & 1) == 1)
 				? state : CHUNK_CELL_STATE::EMPTY;
-			chunk.cell_states[i][j+1] = ((iso_quad_state & 1) == 1)
+			cells[i][j+1] = ((iso_quad_state & 1) == 1)
 				? state : CHUNK_CELL_STATE::EMPTY;
-			chunk.cell_states[i][j+2] = ((iso_quad_state & 8) == 8)
+			cells[i][j+2] = ((iso_quad_state & 8) == 8)
 				? state : CHUNK_CELL_STATE::EMPTY;
-			chunk.cell_states[i][j+3] = ((iso_quad_state & 8) == 8)
+			cells[i][j+3] = ((iso_quad_state & 8) == 8)
 				? state : CHUNK_CELL_STATE::EMPTY;
-			chunk.cell_states[i+1][j] = ((iso_quad_state & 1) == 1)
+			cells[i+1][j] = ((iso_quad_state & 1) == 1)
 				? state : CHUNK_CELL_STATE::EMPTY;
-			chunk.cell_states[i+1][j+1] = ((iso_quad_state & 1) == 1 && (iso_quad_state & 10) > 0)
+			cells[i+1][j+1] = ((iso_quad_state & 1) == 1 && (iso_quad_state & 10) > 0)
 				? state : CHUNK_CELL_STATE::EMPTY;
-			chunk.cell_states[i+1][j+2] = ((iso_quad_state & 8) == 8 && (iso_quad_state & 5) > 0)
+			cells[i+1][j+2] = ((iso_quad_state & 8) == 8 && (iso_quad_state & 5) > 0)
 				? state : CHUNK_CELL_STATE::EMPTY;
-			chunk.cell_states[i+1][j+3] = ((iso_quad_state & 8) == 8)
+			cells[i+1][j+3] = ((iso_quad_state & 8) == 8)
 				? state : CHUNK_CELL_STATE::EMPTY;
-			chunk.cell_states[i+2][j] = ((iso_quad_state & 2) == 2)
+			cells[i+2][j] = ((iso_quad_state & 2) == 2)
 				? state : CHUNK_CELL_STATE::EMPTY;
-			chunk.cell_states[i+2][j+1] = ((iso_quad_state & 2) == 2 && (iso_quad_state & 5) > 0)
+			cells[i+2][j+1] = ((iso_quad_state & 2) == 2 && (iso_quad_state & 5) > 0)
 				? state : CHUNK_CELL_STATE::EMPTY;
-			chunk.cell_states[i+2][j+2] = ((iso_quad_state & 4) == 4 && (iso_quad_state & 10) > 0)
+			cells[i+2][j+2] = ((iso_quad_state & 4) == 4 && (iso_quad_state & 10) > 0)
 				? state : CHUNK_CELL_STATE::EMPTY;
-			chunk.cell_states[i+2][j+3] = ((iso_quad_state & 4) == 4)
+			cells[i+2][j+3] = ((iso_quad_state & 4) == 4)
 				? state : CHUNK_CELL_STATE::EMPTY;
-			chunk.cell_states[i+3][j] = ((iso_quad_state & 2) == 2)
+			cells[i+3][j] = ((iso_quad_state & 2) == 2)
 				? state : CHUNK_CELL_STATE::EMPTY;
-			chunk.cell_states[i+3][j+1] = ((iso_quad_state & 2) == 2)
+			cells[i+3][j+1] = ((iso_quad_state & 2) == 2)
 				? state : CHUNK_CELL_STATE::EMPTY;
-			chunk.cell_states[i+3][j+2] = ((iso_quad_state & 4) == 4)
+			cells[i+3][j+2] = ((iso_quad_state & 4) == 4)
 				? state : CHUNK_CELL_STATE::EMPTY;
-			chunk.cell_states[i+3][j+3] = ((iso_quad_state & 4) == 4)
+			cells[i+3][j+3] = ((iso_quad_state & 4) == 4)
 				? state : CHUNK_CELL_STATE::EMPTY;
 
-			// find eligible non-isoline cells
-			for (int u = 0; u < CHUNK_ISOLINE_SIZE; u++) {
-				for (int v = 0; v < CHUNK_ISOLINE_SIZE; v++) {
-					if (chunk.cell_states[i+u][j+v] == CHUNK_CELL_STATE::EMPTY) {
-						float noise_val = map_noise.noise(noise_scale * (base_world_pos.x + cell_size*((float) i+u+0.5f)),
-							noise_scale * (base_world_pos.y + cell_size*((float) j+v+0.5f)));
-						
-						if (noise_val < CHUNK_NO_OBSTACLE_THRESHOLD) {
-							// mark as empty area
-							chunk.cell_states[i+u][j+v] = CHUNK_CELL_STATE::NO_OBSTACLE_AREA;
-						}
-					}
-				}
-			}
 		} 
 	}
 
+	// find eligible non-isoline cells, then sample them all in one batch
+	float cell_xs[CHUNK_CELLS_PER_ROW];
+	float cell_ys[CHUNK_CELLS_PER_ROW];
+	for (size_t k = 0; k < CHUNK_CELLS_PER_ROW; k++) {
+		cell_xs[k] = noise_scale * (base_world_pos.x + cell_size*((float) k+0.5f));
+		cell_ys[k] = noise_scale * (base_world_pos.y + cell_size*((float) k+0.5f));
+	}
+	std::vector<float> empty_xs, empty_ys, empty_noise;
+	std::vector<unsigned short> empty_cells;
+	empty_xs.reserve(CHUNK_CELLS_PER_ROW * CHUNK_CELLS_PER_ROW);
+	empty_ys.reserve(CHUNK_CELLS_PER_ROW * CHUNK_CELLS_PER_ROW);
+	empty_cells.reserve(CHUNK_CELLS_PER_ROW * CHUNK_CELLS_PER_ROW);
+	for (size_t i = 0; i < CHUNK_CELLS_PER_ROW; i++) {
+		for (size_t j = 0; j < CHUNK_CELLS_PER_ROW; j++) {
+			if (cells[i][j] == CHUNK_CELL_STATE::EMPTY) {
+				empty_xs.push_back(cell_xs[i]);
+				empty_ys.push_back(cell_ys[j]);
+				empty_cells.push_back((unsigned short) (i * CHUNK_CELLS_PER_ROW + j));
+			}
+		}
+	}
+	empty_noise.resize(empty_cells.size());
+	map_noise.noise_batch(empty_xs.data(), empty_ys.data(), empty_noise.data(), empty_cells.size());
+
+	for (size_t k = 0; k < empty_cells.size(); k++) {
+		if (empty_noise[k] < CHUNK_NO_OBSTACLE_THRESHOLD) {
+			// mark as empty area
+			cells[empty_cells[k] / CHUNK_CELLS_PER_ROW][empty_cells[k] % CHUNK_CELLS_PER_ROW] = CHUNK_CELL_STATE::NO_OBSTACLE_AREA;
+		}
+	}
+
+	return cells;
+}
+
+// Generate a section of the world
+Chunk& generateChunk(RenderSystem* renderer, vec2 chunk_pos, PerlinNoiseGenerator& map_noise, PerlinNoiseGenerator& decorator_noise, std::default_random_engine& rng, bool is_spawn_chunk, bool is_boss_chunk, const ChunkCellGrid* cells) {
+	/////////////////////////
+	// INITIALIZATION STEP //
+	/////////////////////////
+
+	// Check if chunk has already been generated
+	short chunk_pos_x = (short) chunk_pos.x;
+	short chunk_pos_y = (short) chunk_pos.y;
+	if (registry.chunks.has(chunk_pos_x, chunk_pos_y))
+		return registry.chunks.get(chunk_pos_x, chunk_pos_y);
+
+	// bring the chunk's serialized state back from its region file if it was evicted
+	chunk_store.page_in(chunk_pos_x, chunk_pos_y);
+
+	std::uniform_real_distribution<float> uniform_dist;
+	float cell_size = (float) CHUNK_CELL_SIZE;
+	float cells_per_row = (float) CHUNK_CELLS_PER_ROW;
+	float chunk_width = cells_per_row * cell_size;
+	float chunk_height = cells_per_row * cell_size;
+
+	vec2 base_world_pos = vec2(chunk_width*((float) chunk_pos_x), chunk_height*((float) chunk_pos_y));
+	float noise_scale = (float) CHUNK_NOISE_PER_CHUNK / chunk_width;
+
+	// initialize new chunk
+	Chunk& chunk = registry.chunks.emplace(chunk_pos_x, chunk_pos_y);
+
+	//////////////////
+	// ISOLINE STEP //
+	//////////////////
+
+	// Compute marching quad (isoline) obstacle data over 4x4 regions of the chunk,
+	// unless a ChunkGenerator worker already did
+	if (cells)
+		chunk.cell_states = *cells;
+	else
+		chunk.cell_states = generateChunkCells(chunk_pos, map_noise);
+
 	// Filter out isoline data from spawn area
 	if (is_spawn_chunk) {
 		vec2 spawn_position = {window_width_px/2, window_height_px - 200};
@@ -2039,6 +1971,9 @@ Chunk& generateChunk(RenderSystem* renderer, vec2 chunk_pos, PerlinNoiseGenerato
 		}
 	}
 
+	// the isoline cells are final now, so the chunk's rock can be baked for drawing
+	renderer->bakeChunkMesh(chunk_pos_x, chunk_pos_y, chunk);
+
 	return chunk;
 }
 
@@ -62,5 +62,8 @@ std::vector<Entity> createIsolineCollisionCircles(vec2 pos, CHUNK_CELL_STATE iso
 
 void removeIsolineCollisionCircles(std::vector<Entity>& collision_entities);
 
-// generate a new world chunk
-Chunk& generateChunk(RenderSystem* renderer, vec2 chunk_pos, PerlinNoiseGenerator& map_noise, PerlinNoiseGenerator& decorator_noise,std::default_random_engine& rng, bool is_spawn_chunk = false, bool is_boss_chunk = false);
+// compute the noise-derived cell states of a chunk (thread-safe, see ChunkGenerator)
+ChunkCellGrid generateChunkCells(vec2 chunk_pos, const PerlinNoiseGenerator& map_noise);
+
+// generate a new world chunk; `cells` may hold the output of generateChunkCells for it, computed ahead of time
+Chunk& generateChunk(RenderSystem* renderer, vec2 chunk_pos, PerlinNoiseGenerator& map_noise, PerlinNoiseGenerator& decorator_noise,std::default_random_engine& rng, bool is_spawn_chunk = false, bool is_boss_chunk = false, const ChunkCellGrid* cells = nullptr);
@@ -17,8 +17,11 @@
 #include "ai_system.hpp"
 #include "start_menu_system.hpp"
 #include "save_system.hpp"
+#include "save_stream.hpp"
 #include "death_screen_system.hpp"
 #include "boss_system.hpp"
+#include "particle_pool.hpp"
+#include "chunk_region_store.hpp"
 
 #ifdef HAVE_RMLUI
 #include <RmlUi/Core.h>
@@ -330,6 +333,8 @@ void WorldSystem::init(RenderSystem* renderer_arg, InventorySystem* inventory_ar
 
 	if (save_system) {
 		save_system->set_world_system(this);
+		if (save_system->ensure_save_directory_exists())
+			chunk_store.set_directory(save_system->get_region_directory());
 	}
 
 	if (start_menu_system && !start_menu_system->is_supported()) {
@@ -1633,12 +1638,23 @@ bool WorldSystem::step(float elapsed_ms_since_last_update) {
 	short right_chunk = (short) std::floor((cam_view.y + buffer) / chunk_size);
 	short top_chunk = (short) std::floor((cam_view.z - buffer) / chunk_size);
 	short bottom_chunk = (short) std::floor((cam_view.w + buffer) / chunk_size);
-	for (short i = left_chunk; i <= right_chunk; i++) {
-		for (short j = top_chunk; j <= bottom_chunk; j++) {
-			if (!registry.chunks.has(i, j) && !boss::isBossFight()) {
-				generateChunk(renderer, vec2(i, j), map_perlin, decorator_perlin, rng, false, false);
+	// Chunks reach this point with their cells already computed by a ChunkGenerator worker, so only
+	// entity creation runs here. Past the frame budget the rest wait for the next frame; the buffer
+	// around the view keeps that a few frames away from being visible.
+	if (!boss::isBossFight()) {
+		auto materialize_start = std::chrono::high_resolution_clock::now();
+		bool over_budget = false;
+		for (short i = left_chunk; i <= right_chunk && !over_budget; i++) {
+			for (short j = top_chunk; j <= bottom_chunk && !over_budget; j++) {
+				if (registry.chunks.has(i, j))
+					continue;
+				chunk_generator.materialize(renderer, ivec2(i, j), map_perlin, decorator_perlin, false, false);
+				float materialize_ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - materialize_start).count();
+				over_budget = materialize_ms > CHUNK_MATERIALIZE_BUDGET_MS;
 			}
 		}
+		chunk_generator.prefetch(ivec2(left_chunk - CHUNK_PREFETCH_RING, top_chunk - CHUNK_PREFETCH_RING),
+			ivec2(right_chunk + CHUNK_PREFETCH_RING, bottom_chunk + CHUNK_PREFETCH_RING));
 	}
 
 	// remove off-screen chunks to save space and compute time
@@ -1710,6 +1726,7 @@ bool WorldSystem::step(float elapsed_ms_since_last_update) {
 			for (Entity e : chunk.walls) {
 				registry.remove_all_components_of(e);
 			}
+			renderer->releaseChunkMesh(chunk);
 			chunksToRemove.push_back(vec2(chunk_pos_x, chunk_pos_y));
 		}
 	}
@@ -1717,6 +1734,9 @@ bool WorldSystem::step(float elapsed_ms_since_last_update) {
 		registry.chunks.remove((short) chunk_coord.x, (short) chunk_coord.y);
 	}
 
+	// keep the serialized chunks in RAM within budget, dropping the ones farthest from the view
+	chunk_store.evict(ivec2((left_chunk + right_chunk) / 2, (top_chunk + bottom_chunk) / 2));
+
 	const float isoline_half_size = (float)(CHUNK_CELL_SIZE * CHUNK_ISOLINE_SIZE) / 2.0f;
 	const float isoline_buffer = isoline_half_size + 100.f; // buffer for collision detection
 	for (int i = 0; i < registry.chunks.size(); i++) {
@@ -1827,38 +1847,7 @@ bool WorldSystem::step(float elapsed_ms_since_last_update) {
 	}
 
 	// Particle steps
-	for (Entity e : registry.particles.entities) {
-		Particle& p = registry.particles.get(e);
-
-		if (!p.alive) continue;
-
-		p.age += elapsed_seconds;
-		if (p.age >= p.lifetime) {
-			p.alive = false;
-			continue;
-		}
-
-		vec3 gravity = vec3(0, -300.f, 0);  
-		p.velocity += gravity * elapsed_seconds * 0.2f;
-
-		p.position += p.velocity * elapsed_seconds;
-
-		float t = p.age / p.lifetime;
-		p.color.a = 1.f - t;           
-	}
-
-	std::vector<Entity> to_delete;
-
-	for (Entity e : registry.particles.entities) {
-		Particle& p = registry.particles.get(e);
-		if (!p.alive) {
-			to_delete.push_back(e);
-		}
-	}
-
-	for (Entity e : to_delete) {
-		registry.remove_all_components_of(e);
-	}
+	particle_pool.step(elapsed_seconds);
 
 	return true;
 }
@@ -1936,23 +1925,24 @@ void WorldSystem::spawn_enemies(float elapsed_seconds) {\
 
 	size_t current_enemy_count = registry.enemies.entities.size();
 
-	const size_t MAX_ENEMIES = 25;
-	if (current_enemy_count >= MAX_ENEMIES)
+	if (current_enemy_count >= max_enemies)
 			return;
+	const int free_slots = (int)(max_enemies - current_enemy_count);
 	
 	// Calculate time in current level
 	float time_in_level_seconds = survival_time_ms / 1000.0f;
 	
 	// Get spawn multiplier from level manager (includes time-based scaling)
 	float spawn_multiplier = level_manager.get_enemy_spawn_multiplier(current_level, time_in_level_seconds);
-	int base_num_enemies = std::min((1 << (wave_count)), (int)(MAX_ENEMIES - current_enemy_count));
+	// waves double in size until the cap; the shift is clamped so long horde runs cannot overflow it
+	int base_num_enemies = std::min(1 << std::min(wave_count, 30), free_slots);
 	int num_enemies = static_cast<int>(base_num_enemies * spawn_multiplier);
-	num_enemies = std::min(num_enemies, (int)(MAX_ENEMIES - current_enemy_count));
+	num_enemies = std::min(num_enemies, free_slots);
 	
 	// Ensure minimum spawn count when respawning due to low visible enemies
 	if (should_respawn) {
 		int min_spawn = 5; // Minimum enemies to spawn when respawning
-		num_enemies = std::max(num_enemies, std::min(min_spawn, (int)(MAX_ENEMIES - current_enemy_count)));
+		num_enemies = std::max(num_enemies, std::min(min_spawn, free_slots));
 	}
 
 	float margin = 50.f;
@@ -2103,6 +2093,8 @@ void WorldSystem::restart_game() {
 	    registry.remove_all_components_of(registry.motions.entities.back());
 	registry.serial_chunks.clear();
 	registry.chunks.clear();
+	renderer->releaseChunkMeshes();
+	particle_pool.clear();
 	
 	while (registry.weapons.entities.size() > 0)
 		registry.remove_all_components_of(registry.weapons.entities.back());
@@ -2178,12 +2170,14 @@ void WorldSystem::restart_game() {
 	this->decorator_seed = (unsigned int) ((float) max_seed * uniform_dist(rng));
 	map_perlin.init(this->map_seed, 4);
 	decorator_perlin.init(this->decorator_seed, 4);
+	chunk_generator.reset(map_perlin, this->decorator_seed);
+	chunk_store.reset(this->map_seed, this->decorator_seed);
 	printf("Generated seeds: %u and %u\n", this->map_seed, this->decorator_seed);
 
 	// generate spawn chunk + chunks visible on start screen
-	generateChunk(renderer, vec2(0, 0), map_perlin, decorator_perlin, rng, true, false);
-	generateChunk(renderer, vec2(-1, 0), map_perlin, decorator_perlin, rng, false, false);
-	generateChunk(renderer, vec2(1, 0), map_perlin, decorator_perlin, rng, false, false);
+	chunk_generator.materialize(renderer, ivec2(0, 0), map_perlin, decorator_perlin, true, false);
+	chunk_generator.materialize(renderer, ivec2(-1, 0), map_perlin, decorator_perlin, false, false);
+	chunk_generator.materialize(renderer, ivec2(1, 0), map_perlin, decorator_perlin, false, false);
 
 	// instead of a constant solid background
 	// created a quad that can be affected by the lighting
@@ -3235,6 +3229,7 @@ void WorldSystem::on_key(int key, int, int action, int mod) {
 		// clear chunks and obstacles
 		registry.serial_chunks.clear();
 		registry.chunks.clear();
+		renderer->releaseChunkMeshes();
 		while (!registry.obstacles.entities.empty()) {
 			Entity obstacle = registry.obstacles.entities.back();
 			registry.remove_all_components_of(obstacle);
@@ -3246,13 +3241,15 @@ void WorldSystem::on_key(int key, int, int action, int mod) {
 		this->decorator_seed = (unsigned int) ((float) max_seed * uniform_dist(rng));
 		map_perlin.init(this->map_seed, 4);
 		decorator_perlin.init(this->decorator_seed, 4);
+		chunk_generator.reset(map_perlin, this->decorator_seed);
+		chunk_store.reset(this->map_seed, this->decorator_seed);
 
 		// re-generate spawn chunk
 		if (registry.motions.has(player_salmon)) {
 			Motion& p_motion = registry.motions.get(player_salmon);
 			float chunk_size = (float) CHUNK_CELL_SIZE * CHUNK_CELLS_PER_ROW;
 			vec2 chunk_pos = vec2(floor(p_motion.position.x / chunk_size), floor(p_motion.position.y / chunk_size));
-			generateChunk(renderer, chunk_pos, map_perlin, decorator_perlin, rng, true, false);
+			chunk_generator.materialize(renderer, ivec2(chunk_pos), map_perlin, decorator_perlin, true, false);
 		}
 		
 	}
@@ -3419,10 +3416,17 @@ void WorldSystem::on_key(int key, int, int action, int mod) {
 		renderer->togglePlayerHitboxDebug();
 	}
 
-	if (action == GLFW_RELEASE && key == GLFW_KEY_F5) {
+	if (action == GLFW_RELEASE && key == GLFW_KEY_F5 && !(mod & GLFW_MOD_CONTROL)) {
 		if (save_system) {
 			save_system->save_game();
-			printf("Game saved!\n");
+			printf("Saving game...\n");
+		}
+	}
+
+	// Export the game as readable JSON with CTRL + F5
+	if (action == GLFW_RELEASE && key == GLFW_KEY_F5 && (mod & GLFW_MOD_CONTROL)) {
+		if (save_system) {
+			save_system->export_json();
 		}
 	}
 
@@ -3937,111 +3941,7 @@ json WorldSystem::serialize() const
 	data["map_seed"] = map_seed;
 	data["decorator_seed"] = decorator_seed;
 
-	data["chunks"] = json::array();
-
-	for (size_t i = 0; i < registry.chunks.components.size(); i++)
-	{
-		Chunk& chunk = registry.chunks.components[i];
-		int x = registry.chunks.position_xs[i];
-		int y = registry.chunks.position_ys[i];
-
-		json chunk_json;
-		chunk_json["x"] = x;
-		chunk_json["y"] = y;
-		chunk_json["decorated"] = true;
-		chunk_json["trees"] = json::array();
-		chunk_json["walls"] = json::array();
-		chunk_json["iso_filters"] = json::array();
-
-		for (Entity tree_entity : chunk.trees)
-		{
-			if (registry.motions.has(tree_entity) && registry.obstacles.has(tree_entity))
-			{
-				Motion& tree_motion = registry.motions.get(tree_entity);
-				json tree_json;
-				tree_json["position"]["x"] = tree_motion.position.x;
-				tree_json["position"]["y"] = tree_motion.position.y;
-				tree_json["scale"] = tree_motion.scale.x;
-				chunk_json["trees"].push_back(tree_json);
-			}
-		}
-		for (Entity wall_entity : chunk.walls)
-		{
-			if (registry.motions.has(wall_entity) && registry.obstacles.has(wall_entity))
-			{
-				Motion& wall_motion = registry.motions.get(wall_entity);
-				json wall_json;
-				wall_json["position"]["x"] = wall_motion.position.x;
-				wall_json["position"]["y"] = wall_motion.position.y;
-				wall_json["scale"]["x"] = wall_motion.scale.x;
-				wall_json["scale"]["y"] = wall_motion.scale.y;
-				chunk_json["walls"].push_back(wall_json);
-			}
-		}
-		for (const IsolineFilter& iso_filter : chunk.iso_filters)
-		{
-			json iso_filter_json;
-			iso_filter_json["reconstruct_upper"] = iso_filter.reconstruct_upper;
-			iso_filter_json["reconstruct_lower"] = iso_filter.reconstruct_lower;
-			iso_filter_json["reconstruct_left"] = iso_filter.reconstruct_left;
-			iso_filter_json["reconstruct_right"] = iso_filter.reconstruct_right;
-			iso_filter_json["upper_left_cell"]["x"] = iso_filter.upper_left_cell.x;
-			iso_filter_json["upper_left_cell"]["y"] = iso_filter.upper_left_cell.y;
-			iso_filter_json["lower_right_cell"]["x"] = iso_filter.lower_right_cell.x;
-			iso_filter_json["lower_right_cell"]["y"] = iso_filter.lower_right_cell.y;
-			chunk_json["iso_filters"].push_back(iso_filter_json);
-		}
-
-		data["chunks"].push_back(chunk_json);
-	}
-
-	for (size_t i = 0; i < registry.serial_chunks.components.size(); i++)
-	{
-		SerializedChunk& chunk = registry.serial_chunks.components[i];
-		int x = registry.serial_chunks.position_xs[i];
-		int y = registry.serial_chunks.position_ys[i];
-
-		json chunk_json;
-		chunk_json["x"] = x;
-		chunk_json["y"] = y;
-		chunk_json["decorated"] = chunk.decorated;
-		chunk_json["trees"] = json::array();
-		chunk_json["walls"] = json::array();
-		chunk_json["iso_filters"] = json::array();
-
-		for (const SerializedTree& tree : chunk.serial_trees)
-		{
-			json tree_json;
-			tree_json["position"]["x"] = tree.position.x;
-			tree_json["position"]["y"] = tree.position.y;
-			tree_json["scale"] = tree.scale;
-			chunk_json["trees"].push_back(tree_json);
-		}
-		for (const SerializedWall& wall : chunk.serial_walls)
-		{
-			json wall_json;
-			wall_json["position"]["x"] = wall.position.x;
-			wall_json["position"]["y"] = wall.position.y;
-			wall_json["scale"]["x"] = wall.scale.x;
-			wall_json["scale"]["y"] = wall.scale.y;
-			chunk_json["walls"].push_back(wall_json);
-		}
-		for (const IsolineFilter& iso_filter : chunk.iso_filters)
-		{
-			json iso_filter_json;
-			iso_filter_json["reconstruct_upper"] = iso_filter.reconstruct_upper;
-			iso_filter_json["reconstruct_lower"] = iso_filter.reconstruct_lower;
-			iso_filter_json["reconstruct_left"] = iso_filter.reconstruct_left;
-			iso_filter_json["reconstruct_right"] = iso_filter.reconstruct_right;
-			iso_filter_json["upper_left_cell"]["x"] = iso_filter.upper_left_cell.x;
-			iso_filter_json["upper_left_cell"]["y"] = iso_filter.upper_left_cell.y;
-			iso_filter_json["lower_right_cell"]["x"] = iso_filter.lower_right_cell.x;
-			iso_filter_json["lower_right_cell"]["y"] = iso_filter.lower_right_cell.y;
-			chunk_json["iso_filters"].push_back(iso_filter_json);
-		}
-
-		data["chunks"].push_back(chunk_json);
-	}
+	data["chunks"] = serialize_chunks();
 
 	printf("Saved %zu active chunks + %zu serialized chunks = %zu total\n",
 	       registry.chunks.components.size(),
@@ -4197,104 +4097,19 @@ void WorldSystem::deserialize(const json& data)
 
 	if (data.contains("map_seed") && data.contains("decorator_seed"))
 	{
-		map_seed = data["map_seed"];
-		decorator_seed = data["decorator_seed"];
-		map_perlin.init(map_seed, 4);
-		decorator_perlin.init(decorator_seed, 4);
-		printf("Loaded seeds: %u and %u\n", map_seed, decorator_seed);
+		restore_seeds(data["map_seed"], data["decorator_seed"]);
 	}
 
 	if (data.contains("chunks"))
 	{
-		registry.serial_chunks.clear();
-		registry.chunks.clear();
-
-		while (!registry.obstacles.entities.empty())
-		{
-			Entity obstacle = registry.obstacles.entities.back();
-			registry.remove_all_components_of(obstacle);
-		}
-
-		for (const auto& chunk_json : data["chunks"])
-		{
-			int x = chunk_json["x"];
-			int y = chunk_json["y"];
-
-			// Skip if chunk already exists to handle duplicates in save file
-			if (registry.serial_chunks.has(x, y)) {
-				continue;
-			}
-
-			SerializedChunk& chunk = registry.serial_chunks.emplace(x, y);
-			chunk.serial_trees.clear();
-			chunk.serial_walls.clear();
-			chunk.iso_filters.clear();
-
-			if (chunk_json.contains("decorated")) {
-				chunk.decorated = chunk_json["decorated"];
-			} else {
-				chunk.decorated = true;
-			}
-
-			for (const auto& tree_json : chunk_json["trees"])
-			{
-				SerializedTree tree;
-				tree.position.x = tree_json["position"]["x"];
-				tree.position.y = tree_json["position"]["y"];
-				tree.scale = tree_json["scale"];
-				chunk.serial_trees.push_back(tree);
-			}
-
-			if (chunk_json.contains("walls")) {
-				for (const auto& wall_json : chunk_json["walls"])
-				{
-					SerializedWall wall;
-					wall.position.x = wall_json["position"]["x"];
-					wall.position.y = wall_json["position"]["y"];
-					wall.scale.x = wall_json["scale"]["x"];
-					wall.scale.y = wall_json["scale"]["y"];
-					chunk.serial_walls.push_back(wall);
-				}
-			}
-			if (chunk_json.contains("iso_filters")) {
-				for (const auto& iso_filter_json : chunk_json["iso_filters"])
-				{
-					IsolineFilter iso_filter;
-					iso_filter.reconstruct_upper = iso_filter_json["reconstruct_upper"];
-					iso_filter.reconstruct_lower = iso_filter_json["reconstruct_lower"];
-					iso_filter.reconstruct_left = iso_filter_json["reconstruct_left"];
-					iso_filter.reconstruct_right = iso_filter_json["reconstruct_right"];
-					iso_filter.upper_left_cell.x = iso_filter_json["upper_left_cell"]["x"];
-					iso_filter.upper_left_cell.y = iso_filter_json["upper_left_cell"]["y"];
-					iso_filter.lower_right_cell.x = iso_filter_json["lower_right_cell"]["x"];
-					iso_filter.lower_right_cell.y = iso_filter_json["lower_right_cell"]["y"];
-					chunk.iso_filters.push_back(iso_filter);
-				}
-			}
-		}
-
-		printf("Loaded %zu chunks, cleared active chunks and obstacles\n", registry.serial_chunks.components.size());
-
-		// ensure that spawn chunk is regenerated as a spawn chunk
-		generateChunk(renderer, vec2(0, 0), map_perlin, decorator_perlin, rng, true, false);
+		clear_saved_chunks();
+		deserialize_chunks(data["chunks"]);
+		finish_chunk_restore();
 	}
 
 	if (data.contains("inventory"))
 	{
-		Entity player_entity = registry.players.entities[0];
-		if (registry.inventories.has(player_entity))
-		{
-			registry.inventories.remove(player_entity);
-		}
-
-		while (!registry.weapons.entities.empty())
-		{
-			registry.remove_all_components_of(registry.weapons.entities.back());
-		}
-		while (!registry.armours.entities.empty())
-		{
-			registry.remove_all_components_of(registry.armours.entities.back());
-		}
+		clear_inventory_items();
 
 		if (data["inventory"].contains("weapons"))
 		{
@@ -4348,17 +4163,7 @@ void WorldSystem::deserialize(const json& data)
 			}
 		}
 
-		printf("Loaded %zu weapons and %zu armours\n",
-		       registry.weapons.entities.size(),
-		       registry.armours.entities.size());
-
-		if (inventory_system && registry.players.entities.size() > 0)
-		{
-			inventory_system->init_player_inventory(player_entity);
-			printf("Reinitialized player inventory UI\n");
-			// Update cursor based on loaded equipped weapon
-			update_crosshair_cursor();
-		}
+		finish_inventory_restore();
 	}
 
 	if (data.contains("level"))
@@ -4392,16 +4197,7 @@ void WorldSystem::deserialize(const json& data)
 				circle_bonfire_positions.push_back(pos);
 			}
 		}
-		printf("Restored level state: level %d, circle %d, radius %.1f, %zu bonfire positions\n",
-		       current_level,
-		       level_manager.get_circle_count(),
-		       level_manager.get_spawn_radius(),
-		       circle_bonfire_positions.size());
-
-		if (objectives_system)
-		{
-			objectives_system->set_circle_level(level_manager.get_circle_count());
-		}
+		finish_level_restore();
 	}
 
 	if (data.contains("objectives"))
@@ -4425,33 +4221,13 @@ void WorldSystem::deserialize(const json& data)
 			vec2 bonfire_pos;
 			bonfire_pos.x = data["bonfire"]["position"]["x"];
 			bonfire_pos.y = data["bonfire"]["position"]["y"];
-			bonfire_entity = createBonfire(renderer, bonfire_pos);
-			bonfire_exists = true;
-			bonfire_spawned = true;
 
 			bool is_active = true;
 			if (data["bonfire"].contains("is_active")) {
 				is_active = data["bonfire"]["is_active"].get<bool>();
 			}
 
-			if (!is_active && registry.renderRequests.has(bonfire_entity)) {
-				RenderRequest& req = registry.renderRequests.get(bonfire_entity);
-				req.used_texture = TEXTURE_ASSET_ID::BONFIRE_OFF;
-				if (registry.lights.has(bonfire_entity)) {
-					registry.lights.get(bonfire_entity).is_enabled = false;
-				}
-			}
-
-			if (is_active) {
-				if (arrow_exists && registry.motions.has(arrow_entity)) {
-					registry.remove_all_components_of(arrow_entity);
-					arrow_exists = false;
-				}
-				arrow_entity = createArrow(renderer);
-				arrow_exists = true;
-			}
-
-			printf("Restored bonfire at (%.1f, %.1f), active: %s\n", bonfire_pos.x, bonfire_pos.y, is_active ? "yes" : "no");
+			restore_bonfire(bonfire_pos, is_active);
 		}
 	}
 
@@ -4469,3 +4245,402 @@ void WorldSystem::deserialize(const json& data)
 		}
 	}
 }
+
+void WorldSystem::restore_seeds(unsigned int map_seed_arg, unsigned int decorator_seed_arg)
+{
+	map_seed = map_seed_arg;
+	decorator_seed = decorator_seed_arg;
+	map_perlin.init(map_seed, 4);
+	decorator_perlin.init(decorator_seed, 4);
+	chunk_generator.reset(map_perlin, decorator_seed);
+	chunk_store.reset(map_seed, decorator_seed);
+	printf("Loaded seeds: %u and %u\n", map_seed, decorator_seed);
+}
+
+void WorldSystem::clear_saved_chunks()
+{
+	registry.serial_chunks.clear();
+	registry.chunks.clear();
+	renderer->releaseChunkMeshes();
+
+	while (!registry.obstacles.entities.empty())
+	{
+		Entity obstacle = registry.obstacles.entities.back();
+		registry.remove_all_components_of(obstacle);
+	}
+}
+
+void WorldSystem::finish_chunk_restore()
+{
+	printf("Loaded %zu chunks, cleared active chunks and obstacles\n", registry.serial_chunks.components.size());
+
+	// ensure that spawn chunk is regenerated as a spawn chunk
+	chunk_generator.materialize(renderer, ivec2(0, 0), map_perlin, decorator_perlin, true, false);
+}
+
+void WorldSystem::clear_inventory_items()
+{
+	Entity player_entity = registry.players.entities[0];
+	if (registry.inventories.has(player_entity))
+	{
+		registry.inventories.remove(player_entity);
+	}
+
+	while (!registry.weapons.entities.empty())
+	{
+		registry.remove_all_components_of(registry.weapons.entities.back());
+	}
+	while (!registry.armours.entities.empty())
+	{
+		registry.remove_all_components_of(registry.armours.entities.back());
+	}
+}
+
+void WorldSystem::finish_inventory_restore()
+{
+	printf("Loaded %zu weapons and %zu armours\n",
+	       registry.weapons.entities.size(),
+	       registry.armours.entities.size());
+
+	if (inventory_system && registry.players.entities.size() > 0)
+	{
+		inventory_system->init_player_inventory(registry.players.entities[0]);
+		printf("Reinitialized player inventory UI\n");
+		// Update cursor based on loaded equipped weapon
+		update_crosshair_cursor();
+	}
+}
+
+void WorldSystem::finish_level_restore()
+{
+	printf("Restored level state: level %d, circle %d, radius %.1f, %zu bonfire positions\n",
+	       current_level,
+	       level_manager.get_circle_count(),
+	       level_manager.get_spawn_radius(),
+	       circle_bonfire_positions.size());
+
+	if (objectives_system)
+	{
+		objectives_system->set_circle_level(level_manager.get_circle_count());
+	}
+}
+
+void WorldSystem::restore_bonfire(vec2 position, bool is_active)
+{
+	bonfire_entity = createBonfire(renderer, position);
+	bonfire_exists = true;
+	bonfire_spawned = true;
+
+	if (!is_active && registry.renderRequests.has(bonfire_entity)) {
+		RenderRequest& req = registry.renderRequests.get(bonfire_entity);
+		req.used_texture = TEXTURE_ASSET_ID::BONFIRE_OFF;
+		if (registry.lights.has(bonfire_entity)) {
+			registry.lights.get(bonfire_entity).is_enabled = false;
+		}
+	}
+
+	if (is_active) {
+		if (arrow_exists && registry.motions.has(arrow_entity)) {
+			registry.remove_all_components_of(arrow_entity);
+			arrow_exists = false;
+		}
+		arrow_entity = createArrow(renderer);
+		arrow_exists = true;
+	}
+
+	printf("Restored bonfire at (%.1f, %.1f), active: %s\n", position.x, position.y, is_active ? "yes" : "no");
+}
+
+void WorldSystem::write_save(SaveWriter& out) const
+{
+	if (registry.players.entities.size() > 0)
+	{
+		Entity player_entity = registry.players.entities[0];
+		out.begin_section(SaveSection::PLAYER);
+
+		const bool has_motion = registry.motions.has(player_entity);
+		out.write_bool(has_motion);
+		if (has_motion)
+		{
+			Motion& motion = registry.motions.get(player_entity);
+			out.write_vec2(motion.position);
+			out.write_f32(motion.angle);
+		}
+
+		Player& player = registry.players.get(player_entity);
+		out.write_f32(player.health);
+		out.write_f32(player.max_health);
+		out.write_i32(player.armour);
+		out.write_i32(player.max_armour);
+		out.write_i32(player.currency);
+		out.write_i32(player.magazine_size);
+		out.write_i32(player.ammo_in_mag);
+
+		const bool has_upgrades = registry.playerUpgrades.has(player_entity);
+		out.write_bool(has_upgrades);
+		if (has_upgrades)
+		{
+			PlayerUpgrades& upgrades = registry.playerUpgrades.get(player_entity);
+			out.write_i32(upgrades.movement_speed_level);
+			out.write_i32(upgrades.max_health_level);
+			out.write_i32(upgrades.armour_level);
+			out.write_i32(upgrades.light_radius_level);
+			out.write_i32(upgrades.dash_cooldown_level);
+			out.write_i32(upgrades.health_regen_level);
+			out.write_i32(upgrades.crit_chance_level);
+			out.write_i32(upgrades.life_steal_level);
+			out.write_i32(upgrades.flashlight_width_level);
+			out.write_i32(upgrades.flashlight_damage_level);
+			out.write_i32(upgrades.flashlight_slow_level);
+			out.write_i32(upgrades.xylarite_multiplier_level);
+		}
+		out.end_section();
+	}
+
+	out.begin_section(SaveSection::WORLD);
+	out.write_u32(map_seed);
+	out.write_u32(decorator_seed);
+	out.end_section();
+
+	write_chunk_sections(out);
+	printf("Saved %zu active chunks + %zu serialized chunks\n",
+	       registry.chunks.components.size(),
+	       registry.serial_chunks.components.size());
+
+	out.begin_section(SaveSection::INVENTORY);
+	out.write_u32((uint32_t)registry.weapons.entities.size());
+	for (Entity weapon_entity : registry.weapons.entities)
+	{
+		Weapon& weapon = registry.weapons.get(weapon_entity);
+		out.write_i32(static_cast<int>(weapon.type));
+		out.write_string(weapon.name);
+		out.write_string(weapon.description);
+		out.write_i32(weapon.damage);
+		out.write_i32(weapon.price);
+		out.write_bool(weapon.owned);
+		out.write_bool(weapon.equipped);
+		out.write_i32(static_cast<int>(weapon.rarity));
+		out.write_f32(weapon.fire_rate_rpm);
+
+		WeaponUpgrades upgrades;
+		if (registry.weaponUpgrades.has(weapon_entity))
+			upgrades = registry.weaponUpgrades.get(weapon_entity);
+		out.write_i32(upgrades.fire_rate_level);
+		out.write_i32(upgrades.damage_level);
+		out.write_i32(upgrades.ammo_capacity_level);
+		out.write_i32(upgrades.reload_time_level);
+	}
+	out.write_u32((uint32_t)registry.armours.entities.size());
+	for (Entity armour_entity : registry.armours.entities)
+	{
+		armour& armour = registry.armours.get(armour_entity);
+		out.write_i32(static_cast<int>(armour.type));
+		out.write_string(armour.name);
+		out.write_string(armour.description);
+		out.write_i32(armour.defense);
+		out.write_i32(armour.price);
+		out.write_bool(armour.owned);
+		out.write_bool(armour.equipped);
+		out.write_i32(static_cast<int>(armour.rarity));
+	}
+	out.end_section();
+
+	out.begin_section(SaveSection::LEVEL);
+	out.write_i32(level_manager.get_circle_count());
+	out.write_f32(level_manager.get_spawn_radius());
+	out.write_i32(current_level);
+	out.write_vec2(initial_spawn_position);
+	out.write_u32((uint32_t)circle_bonfire_positions.size());
+	for (const vec2& pos : circle_bonfire_positions)
+		out.write_vec2(pos);
+
+	out.write_f32(survival_time_ms);
+	out.write_i32(kill_count);
+
+	const bool save_bonfire = bonfire_exists && registry.motions.has(bonfire_entity);
+	out.write_bool(save_bonfire);
+	if (save_bonfire)
+	{
+		out.write_vec2(registry.motions.get(bonfire_entity).position);
+		out.write_bool(!registry.renderRequests.has(bonfire_entity) ||
+			registry.renderRequests.get(bonfire_entity).used_texture == TEXTURE_ASSET_ID::BONFIRE);
+	}
+
+	out.write_bool(tutorial_system && tutorial_system->is_active());
+	out.write_i32(tutorial_system ? tutorial_system->get_current_step() : 0);
+	out.end_section();
+}
+
+void WorldSystem::read_save(SaveReader& in)
+{
+	bool chunks_cleared = false;
+	bool chunks_pending = false;
+	for (SaveSection section = in.next_section(); section != SaveSection::END; section = in.next_section())
+	{
+		// regenerate the spawn chunk once the chunk sections are through, before anything else loads
+		if (chunks_pending && section != SaveSection::CHUNKS && section != SaveSection::SERIAL_CHUNKS)
+		{
+			finish_chunk_restore();
+			chunks_pending = false;
+		}
+
+		switch (section)
+		{
+		case SaveSection::PLAYER:
+		{
+			if (registry.players.entities.size() == 0)
+				break;
+			Entity player_entity = registry.players.entities[0];
+
+			if (in.read_bool())
+			{
+				vec2 position = in.read_vec2();
+				float angle = in.read_f32();
+				if (registry.motions.has(player_entity))
+				{
+					Motion& motion = registry.motions.get(player_entity);
+					motion.position = position;
+					motion.angle = angle;
+				}
+			}
+
+			Player& player = registry.players.get(player_entity);
+			player.health = in.read_f32();
+			player.max_health = in.read_f32();
+			player.armour = in.read_i32();
+			player.max_armour = in.read_i32();
+			player.currency = in.read_i32();
+			player.magazine_size = in.read_i32();
+			player.ammo_in_mag = in.read_i32();
+
+			if (in.read_bool())
+			{
+				if (!registry.playerUpgrades.has(player_entity))
+				{
+					registry.playerUpgrades.emplace(player_entity);
+				}
+				PlayerUpgrades& upgrades = registry.playerUpgrades.get(player_entity);
+				upgrades.movement_speed_level = in.read_i32();
+				upgrades.max_health_level = in.read_i32();
+				upgrades.armour_level = in.read_i32();
+				upgrades.light_radius_level = in.read_i32();
+				upgrades.dash_cooldown_level = in.read_i32();
+				upgrades.health_regen_level = in.read_i32();
+				upgrades.crit_chance_level = in.read_i32();
+				upgrades.life_steal_level = in.read_i32();
+				upgrades.flashlight_width_level = in.read_i32();
+				upgrades.flashlight_damage_level = in.read_i32();
+				upgrades.flashlight_slow_level = in.read_i32();
+				upgrades.xylarite_multiplier_level = in.read_i32();
+			}
+			break;
+		}
+		case SaveSection::WORLD:
+		{
+			unsigned int map_seed_arg = in.read_u32();
+			restore_seeds(map_seed_arg, in.read_u32());
+			break;
+		}
+		case SaveSection::CHUNKS:
+		case SaveSection::SERIAL_CHUNKS:
+		case SaveSection::REGIONS:
+			if (!chunks_cleared)
+			{
+				clear_saved_chunks();
+				chunks_cleared = true;
+			}
+			// region chunks are paged in from the files of the seeds just restored, through the
+			// offset tables the save kept
+			if (section == SaveSection::REGIONS)
+				chunk_store.read_tables(in);
+			else
+				read_chunk_section(in);
+			chunks_pending = true;
+			break;
+		case SaveSection::INVENTORY:
+		{
+			if (registry.players.entities.size() == 0)
+				break;
+			clear_inventory_items();
+
+			// type, two empty strings, damage, price, owned, equipped, rarity, rate, four upgrade levels
+			const uint32_t weapon_count = in.read_count(46);
+			for (uint32_t i = 0; i < weapon_count; i++)
+			{
+				Entity weapon_entity = Entity();
+				Weapon& weapon = registry.weapons.emplace(weapon_entity);
+				weapon.type = static_cast<WeaponType>(in.read_i32());
+				weapon.name = in.read_string();
+				weapon.description = in.read_string();
+				weapon.damage = in.read_i32();
+				weapon.price = in.read_i32();
+				weapon.owned = in.read_bool();
+				weapon.equipped = in.read_bool();
+				weapon.rarity = static_cast<ItemRarity>(in.read_i32());
+				weapon.fire_rate_rpm = in.read_f32();
+
+				WeaponUpgrades& upgrades = registry.weaponUpgrades.emplace(weapon_entity);
+				upgrades.fire_rate_level = in.read_i32();
+				upgrades.damage_level = in.read_i32();
+				upgrades.ammo_capacity_level = in.read_i32();
+				upgrades.reload_time_level = in.read_i32();
+			}
+
+			// type, two empty strings, defense, price, owned, equipped, rarity
+			const uint32_t armour_count = in.read_count(26);
+			for (uint32_t i = 0; i < armour_count; i++)
+			{
+				Entity armour_entity = Entity();
+				armour& armour = registry.armours.emplace(armour_entity);
+				armour.type = static_cast<armourType>(in.read_i32());
+				armour.name = in.read_string();
+				armour.description = in.read_string();
+				armour.defense = in.read_i32();
+				armour.price = in.read_i32();
+				armour.owned = in.read_bool();
+				armour.equipped = in.read_bool();
+				armour.rarity = static_cast<ItemRarity>(in.read_i32());
+			}
+
+			finish_inventory_restore();
+			break;
+		}
+		case SaveSection::LEVEL:
+		{
+			level_manager.set_circle_count(in.read_i32());
+			level_manager.set_spawn_radius(in.read_f32());
+			current_level = in.read_i32();
+			update_level_display();
+			initial_spawn_position = in.read_vec2();
+			circle_bonfire_positions.resize(in.read_count(8));
+			for (vec2& pos : circle_bonfire_positions)
+				pos = in.read_vec2();
+			finish_level_restore();
+
+			survival_time_ms = in.read_f32();
+			kill_count = in.read_i32();
+			printf("Restored objectives: %.1fs survival, %d kills\n",
+			       survival_time_ms / 1000.0f, kill_count);
+
+			if (in.read_bool())
+			{
+				vec2 bonfire_pos = in.read_vec2();
+				restore_bonfire(bonfire_pos, in.read_bool());
+			}
+
+			// the tutorial is hidden after any load, whatever its state was
+			in.read_bool();
+			in.read_i32();
+			if (tutorial_system)
+				tutorial_system->skip_tutorial();
+			break;
+		}
+		default:
+			// written by a newer version; next_section() skips it
+			break;
+		}
+	}
+
+	if (chunks_pending)
+		finish_chunk_restore();
+}
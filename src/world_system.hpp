@@ -23,6 +23,7 @@ using json = nlohmann::json;
 #include "menu_icons_system.hpp"
 #include "health_system.hpp"
 #include "noise_gen.hpp"
+#include "chunk_generator.hpp"
 #include "level_manager.hpp"
 
 // Forward declaration
@@ -30,6 +31,12 @@ class AISystem;
 class StartMenuSystem;
 class SaveSystem;
 class DeathScreenSystem;
+class SaveWriter;
+class SaveReader;
+
+// Live enemy cap of a normal run, and the default cap of horde mode (--horde)
+const size_t DEFAULT_MAX_ENEMIES = 25;
+const size_t HORDE_MAX_ENEMIES = 2000;
 
 // Container for all our entities and game logic. Individual rendering / update is
 // deferred to the relative update() methods
@@ -74,6 +81,10 @@ public:
 
 	// Should the game be over ?
 	bool is_over()const;
+
+	// Most enemies spawn_enemies keeps alive at once
+	void set_max_enemies(size_t count) { max_enemies = count; }
+	size_t get_max_enemies() const { return max_enemies; }
 	
 	// Exit bonfire mode (called when inventory is closed)
 	void exit_bonfire_mode();
@@ -87,9 +98,14 @@ public:
 
 	void update_crosshair_cursor();
 
+	// JSON save, kept as the readable debug export
 	json serialize() const;
 	void deserialize(const json& data);
 
+	// Binary save: every section after the header, in SaveSection order
+	void write_save(SaveWriter& out) const;
+	void read_save(SaveReader& in);
+
 	// hurt knockback system (from enemy collisions)
 	bool is_hurt_knockback;
 	float hurt_knockback_timer;
@@ -118,6 +134,15 @@ private:
 
 	void play_hud_intro();
 
+	// Load steps shared by deserialize() and read_save()
+	void restore_seeds(unsigned int map_seed_arg, unsigned int decorator_seed_arg);
+	void clear_saved_chunks();
+	void finish_chunk_restore();
+	void clear_inventory_items();
+	void finish_inventory_restore();
+	void finish_level_restore();
+	void restore_bonfire(vec2 position, bool is_active);
+
 	// OpenGL window handle
 	GLFWwindow* window;
 	
@@ -189,6 +214,7 @@ private:
 	float spawn_timer = 0.0f;
 	float wave_timer = 0.0f;
 	int wave_count = 0;
+	size_t max_enemies = DEFAULT_MAX_ENEMIES;
 	
 	// Level tracking - separate from waves
 	int current_level = 1;
@@ -204,6 +230,7 @@ private:
 	PerlinNoiseGenerator decorator_perlin;
 	unsigned int map_seed = 0;
 	unsigned int decorator_seed = 0;
+	ChunkGenerator chunk_generator;
 
 	// Objectives tracking
 	float survival_time_ms = 0.f;